@@ -27,7 +27,10 @@
 
     This file contains the implementation of IPC tool to communicate with BOT
     server. The IPC tool first parsed the input arguments which users specify 
-    and then sends command packets to BOT server via UDP protocol.
+    and then sends command packets to BOT server via UDP protocol. With 
+    option -l, the request is sent through the local control channel of BOT 
+    server instead, and the response of BOT server is printed. The control 
+    channel is a named pipe on Windows and a Unix domain socket elsewhere.
 
   Authors:
 
@@ -69,6 +72,169 @@ void display_usage(){
     printf("\n");
     printf("-a: specify the area_id to reload settings\n");
     printf("\n");
+    printf("-l: send the request through the local control channel and " \
+           "print the response. Option -p is not needed. The supported " \
+           "requests are:\n");
+    printf("    %s: reload settings specified by options -c, -r, -f and -a\n",
+           ControlRequest_String[0]);
+    printf("    %s : show statistics of the server\n", 
+           ControlRequest_String[1]);
+    printf("    %s : summarize pending tracking data immediately\n", 
+           ControlRequest_String[2]);
+    printf("    %s : show the number of objects in each area, room and " \
+           "object type\n", 
+           ControlRequest_String[3]);
+    printf("    %s : show the flow control level and the counters of " \
+           "each gateway\n", 
+           ControlRequest_String[4]);
+    printf("    %s : show the event-time watermark and the late rows of " \
+           "each gateway\n", 
+           ControlRequest_String[5]);
+    printf("    %s : measure the throughput of a shared ring in records " \
+           "per second\n", 
+           ControlRequest_String[6]);
+    printf("    %s : show the time spent in each processing stage\n", 
+           ControlRequest_String[7]);
+    printf("    %s : measure the strategies of writing tracking data " \
+           "into the database, or show the progress of the running " \
+           "measurement\n", 
+           ControlRequest_String[8]);
+    printf("\n");
+    printf("-i: specify the server process to send the request of option " \
+           "-l to. The supported values are:\n");
+    printf("    %s      : the server process doing all work (default)\n", 
+           ControlInstance_String[0]);
+    printf("    %s   : the ingest process of a split server\n", 
+           ControlInstance_String[1]);
+    printf("    %s: the analytics process of a split server\n", 
+           ControlInstance_String[2]);
+    printf("    Elsewhere than Windows, run the tool in the installation " \
+           "directory of the server.\n");
+    printf("\n");
+}
+
+#ifdef _WIN32
+
+int call_control_channel(char *instance_name, 
+                         char *request, 
+                         char *response, 
+                         int response_len){
+
+    char pipe_name[LENGTH_OF_CONTROL_CHANNEL_ENDPOINT];
+    DWORD received_len = 0;
+
+    memset(pipe_name, 0, sizeof(pipe_name));
+    sprintf(pipe_name, CONTROL_CHANNEL_PIPE_NAME, instance_name);
+
+    if(!CallNamedPipe(pipe_name,
+                      request,
+                      strlen(request),
+                      response,
+                      response_len - 1,
+                      &received_len,
+                      CONTROL_CHANNEL_TIMEOUT_IN_MS)){
+        printf("control channel [%s] is not available, error=[%d]\n", 
+               pipe_name, GetLastError());
+        return -1;
+    }
+
+    return 0;
+}
+
+#else
+
+int call_control_channel(char *instance_name, 
+                         char *request, 
+                         char *response, 
+                         int response_len){
+
+    struct sockaddr_un address;
+    struct timeval timeout;
+    int control_socket = -1;
+    int received_len = 0;
+    int total_len = 0;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    sprintf(address.sun_path, CONTROL_CHANNEL_SOCKET_PATH, instance_name);
+
+    control_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(control_socket < 0){
+        printf("create control socket failed, error=[%s]\n", 
+               strerror(errno));
+        return -1;
+    }
+
+    /* Give up instead of waiting forever for a server which hangs */
+    timeout.tv_sec = CONTROL_CHANNEL_TIMEOUT_IN_MS / 1000;
+    timeout.tv_usec = (CONTROL_CHANNEL_TIMEOUT_IN_MS % 1000) * 1000;
+    setsockopt(control_socket, SOL_SOCKET, SO_RCVTIMEO, 
+               (char *)&timeout, sizeof(timeout));
+    setsockopt(control_socket, SOL_SOCKET, SO_SNDTIMEO, 
+               (char *)&timeout, sizeof(timeout));
+
+    if(connect(control_socket, 
+               (struct sockaddr *)&address, 
+               sizeof(address)) < 0 ||
+       send(control_socket, request, strlen(request), 0) < 0){
+
+        printf("control channel [%s] is not available, error=[%s]\n", 
+               address.sun_path, strerror(errno));
+        close(control_socket);
+        return -1;
+    }
+
+    /* The server closes the connection after it sends the response */
+    while(total_len < response_len - 1){
+
+        received_len = recv(control_socket, 
+                            response + total_len, 
+                            response_len - 1 - total_len, 
+                            0);
+        if(received_len <= 0){
+            break;
+        }
+        total_len += received_len;
+    }
+
+    close(control_socket);
+
+    if(0 == total_len){
+        printf("control channel [%s] sent no response\n", address.sun_path);
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif
+
+int send_control_request(char *instance_name, 
+                         char *request, 
+                         int verbose_mode){
+
+    char response[CONTROL_MESSAGE_LENGTH];
+
+    if(verbose_mode){
+        printf("control request = [%s]\n", request);
+    }
+
+    memset(response, 0, sizeof(response));
+
+    if(0 != call_control_channel(instance_name, 
+                                 request, 
+                                 response, 
+                                 sizeof(response))){
+        return -1;
+    }
+
+    printf("%s\n", response);
+
+    if(strncmp(response, "ok", strlen("ok")) != 0){
+        return -1;
+    }
+
+    return 0;
 }
 
 int main(int argc, char **argv)
@@ -94,10 +260,15 @@ int main(int argc, char **argv)
     struct sockaddr_in si_send;
     char message_content[WIFI_MESSAGE_LENGTH];
 
+    char *control_request = NULL;
+    char control_content[CONTROL_MESSAGE_LENGTH];
+    char *control_instance_name = (char *)ControlInstanceName_String[0];
+    int is_valid_instance = 0;
+
     int verbose_mode = 0;
     
     /* Parse user input of IPC command */
-    while((ch = getopt(argc, argv, "p:c:r:f:a:vh")) != -1){
+    while((ch = getopt(argc, argv, "p:c:r:f:a:l:i:vh")) != -1){
         switch(ch){
             case 'p':
                 server_port = atoi(optarg);
@@ -131,6 +302,27 @@ int main(int argc, char **argv)
             case 'a':
                 area_id = atoi(optarg);
                 break;
+            case 'l':
+                control_request = optarg;
+                break;
+            case 'i':
+                is_valid_instance = 0;
+                for(i = 0; 
+                    i < sizeof(ControlInstance_String) / sizeof(char *); 
+                    i++){
+                    if(strcmp(optarg, ControlInstance_String[i]) == 0){
+                        control_instance_name = 
+                            (char *)ControlInstanceName_String[i];
+                        is_valid_instance = 1;
+                        break;
+                    }
+                }
+                if(!is_valid_instance){
+                    printf("invalid argument: option -i, " \
+                           "use option -h to see the usage.\n");
+                    return -1;
+                }
+                break;
             case 'v':
                 verbose_mode = 1;
                 break;
@@ -144,6 +336,57 @@ int main(int argc, char **argv)
         }
     }
 
+    /* Send the request through the local control channel */
+    if(control_request != NULL){
+
+        memset(control_content, 0, sizeof(control_content));
+
+        if(strcmp(control_request, ControlRequest_String[0]) == 0){
+
+            if(command != CMD_RELOAD_GEO_FENCE_SETTING && 
+               command != CMD_RELOAD_MONITOR_SETTING){
+                printf("invalid argument: option -c, " \
+                       "use option -h to see the usage.\n");
+                return -1;
+            }
+
+            if(area_scope == AREA_ONE){
+                sprintf(control_content, "%s;%d;%d;%d;%d;", 
+                        control_request,
+                        command,
+                        geofence_setting,
+                        area_scope,
+                        area_id);
+            }else{
+                sprintf(control_content, "%s;%d;%d;%d;", 
+                        control_request,
+                        command,
+                        geofence_setting,
+                        area_scope);
+            }
+
+        }else if(strcmp(control_request, ControlRequest_String[1]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[2]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[3]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[4]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[5]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[6]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[7]) == 0 ||
+                 strcmp(control_request, ControlRequest_String[8]) == 0){
+
+            sprintf(control_content, "%s;", control_request);
+
+        }else{
+            printf("invalid argument: option -l, " \
+                   "use option -h to see the usage.\n");
+            return -1;
+        }
+
+        return send_control_request(control_instance_name,
+                                    control_content, 
+                                    verbose_mode);
+    }
+
     /* Prepare IPC command to be sent */
     memset(message_content, 0, sizeof(message_content));
 
@@ -201,10 +444,12 @@ int main(int argc, char **argv)
         printf("IPC message content = [%s]\n", message_content);
     }
 
+#ifdef _WIN32
     sockVersion = MAKEWORD(2,2);
 
     if(WSAStartup(sockVersion, &wsaData) != 0)
          return -1;
+#endif
 
     /* create a send UDP socket */
     if ((send_socket = 
@@ -226,8 +471,12 @@ int main(int argc, char **argv)
         if(verbose_mode){
             printf("sendto error.[%s]\n", strerror(errno));
         }
+#ifdef _WIN32
         closesocket(send_socket);
         WSACleanup();
+#else
+        close(send_socket);
+#endif
         return -1;
 
     }else{
@@ -236,8 +485,12 @@ int main(int argc, char **argv)
         }
     }
 
+#ifdef _WIN32
     closesocket(send_socket);
     WSACleanup();
+#else
+    close(send_socket);
+#endif
 
 	return 0;
 }
@@ -38,10 +38,20 @@
 
 #include "getopt.h"
 
+#ifdef _WIN32
 #include <winsock2.h>
 #include <windows.h>
 #pragma comment(lib,"WS2_32.lib")
 #include <WS2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
 
 #include "Common.h"
 
@@ -49,6 +59,68 @@
 BOT server installed on the same machine. */
 #define LOCAL_SERVER_IP "127.0.0.1"
 
+/* Name of the named pipe of the local control channel of BOT server on 
+Windows. The %s is the instance name of the server process. */
+#define CONTROL_CHANNEL_PIPE_NAME "\\\\.\\pipe\\bot_server_control%s"
+
+/* File path of the Unix domain socket of the local control channel of BOT 
+server, relative to the installation directory of BOT server. The %s is the 
+instance name of the server process. */
+#define CONTROL_CHANNEL_SOCKET_PATH "./temp/control/bot_server_control%s.sock"
+
+/* Maximum length in number of bytes of the name of the control channel */
+#define LENGTH_OF_CONTROL_CHANNEL_ENDPOINT 108
+
+/* Maximum length in number of bytes of a control request or response */
+#define CONTROL_MESSAGE_LENGTH 4096
+
+/* Time in milliseconds to wait for the control channel to be available */
+#define CONTROL_CHANNEL_TIMEOUT_IN_MS 5000
+
+/* Requests supported by the local control channel of BOT server */
+const char * const ControlRequest_String[] = {
+
+    "reload",
+
+    "stats",
+
+    "flush",
+
+    "occupancy",
+
+    "flowcontrol",
+
+    "watermark",
+
+    "ringbench",
+
+    "profile",
+
+    "ingestbench",
+};
+
+/* Server processes which own a local control channel. An installation runs 
+either one process doing all work, or an ingest and an analytics process. */
+const char * const ControlInstance_String[] = {
+
+    "all",
+
+    "ingest",
+
+    "analytics",
+};
+
+/* The instance names of the server processes in the name of their control 
+channels, in the order of ControlInstance_String */
+const char * const ControlInstanceName_String[] = {
+
+    "",
+
+    "_ingest",
+
+    "_analytics",
+};
+
 /* Readable sentence to help users of IPC tool specify IPC commands. */
 const char * const IPCCommand_String[] = {
 
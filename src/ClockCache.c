@@ -0,0 +1,113 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ClockCache.c
+
+  File Description:
+
+     This file provides a process-wide cache of the monotonic and wall clock
+     in seconds. A ticker thread refreshes the cache, so the hot paths read
+     the time without issuing clock system calls.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "ClockCache.h"
+
+void init_clock_cache(){
+
+    pthread_mutex_init(&clock_cache.clock_lock, 0);
+
+    clock_cache.clock_time = get_clock_time();
+    clock_cache.system_time = get_system_time();
+    clock_cache.is_simulated = false;
+}
+
+void *clock_cache_ticker(){
+
+    while(true == ready_to_work){
+
+        pthread_mutex_lock(&clock_cache.clock_lock);
+
+        if(false == clock_cache.is_simulated){
+            clock_cache.clock_time = get_clock_time();
+            clock_cache.system_time = get_system_time();
+        }
+
+        pthread_mutex_unlock(&clock_cache.clock_lock);
+
+        sleep_t(CLOCK_CACHE_TICK_IN_MS);
+    }
+
+    return (void *)NULL;
+}
+
+int get_cached_clock_time(){
+
+    return clock_cache.clock_time;
+}
+
+int get_cached_system_time(){
+
+    return clock_cache.system_time;
+}
+
+void set_simulated_clock(int system_time){
+
+    pthread_mutex_lock(&clock_cache.clock_lock);
+
+    clock_cache.is_simulated = true;
+    clock_cache.clock_time = get_clock_time();
+    clock_cache.system_time = system_time;
+
+    pthread_mutex_unlock(&clock_cache.clock_lock);
+}
+
+void advance_simulated_clock(int seconds){
+
+    pthread_mutex_lock(&clock_cache.clock_lock);
+
+    clock_cache.clock_time += seconds;
+    clock_cache.system_time += seconds;
+
+    pthread_mutex_unlock(&clock_cache.clock_lock);
+}
+
+void stop_simulated_clock(){
+
+    pthread_mutex_lock(&clock_cache.clock_lock);
+
+    clock_cache.is_simulated = false;
+    clock_cache.clock_time = get_clock_time();
+    clock_cache.system_time = get_system_time();
+
+    pthread_mutex_unlock(&clock_cache.clock_lock);
+}
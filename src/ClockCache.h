@@ -0,0 +1,201 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ClockCache.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in ClockCache.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef CLOCK_CACHE_H
+#define CLOCK_CACHE_H
+
+#include "BeDIS.h"
+
+/* The time interval in milliseconds between two consecutive refreshes of the 
+cached clock. This bounds the staleness of the cached time. */
+#define CLOCK_CACHE_TICK_IN_MS 100
+
+typedef struct {
+
+    /* The cached monotonic time in seconds, as returned by get_clock_time */
+    volatile int clock_time;
+
+    /* The cached wall time in seconds since epoch, as returned by 
+       get_system_time */
+    volatile int system_time;
+
+    /* The flag indicating whether the cache holds a simulated clock which 
+       is only moved by advance_simulated_clock */
+    volatile bool is_simulated;
+
+    /* The lock serializing the writers of the cache, so the ticker never 
+       overwrites a simulated clock set between its check and its write. 
+       Readers do not take it. */
+    pthread_mutex_t clock_lock;
+
+} ClockCache;
+
+/* global variables */
+
+/* The process-wide clock cache */
+ClockCache clock_cache;
+
+/*
+  init_clock_cache:
+
+     This function fills the clock cache with the current time. It must be 
+     called before any thread reads the cache.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+
+ */
+
+void init_clock_cache();
+
+/*
+  clock_cache_ticker:
+
+     This function is executed by a dedicated thread to refresh the clock 
+     cache every CLOCK_CACHE_TICK_IN_MS milliseconds until the server stops.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+
+ */
+
+void *clock_cache_ticker();
+
+/*
+  get_cached_clock_time:
+
+     This function returns the cached monotonic time in seconds. It is a 
+     drop-in replacement of get_clock_time on hot paths.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     int - The cached monotonic time in seconds
+
+ */
+
+int get_cached_clock_time();
+
+/*
+  get_cached_system_time:
+
+     This function returns the cached wall time in seconds since epoch. It is 
+     a drop-in replacement of get_system_time on hot paths.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     int - The cached wall time in seconds since epoch
+
+ */
+
+int get_cached_system_time();
+
+/*
+  set_simulated_clock:
+
+     This function detaches the clock cache from the real clocks and sets 
+     the cached wall time to the specified time. The ticker stops refreshing
+     the cache until stop_simulated_clock is called.
+
+  Parameters:
+
+     system_time - The simulated wall time in seconds since epoch
+
+  Return value:
+
+     None
+
+ */
+
+void set_simulated_clock(int system_time);
+
+/*
+  advance_simulated_clock:
+
+     This function moves both cached times of the simulated clock forward.
+
+  Parameters:
+
+     seconds - The number of seconds to advance
+
+  Return value:
+
+     None
+
+ */
+
+void advance_simulated_clock(int seconds);
+
+/*
+  stop_simulated_clock:
+
+     This function reattaches the clock cache to the real clocks.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+
+ */
+
+void stop_simulated_clock();
+
+#endif
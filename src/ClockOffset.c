@@ -0,0 +1,215 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ClockOffset.c
+
+  File Description:
+
+     This file provides APIs to estimate the clock offset between the server
+     and each LBeacon, so the tracking data can be stored in server time.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "ClockOffset.h"
+
+static int get_clock_offset_bucket(char *lbeacon_uuid){
+
+    unsigned int hash = 5381;
+    char *current_char = lbeacon_uuid;
+
+    while(*current_char != '\0'){
+        hash = ((hash << 5) + hash) + (unsigned char) *current_char;
+        current_char++;
+    }
+
+    return hash % NUMBER_OF_CLOCK_OFFSET_BUCKETS;
+}
+
+static int round_clock_offset(double offset){
+
+    if(offset < 0){
+        return (int)(offset - 0.5);
+    }
+    return (int)(offset + 0.5);
+}
+
+void init_clock_offset_list(ClockOffsetListHead *clock_offset_list_head){
+
+    int i;
+
+    pthread_mutex_init(&clock_offset_list_head->list_lock, 0);
+
+    for(i = 0; i < NUMBER_OF_CLOCK_OFFSET_BUCKETS; i++){
+        init_entry(&clock_offset_list_head->bucket_list_head[i]);
+    }
+}
+
+void destroy_clock_offset_list(ClockOffsetListHead *clock_offset_list_head){
+
+    int i;
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    ClockOffsetNode *current_list_ptr = NULL;
+
+    pthread_mutex_lock(&clock_offset_list_head->list_lock);
+
+    for(i = 0; i < NUMBER_OF_CLOCK_OFFSET_BUCKETS; i++){
+
+        list_for_each_safe(current_list_entry,
+                           next_list_entry,
+                           &clock_offset_list_head->bucket_list_head[i]){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         ClockOffsetNode,
+                                         clock_offset_list_entry);
+
+            remove_list_node(&current_list_ptr->clock_offset_list_entry);
+
+            mp_free(&clock_offset_mempool, current_list_ptr);
+        }
+    }
+
+    pthread_mutex_unlock(&clock_offset_list_head->list_lock);
+}
+
+ErrorCode get_smoothed_clock_offset(ClockOffsetListHead *clock_offset_list_head,
+                                    char *lbeacon_uuid,
+                                    int offset_sample,
+                                    int *applied_offset){
+
+    int bucket = 0;
+    List_Entry *current_list_entry = NULL;
+    ClockOffsetNode *current_list_ptr = NULL;
+    ClockOffsetNode *target_node = NULL;
+    int retry_times = 0;
+    double difference = 0;
+
+    *applied_offset = offset_sample;
+
+    if(lbeacon_uuid == NULL || strlen(lbeacon_uuid) >= LENGTH_OF_UUID){
+        return E_INPUT_PARAMETER;
+    }
+
+    bucket = get_clock_offset_bucket(lbeacon_uuid);
+
+    pthread_mutex_lock(&clock_offset_list_head->list_lock);
+
+    list_for_each(current_list_entry,
+                  &clock_offset_list_head->bucket_list_head[bucket]){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     ClockOffsetNode,
+                                     clock_offset_list_entry);
+
+        if(strncmp(current_list_ptr->lbeacon_uuid,
+                   lbeacon_uuid,
+                   LENGTH_OF_UUID) == 0){
+
+            target_node = current_list_ptr;
+            break;
+        }
+    }
+
+    if(NULL == target_node){
+
+        retry_times = MEMORY_ALLOCATE_RETRIES;
+        while(retry_times --){
+            target_node = mp_alloc(&clock_offset_mempool);
+            if(NULL != target_node)
+                break;
+        }
+        if(NULL == target_node){
+            pthread_mutex_unlock(&clock_offset_list_head->list_lock);
+
+            zlog_error(category_debug,
+                       "get_smoothed_clock_offset (target_node) mp_alloc " \
+                       "failed, apply raw offset");
+            return E_MALLOC;
+        }
+
+        memset(target_node, 0, sizeof(ClockOffsetNode));
+
+        init_entry(&target_node->clock_offset_list_entry);
+
+        strcpy(target_node->lbeacon_uuid, lbeacon_uuid);
+        target_node->smoothed_offset = offset_sample;
+
+        insert_list_tail(&target_node->clock_offset_list_entry,
+                         &clock_offset_list_head->bucket_list_head[bucket]);
+
+    }else{
+
+        difference = offset_sample - target_node->smoothed_offset;
+
+        if(difference > CLOCK_OFFSET_OUTLIER_THRESHOLD_IN_SEC ||
+           difference < -CLOCK_OFFSET_OUTLIER_THRESHOLD_IN_SEC){
+
+            /* Consecutive outliers close to each other mean the clock of the
+               LBeacon was adjusted */
+            if(target_node->number_of_outliers > 0 &&
+               abs(offset_sample - target_node->last_outlier_offset) > 
+               CLOCK_OFFSET_OUTLIER_THRESHOLD_IN_SEC){
+
+                target_node->number_of_outliers = 0;
+            }
+
+            target_node->number_of_outliers++;
+            target_node->last_outlier_offset = offset_sample;
+
+            if(target_node->number_of_outliers >= 
+               CLOCK_OFFSET_OUTLIERS_BEFORE_RESET){
+
+                zlog_info(category_debug,
+                          "clock offset of lbeacon_uuid=[%s] is reset " \
+                          "from [%d] to [%d]",
+                          lbeacon_uuid,
+                          round_clock_offset(target_node->smoothed_offset),
+                          offset_sample);
+
+                target_node->smoothed_offset = offset_sample;
+                target_node->number_of_outliers = 0;
+            }
+
+        }else{
+
+            target_node->smoothed_offset += 
+                CLOCK_OFFSET_SMOOTHING_WEIGHT * difference;
+            target_node->number_of_outliers = 0;
+        }
+    }
+
+    *applied_offset = round_clock_offset(target_node->smoothed_offset);
+
+    pthread_mutex_unlock(&clock_offset_list_head->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
@@ -0,0 +1,163 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ClockOffset.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in ClockOffset.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef CLOCK_OFFSET_H
+#define CLOCK_OFFSET_H
+
+#include "BeDIS.h"
+
+/* Number of hash buckets used to look up the clock offset of LBeacons */
+#define NUMBER_OF_CLOCK_OFFSET_BUCKETS 256
+
+/* The weight of a new offset sample in the smoothed clock offset */
+#define CLOCK_OFFSET_SMOOTHING_WEIGHT 0.125
+
+/* The difference in seconds between an offset sample and the smoothed clock 
+offset above which the sample is treated as an outlier */
+#define CLOCK_OFFSET_OUTLIER_THRESHOLD_IN_SEC 5
+
+/* The number of consecutive outliers after which the clock of the LBeacon is 
+treated as adjusted and the smoothed clock offset restarts from the latest 
+sample */
+#define CLOCK_OFFSET_OUTLIERS_BEFORE_RESET 3
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The hash buckets of clock offset nodes */
+    struct List_Entry bucket_list_head[NUMBER_OF_CLOCK_OFFSET_BUCKETS];
+
+} ClockOffsetListHead;
+
+typedef struct {
+
+    char lbeacon_uuid[LENGTH_OF_UUID];
+
+    /* The smoothed offset in seconds of server time against LBeacon time */
+    double smoothed_offset;
+
+    /* The number of consecutive outlier samples */
+    int number_of_outliers;
+
+    /* The latest outlier sample */
+    int last_outlier_offset;
+
+    List_Entry clock_offset_list_entry;
+
+} ClockOffsetNode;
+
+/* global variables */
+
+/* The mempool for the clock offset node structures */
+Memory_Pool clock_offset_mempool;
+
+/*
+  init_clock_offset_list:
+
+     This function initializes the list of clock offsets of LBeacons.
+
+  Parameters:
+
+     clock_offset_list_head - The pointer to the head of the clock offset list
+
+  Return value:
+
+     None
+
+ */
+
+void init_clock_offset_list(ClockOffsetListHead *clock_offset_list_head);
+
+/*
+  destroy_clock_offset_list:
+
+     This function releases all nodes in the clock offset list back to the 
+     memory pool.
+
+  Parameters:
+
+     clock_offset_list_head - The pointer to the head of the clock offset list
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_clock_offset_list(ClockOffsetListHead *clock_offset_list_head);
+
+/*
+  get_smoothed_clock_offset:
+
+     This function feeds a new offset sample of an LBeacon into its smoothed 
+     clock offset and returns the offset to be applied to the timestamps 
+     reported by the LBeacon. The smoothed offset is an exponentially weighted
+     moving average of the samples. Single outliers caused by network or 
+     queueing delay are ignored, while consecutive outliers restart the 
+     average from the latest sample.
+
+  Parameters:
+
+     clock_offset_list_head - The pointer to the head of the clock offset list
+
+     lbeacon_uuid - The UUID of the LBeacon which reported the timestamps
+
+     offset_sample - The server time minus the LBeacon time in seconds 
+                     observed in the current message
+
+     applied_offset - The output offset in seconds to be added to the 
+                      timestamps reported by the LBeacon
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_MALLOC: no free node in clock_offset_mempool. The raw 
+                           offset_sample is returned in applied_offset.
+
+ */
+
+ErrorCode get_smoothed_clock_offset(ClockOffsetListHead *clock_offset_list_head,
+                                    char *lbeacon_uuid,
+                                    int offset_sample,
+                                    int *applied_offset);
+
+#endif
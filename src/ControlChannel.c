@@ -0,0 +1,419 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ControlChannel.c
+
+  File Description:
+
+     This file provides the local control channel of the server. Local
+     control tools send requests through a Unix domain socket, or a named
+     pipe on Windows, and receive a response for each request. The channel
+     does not share the receive thread or the buffer nodes with the packets
+     from gateways.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "ControlChannel.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+static void process_control_request(ControlChannel *channel,
+                                    char *request,
+                                    char *response,
+                                    size_t response_len){
+
+    memset(response, 0, response_len);
+
+    if(WORK_SUCCESSFULLY != channel->handler(request, 
+                                             response, 
+                                             response_len) &&
+       strlen(response) == 0){
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_ERROR);
+    }
+
+    zlog_info(category_debug, "control request [%s] response [%s]", 
+              request, response);
+}
+
+static void *control_job_routine(void *_channel){
+
+    ControlChannel *channel = (ControlChannel *)_channel;
+    char response[CONTROL_MESSAGE_LENGTH];
+
+    memset(response, 0, sizeof(response));
+
+    if(WORK_SUCCESSFULLY != channel->job_handler(channel->job_request, 
+                                                 response, 
+                                                 sizeof(response)) &&
+       strlen(response) == 0){
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_ERROR);
+    }
+
+    zlog_info(category_debug, "control job [%s] response [%s]", 
+              channel->job_request, response);
+
+    pthread_mutex_lock(&channel->job_lock);
+
+    strncpy(channel->job_response, response, 
+            sizeof(channel->job_response) - 1);
+    channel->is_job_running = false;
+    channel->is_job_finished = true;
+
+    pthread_mutex_unlock(&channel->job_lock);
+
+    return (void *)NULL;
+}
+
+static void init_control_job(ControlChannel *channel,
+                             ControlRequestHandler job_handler){
+
+    channel->job_handler = job_handler;
+
+    pthread_mutex_init(&channel->job_lock, 0);
+
+    memset(channel->job_request, 0, sizeof(channel->job_request));
+    memset(channel->job_response, 0, sizeof(channel->job_response));
+    channel->is_job_running = false;
+    channel->is_job_finished = false;
+}
+
+ErrorCode submit_control_job(ControlChannel *channel, 
+                             char *request, 
+                             char *response, 
+                             size_t response_len){
+
+    pthread_t job_thread;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    pthread_mutex_lock(&channel->job_lock);
+
+    if(true == channel->is_job_running){
+
+        if(strcmp(channel->job_request, request) == 0){
+            sprintf(response, "%s;running;", CONTROL_RESPONSE_OK);
+        }else{
+            sprintf(response, "%s;another job is running;", 
+                    CONTROL_RESPONSE_ERROR);
+            ret_val = E_INPUT_PARAMETER;
+        }
+
+    }else if(true == channel->is_job_finished &&
+             strcmp(channel->job_request, request) == 0){
+
+        memset(response, 0, response_len);
+        strncpy(response, channel->job_response, response_len - 1);
+        channel->is_job_finished = false;
+
+    }else{
+
+        memset(channel->job_request, 0, sizeof(channel->job_request));
+        strncpy(channel->job_request, request, 
+                sizeof(channel->job_request) - 1);
+        memset(channel->job_response, 0, sizeof(channel->job_response));
+        channel->is_job_running = true;
+        channel->is_job_finished = false;
+
+        if(WORK_SUCCESSFULLY != startThread(&job_thread, 
+                                            control_job_routine, 
+                                            channel)){
+
+            channel->is_job_running = false;
+            sprintf(response, "%s;job thread failed;", 
+                    CONTROL_RESPONSE_ERROR);
+            ret_val = E_INITIALIZATION_FAIL;
+        }else{
+            sprintf(response, "%s;started;", CONTROL_RESPONSE_OK);
+        }
+    }
+
+    pthread_mutex_unlock(&channel->job_lock);
+
+    return ret_val;
+}
+
+#ifdef _WIN32
+
+ErrorCode init_control_channel(ControlChannel *channel, 
+                               char *instance_name,
+                               ControlRequestHandler handler,
+                               ControlRequestHandler job_handler){
+
+    DWORD pipe_mode = PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT;
+
+#ifdef PIPE_REJECT_REMOTE_CLIENTS
+    pipe_mode |= PIPE_REJECT_REMOTE_CLIENTS;
+#endif
+
+    channel->handler = handler;
+    init_control_job(channel, job_handler);
+
+    memset(channel->endpoint, 0, sizeof(channel->endpoint));
+    sprintf(channel->endpoint, CONTROL_CHANNEL_PIPE_NAME, instance_name);
+
+    channel->pipe = CreateNamedPipe(channel->endpoint,
+                                    PIPE_ACCESS_DUPLEX,
+                                    pipe_mode,
+                                    1,
+                                    CONTROL_MESSAGE_LENGTH,
+                                    CONTROL_MESSAGE_LENGTH,
+                                    0,
+                                    NULL);
+
+    if(INVALID_HANDLE_VALUE == channel->pipe){
+        zlog_error(category_debug, 
+                   "CreateNamedPipe failed, error=[%d]", GetLastError());
+        return E_INITIALIZATION_FAIL;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+void release_control_channel(ControlChannel *channel, bool is_taken_over){
+
+    if(INVALID_HANDLE_VALUE != channel->pipe){
+        CloseHandle(channel->pipe);
+        channel->pipe = INVALID_HANDLE_VALUE;
+    }
+}
+
+void *control_channel_routine(void *_channel){
+
+    ControlChannel *channel = (ControlChannel *)_channel;
+    char request[CONTROL_MESSAGE_LENGTH];
+    char response[CONTROL_MESSAGE_LENGTH];
+    DWORD request_len = 0;
+    DWORD response_len = 0;
+
+    while(true == ready_to_work){
+
+        if(!ConnectNamedPipe(channel->pipe, NULL) && 
+           ERROR_PIPE_CONNECTED != GetLastError()){
+
+            sleep_t(BUSY_WAITING_TIME_IN_MS);
+            continue;
+        }
+
+        memset(request, 0, sizeof(request));
+
+        if(ReadFile(channel->pipe, 
+                    request, 
+                    sizeof(request) - 1, 
+                    &request_len, 
+                    NULL) && request_len > 0){
+
+            process_control_request(channel, 
+                                    request, 
+                                    response, 
+                                    sizeof(response));
+
+            WriteFile(channel->pipe, 
+                      response, 
+                      strlen(response), 
+                      &response_len, 
+                      NULL);
+
+            FlushFileBuffers(channel->pipe);
+        }
+
+        DisconnectNamedPipe(channel->pipe);
+    }
+
+    return (void *)NULL;
+}
+
+#else
+
+ErrorCode init_control_channel(ControlChannel *channel, 
+                               char *instance_name,
+                               ControlRequestHandler handler,
+                               ControlRequestHandler job_handler){
+
+    struct sockaddr_un address;
+    struct stat endpoint_stat;
+    struct stat directory_stat;
+
+    channel->handler = handler;
+    init_control_job(channel, job_handler);
+
+    memset(channel->endpoint, 0, sizeof(channel->endpoint));
+    sprintf(channel->endpoint, CONTROL_CHANNEL_SOCKET_PATH, instance_name);
+
+    /* Only the account running the server can send control requests, 
+       because only it can enter the directory of the socket. A directory 
+       left by another account or with wider permissions is not trusted. */
+    if(mkdir(CONTROL_CHANNEL_SOCKET_DIRECTORY, S_IRWXU) < 0 && 
+       EEXIST != errno){
+
+        zlog_error(category_debug, "create control directory [%s] failed",
+                   CONTROL_CHANNEL_SOCKET_DIRECTORY);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    if(lstat(CONTROL_CHANNEL_SOCKET_DIRECTORY, &directory_stat) < 0 ||
+       !S_ISDIR(directory_stat.st_mode) ||
+       directory_stat.st_uid != geteuid() ||
+       chmod(CONTROL_CHANNEL_SOCKET_DIRECTORY, S_IRWXU) < 0){
+
+        zlog_error(category_debug, "control directory [%s] is not private",
+                   CONTROL_CHANNEL_SOCKET_DIRECTORY);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    channel->listen_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(channel->listen_socket < 0){
+        zlog_error(category_debug, "create control socket failed");
+        return E_INITIALIZATION_FAIL;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, 
+            channel->endpoint, 
+            sizeof(address.sun_path) - 1);
+
+    /* Remove the socket file left by a previous run, or take the path over 
+       from the process being upgraded */
+    unlink(channel->endpoint);
+
+    if(bind(channel->listen_socket, 
+            (struct sockaddr *)&address, 
+            sizeof(address)) < 0 || 
+       listen(channel->listen_socket, 1) < 0){
+
+        zlog_error(category_debug, "bind control socket [%s] failed", 
+                   channel->endpoint);
+
+        close(channel->listen_socket);
+        channel->listen_socket = -1;
+        return E_INITIALIZATION_FAIL;
+    }
+
+    /* Remember the socket file, so this process never removes a socket 
+       file bound by another process at the same path */
+    memset(&endpoint_stat, 0, sizeof(endpoint_stat));
+    stat(channel->endpoint, &endpoint_stat);
+    channel->endpoint_device = endpoint_stat.st_dev;
+    channel->endpoint_inode = endpoint_stat.st_ino;
+
+    return WORK_SUCCESSFULLY;
+}
+
+void release_control_channel(ControlChannel *channel, bool is_taken_over){
+
+    struct stat endpoint_stat;
+
+    if(channel->listen_socket >= 0){
+        close(channel->listen_socket);
+        channel->listen_socket = -1;
+
+        if(false == is_taken_over &&
+           0 == stat(channel->endpoint, &endpoint_stat) &&
+           endpoint_stat.st_dev == channel->endpoint_device &&
+           endpoint_stat.st_ino == channel->endpoint_inode){
+
+            unlink(channel->endpoint);
+        }
+    }
+}
+
+void *control_channel_routine(void *_channel){
+
+    ControlChannel *channel = (ControlChannel *)_channel;
+    char request[CONTROL_MESSAGE_LENGTH];
+    char response[CONTROL_MESSAGE_LENGTH];
+    int client_socket = -1;
+    int request_len = 0;
+    fd_set read_fds;
+    struct timeval timeout;
+    struct timeval client_timeout;
+
+    client_timeout.tv_sec = CONTROL_CHANNEL_CLIENT_TIMEOUT_IN_MS / 1000;
+    client_timeout.tv_usec = 
+        (CONTROL_CHANNEL_CLIENT_TIMEOUT_IN_MS % 1000) * 1000;
+
+    while(true == ready_to_work){
+
+        /* Wait with timeout, so the thread notices the server stops */
+        FD_ZERO(&read_fds);
+        FD_SET(channel->listen_socket, &read_fds);
+        timeout.tv_sec = 0;
+        timeout.tv_usec = BUSY_WAITING_TIME_IN_MS * 1000;
+
+        if(select(channel->listen_socket + 1, 
+                  &read_fds, 
+                  NULL, 
+                  NULL, 
+                  &timeout) <= 0){
+            continue;
+        }
+
+        client_socket = accept(channel->listen_socket, NULL, NULL);
+        if(client_socket < 0){
+            continue;
+        }
+
+        /* Requests are served one at a time, so a client which neither 
+           sends nor reads is dropped after the timeout */
+        setsockopt(client_socket, SOL_SOCKET, SO_RCVTIMEO, 
+                   (char *)&client_timeout, sizeof(client_timeout));
+        setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, 
+                   (char *)&client_timeout, sizeof(client_timeout));
+
+        memset(request, 0, sizeof(request));
+
+        request_len = recv(client_socket, request, sizeof(request) - 1, 0);
+        if(request_len > 0){
+
+            process_control_request(channel, 
+                                    request, 
+                                    response, 
+                                    sizeof(response));
+
+            send(client_socket, response, strlen(response), 0);
+        }
+
+        close(client_socket);
+    }
+
+    return (void *)NULL;
+}
+
+#endif
@@ -0,0 +1,286 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ControlChannel.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in ControlChannel.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef CONTROL_CHANNEL_H
+#define CONTROL_CHANNEL_H
+
+#include "BeDIS.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#endif
+
+/* Name of the named pipe of the control channel on Windows. The %s is the 
+instance name of the server process. */
+#define CONTROL_CHANNEL_PIPE_NAME "\\\\.\\pipe\\bot_server_control%s"
+
+/* The directory holding the Unix domain sockets of the control channel. 
+Only the account running the server can enter it, which keeps other 
+accounts away from the sockets without changing the umask of the process. */
+#define CONTROL_CHANNEL_SOCKET_DIRECTORY "./temp/control"
+
+/* File path of the Unix domain socket of the control channel. The %s is the 
+instance name of the server process. */
+#define CONTROL_CHANNEL_SOCKET_PATH \
+    CONTROL_CHANNEL_SOCKET_DIRECTORY "/bot_server_control%s.sock"
+
+/* Time in milliseconds the control channel waits for a client to send its 
+request or to take the response, so an idle client does not hold the 
+channel */
+#define CONTROL_CHANNEL_CLIENT_TIMEOUT_IN_MS 1000
+
+/* The instance names of the server processes. The ingest and analytics 
+processes sharing one installation each need their own endpoint. */
+#define CONTROL_CHANNEL_INSTANCE_ALL ""
+#define CONTROL_CHANNEL_INSTANCE_INGEST "_ingest"
+#define CONTROL_CHANNEL_INSTANCE_ANALYTICS "_analytics"
+
+/* Maximum length in number of bytes of the name of the endpoint */
+#define LENGTH_OF_CONTROL_CHANNEL_ENDPOINT 108
+
+/* Maximum length in number of bytes of a control request or response */
+#define CONTROL_MESSAGE_LENGTH 4096
+
+/* The request to reload settings. It is followed by the IPC command, for 
+example "reload;1;1;1;" to reload all geo-fence settings in all areas. */
+#define CONTROL_REQUEST_RELOAD "reload"
+
+/* The request to get the statistics of the server */
+#define CONTROL_REQUEST_STATS "stats"
+
+/* The request to summarize the pending tracking data immediately. It runs 
+as a job of the control channel, see submit_control_job. */
+#define CONTROL_REQUEST_FLUSH "flush"
+
+/* The request to get the number of objects in each area, room and object 
+type */
+#define CONTROL_REQUEST_OCCUPANCY "occupancy"
+
+/* The request to get the trajectory of an object in a time range. It is 
+followed by the MAC address of the object and the beginning and end of the 
+time range in microseconds since epoch, for example 
+"trajectory;c1:00:00:00:00:01;1571100000000000;1571103600000000;". */
+#define CONTROL_REQUEST_TRAJECTORY "trajectory"
+
+/* The request to get the flow control level and the counters of each 
+gateway */
+#define CONTROL_REQUEST_FLOW_CONTROL "flowcontrol"
+
+/* The request to get the event-time watermark and the late rows of each 
+gateway */
+#define CONTROL_REQUEST_WATERMARK "watermark"
+
+/* The request to measure the throughput of a shared ring in records per 
+second. It runs as a job of the control channel. */
+#define CONTROL_REQUEST_RING_BENCHMARK "ringbench"
+
+/* The request to get the time spent in each processing stage. It may be 
+followed by PROFILE_REQUEST_RESET, "on" or "off". */
+#define CONTROL_REQUEST_PROFILE "profile"
+
+/* The request to measure the strategies of writing tracking data into the 
+database. It starts a benchmark if none is running, and shows the progress 
+of the running benchmark otherwise. */
+#define CONTROL_REQUEST_INGEST_BENCHMARK "ingestbench"
+
+/* The prefix of the response to a request completed successfully */
+#define CONTROL_RESPONSE_OK "ok"
+
+/* The prefix of the response to a failed request */
+#define CONTROL_RESPONSE_ERROR "error"
+
+/* The function to process a control request and fill in the response */
+typedef ErrorCode (*ControlRequestHandler)(char *request, 
+                                           char *response, 
+                                           size_t response_len);
+
+typedef struct {
+
+    /* The function to process each request */
+    ControlRequestHandler handler;
+
+    /* The function to process a request which takes long. It runs in the 
+       job thread, so the control channel keeps serving other requests. */
+    ControlRequestHandler job_handler;
+
+    /* The lock of the job state below */
+    pthread_mutex_t job_lock;
+
+    /* The request run by the job thread, and its response once finished */
+    char job_request[CONTROL_MESSAGE_LENGTH];
+    char job_response[CONTROL_MESSAGE_LENGTH];
+
+    /* The flag indicating whether the job thread is running job_request */
+    bool is_job_running;
+
+    /* The flag indicating whether job_response is waiting to be taken */
+    bool is_job_finished;
+
+    /* The name of the named pipe or the path of the Unix domain socket */
+    char endpoint[LENGTH_OF_CONTROL_CHANNEL_ENDPOINT];
+
+#ifdef _WIN32
+    /* The named pipe instance waiting for a client */
+    HANDLE pipe;
+#else
+    /* The listening Unix domain socket */
+    int listen_socket;
+
+    /* The socket file this process bound. Another process may bind a new 
+       socket file at the same path, which must not be removed by this 
+       process. */
+    dev_t endpoint_device;
+    ino_t endpoint_inode;
+#endif
+
+} ControlChannel;
+
+/* global variables */
+
+/* The local control channel of the server */
+ControlChannel control_channel;
+
+/*
+  init_control_channel:
+
+     This function creates the endpoint of the local control channel.
+
+  Parameters:
+
+     channel - The pointer to the control channel
+
+     instance_name - The instance name of the server process, one of the 
+                     CONTROL_CHANNEL_INSTANCE_* values
+
+     handler - The function to process each request
+
+     job_handler - The function to process the requests handed to 
+                   submit_control_job
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INITIALIZATION_FAIL: the endpoint cannot be created.
+
+ */
+
+ErrorCode init_control_channel(ControlChannel *channel, 
+                               char *instance_name,
+                               ControlRequestHandler handler,
+                               ControlRequestHandler job_handler);
+
+/*
+  submit_control_job:
+
+     This function hands a request which takes long to the job thread of 
+     the control channel. One job runs at a time. The first request starts 
+     the job and is answered with "ok;started;". The same request sent 
+     again is answered with "ok;running;" until the job finishes, and then 
+     with the response of the job.
+
+  Parameters:
+
+     channel - The pointer to the control channel
+
+     request - The request string
+
+     response - The buffer for the response string
+
+     response_len - Length in number of bytes of the response buffer
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: another job is running.
+                 E_INITIALIZATION_FAIL: the job thread cannot be created.
+
+ */
+
+ErrorCode submit_control_job(ControlChannel *channel, 
+                             char *request, 
+                             char *response, 
+                             size_t response_len);
+
+/*
+  release_control_channel:
+
+     This function closes the endpoint of the local control channel. The 
+     socket file is removed only if it is still the one this process bound.
+
+  Parameters:
+
+     channel - The pointer to the control channel
+
+     is_taken_over - The flag indicating whether a new process took over 
+                     this process through a socket handoff. The socket file 
+                     then belongs to the new process and is kept.
+
+  Return value:
+
+     None
+
+ */
+
+void release_control_channel(ControlChannel *channel, bool is_taken_over);
+
+/*
+  control_channel_routine:
+
+     This function is executed by a dedicated thread to serve control 
+     requests one at a time until the server stops. Each request is answered
+     with a response starting with CONTROL_RESPONSE_OK or 
+     CONTROL_RESPONSE_ERROR.
+
+  Parameters:
+
+     _channel - The pointer to the control channel
+
+  Return value:
+
+     None
+
+ */
+
+void *control_channel_routine(void *_channel);
+
+#endif
@@ -0,0 +1,254 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     CpuAffinity.c
+
+  File Description:
+
+     This file provides APIs to pin server threads to the CPU set of their
+     role and to apply real-time scheduling to time-critical roles.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef _WIN32
+#define _GNU_SOURCE
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#include "CpuAffinity.h"
+
+/* The role the calling thread currently runs in */
+static THREAD_LOCAL ThreadRole current_thread_role = THREAD_ROLE_NONE;
+
+static char *thread_role_name[NUMBER_OF_THREAD_ROLES] = {
+    "none",
+    "receiver",
+    "time-critical worker",
+    "normal worker",
+    "db/monitor"
+};
+
+static bool is_realtime_role(ThreadRoleProfiles *thread_role_profiles,
+                             ThreadRole role){
+
+    return thread_role_profiles->is_enabled_realtime_scheduling &&
+           (role == THREAD_ROLE_RECEIVER ||
+            role == THREAD_ROLE_TIME_CRITICAL_WORKER);
+}
+
+static int get_number_of_cpus(){
+
+#ifdef _WIN32
+    SYSTEM_INFO system_info;
+
+    GetSystemInfo(&system_info);
+
+    return system_info.dwNumberOfProcessors;
+#else
+    return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+static ErrorCode parse_cpu_set(char *cpu_set, unsigned long long *cpu_mask){
+
+    char buf[CONFIG_BUFFER_SIZE];
+    char *save_ptr = NULL;
+    char *range = NULL;
+    char *range_end = NULL;
+    int first_cpu = 0;
+    int last_cpu = 0;
+    int cpu = 0;
+
+    *cpu_mask = 0;
+
+    if(strncmp(cpu_set, CPU_SET_ALL, strlen(CPU_SET_ALL)) == 0){
+        return WORK_SUCCESSFULLY;
+    }
+
+    memset(buf, 0, sizeof(buf));
+    strncpy(buf, cpu_set, sizeof(buf) - 1);
+
+    range = strtok_save(buf, DELIMITER_COMMA, &save_ptr);
+    while(range != NULL){
+
+        if(strspn(range, "0123456789-") != strlen(range) || 
+           strlen(range) == 0){
+            *cpu_mask = 0;
+            return E_INPUT_PARAMETER;
+        }
+
+        first_cpu = atoi(range);
+        last_cpu = first_cpu;
+
+        range_end = strchr(range, '-');
+        if(range_end != NULL){
+            last_cpu = atoi(range_end + 1);
+        }
+
+        if(first_cpu > last_cpu || last_cpu >= MAXIMUM_CPUS_IN_CPU_SET){
+            *cpu_mask = 0;
+            return E_INPUT_PARAMETER;
+        }
+
+        for(cpu = first_cpu; cpu <= last_cpu; cpu++){
+            *cpu_mask |= (1ULL << cpu);
+        }
+
+        range = strtok_save(NULL, DELIMITER_COMMA, &save_ptr);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode init_thread_role_profiles(ThreadRoleProfiles *thread_role_profiles){
+
+    int role;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    unsigned long long time_critical_mask = 0;
+
+    zlog_info(category_debug, "CPU topology: [%d] CPUs online", 
+              get_number_of_cpus());
+
+    for(role = THREAD_ROLE_RECEIVER; role < NUMBER_OF_THREAD_ROLES; role++){
+
+        if(WORK_SUCCESSFULLY != 
+           parse_cpu_set(thread_role_profiles->cpu_set[role],
+                         &thread_role_profiles->cpu_mask[role])){
+
+            zlog_error(category_debug, 
+                       "Invalid cpu set [%s] of role [%s], not pinned",
+                       thread_role_profiles->cpu_set[role],
+                       thread_role_name[role]);
+
+            ret_val = E_INPUT_PARAMETER;
+        }
+
+        zlog_info(category_debug, 
+                  "Thread role [%s]: cpu set [%s] mask [0x%llx], " \
+                  "scheduling [%s]",
+                  thread_role_name[role],
+                  thread_role_profiles->cpu_set[role],
+                  thread_role_profiles->cpu_mask[role],
+                  is_realtime_role(thread_role_profiles, role) ? 
+                  "SCHED_FIFO" : "default");
+    }
+
+    /* Time-critical roles are only isolated when they do not share CPUs with
+       the database and monitor threads */
+    time_critical_mask = 
+        thread_role_profiles->cpu_mask[THREAD_ROLE_RECEIVER] |
+        thread_role_profiles->cpu_mask[THREAD_ROLE_TIME_CRITICAL_WORKER];
+
+    if(time_critical_mask == 0 ||
+       thread_role_profiles->cpu_mask[THREAD_ROLE_DB_MONITOR] == 0 ||
+       (time_critical_mask & 
+        thread_role_profiles->cpu_mask[THREAD_ROLE_DB_MONITOR]) != 0){
+
+        zlog_info(category_debug, 
+                  "Time-critical threads are not isolated from db/monitor " \
+                  "threads");
+    }
+
+    return ret_val;
+}
+
+void apply_thread_role(ThreadRoleProfiles *thread_role_profiles, 
+                       ThreadRole role){
+
+    unsigned long long cpu_mask = 0;
+    bool was_realtime = false;
+    bool is_realtime = false;
+#ifndef _WIN32
+    cpu_set_t cpu_set;
+    int cpu = 0;
+    struct sched_param param;
+#endif
+
+    if(current_thread_role == role){
+        return;
+    }
+
+    cpu_mask = thread_role_profiles->cpu_mask[role];
+    was_realtime = is_realtime_role(thread_role_profiles, 
+                                    current_thread_role);
+    is_realtime = is_realtime_role(thread_role_profiles, role);
+
+#ifdef _WIN32
+    if(cpu_mask == 0){
+        cpu_mask = (get_number_of_cpus() >= MAXIMUM_CPUS_IN_CPU_SET) ? 
+                   ~0ULL : (1ULL << get_number_of_cpus()) - 1;
+    }
+    if(0 == SetThreadAffinityMask(GetCurrentThread(), 
+                                  (DWORD_PTR) cpu_mask)){
+        zlog_error(category_debug, 
+                   "SetThreadAffinityMask failed, role [%s]",
+                   thread_role_name[role]);
+    }
+
+    if(is_realtime){
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    }else if(was_realtime){
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+    }
+#else
+    CPU_ZERO(&cpu_set);
+    for(cpu = 0; cpu < get_number_of_cpus() && cpu < CPU_SETSIZE; cpu++){
+        if(cpu_mask == 0 || 
+           (cpu < MAXIMUM_CPUS_IN_CPU_SET && (cpu_mask & (1ULL << cpu)))){
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+    if(0 != pthread_setaffinity_np(pthread_self(), 
+                                   sizeof(cpu_set), 
+                                   &cpu_set)){
+        zlog_error(category_debug, 
+                   "pthread_setaffinity_np failed, role [%s]",
+                   thread_role_name[role]);
+    }
+
+    memset(&param, 0, sizeof(param));
+    if(is_realtime){
+        param.sched_priority = REALTIME_PRIORITY_OF_TIME_CRITICAL_ROLES;
+        if(0 != pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)){
+            zlog_error(category_debug, 
+                       "pthread_setschedparam SCHED_FIFO failed, role [%s]",
+                       thread_role_name[role]);
+        }
+    }else if(was_realtime){
+        param.sched_priority = 0;
+        pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+#endif
+
+    current_thread_role = role;
+}
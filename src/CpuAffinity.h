@@ -0,0 +1,138 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     CpuAffinity.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in CpuAffinity.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include "BeDIS.h"
+
+/* The CPU set string meaning the threads of a role are not pinned */
+#define CPU_SET_ALL "all"
+
+/* The maximum number of CPUs which can be specified in a CPU set */
+#define MAXIMUM_CPUS_IN_CPU_SET 64
+
+/* The SCHED_FIFO priority of the threads of time-critical roles */
+#define REALTIME_PRIORITY_OF_TIME_CRITICAL_ROLES 10
+
+/* Thread local storage specifier of the compiler */
+#ifdef _WIN32
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* Role of a server thread. Threads of the same role share a CPU set. */
+typedef enum _ThreadRole{
+    THREAD_ROLE_NONE = 0,
+    /* Threads receiving packets from gateways */
+    THREAD_ROLE_RECEIVER = 1,
+    /* The thread processing the time-critical buffer list */
+    THREAD_ROLE_TIME_CRITICAL_WORKER = 2,
+    /* Worker threads processing the other buffer lists */
+    THREAD_ROLE_NORMAL_WORKER = 3,
+    /* Threads summarizing, monitoring and maintaining the database */
+    THREAD_ROLE_DB_MONITOR = 4,
+    NUMBER_OF_THREAD_ROLES = 5
+} ThreadRole;
+
+typedef struct {
+
+    /* The CPU set of each role as specified in the config file, for example
+       "0", "1-3", "0,2" or CPU_SET_ALL */
+    char cpu_set[NUMBER_OF_THREAD_ROLES][CONFIG_BUFFER_SIZE];
+
+    /* The CPU mask parsed from cpu_set. 0 means not pinned. */
+    unsigned long long cpu_mask[NUMBER_OF_THREAD_ROLES];
+
+    /* The flag indicating whether receiver and time-critical worker threads 
+       run with real-time scheduling */
+    int is_enabled_realtime_scheduling;
+
+} ThreadRoleProfiles;
+
+/*
+  init_thread_role_profiles:
+
+     This function parses the CPU set of each role and writes a report of the
+     CPU topology and the profile of each role to the log.
+
+  Parameters:
+
+     thread_role_profiles - The pointer to the thread role profiles in server
+                            global configuration structure
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: a CPU set has invalid format. The role of
+                                    the invalid CPU set is not pinned.
+
+ */
+
+ErrorCode init_thread_role_profiles(ThreadRoleProfiles *thread_role_profiles);
+
+/*
+  apply_thread_role:
+
+     This function pins the calling thread to the CPU set of the role and 
+     applies the scheduling policy of the role. Each thread applies a 
+     single role; time-critical work runs on its own thread rather than on 
+     the shared worker threads. The call returns immediately if the calling 
+     thread already runs in the role.
+
+  Parameters:
+
+     thread_role_profiles - The pointer to the thread role profiles in server
+                            global configuration structure
+
+     role - The role of the calling thread
+
+  Return value:
+
+     None
+
+ */
+
+void apply_thread_role(ThreadRoleProfiles *thread_role_profiles, 
+                       ThreadRole role);
+
+#endif
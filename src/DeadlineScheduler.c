@@ -0,0 +1,268 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     DeadlineScheduler.c
+
+  File Description:
+
+     This file provides APIs to process received packets in the order of
+     their deadlines. Each class of packets has a latency budget, and the
+     deadline of a packet is its receive time plus the budget of its class.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "DeadlineScheduler.h"
+#include "ClockCache.h"
+
+/* The names of the classes in the report */
+static const char * const DeadlineClass_String[] = {
+    "time_critical",
+    "join_request",
+    "ipc_command",
+    "tracked_object_data",
+    "health_report"
+};
+
+void init_deadline_scheduler(DeadlineScheduler *scheduler){
+
+    int i;
+
+    pthread_mutex_init(&scheduler->list_lock, 0);
+
+    for(i = 0; i < NUMBER_OF_DEADLINE_CLASSES; i++){
+
+        memset(&scheduler->queues[i], 0, sizeof(DeadlineQueue));
+
+        init_entry(&scheduler->queues[i].list_head);
+    }
+}
+
+void set_deadline_class(DeadlineScheduler *scheduler,
+                        DeadlineClass deadline_class,
+                        int budget_in_sec,
+                        DeadlineRoutine routine){
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    scheduler->queues[deadline_class].budget_in_sec = budget_in_sec;
+    scheduler->queues[deadline_class].routine = routine;
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+}
+
+void destroy_deadline_scheduler(DeadlineScheduler *scheduler){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    BufferNode *current_list_ptr = NULL;
+    int i;
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    for(i = 0; i < NUMBER_OF_DEADLINE_CLASSES; i++){
+
+        list_for_each_safe(current_list_entry,
+                           next_list_entry,
+                           &scheduler->queues[i].list_head){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         BufferNode,
+                                         buffer_entry);
+
+            remove_list_node(&current_list_ptr->buffer_entry);
+
+            mp_free(&node_mempool, current_list_ptr);
+        }
+
+        scheduler->queues[i].number_of_queued_packets = 0;
+    }
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+}
+
+void enqueue_deadline_packet(DeadlineScheduler *scheduler,
+                             DeadlineClass deadline_class,
+                             BufferNode *buffer_node){
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    insert_list_tail(&buffer_node->buffer_entry,
+                     &scheduler->queues[deadline_class].list_head);
+
+    scheduler->queues[deadline_class].number_of_queued_packets++;
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+}
+
+BufferNode *dequeue_deadline_packet(DeadlineScheduler *scheduler,
+                                    DeadlineClass *deadline_class){
+
+    List_Entry *current_list_entry = NULL;
+    BufferNode *current_list_ptr = NULL;
+    BufferNode *earliest_node = NULL;
+    int earliest_class = 0;
+    int earliest_deadline = 0;
+    int deadline = 0;
+    int current_time = get_cached_clock_time();
+    DeadlineQueue *queue = NULL;
+    int i;
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    /* Only the head of each queue can hold the earliest deadline of its 
+       class */
+    for(i = 0; i < NUMBER_OF_DEADLINE_CLASSES; i++){
+
+        list_for_each(current_list_entry, &scheduler->queues[i].list_head){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         BufferNode,
+                                         buffer_entry);
+
+            deadline = current_list_ptr->uptime_at_receive + 
+                       scheduler->queues[i].budget_in_sec;
+
+            if(NULL == earliest_node || deadline < earliest_deadline){
+                earliest_node = current_list_ptr;
+                earliest_class = i;
+                earliest_deadline = deadline;
+            }
+            break;
+        }
+    }
+
+    if(NULL != earliest_node){
+
+        queue = &scheduler->queues[earliest_class];
+
+        remove_list_node(&earliest_node->buffer_entry);
+
+        queue->number_of_queued_packets--;
+        queue->number_of_dispatched_packets++;
+
+        if(current_time > earliest_deadline){
+            queue->number_of_deadline_misses++;
+
+            if(current_time - earliest_deadline > 
+               queue->max_deadline_miss_in_sec){
+                queue->max_deadline_miss_in_sec = 
+                    current_time - earliest_deadline;
+            }
+        }
+
+        *deadline_class = (DeadlineClass) earliest_class;
+    }
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+
+    return earliest_node;
+}
+
+int get_number_of_deadline_packets(DeadlineScheduler *scheduler){
+
+    int number_of_packets = 0;
+    int i;
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    for(i = 0; i < NUMBER_OF_DEADLINE_CLASSES; i++){
+        number_of_packets += scheduler->queues[i].number_of_queued_packets;
+    }
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+
+    return number_of_packets;
+}
+
+void *deadline_worker_routine(void *_scheduler){
+
+    DeadlineScheduler *scheduler = (DeadlineScheduler *)_scheduler;
+    BufferNode *current_node = NULL;
+    DeadlineClass deadline_class = DEADLINE_CLASS_TIME_CRITICAL;
+    DeadlineRoutine routine = NULL;
+
+    while(true == ready_to_work){
+
+        current_node = dequeue_deadline_packet(scheduler, &deadline_class);
+
+        if(NULL == current_node){
+            sleep_t(DEADLINE_WORKER_IDLE_WAITING_TIME_IN_MS);
+            continue;
+        }
+
+        routine = scheduler->queues[deadline_class].routine;
+
+        /* The routine releases the buffer node */
+        if(NULL != routine){
+            routine(current_node);
+        }else{
+            mp_free(&node_mempool, current_node);
+        }
+    }
+
+    return (void *)NULL;
+}
+
+int get_deadline_scheduler_report(DeadlineScheduler *scheduler,
+                                  char *buf,
+                                  size_t buf_len){
+
+    char one_class[128];
+    size_t used_len = 0;
+    int i;
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    for(i = 0; i < NUMBER_OF_DEADLINE_CLASSES; i++){
+
+        memset(one_class, 0, sizeof(one_class));
+        sprintf(one_class, "edf_%s=%d/%d/%d/%d;",
+                DeadlineClass_String[i],
+                scheduler->queues[i].number_of_dispatched_packets,
+                scheduler->queues[i].number_of_deadline_misses,
+                scheduler->queues[i].max_deadline_miss_in_sec,
+                scheduler->queues[i].number_of_queued_packets);
+
+        if(used_len + strlen(one_class) + 1 > buf_len){
+            break;
+        }
+
+        strcpy(buf + used_len, one_class);
+        used_len += strlen(one_class);
+    }
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+
+    return (int) used_len;
+}
@@ -0,0 +1,272 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     DeadlineScheduler.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in DeadlineScheduler.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include "BeDIS.h"
+
+/* Maximum number of worker threads taking packets from the deadline 
+scheduler */
+#define MAX_NUMBER_OF_DEADLINE_WORKERS 32
+
+/* Time in milliseconds a worker sleeps when no packet is waiting */
+#define DEADLINE_WORKER_IDLE_WAITING_TIME_IN_MS 10
+
+/* The classes of received packets. When two packets have the same deadline, 
+the packet of the class listed first is processed first. */
+typedef enum _DeadlineClass{
+    DEADLINE_CLASS_TIME_CRITICAL = 0,
+    DEADLINE_CLASS_JOIN_REQUEST = 1,
+    DEADLINE_CLASS_IPC_COMMAND = 2,
+    DEADLINE_CLASS_TRACKED_OBJECT_DATA = 3,
+    DEADLINE_CLASS_HEALTH_REPORT = 4,
+    NUMBER_OF_DEADLINE_CLASSES = 5,
+} DeadlineClass;
+
+/* The function to process a buffer node of a class */
+typedef void *(*DeadlineRoutine)(void *_buffer_node);
+
+typedef struct {
+
+    /* The latency budget in seconds of the class */
+    int budget_in_sec;
+
+    /* The function to process the packets of the class */
+    DeadlineRoutine routine;
+
+    /* The buffer nodes of the class in the order they were received. The 
+       budget is the same for all of them, so this order is also the order 
+       of their deadlines. */
+    struct List_Entry list_head;
+
+    /* The number of packets waiting in the queue */
+    int number_of_queued_packets;
+
+    /* The number of packets taken from the queue */
+    int number_of_dispatched_packets;
+
+    /* The number of packets taken after their deadline */
+    int number_of_deadline_misses;
+
+    /* The largest time in seconds a packet was taken after its deadline */
+    int max_deadline_miss_in_sec;
+
+} DeadlineQueue;
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    DeadlineQueue queues[NUMBER_OF_DEADLINE_CLASSES];
+
+} DeadlineScheduler;
+
+/*
+  init_deadline_scheduler:
+
+     This function initializes the queues of the deadline scheduler.
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+  Return value:
+
+     None
+
+ */
+
+void init_deadline_scheduler(DeadlineScheduler *scheduler);
+
+/*
+  set_deadline_class:
+
+     This function sets the latency budget and the processing function of a 
+     class.
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+     deadline_class - The class of packets
+
+     budget_in_sec - The latency budget in seconds of the class
+
+     routine - The function to process the packets of the class
+
+  Return value:
+
+     None
+
+ */
+
+void set_deadline_class(DeadlineScheduler *scheduler,
+                        DeadlineClass deadline_class,
+                        int budget_in_sec,
+                        DeadlineRoutine routine);
+
+/*
+  destroy_deadline_scheduler:
+
+     This function releases the buffer nodes still waiting in the queues 
+     back to node_mempool.
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_deadline_scheduler(DeadlineScheduler *scheduler);
+
+/*
+  enqueue_deadline_packet:
+
+     This function appends a received buffer node to the queue of its class.
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+     deadline_class - The class of the packet
+
+     buffer_node - The buffer node of the packet. Its uptime_at_receive is 
+                   the start of its latency budget.
+
+  Return value:
+
+     None
+
+ */
+
+void enqueue_deadline_packet(DeadlineScheduler *scheduler,
+                             DeadlineClass deadline_class,
+                             BufferNode *buffer_node);
+
+/*
+  dequeue_deadline_packet:
+
+     This function removes the packet with the earliest deadline among the 
+     heads of all queues and counts a deadline miss if the deadline has 
+     passed.
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+     deadline_class - The output class of the packet
+
+  Return value:
+
+     BufferNode * - The buffer node of the packet, or NULL if all queues are 
+                    empty
+
+ */
+
+BufferNode *dequeue_deadline_packet(DeadlineScheduler *scheduler,
+                                    DeadlineClass *deadline_class);
+
+/*
+  get_number_of_deadline_packets:
+
+     This function returns the number of packets waiting in all queues.
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+  Return value:
+
+     int - The number of packets waiting
+
+ */
+
+int get_number_of_deadline_packets(DeadlineScheduler *scheduler);
+
+/*
+  deadline_worker_routine:
+
+     This function takes packets in the order of their deadlines and 
+     processes each of them with the function of its class until 
+     ready_to_work becomes false.
+
+  Parameters:
+
+     _scheduler - The pointer to the deadline scheduler
+
+  Return value:
+
+     None
+
+ */
+
+void *deadline_worker_routine(void *_scheduler);
+
+/*
+  get_deadline_scheduler_report:
+
+     This function writes the counters of each class into buf with the 
+     format "edf_<class>=dispatched/misses/max_miss_in_sec/queued;".
+
+  Parameters:
+
+     scheduler - The pointer to the deadline scheduler
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     int - The number of bytes written into buf
+
+ */
+
+int get_deadline_scheduler_report(DeadlineScheduler *scheduler,
+                                  char *buf,
+                                  size_t buf_len);
+
+#endif
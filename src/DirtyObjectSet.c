@@ -0,0 +1,288 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     DirtyObjectSet.c
+
+  File Description:
+
+     This file provides APIs to record which objects received new tracking
+     data, so the location summarization only processes those objects.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "DirtyObjectSet.h"
+
+static int get_dirty_object_bucket(char *mac_address){
+
+    unsigned int hash = 5381;
+    char *current_char = mac_address;
+
+    while(*current_char != '\0'){
+        hash = ((hash << 5) + hash) + (unsigned char) *current_char;
+        current_char++;
+    }
+
+    return hash % NUMBER_OF_DIRTY_OBJECT_BUCKETS;
+}
+
+void init_dirty_object_set(DirtyObjectSetHead *dirty_object_set_head){
+
+    int i;
+
+    pthread_mutex_init(&dirty_object_set_head->list_lock, 0);
+
+    for(i = 0; i < NUMBER_OF_DIRTY_OBJECT_BUCKETS; i++){
+        init_entry(&dirty_object_set_head->bucket_list_head[i]);
+    }
+
+    init_entry(&dirty_object_set_head->list_head);
+
+    dirty_object_set_head->number_of_objects = 0;
+}
+
+void destroy_dirty_object_set(DirtyObjectSetHead *dirty_object_set_head){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    DirtyObjectNode *current_list_ptr = NULL;
+
+    pthread_mutex_lock(&dirty_object_set_head->list_lock);
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &dirty_object_set_head->list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     DirtyObjectNode,
+                                     dirty_object_list_entry);
+
+        remove_list_node(&current_list_ptr->bucket_list_entry);
+        remove_list_node(&current_list_ptr->dirty_object_list_entry);
+
+        mp_free(&dirty_object_mempool, current_list_ptr);
+    }
+
+    dirty_object_set_head->number_of_objects = 0;
+
+    pthread_mutex_unlock(&dirty_object_set_head->list_lock);
+}
+
+ErrorCode mark_object_dirty(DirtyObjectSetHead *dirty_object_set_head,
+                            char *mac_address,
+                            int event_time){
+
+    int bucket = 0;
+    List_Entry *current_list_entry = NULL;
+    DirtyObjectNode *current_list_ptr = NULL;
+    DirtyObjectNode *new_node = NULL;
+    int retry_times = 0;
+
+    if(mac_address == NULL || strlen(mac_address) == 0 ||
+       strlen(mac_address) >= LENGTH_OF_MAC_ADDRESS){
+        return E_INPUT_PARAMETER;
+    }
+
+    bucket = get_dirty_object_bucket(mac_address);
+
+    pthread_mutex_lock(&dirty_object_set_head->list_lock);
+
+    list_for_each(current_list_entry,
+                  &dirty_object_set_head->bucket_list_head[bucket]){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     DirtyObjectNode,
+                                     bucket_list_entry);
+
+        if(strncmp(current_list_ptr->mac_address,
+                   mac_address,
+                   LENGTH_OF_MAC_ADDRESS) == 0){
+
+            /* Keep the oldest unsummarized event time, so an object seen 
+               more often than the allowed lateness is still collected once 
+               its oldest row passes the watermark */
+            if(event_time < current_list_ptr->event_time){
+                current_list_ptr->event_time = event_time;
+            }
+
+            pthread_mutex_unlock(&dirty_object_set_head->list_lock);
+            return WORK_SUCCESSFULLY;
+        }
+    }
+
+    retry_times = MEMORY_ALLOCATE_RETRIES;
+    while(retry_times --){
+        new_node = mp_alloc(&dirty_object_mempool);
+        if(NULL != new_node)
+            break;
+    }
+    if(NULL == new_node){
+        pthread_mutex_unlock(&dirty_object_set_head->list_lock);
+
+        zlog_error(category_debug,
+                   "mark_object_dirty (new_node) mp_alloc failed, " \
+                   "abort this data");
+        return E_MALLOC;
+    }
+
+    memset(new_node, 0, sizeof(DirtyObjectNode));
+
+    init_entry(&new_node->bucket_list_entry);
+    init_entry(&new_node->dirty_object_list_entry);
+
+    strcpy(new_node->mac_address, mac_address);
+    new_node->event_time = event_time;
+
+    insert_list_tail(&new_node->bucket_list_entry,
+                     &dirty_object_set_head->bucket_list_head[bucket]);
+    insert_list_tail(&new_node->dirty_object_list_entry,
+                     &dirty_object_set_head->list_head);
+
+    dirty_object_set_head->number_of_objects++;
+
+    pthread_mutex_unlock(&dirty_object_set_head->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+int mark_objects_dirty(DirtyObjectSetHead *dirty_object_set_head,
+                       char *mac_address_list,
+                       int event_time){
+
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+    char *current_position = mac_address_list;
+    char *next_delimiter = NULL;
+    size_t mac_address_len = 0;
+    int number_of_marked = 0;
+
+    while(NULL != current_position && '\0' != *current_position){
+
+        next_delimiter = strstr(current_position, DELIMITER_COMMA);
+        if(NULL == next_delimiter){
+            mac_address_len = strlen(current_position);
+        }else{
+            mac_address_len = next_delimiter - current_position;
+        }
+
+        if(mac_address_len < sizeof(mac_address)){
+
+            memset(mac_address, 0, sizeof(mac_address));
+            memcpy(mac_address, current_position, mac_address_len);
+
+            if(WORK_SUCCESSFULLY == mark_object_dirty(dirty_object_set_head,
+                                                      mac_address,
+                                                      event_time)){
+                number_of_marked++;
+            }
+        }
+
+        if(NULL == next_delimiter){
+            break;
+        }
+        current_position = next_delimiter + strlen(DELIMITER_COMMA);
+    }
+
+    return number_of_marked;
+}
+
+int get_number_of_dirty_objects(DirtyObjectSetHead *dirty_object_set_head){
+
+    int number_of_objects = 0;
+
+    pthread_mutex_lock(&dirty_object_set_head->list_lock);
+
+    number_of_objects = dirty_object_set_head->number_of_objects;
+
+    pthread_mutex_unlock(&dirty_object_set_head->list_lock);
+
+    return number_of_objects;
+}
+
+int collect_dirty_objects(DirtyObjectSetHead *dirty_object_set_head,
+                          char *buf,
+                          size_t buf_len,
+                          int max_objects,
+                          int watermark){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    DirtyObjectNode *current_list_ptr = NULL;
+    int number_of_collected = 0;
+    size_t used_len = 0;
+    size_t mac_address_len = 0;
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&dirty_object_set_head->list_lock);
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &dirty_object_set_head->list_head){
+
+        if(number_of_collected >= max_objects){
+            break;
+        }
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     DirtyObjectNode,
+                                     dirty_object_list_entry);
+
+        if(watermark > 0 && current_list_ptr->event_time > watermark){
+            continue;
+        }
+
+        mac_address_len = strlen(current_list_ptr->mac_address);
+
+        /* Keep room for the delimiter and the terminating character */
+        if(used_len + mac_address_len + 2 > buf_len){
+            break;
+        }
+
+        if(number_of_collected > 0){
+            strcat(buf, DELIMITER_COMMA);
+            used_len += strlen(DELIMITER_COMMA);
+        }
+        strcat(buf, current_list_ptr->mac_address);
+        used_len += mac_address_len;
+
+        remove_list_node(&current_list_ptr->bucket_list_entry);
+        remove_list_node(&current_list_ptr->dirty_object_list_entry);
+
+        mp_free(&dirty_object_mempool, current_list_ptr);
+
+        dirty_object_set_head->number_of_objects--;
+        number_of_collected++;
+    }
+
+    pthread_mutex_unlock(&dirty_object_set_head->list_lock);
+
+    return number_of_collected;
+}
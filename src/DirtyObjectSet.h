@@ -0,0 +1,229 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     DirtyObjectSet.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in DirtyObjectSet.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef DIRTY_OBJECT_SET_H
+#define DIRTY_OBJECT_SET_H
+
+#include "BeDIS.h"
+
+/* Number of hash buckets used to look up objects in the dirty object set */
+#define NUMBER_OF_DIRTY_OBJECT_BUCKETS 1024
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The hash buckets used to check whether an object is already in the
+       set */
+    struct List_Entry bucket_list_head[NUMBER_OF_DIRTY_OBJECT_BUCKETS];
+
+    /* The list of objects in the order they were marked as dirty */
+    struct List_Entry list_head;
+
+    /* The number of objects currently in the set */
+    int number_of_objects;
+
+} DirtyObjectSetHead;
+
+typedef struct {
+
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+
+    /* The oldest event time in seconds since epoch of the tracking data of 
+       the object not summarized yet */
+    int event_time;
+
+    /* The list entry for inserting the node into its hash bucket */
+    List_Entry bucket_list_entry;
+
+    /* The list entry for inserting the node into the ordered list */
+    List_Entry dirty_object_list_entry;
+
+} DirtyObjectNode;
+
+/* global variables */
+
+/* The mempool for the dirty object node structures */
+Memory_Pool dirty_object_mempool;
+
+/*
+  init_dirty_object_set:
+
+     This function initializes the set of objects which received new tracking
+     data since the last location summarization.
+
+  Parameters:
+
+     dirty_object_set_head - The pointer to the head of the dirty object set
+
+  Return value:
+
+     None
+
+ */
+
+void init_dirty_object_set(DirtyObjectSetHead *dirty_object_set_head);
+
+/*
+  destroy_dirty_object_set:
+
+     This function releases all nodes in the dirty object set back to the
+     memory pool.
+
+  Parameters:
+
+     dirty_object_set_head - The pointer to the head of the dirty object set
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_dirty_object_set(DirtyObjectSetHead *dirty_object_set_head);
+
+/*
+  mark_object_dirty:
+
+     This function is called by the ingestion path after new tracking rows of
+     an object are stored in tracking_table. An object already in the set is
+     not inserted again, but keeps the oldest event time of its rows.
+
+  Parameters:
+
+     dirty_object_set_head - The pointer to the head of the dirty object set
+
+     mac_address - The MAC address of the object with new tracking data
+
+     event_time - The event time in seconds since epoch of the new tracking 
+                  data
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_MALLOC: no free node in dirty_object_mempool.
+
+ */
+
+ErrorCode mark_object_dirty(DirtyObjectSetHead *dirty_object_set_head,
+                            char *mac_address,
+                            int event_time);
+
+/*
+  mark_objects_dirty:
+
+     This function marks again the objects collected by 
+     collect_dirty_objects whose batch failed to be summarized, so they are 
+     summarized by a later run instead of being lost.
+
+  Parameters:
+
+     dirty_object_set_head - The pointer to the head of the dirty object set
+
+     mac_address_list - The MAC addresses separated by DELIMITER_COMMA, as 
+                        written by collect_dirty_objects
+
+     event_time - The event time in seconds since epoch to mark the objects 
+                  with. The watermark of the failed batch keeps them 
+                  collectable by the next run.
+
+  Return value:
+
+     int - The number of objects marked
+
+ */
+
+int mark_objects_dirty(DirtyObjectSetHead *dirty_object_set_head,
+                       char *mac_address_list,
+                       int event_time);
+
+/*
+  get_number_of_dirty_objects:
+
+     This function returns the number of objects waiting to be summarized.
+
+  Parameters:
+
+     dirty_object_set_head - The pointer to the head of the dirty object set
+
+  Return value:
+
+     int - The number of objects in the set
+
+ */
+
+int get_number_of_dirty_objects(DirtyObjectSetHead *dirty_object_set_head);
+
+/*
+  collect_dirty_objects:
+
+     This function removes at most max_objects objects from the set and
+     writes their MAC addresses into buf separated by DELIMITER_COMMA. The
+     objects are removed in the order they were marked. Objects whose oldest 
+     unsummarized tracking data is later than the watermark stay in the set 
+     until the watermark passes it.
+
+  Parameters:
+
+     dirty_object_set_head - The pointer to the head of the dirty object set
+
+     buf - The output buffer of MAC addresses
+
+     buf_len - Length in number of bytes of buf
+
+     max_objects - The maximum number of objects to be collected
+
+     watermark - The event-time watermark in seconds since epoch. 0 collects 
+                 objects regardless of their event time.
+
+  Return value:
+
+     int - The number of objects collected into buf
+
+ */
+
+int collect_dirty_objects(DirtyObjectSetHead *dirty_object_set_head,
+                          char *buf,
+                          size_t buf_len,
+                          int max_objects,
+                          int watermark);
+
+#endif
@@ -0,0 +1,242 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     EventWatermark.c
+
+  File Description:
+
+     This file provides APIs to track the event time of tracking data from
+     each gateway, so the location summarization only closes windows which
+     no gateway can still add rows to, and late rows are detected.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "EventWatermark.h"
+#include "ClockCache.h"
+
+/* Returns the entry of the gateway, taking a free entry for a new gateway. 
+   NULL is returned when all entries are used. The caller must hold the list 
+   lock. */
+static EventWatermarkGateway *find_event_watermark_gateway(
+    EventWatermarkState *state,
+    char *net_address){
+
+    EventWatermarkGateway *free_gateway = NULL;
+    int i;
+
+    for(i = 0; i < MAX_NUMBER_NODES; i++){
+
+        if(false == state->gateways[i].is_used){
+            if(NULL == free_gateway){
+                free_gateway = &state->gateways[i];
+            }
+            continue;
+        }
+
+        if(strncmp(state->gateways[i].net_address, 
+                   net_address, 
+                   NETWORK_ADDR_LENGTH) == 0){
+
+            return &state->gateways[i];
+        }
+    }
+
+    if(NULL != free_gateway){
+
+        memset(free_gateway, 0, sizeof(EventWatermarkGateway));
+
+        free_gateway->is_used = true;
+        strncpy(free_gateway->net_address, 
+                net_address, 
+                NETWORK_ADDR_LENGTH - 1);
+    }
+
+    return free_gateway;
+}
+
+void init_event_watermark(EventWatermarkState *state,
+                          int allowed_lateness_in_sec){
+
+    memset(state->gateways, 0, sizeof(state->gateways));
+
+    pthread_mutex_init(&state->list_lock, 0);
+
+    state->allowed_lateness_in_sec = allowed_lateness_in_sec;
+    state->watermark = 0;
+    state->number_of_late_rows = 0;
+}
+
+bool observe_event_time(EventWatermarkState *state,
+                        char *net_address,
+                        int event_time){
+
+    EventWatermarkGateway *gateway = NULL;
+    bool is_late = false;
+    int lateness = 0;
+
+    if(state->allowed_lateness_in_sec <= 0 || NULL == net_address){
+        return false;
+    }
+
+    pthread_mutex_lock(&state->list_lock);
+
+    gateway = find_event_watermark_gateway(state, net_address);
+
+    if(NULL != gateway){
+
+        gateway->number_of_rows++;
+        gateway->last_receive_time = get_cached_clock_time();
+
+        if(event_time > gateway->max_event_time){
+            gateway->max_event_time = event_time;
+        }
+
+        lateness = gateway->max_event_time - event_time;
+
+        if(lateness > gateway->max_observed_lateness_in_sec){
+            gateway->max_observed_lateness_in_sec = lateness;
+        }
+
+        /* A row behind the watermark of the whole server belongs to a 
+           window which may already be closed, even if the gateway itself 
+           is on time */
+        if(lateness > state->allowed_lateness_in_sec || 
+           event_time <= state->watermark){
+
+            gateway->number_of_late_rows++;
+            state->number_of_late_rows++;
+            is_late = true;
+        }
+    }
+
+    pthread_mutex_unlock(&state->list_lock);
+
+    return is_late;
+}
+
+int get_event_watermark(EventWatermarkState *state){
+
+    int current_time = get_cached_clock_time();
+    int watermark = 0;
+    int gateway_watermark = 0;
+    bool has_active_gateway = false;
+    int i;
+
+    if(state->allowed_lateness_in_sec <= 0){
+        return 0;
+    }
+
+    pthread_mutex_lock(&state->list_lock);
+
+    for(i = 0; i < MAX_NUMBER_NODES; i++){
+
+        if(false == state->gateways[i].is_used ||
+           current_time - state->gateways[i].last_receive_time > 
+           EVENT_WATERMARK_IDLE_TIMEOUT_IN_SEC){
+            continue;
+        }
+
+        gateway_watermark = state->gateways[i].max_event_time - 
+                            state->allowed_lateness_in_sec;
+
+        if(false == has_active_gateway || gateway_watermark < watermark){
+            watermark = gateway_watermark;
+        }
+        has_active_gateway = true;
+    }
+
+    if(false == has_active_gateway){
+        watermark = get_cached_system_time() - state->allowed_lateness_in_sec;
+    }
+
+    if(watermark > state->watermark){
+        state->watermark = watermark;
+    }
+
+    watermark = state->watermark;
+
+    pthread_mutex_unlock(&state->list_lock);
+
+    return watermark;
+}
+
+int get_event_watermark_report(EventWatermarkState *state,
+                               bool is_per_gateway,
+                               char *buf,
+                               size_t buf_len){
+
+    char one_gateway[NETWORK_ADDR_LENGTH + 64];
+    size_t used_len = 0;
+    int i;
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&state->list_lock);
+
+    memset(one_gateway, 0, sizeof(one_gateway));
+    sprintf(one_gateway, 
+            "event_watermark=%d;watermark_lag=%d;late_rows=%d;",
+            state->watermark,
+            (0 == state->watermark) ? 
+                0 : get_cached_system_time() - state->watermark,
+            state->number_of_late_rows);
+
+    if(strlen(one_gateway) + 1 <= buf_len){
+        strcpy(buf, one_gateway);
+        used_len = strlen(one_gateway);
+    }
+
+    for(i = 0; true == is_per_gateway && i < MAX_NUMBER_NODES; i++){
+
+        if(false == state->gateways[i].is_used){
+            continue;
+        }
+
+        memset(one_gateway, 0, sizeof(one_gateway));
+        sprintf(one_gateway, "%s=%d/%d/%d;",
+                state->gateways[i].net_address,
+                state->gateways[i].number_of_rows,
+                state->gateways[i].number_of_late_rows,
+                state->gateways[i].max_observed_lateness_in_sec);
+
+        if(used_len + strlen(one_gateway) + 1 > buf_len){
+            break;
+        }
+
+        strcpy(buf + used_len, one_gateway);
+        used_len += strlen(one_gateway);
+    }
+
+    pthread_mutex_unlock(&state->list_lock);
+
+    return (int) used_len;
+}
@@ -0,0 +1,194 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     EventWatermark.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in EventWatermark.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef EVENT_WATERMARK_H
+#define EVENT_WATERMARK_H
+
+#include "BeDIS.h"
+
+/* The time in seconds after which a gateway without new tracking data no 
+longer holds back the watermark */
+#define EVENT_WATERMARK_IDLE_TIMEOUT_IN_SEC 30
+
+typedef struct {
+
+    bool is_used;
+
+    char net_address[NETWORK_ADDR_LENGTH];
+
+    /* The latest event time in seconds since epoch of the rows from the 
+       gateway */
+    int max_event_time;
+
+    /* The time the latest row from the gateway was received */
+    int last_receive_time;
+
+    /* The number of rows received from the gateway */
+    int number_of_rows;
+
+    /* The number of rows older than the watermark of the gateway */
+    int number_of_late_rows;
+
+    /* The largest distance in seconds between max_event_time and the event 
+       time of a row. It shows how far allowed_lateness_in_sec is from the 
+       real disorder of the gateway. */
+    int max_observed_lateness_in_sec;
+
+} EventWatermarkGateway;
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The time in seconds a row may be older than the latest row of its 
+       gateway and still be on time. Zero disables watermarks. */
+    int allowed_lateness_in_sec;
+
+    /* The watermark in seconds since epoch. It never moves backwards, so a 
+       window closed by the location summarization is never reopened. */
+    int watermark;
+
+    /* The number of rows older than the watermark of their gateway, in 
+       total */
+    int number_of_late_rows;
+
+    EventWatermarkGateway gateways[MAX_NUMBER_NODES];
+
+} EventWatermarkState;
+
+/*
+  init_event_watermark:
+
+     This function initializes the watermark state.
+
+  Parameters:
+
+     state - The pointer to the watermark state
+
+     allowed_lateness_in_sec - The time in seconds a row may be older than 
+                               the latest row of its gateway. Zero disables 
+                               watermarks.
+
+  Return value:
+
+     None
+
+ */
+
+void init_event_watermark(EventWatermarkState *state,
+                          int allowed_lateness_in_sec);
+
+/*
+  observe_event_time:
+
+     This function advances the watermark of the gateway with the event time 
+     of a row and tells whether the row is late. A row is late when it is 
+     older than the latest row of its gateway by more than 
+     allowed_lateness_in_sec.
+
+  Parameters:
+
+     state - The pointer to the watermark state
+
+     net_address - The address of the gateway which sent the row
+
+     event_time - The event time of the row in seconds since epoch
+
+  Return value:
+
+     bool - true if the row is late, false otherwise or when watermarks are 
+            disabled
+
+ */
+
+bool observe_event_time(EventWatermarkState *state,
+                        char *net_address,
+                        int event_time);
+
+/*
+  get_event_watermark:
+
+     This function advances and returns the watermark. It is the smallest 
+     watermark of the gateways which sent rows within 
+     EVENT_WATERMARK_IDLE_TIMEOUT_IN_SEC. The current time minus 
+     allowed_lateness_in_sec is used when no gateway is active.
+
+  Parameters:
+
+     state - The pointer to the watermark state
+
+  Return value:
+
+     int - The watermark in seconds since epoch, or 0 when watermarks are 
+           disabled
+
+ */
+
+int get_event_watermark(EventWatermarkState *state);
+
+/*
+  get_event_watermark_report:
+
+     This function writes the watermark and the late rows into buf.
+
+  Parameters:
+
+     state - The pointer to the watermark state
+
+     is_per_gateway - The flag indicating whether the counters of each 
+                      gateway are included
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     int - The number of bytes written into buf
+
+ */
+
+int get_event_watermark_report(EventWatermarkState *state,
+                               bool is_per_gateway,
+                               char *buf,
+                               size_t buf_len);
+
+#endif
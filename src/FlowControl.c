@@ -0,0 +1,309 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     FlowControl.c
+
+  File Description:
+
+     This file provides APIs to decide when gateways are asked to slow down
+     according to the occupancy of the receive queues, and to measure
+     whether each gateway follows the request.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "FlowControl.h"
+
+/* Returns the entry of the gateway, taking a free entry for a new gateway. 
+   NULL is returned when all entries are used. The caller must hold the list 
+   lock. */
+static FlowControlGateway *find_flow_control_gateway(FlowControlState *state,
+                                                     char *net_address){
+
+    FlowControlGateway *free_gateway = NULL;
+    int i;
+
+    for(i = 0; i < MAX_NUMBER_NODES; i++){
+
+        if(false == state->gateways[i].is_used){
+            if(NULL == free_gateway){
+                free_gateway = &state->gateways[i];
+            }
+            continue;
+        }
+
+        if(strncmp(state->gateways[i].net_address, 
+                   net_address, 
+                   NETWORK_ADDR_LENGTH) == 0){
+
+            return &state->gateways[i];
+        }
+    }
+
+    if(NULL != free_gateway){
+
+        memset(free_gateway, 0, sizeof(FlowControlGateway));
+
+        free_gateway->is_used = true;
+        strncpy(free_gateway->net_address, 
+                net_address, 
+                NETWORK_ADDR_LENGTH - 1);
+    }
+
+    return free_gateway;
+}
+
+void init_flow_control(FlowControlState *state,
+                       int capacity,
+                       int high_watermark_in_percent,
+                       int low_watermark_in_percent,
+                       int critical_watermark_in_percent,
+                       int normal_interval_in_sec){
+
+    memset(state->gateways, 0, sizeof(state->gateways));
+
+    pthread_mutex_init(&state->list_lock, 0);
+
+    state->level = FLOW_CONTROL_NORMAL;
+    state->capacity = capacity;
+    state->high_watermark_in_percent = high_watermark_in_percent;
+    state->low_watermark_in_percent = low_watermark_in_percent;
+    state->critical_watermark_in_percent = critical_watermark_in_percent;
+    state->normal_interval_in_sec = normal_interval_in_sec;
+    state->occupancy_in_percent = 0;
+    state->number_of_pending_allocation_failures = 0;
+    state->number_of_allocation_failures = 0;
+    state->number_of_level_changes = 0;
+    state->last_broadcast_time = 0;
+}
+
+bool update_flow_control_level(FlowControlState *state,
+                               int number_of_queued_nodes,
+                               int current_time){
+
+    FlowControlLevel new_level = FLOW_CONTROL_NORMAL;
+    bool is_to_broadcast = false;
+
+    pthread_mutex_lock(&state->list_lock);
+
+    if(0 == state->high_watermark_in_percent || 0 >= state->capacity){
+        pthread_mutex_unlock(&state->list_lock);
+        return false;
+    }
+
+    state->occupancy_in_percent = number_of_queued_nodes * 100 / 
+                                  state->capacity;
+
+    new_level = state->level;
+
+    if(state->occupancy_in_percent >= state->critical_watermark_in_percent ||
+       state->number_of_pending_allocation_failures > 0){
+
+        new_level = FLOW_CONTROL_DEFER_NON_CRITICAL;
+
+    }else if(state->occupancy_in_percent >= state->high_watermark_in_percent){
+
+        if(FLOW_CONTROL_NORMAL == state->level){
+            new_level = FLOW_CONTROL_SLOW_DOWN;
+        }
+
+    }else if(state->occupancy_in_percent <= state->low_watermark_in_percent){
+
+        new_level = FLOW_CONTROL_NORMAL;
+
+    }else if(FLOW_CONTROL_DEFER_NON_CRITICAL == state->level){
+
+        /* Between the watermarks the level only steps down from deferring 
+           to slowing down, and otherwise stays */
+        new_level = FLOW_CONTROL_SLOW_DOWN;
+    }
+
+    state->number_of_pending_allocation_failures = 0;
+
+    if(new_level != state->level){
+
+        zlog_info(category_debug, 
+                  "Flow control level changes from [%d] to [%d], " \
+                  "queue occupancy [%d]%%",
+                  state->level, new_level, state->occupancy_in_percent);
+
+        state->level = new_level;
+        state->number_of_level_changes++;
+
+        is_to_broadcast = true;
+
+    }else if(FLOW_CONTROL_NORMAL != state->level &&
+             current_time - state->last_broadcast_time >= 
+             FLOW_CONTROL_RESEND_INTERVAL_IN_SEC){
+
+        is_to_broadcast = true;
+    }
+
+    if(true == is_to_broadcast){
+        state->last_broadcast_time = current_time;
+    }
+
+    pthread_mutex_unlock(&state->list_lock);
+
+    return is_to_broadcast;
+}
+
+FlowControlLevel get_flow_control_level(FlowControlState *state){
+
+    FlowControlLevel level = FLOW_CONTROL_NORMAL;
+
+    pthread_mutex_lock(&state->list_lock);
+
+    level = state->level;
+
+    pthread_mutex_unlock(&state->list_lock);
+
+    return level;
+}
+
+void record_flow_control_allocation_failure(FlowControlState *state){
+
+    pthread_mutex_lock(&state->list_lock);
+
+    state->number_of_pending_allocation_failures++;
+    state->number_of_allocation_failures++;
+
+    pthread_mutex_unlock(&state->list_lock);
+}
+
+void record_flow_control_packet(FlowControlState *state,
+                                char *net_address,
+                                int pkt_type,
+                                int current_time){
+
+    FlowControlGateway *gateway = NULL;
+    bool is_non_critical = false;
+
+    is_non_critical = (tracked_object_data == pkt_type ||
+                       gateway_health_report == pkt_type ||
+                       beacon_health_report == pkt_type);
+
+    pthread_mutex_lock(&state->list_lock);
+
+    gateway = find_flow_control_gateway(state, net_address);
+    if(NULL == gateway){
+        pthread_mutex_unlock(&state->list_lock);
+        return;
+    }
+
+    gateway->number_of_packets++;
+
+    if(true == is_non_critical && FLOW_CONTROL_NORMAL != state->level){
+
+        gateway->number_of_throttled_packets++;
+
+        if(FLOW_CONTROL_DEFER_NON_CRITICAL == state->level){
+
+            gateway->number_of_non_compliant_packets++;
+
+        }else if(tracked_object_data == pkt_type &&
+                 current_time - gateway->last_tracked_object_data_time < 
+                 state->normal_interval_in_sec * 
+                 FLOW_CONTROL_SLOW_DOWN_FACTOR){
+
+            gateway->number_of_non_compliant_packets++;
+        }
+    }
+
+    if(tracked_object_data == pkt_type){
+        gateway->last_tracked_object_data_time = current_time;
+    }
+
+    pthread_mutex_unlock(&state->list_lock);
+}
+
+int get_flow_control_report(FlowControlState *state,
+                            bool is_per_gateway,
+                            char *buf,
+                            size_t buf_len){
+
+    char one_gateway[NETWORK_ADDR_LENGTH + 64];
+    int number_of_non_compliant_gateways = 0;
+    size_t used_len = 0;
+    int i;
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&state->list_lock);
+
+    for(i = 0; i < MAX_NUMBER_NODES; i++){
+        if(true == state->gateways[i].is_used &&
+           state->gateways[i].number_of_non_compliant_packets > 0){
+            number_of_non_compliant_gateways++;
+        }
+    }
+
+    memset(one_gateway, 0, sizeof(one_gateway));
+    sprintf(one_gateway, 
+            "flow_control_level=%d;queue_occupancy=%d;" \
+            "allocation_failures=%d;level_changes=%d;" \
+            "non_compliant_gateways=%d;",
+            state->level,
+            state->occupancy_in_percent,
+            state->number_of_allocation_failures,
+            state->number_of_level_changes,
+            number_of_non_compliant_gateways);
+
+    if(strlen(one_gateway) + 1 <= buf_len){
+        strcpy(buf, one_gateway);
+        used_len = strlen(one_gateway);
+    }
+
+    for(i = 0; true == is_per_gateway && i < MAX_NUMBER_NODES; i++){
+
+        if(false == state->gateways[i].is_used){
+            continue;
+        }
+
+        memset(one_gateway, 0, sizeof(one_gateway));
+        sprintf(one_gateway, "%s=%d/%d/%d;",
+                state->gateways[i].net_address,
+                state->gateways[i].number_of_packets,
+                state->gateways[i].number_of_throttled_packets,
+                state->gateways[i].number_of_non_compliant_packets);
+
+        if(used_len + strlen(one_gateway) + 1 > buf_len){
+            break;
+        }
+
+        strcpy(buf + used_len, one_gateway);
+        used_len += strlen(one_gateway);
+    }
+
+    pthread_mutex_unlock(&state->list_lock);
+
+    return (int) used_len;
+}
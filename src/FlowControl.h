@@ -0,0 +1,304 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     FlowControl.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in FlowControl.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef FLOW_CONTROL_H
+#define FLOW_CONTROL_H
+
+#include "BeDIS.h"
+
+/* The packet type of flow control messages sent from the server to gateways. 
+The packet types in BeDIS.h do not include flow control, so a value above all 
+of them is used. Gateways which do not know this type drop the message. */
+#define FLOW_CONTROL_PKT_TYPE 64
+
+/* The time interval in seconds between two consecutive broadcasts of the 
+same flow control level. The level is broadcast again because UDP messages 
+may be lost. */
+#define FLOW_CONTROL_RESEND_INTERVAL_IN_SEC 5
+
+/* The factor by which gateways are asked to stretch the interval between 
+tracked object data and to enlarge their batches at FLOW_CONTROL_SLOW_DOWN. 
+The server polls gateways less often by the same factor. */
+#define FLOW_CONTROL_SLOW_DOWN_FACTOR 2
+
+/* The levels of flow control. The message to gateways has the format 
+"from_server;FLOW_CONTROL_PKT_TYPE;API_version;level;slow_down_factor;". */
+typedef enum _FlowControlLevel{
+    /* Gateways send at their normal rate */
+    FLOW_CONTROL_NORMAL = 0,
+    /* Gateways stretch the interval between tracked object data and batch 
+       more objects in each message */
+    FLOW_CONTROL_SLOW_DOWN = 1,
+    /* Gateways only send join requests and time-critical tracked object data, 
+       and defer the other types until the level drops */
+    FLOW_CONTROL_DEFER_NON_CRITICAL = 2,
+} FlowControlLevel;
+
+typedef struct {
+
+    bool is_used;
+
+    char net_address[NETWORK_ADDR_LENGTH];
+
+    /* The number of packets received from the gateway */
+    int number_of_packets;
+
+    /* The number of non-critical packets received while the level is not 
+       FLOW_CONTROL_NORMAL */
+    int number_of_throttled_packets;
+
+    /* The number of non-critical packets which ignored the flow control 
+       level. They arrived at FLOW_CONTROL_DEFER_NON_CRITICAL, or arrived 
+       at FLOW_CONTROL_SLOW_DOWN sooner than the stretched interval. */
+    int number_of_non_compliant_packets;
+
+    /* The time the latest tracked object data was received */
+    int last_tracked_object_data_time;
+
+} FlowControlGateway;
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    FlowControlLevel level;
+
+    /* The occupancy in percent of the receive queues at and above which the 
+       level is raised to FLOW_CONTROL_SLOW_DOWN. Zero disables flow 
+       control. */
+    int high_watermark_in_percent;
+
+    /* The occupancy in percent at and below which the level drops back to 
+       FLOW_CONTROL_NORMAL */
+    int low_watermark_in_percent;
+
+    /* The occupancy in percent at and above which the level is raised to 
+       FLOW_CONTROL_DEFER_NON_CRITICAL */
+    int critical_watermark_in_percent;
+
+    /* The number of buffer nodes the receive queues can hold */
+    int capacity;
+
+    /* The occupancy in percent at the latest update */
+    int occupancy_in_percent;
+
+    /* The number of failures to allocate buffer nodes since the latest 
+       update, and in total */
+    int number_of_pending_allocation_failures;
+    int number_of_allocation_failures;
+
+    /* The number of times the level changed */
+    int number_of_level_changes;
+
+    /* The time the level was last broadcast to gateways */
+    int last_broadcast_time;
+
+    /* The expected interval in seconds between tracked object data of a 
+       gateway at FLOW_CONTROL_NORMAL */
+    int normal_interval_in_sec;
+
+    FlowControlGateway gateways[MAX_NUMBER_NODES];
+
+} FlowControlState;
+
+/*
+  init_flow_control:
+
+     This function initializes the flow control state at FLOW_CONTROL_NORMAL.
+
+  Parameters:
+
+     state - The pointer to the flow control state
+
+     capacity - The number of buffer nodes the receive queues can hold
+
+     high_watermark_in_percent - The occupancy to raise the level to 
+                                 FLOW_CONTROL_SLOW_DOWN. Zero disables flow 
+                                 control.
+
+     low_watermark_in_percent - The occupancy to drop the level back to 
+                                FLOW_CONTROL_NORMAL
+
+     critical_watermark_in_percent - The occupancy to raise the level to 
+                                     FLOW_CONTROL_DEFER_NON_CRITICAL
+
+     normal_interval_in_sec - The expected interval in seconds between 
+                              tracked object data of a gateway at 
+                              FLOW_CONTROL_NORMAL
+
+  Return value:
+
+     None
+
+ */
+
+void init_flow_control(FlowControlState *state,
+                       int capacity,
+                       int high_watermark_in_percent,
+                       int low_watermark_in_percent,
+                       int critical_watermark_in_percent,
+                       int normal_interval_in_sec);
+
+/*
+  update_flow_control_level:
+
+     This function decides the flow control level from the number of queued 
+     buffer nodes and the allocation failures since the previous update. 
+     The level is raised as soon as a watermark is reached, but only drops 
+     back to FLOW_CONTROL_NORMAL at the low watermark, so it does not flap 
+     around a single threshold.
+
+  Parameters:
+
+     state - The pointer to the flow control state
+
+     number_of_queued_nodes - The number of buffer nodes in the receive 
+                              queues
+
+     current_time - The current uptime in seconds
+
+  Return value:
+
+     bool - true: the level should be broadcast to gateways, because it 
+                  changed or the resend interval passed.
+            false: nothing needs to be sent.
+
+ */
+
+bool update_flow_control_level(FlowControlState *state,
+                               int number_of_queued_nodes,
+                               int current_time);
+
+/*
+  get_flow_control_level:
+
+     This function returns the current flow control level.
+
+  Parameters:
+
+     state - The pointer to the flow control state
+
+  Return value:
+
+     FlowControlLevel - The current level
+
+ */
+
+FlowControlLevel get_flow_control_level(FlowControlState *state);
+
+/*
+  record_flow_control_allocation_failure:
+
+     This function records a packet dropped because no buffer node could be 
+     allocated. The next update raises the level to 
+     FLOW_CONTROL_DEFER_NON_CRITICAL.
+
+  Parameters:
+
+     state - The pointer to the flow control state
+
+  Return value:
+
+     None
+
+ */
+
+void record_flow_control_allocation_failure(FlowControlState *state);
+
+/*
+  record_flow_control_packet:
+
+     This function records a packet received from a gateway and checks 
+     whether the gateway follows the current flow control level.
+
+  Parameters:
+
+     state - The pointer to the flow control state
+
+     net_address - The address of the gateway
+
+     pkt_type - The packet type of the packet
+
+     current_time - The current uptime in seconds
+
+  Return value:
+
+     None
+
+ */
+
+void record_flow_control_packet(FlowControlState *state,
+                                char *net_address,
+                                int pkt_type,
+                                int current_time);
+
+/*
+  get_flow_control_report:
+
+     This function writes the flow control level and counters into buf in 
+     the format of "flow_control_level=L;queue_occupancy=P;
+     allocation_failures=N;level_changes=N;non_compliant_gateways=N;". If 
+     is_per_gateway is true, one more "address=packets/throttled/
+     non_compliant;" field is written for each gateway.
+
+  Parameters:
+
+     state - The pointer to the flow control state
+
+     is_per_gateway - The flag indicating whether the counters of each 
+                      gateway are written
+
+     buf - The output buffer
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     int - The number of bytes written into buf
+
+ */
+
+int get_flow_control_report(FlowControlState *state,
+                            bool is_per_gateway,
+                            char *buf,
+                            size_t buf_len);
+
+#endif
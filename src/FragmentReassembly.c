@@ -0,0 +1,366 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     FragmentReassembly.c
+
+  File Description:
+
+     This file provides APIs to reassemble a logical report which a gateway
+     splits into several datagrams, so the report can be processed as one
+     batch.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "FragmentReassembly.h"
+#include "ClockCache.h"
+
+static void expire_pending_reports(FragmentReassemblyHead *reassembly_head,
+                                   int current_time){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    ReassemblyNode *current_list_ptr = NULL;
+
+    /* The pending list is in the order the first fragments arrived, so the 
+       scan stops at the first report which has not timed out */
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &reassembly_head->pending_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     ReassemblyNode,
+                                     report_list_entry);
+
+        if(current_time - current_list_ptr->first_fragment_time < 
+           reassembly_head->timeout_in_sec){
+            break;
+        }
+
+        zlog_error(category_debug, 
+                   "report [%d] from [%s] expired with fragments [0x%x] " \
+                   "of [%d]", 
+                   current_list_ptr->report_id,
+                   current_list_ptr->net_address,
+                   current_list_ptr->received_fragments,
+                   current_list_ptr->number_of_fragments);
+
+        remove_list_node(&current_list_ptr->report_list_entry);
+
+        mp_free(&fragment_reassembly_mempool, current_list_ptr);
+
+        reassembly_head->number_of_pending_reports--;
+        reassembly_head->number_of_expired_reports++;
+    }
+}
+
+static void pack_report_fragments(ReassemblyNode *report){
+
+    int i;
+    int offset = 0;
+
+    /* Each fragment moves towards the beginning of the content, so the 
+       fragments not packed yet are never overwritten */
+    for(i = 0; i < report->number_of_fragments; i++){
+        memmove(report->content + offset, 
+                report->content + i * WIFI_MESSAGE_LENGTH, 
+                report->fragment_length[i]);
+        offset += report->fragment_length[i];
+    }
+
+    report->content[offset] = '\0';
+    report->content_size = offset;
+}
+
+void init_fragment_reassembly(FragmentReassemblyHead *reassembly_head,
+                              int timeout_in_sec){
+
+    pthread_mutex_init(&reassembly_head->list_lock, 0);
+
+    init_entry(&reassembly_head->pending_list_head);
+    init_entry(&reassembly_head->completed_list_head);
+
+    reassembly_head->timeout_in_sec = timeout_in_sec;
+    reassembly_head->number_of_pending_reports = 0;
+    reassembly_head->number_of_completed_reports = 0;
+    reassembly_head->number_of_expired_reports = 0;
+    reassembly_head->number_of_duplicate_fragments = 0;
+    reassembly_head->number_of_dropped_fragments = 0;
+}
+
+void destroy_fragment_reassembly(FragmentReassemblyHead *reassembly_head){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    ReassemblyNode *current_list_ptr = NULL;
+
+    pthread_mutex_lock(&reassembly_head->list_lock);
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &reassembly_head->pending_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     ReassemblyNode,
+                                     report_list_entry);
+
+        remove_list_node(&current_list_ptr->report_list_entry);
+
+        mp_free(&fragment_reassembly_mempool, current_list_ptr);
+    }
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &reassembly_head->completed_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     ReassemblyNode,
+                                     report_list_entry);
+
+        remove_list_node(&current_list_ptr->report_list_entry);
+
+        mp_free(&fragment_reassembly_mempool, current_list_ptr);
+    }
+
+    reassembly_head->number_of_pending_reports = 0;
+
+    pthread_mutex_unlock(&reassembly_head->list_lock);
+}
+
+ErrorCode add_report_fragment(FragmentReassemblyHead *reassembly_head,
+                              char *net_address,
+                              float API_version,
+                              char *content,
+                              bool *is_completed){
+
+    int report_id = 0;
+    int fragment_index = 0;
+    int number_of_fragments = 0;
+    int pkt_type = 0;
+    int header_length = 0;
+    int payload_length = 0;
+    char *payload = NULL;
+    int current_time = get_cached_clock_time();
+    List_Entry *current_list_entry = NULL;
+    ReassemblyNode *current_list_ptr = NULL;
+    ReassemblyNode *report = NULL;
+    int retry_times = 0;
+
+    *is_completed = false;
+
+    if(4 != sscanf(content, "%d;%d;%d;%d;%n", 
+                   &report_id, 
+                   &fragment_index, 
+                   &number_of_fragments, 
+                   &pkt_type,
+                   &header_length) ||
+       header_length == 0 ||
+       number_of_fragments <= 0 || 
+       number_of_fragments > MAX_FRAGMENTS_IN_REPORT ||
+       fragment_index < 0 || 
+       fragment_index >= number_of_fragments){
+
+        pthread_mutex_lock(&reassembly_head->list_lock);
+        reassembly_head->number_of_dropped_fragments++;
+        pthread_mutex_unlock(&reassembly_head->list_lock);
+
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    payload = content + header_length;
+    payload_length = strlen(payload);
+
+    /* Keep room for the terminating character of the packed content */
+    if(payload_length >= WIFI_MESSAGE_LENGTH){
+        pthread_mutex_lock(&reassembly_head->list_lock);
+        reassembly_head->number_of_dropped_fragments++;
+        pthread_mutex_unlock(&reassembly_head->list_lock);
+
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    pthread_mutex_lock(&reassembly_head->list_lock);
+
+    expire_pending_reports(reassembly_head, current_time);
+
+    list_for_each(current_list_entry, &reassembly_head->pending_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     ReassemblyNode,
+                                     report_list_entry);
+
+        if(current_list_ptr->report_id == report_id &&
+           strncmp(current_list_ptr->net_address, 
+                   net_address, 
+                   NETWORK_ADDR_LENGTH) == 0){
+
+            report = current_list_ptr;
+            break;
+        }
+    }
+
+    if(NULL == report){
+
+        retry_times = MEMORY_ALLOCATE_RETRIES;
+        while(retry_times --){
+            report = mp_alloc(&fragment_reassembly_mempool);
+            if(NULL != report)
+                break;
+        }
+        if(NULL == report){
+            reassembly_head->number_of_dropped_fragments++;
+
+            pthread_mutex_unlock(&reassembly_head->list_lock);
+
+            zlog_error(category_debug,
+                       "add_report_fragment (report) mp_alloc failed, " \
+                       "abort this data");
+            return E_MALLOC;
+        }
+
+        memset(report, 0, sizeof(ReassemblyNode));
+
+        init_entry(&report->report_list_entry);
+
+        strncpy(report->net_address, net_address, NETWORK_ADDR_LENGTH - 1);
+        report->report_id = report_id;
+        report->pkt_type = pkt_type;
+        report->API_version = API_version;
+        report->number_of_fragments = number_of_fragments;
+        report->first_fragment_time = current_time;
+
+        insert_list_tail(&report->report_list_entry,
+                         &reassembly_head->pending_list_head);
+
+        reassembly_head->number_of_pending_reports++;
+
+    }else if(report->number_of_fragments != number_of_fragments ||
+             report->pkt_type != pkt_type){
+
+        reassembly_head->number_of_dropped_fragments++;
+
+        pthread_mutex_unlock(&reassembly_head->list_lock);
+
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    if(report->received_fragments & (1U << fragment_index)){
+
+        reassembly_head->number_of_duplicate_fragments++;
+
+        pthread_mutex_unlock(&reassembly_head->list_lock);
+
+        return WORK_SUCCESSFULLY;
+    }
+
+    memcpy(report->content + fragment_index * WIFI_MESSAGE_LENGTH, 
+           payload, 
+           payload_length);
+    report->fragment_length[fragment_index] = payload_length;
+    report->received_fragments |= (1U << fragment_index);
+
+    if(report->received_fragments == 
+       (1U << report->number_of_fragments) - 1){
+
+        pack_report_fragments(report);
+
+        remove_list_node(&report->report_list_entry);
+        insert_list_tail(&report->report_list_entry,
+                         &reassembly_head->completed_list_head);
+
+        reassembly_head->number_of_pending_reports--;
+        reassembly_head->number_of_completed_reports++;
+
+        *is_completed = true;
+    }
+
+    pthread_mutex_unlock(&reassembly_head->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+ReassemblyNode *take_completed_report(FragmentReassemblyHead *reassembly_head){
+
+    List_Entry *current_list_entry = NULL;
+    ReassemblyNode *report = NULL;
+
+    pthread_mutex_lock(&reassembly_head->list_lock);
+
+    list_for_each(current_list_entry, &reassembly_head->completed_list_head){
+
+        report = ListEntry(current_list_entry,
+                           ReassemblyNode,
+                           report_list_entry);
+        break;
+    }
+
+    if(NULL != report){
+        remove_list_node(&report->report_list_entry);
+    }
+
+    pthread_mutex_unlock(&reassembly_head->list_lock);
+
+    return report;
+}
+
+void release_completed_report(ReassemblyNode *report){
+
+    mp_free(&fragment_reassembly_mempool, report);
+}
+
+void get_fragment_reassembly_report(FragmentReassemblyHead *reassembly_head,
+                                    char *buf,
+                                    size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+
+    memset(report, 0, sizeof(report));
+
+    pthread_mutex_lock(&reassembly_head->list_lock);
+
+    expire_pending_reports(reassembly_head, get_cached_clock_time());
+
+    sprintf(report, 
+            "reassembly_pending_reports=%d;reassembly_completed_reports=%llu;" \
+            "reassembly_expired_reports=%llu;" \
+            "reassembly_duplicate_fragments=%llu;" \
+            "reassembly_dropped_fragments=%llu;",
+            reassembly_head->number_of_pending_reports,
+            reassembly_head->number_of_completed_reports,
+            reassembly_head->number_of_expired_reports,
+            reassembly_head->number_of_duplicate_fragments,
+            reassembly_head->number_of_dropped_fragments);
+
+    pthread_mutex_unlock(&reassembly_head->list_lock);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
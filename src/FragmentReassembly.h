@@ -0,0 +1,271 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     FragmentReassembly.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in FragmentReassembly.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef FRAGMENT_REASSEMBLY_H
+#define FRAGMENT_REASSEMBLY_H
+
+#include "BeDIS.h"
+
+/* The packet type of a fragment of a logical report. The packet types in 
+BeDIS.h do not include fragments, so a value above all of them is used. The 
+content of a fragment has the format 
+"report_id;fragment_index;number_of_fragments;pkt_type;payload", and the 
+payloads of all fragments concatenated in the order of fragment_index form 
+the content of a packet of pkt_type. */
+#define FRAGMENTED_REPORT_PKT_TYPE 65
+
+/* Maximum number of fragments in a logical report */
+#define MAX_FRAGMENTS_IN_REPORT 16
+
+/* Length in bytes of the content of a reassembled report */
+#define LENGTH_OF_REASSEMBLED_REPORT \
+    (MAX_FRAGMENTS_IN_REPORT * WIFI_MESSAGE_LENGTH)
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The list of reports waiting for more fragments, in the order their 
+       first fragment arrived */
+    struct List_Entry pending_list_head;
+
+    /* The list of reports with all fragments received, waiting to be 
+       processed */
+    struct List_Entry completed_list_head;
+
+    /* The time in seconds a report waits for its missing fragments before 
+       it is discarded */
+    int timeout_in_sec;
+
+    /* The number of reports currently waiting for more fragments */
+    int number_of_pending_reports;
+
+    /* The number of reports reassembled */
+    unsigned long long number_of_completed_reports;
+
+    /* The number of reports discarded because fragments were missing when 
+       they timed out */
+    unsigned long long number_of_expired_reports;
+
+    /* The number of fragments received more than once */
+    unsigned long long number_of_duplicate_fragments;
+
+    /* The number of fragments dropped because they were malformed or no 
+       reassembly buffer was available */
+    unsigned long long number_of_dropped_fragments;
+
+} FragmentReassemblyHead;
+
+typedef struct {
+
+    /* The gateway which sent the report */
+    char net_address[NETWORK_ADDR_LENGTH];
+
+    /* The id of the report chosen by the gateway */
+    int report_id;
+
+    /* The packet type and API version of the reassembled content */
+    int pkt_type;
+    float API_version;
+
+    int number_of_fragments;
+
+    /* The bitmap of received fragments. Bit i is set when the fragment with 
+       fragment_index i is received. */
+    unsigned int received_fragments;
+
+    /* The length of the payload of each fragment */
+    int fragment_length[MAX_FRAGMENTS_IN_REPORT];
+
+    /* The time the first fragment of the report arrived */
+    int first_fragment_time;
+
+    /* The payload of fragment i is stored at offset i * WIFI_MESSAGE_LENGTH 
+       until the report is complete, and is then packed in order */
+    char content[LENGTH_OF_REASSEMBLED_REPORT];
+
+    int content_size;
+
+    /* The list entry for inserting the node into the pending or completed 
+       list */
+    List_Entry report_list_entry;
+
+} ReassemblyNode;
+
+/* global variables */
+
+/* The mempool for the reassembly node structures */
+Memory_Pool fragment_reassembly_mempool;
+
+/*
+  init_fragment_reassembly:
+
+     This function initializes the lists of reports being reassembled.
+
+  Parameters:
+
+     reassembly_head - The pointer to the head of the reassembly lists
+
+     timeout_in_sec - The time in seconds a report waits for its missing 
+                      fragments
+
+  Return value:
+
+     None
+
+ */
+
+void init_fragment_reassembly(FragmentReassemblyHead *reassembly_head,
+                              int timeout_in_sec);
+
+/*
+  destroy_fragment_reassembly:
+
+     This function releases all pending and completed reports back to the 
+     memory pool.
+
+  Parameters:
+
+     reassembly_head - The pointer to the head of the reassembly lists
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_fragment_reassembly(FragmentReassemblyHead *reassembly_head);
+
+/*
+  add_report_fragment:
+
+     This function stores a fragment into the report with the same gateway 
+     and report id, and moves the report to the completed list when all of 
+     its fragments are received. Reports which timed out are discarded 
+     first.
+
+  Parameters:
+
+     reassembly_head - The pointer to the head of the reassembly lists
+
+     net_address - The address of the gateway which sent the fragment
+
+     API_version - The API version of the fragment
+
+     content - The content of the fragment after the packet header
+
+     is_completed - The output flag indicating whether the fragment 
+                    completed its report
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_API_PROTOCOL_FORMAT: the fragment is malformed.
+                 E_MALLOC: no free node in fragment_reassembly_mempool.
+
+ */
+
+ErrorCode add_report_fragment(FragmentReassemblyHead *reassembly_head,
+                              char *net_address,
+                              float API_version,
+                              char *content,
+                              bool *is_completed);
+
+/*
+  take_completed_report:
+
+     This function removes the oldest completed report from the completed 
+     list. The caller releases it by release_completed_report.
+
+  Parameters:
+
+     reassembly_head - The pointer to the head of the reassembly lists
+
+  Return value:
+
+     ReassemblyNode * - The completed report, or NULL if there is none
+
+ */
+
+ReassemblyNode *take_completed_report(FragmentReassemblyHead *reassembly_head);
+
+/*
+  release_completed_report:
+
+     This function returns a report taken by take_completed_report to the 
+     memory pool.
+
+  Parameters:
+
+     report - The pointer to the completed report
+
+  Return value:
+
+     None
+
+ */
+
+void release_completed_report(ReassemblyNode *report);
+
+/*
+  get_fragment_reassembly_report:
+
+     This function writes the counters of the reassembly into buf.
+
+  Parameters:
+
+     reassembly_head - The pointer to the head of the reassembly lists
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_fragment_reassembly_report(FragmentReassemblyHead *reassembly_head,
+                                    char *buf,
+                                    size_t buf_len);
+
+#endif
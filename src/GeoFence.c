@@ -311,7 +311,8 @@ ErrorCode construct_objects_list_under_geo_fence_monitoring(
 
     if(WORK_SUCCESSFULLY != 
        SQL_dump_mac_address_under_geo_fence_monitor(db_connection_list_head, 
-                                                    DUMP_GEO_FENCE_OBJECTS_FILE)){
+                                                    DUMP_GEO_FENCE_OBJECTS_FILE,
+                                                    &object_mirror)){
 
         zlog_error(category_debug,
                    "cannot operate database");
@@ -680,7 +681,7 @@ ErrorCode examine_object_tracking_data(
     GeoFenceViolationNode *current_violation_list_ptr = NULL;
 
     bool is_found_mac_address = false;
-    int current_time = get_system_time();
+    int current_time = get_cached_system_time();
 
     GeoFenceViolationNode *new_node = NULL;
     int retry_times = 0;
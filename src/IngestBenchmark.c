@@ -0,0 +1,1238 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     IngestBenchmark.c
+
+  File Description:
+
+     This file provides APIs to measure the throughput and latency of the
+     strategies of writing tracking data into the database.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "IngestBenchmark.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+/* The values of one generated row */
+typedef struct {
+
+    /* The text of each column */
+    char texts[NUMBER_OF_INGEST_BENCHMARK_COLUMNS]
+              [LENGTH_OF_INGEST_BENCHMARK_FIELD];
+
+    /* The integer of each numeric column. Timestamps are in seconds since 
+       epoch. */
+    long long numbers[NUMBER_OF_INGEST_BENCHMARK_COLUMNS];
+
+} IngestBenchmarkRow;
+
+/* The share of a case written through one connection */
+typedef struct {
+
+    IngestBenchmark *benchmark;
+
+    int connection_index;
+
+    IngestStrategy strategy;
+
+    int batch_size;
+
+    int first_row;
+
+    int number_of_rows;
+
+    /* The latency in microseconds of each batch */
+    unsigned long *latencies;
+
+    int number_of_batches;
+
+    ErrorCode result;
+
+} IngestBenchmarkWorker;
+
+static const int ingest_benchmark_batch_sizes[
+    NUMBER_OF_INGEST_BENCHMARK_BATCH_SIZES] = {1, 10, 100, 1000, 10000};
+
+static const char * const ingest_strategy_names[
+    NUMBER_OF_INGEST_STRATEGIES] = {
+
+    "temp_file_copy",
+
+    "copy_stdin",
+
+    "binary_copy",
+
+    "multi_row_insert",
+
+    "prepared_insert",
+};
+
+static const char * const ingest_benchmark_column_names[
+    NUMBER_OF_INGEST_BENCHMARK_COLUMNS] = {
+
+    "object_mac_address",
+
+    "lbeacon_uuid",
+
+    "rssi",
+
+    "panic_button",
+
+    "battery_voltage",
+
+    "initial_timestamp",
+
+    "final_timestamp",
+
+    "server_time_offset",
+};
+
+static const char *ingest_benchmark_columns = 
+    "(object_mac_address, " \
+    "lbeacon_uuid, " \
+    "rssi, " \
+    "panic_button, " \
+    "battery_voltage, " \
+    "initial_timestamp, " \
+    "final_timestamp, " \
+    "server_time_offset)";
+
+static long long get_monotonic_time_in_us(){
+
+#ifdef _WIN32
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    return (long long)(counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+}
+
+static bool is_local_host(char *host){
+
+    /* A host starting with a slash is the directory of a Unix domain 
+       socket */
+    return (NULL == host || strlen(host) == 0 || host[0] == '/' ||
+            strcmp(host, "localhost") == 0 ||
+            strcmp(host, "127.0.0.1") == 0 ||
+            strcmp(host, "::1") == 0);
+}
+
+static bool is_local_database(PGconn *db_conn){
+
+    return is_local_host(PQhost(db_conn));
+}
+
+static bool is_local_conninfo(char *conninfo){
+
+    PQconninfoOption *options = NULL;
+    PQconninfoOption *option = NULL;
+    bool is_local = true;
+
+    options = PQconninfoParse(conninfo, NULL);
+    if(NULL == options){
+        return false;
+    }
+
+    for(option = options; NULL != option->keyword; option++){
+
+        if((strcmp(option->keyword, "host") == 0 ||
+            strcmp(option->keyword, "hostaddr") == 0) &&
+           false == is_local_host(option->val)){
+            is_local = false;
+        }
+    }
+
+    PQconninfoFree(options);
+
+    return is_local;
+}
+
+static long get_backend_cpu_time_in_ms(PGconn *db_conn){
+
+#ifdef _WIN32
+    return -1;
+#else
+    char filename[MAX_PATH];
+    char stat[CONFIG_BUFFER_SIZE];
+    char *fields = NULL;
+    FILE *file = NULL;
+    unsigned long user_time = 0;
+    unsigned long system_time = 0;
+    long ticks_per_second = sysconf(_SC_CLK_TCK);
+
+    if(false == is_local_database(db_conn) || ticks_per_second <= 0){
+        return -1;
+    }
+
+    memset(filename, 0, sizeof(filename));
+    sprintf(filename, "/proc/%d/stat", PQbackendPID(db_conn));
+
+    file = fopen(filename, "r");
+    if(NULL == file){
+        return -1;
+    }
+
+    memset(stat, 0, sizeof(stat));
+    if(NULL == fgets(stat, sizeof(stat), file)){
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    /* The process name may contain spaces, so the fields are counted from 
+       its closing parenthesis */
+    fields = strrchr(stat, ')');
+    if(NULL == fields){
+        return -1;
+    }
+
+    if(2 != sscanf(fields + 1, 
+                   " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+                   &user_time, 
+                   &system_time)){
+        return -1;
+    }
+
+    return (long)((user_time + system_time) * 1000 / ticks_per_second);
+#endif
+}
+
+static long get_database_cpu_time_in_ms(IngestBenchmark *benchmark, 
+                                        int number_of_connections){
+
+    long total_time = 0;
+    long cpu_time = 0;
+    int i;
+
+    for(i = 0; i < number_of_connections; i++){
+
+        cpu_time = get_backend_cpu_time_in_ms(benchmark->db_conns[i]);
+        if(cpu_time < 0){
+            return -1;
+        }
+        total_time += cpu_time;
+    }
+
+    return total_time;
+}
+
+static void get_ingest_benchmark_row(int index, IngestBenchmarkRow *row){
+
+    int object_index = index % INGEST_BENCHMARK_NUMBER_OF_OBJECTS;
+    time_t rawtime;
+    struct tm ts;
+    int i;
+
+    memset(row, 0, sizeof(IngestBenchmarkRow));
+
+    sprintf(row->texts[0], "c1:00:00:%02x:%02x:%02x", 
+            (object_index >> 16) & 0xff,
+            (object_index >> 8) & 0xff,
+            object_index & 0xff);
+
+    sprintf(row->texts[1], "%032d", 
+            index % INGEST_BENCHMARK_NUMBER_OF_LBEACONS);
+
+    row->numbers[2] = -40 - index % 50;
+    row->numbers[3] = 0;
+    row->numbers[4] = 3;
+    row->numbers[6] = INGEST_BENCHMARK_BASE_TIME + 
+                      index / INGEST_BENCHMARK_NUMBER_OF_OBJECTS;
+    row->numbers[5] = row->numbers[6] - 5;
+    row->numbers[7] = 0;
+
+    for(i = 2; i < NUMBER_OF_INGEST_BENCHMARK_COLUMNS; i++){
+
+        if(5 == i || 6 == i){
+
+            rawtime = (time_t)row->numbers[i];
+#ifdef _WIN32
+            gmtime_s(&ts, &rawtime);
+#else
+            gmtime_r(&rawtime, &ts);
+#endif
+            strftime(row->texts[i], sizeof(row->texts[i]), 
+                     "%Y-%m-%d %H:%M:%S", &ts);
+        }else{
+            sprintf(row->texts[i], "%d", (int)row->numbers[i]);
+        }
+    }
+}
+
+static char *put_binary_integer(char *position, 
+                                long long value, 
+                                int number_of_bytes){
+
+    int i;
+
+    for(i = number_of_bytes - 1; i >= 0; i--){
+        position[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+
+    return position + number_of_bytes;
+}
+
+static int get_hex_value(char hex){
+
+    if(hex >= '0' && hex <= '9'){
+        return hex - '0';
+    }
+    if(hex >= 'a' && hex <= 'f'){
+        return hex - 'a' + 10;
+    }
+    if(hex >= 'A' && hex <= 'F'){
+        return hex - 'A' + 10;
+    }
+    return -1;
+}
+
+static char *put_binary_hex_string(char *position, 
+                                   char *text, 
+                                   int number_of_bytes){
+
+    int number_of_digits = 0;
+    int digit = 0;
+
+    position = put_binary_integer(position, number_of_bytes, 4);
+
+    memset(position, 0, number_of_bytes);
+
+    /* Separators such as dashes and colons are skipped */
+    while(*text != '\0' && number_of_digits < number_of_bytes * 2){
+
+        digit = get_hex_value(*text);
+        text++;
+
+        if(digit < 0){
+            continue;
+        }
+
+        if(number_of_digits % 2 == 0){
+            position[number_of_digits / 2] = (char)(digit << 4);
+        }else{
+            position[number_of_digits / 2] |= (char)digit;
+        }
+        number_of_digits++;
+    }
+
+    return position + number_of_bytes;
+}
+
+/* Encodes a column in the binary COPY format of its type. Returns NULL if 
+   the type is not supported. */
+static char *put_binary_field(char *position, 
+                              Oid type, 
+                              char *text, 
+                              long long number){
+
+    float float_value = 0;
+    double double_value = 0;
+    unsigned long float_bits = 0;
+    long long double_bits = 0;
+
+    switch(type){
+
+        /* text, varchar and bpchar */
+        case 25:
+        case 1043:
+        case 1042:
+            position = put_binary_integer(position, strlen(text), 4);
+            memcpy(position, text, strlen(text));
+            return position + strlen(text);
+
+        /* uuid */
+        case 2950:
+            return put_binary_hex_string(position, text, 16);
+
+        /* macaddr */
+        case 829:
+            return put_binary_hex_string(position, text, 6);
+
+        /* int2 */
+        case 21:
+            position = put_binary_integer(position, 2, 4);
+            return put_binary_integer(position, number, 2);
+
+        /* int4 */
+        case 23:
+            position = put_binary_integer(position, 4, 4);
+            return put_binary_integer(position, number, 4);
+
+        /* int8 */
+        case 20:
+            position = put_binary_integer(position, 8, 4);
+            return put_binary_integer(position, number, 8);
+
+        /* float4 */
+        case 700:
+            float_value = (float)number;
+            memcpy(&float_bits, &float_value, sizeof(float_value));
+            position = put_binary_integer(position, 4, 4);
+            return put_binary_integer(position, float_bits, 4);
+
+        /* float8 */
+        case 701:
+            double_value = (double)number;
+            memcpy(&double_bits, &double_value, sizeof(double_value));
+            position = put_binary_integer(position, 8, 4);
+            return put_binary_integer(position, double_bits, 8);
+
+        /* timestamp and timestamptz, in microseconds since 2000-01-01 */
+        case 1114:
+        case 1184:
+            position = put_binary_integer(position, 8, 4);
+            return put_binary_integer(position, 
+                                      (number - 946684800) * 1000000, 
+                                      8);
+
+        default:
+            return NULL;
+    }
+}
+
+static ErrorCode execute_ingest_benchmark_sql(PGconn *db_conn, char *sql){
+
+    PGresult *res = NULL;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    res = PQexec(db_conn, sql);
+
+    if(PQresultStatus(res) != PGRES_COMMAND_OK && 
+       PQresultStatus(res) != PGRES_TUPLES_OK){
+
+        zlog_error(category_debug, "ingest benchmark SQL failed: %s", 
+                   PQerrorMessage(db_conn));
+        ret_val = E_SQL_EXECUTE;
+    }
+    PQclear(res);
+
+    return ret_val;
+}
+
+static ErrorCode copy_ingest_benchmark_rows(PGconn *db_conn, 
+                                            char *sql, 
+                                            char *rows, 
+                                            int rows_len){
+
+    PGresult *res = NULL;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    res = PQexec(db_conn, sql);
+
+    if(PQresultStatus(res) != PGRES_COPY_IN){
+        PQclear(res);
+
+        zlog_error(category_debug, "ingest benchmark COPY failed: %s", 
+                   PQerrorMessage(db_conn));
+        return E_SQL_EXECUTE;
+    }
+    PQclear(res);
+
+    if(1 != PQputCopyData(db_conn, rows, rows_len)){
+
+        ret_val = E_SQL_EXECUTE;
+        PQputCopyEnd(db_conn, "cannot send benchmark rows");
+
+    }else if(1 != PQputCopyEnd(db_conn, NULL)){
+
+        ret_val = E_SQL_EXECUTE;
+    }
+
+    while(NULL != (res = PQgetResult(db_conn))){
+        if(PQresultStatus(res) != PGRES_COMMAND_OK){
+            zlog_error(category_debug, "ingest benchmark COPY failed: %s", 
+                       PQerrorMessage(db_conn));
+            ret_val = E_SQL_EXECUTE;
+        }
+        PQclear(res);
+    }
+
+    return ret_val;
+}
+
+static ErrorCode write_ingest_benchmark_batch(IngestBenchmarkWorker *worker,
+                                              int first_row,
+                                              int number_of_rows,
+                                              char *buf,
+                                              char *filename){
+
+    IngestBenchmark *benchmark = worker->benchmark;
+    PGconn *db_conn = benchmark->db_conns[worker->connection_index];
+    IngestBenchmarkRow row;
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    const char *values[NUMBER_OF_INGEST_BENCHMARK_COLUMNS];
+    char *position = buf;
+    FILE *file = NULL;
+    PGresult *res = NULL;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    int i;
+    int j;
+
+    memset(sql, 0, sizeof(sql));
+
+    switch(worker->strategy){
+
+        case INGEST_STRATEGY_TEMP_FILE_COPY:
+        case INGEST_STRATEGY_COPY_STDIN:
+
+            if(INGEST_STRATEGY_TEMP_FILE_COPY == worker->strategy){
+                file = fopen(filename, "wt");
+                if(NULL == file){
+                    zlog_error(category_debug, "cannot open filepath %s", 
+                               filename);
+                    return E_OPEN_FILE;
+                }
+            }
+
+            for(i = first_row; i < first_row + number_of_rows; i++){
+
+                get_ingest_benchmark_row(i, &row);
+
+                position += sprintf(position, "%s,%s,%s,%s,%s,%s,%s,%s\n",
+                                    row.texts[0], row.texts[1], 
+                                    row.texts[2], row.texts[3], 
+                                    row.texts[4], row.texts[5], 
+                                    row.texts[6], row.texts[7]);
+            }
+
+            if(INGEST_STRATEGY_TEMP_FILE_COPY == worker->strategy){
+
+                fwrite(buf, 1, position - buf, file);
+                fclose(file);
+
+                sprintf(sql, "COPY %s %s FROM \'%s\' DELIMITER \',\' CSV;",
+                        INGEST_BENCHMARK_TABLE, 
+                        ingest_benchmark_columns,
+                        filename);
+
+                ret_val = execute_ingest_benchmark_sql(db_conn, sql);
+
+                remove(filename);
+
+                return ret_val;
+            }
+
+            sprintf(sql, "COPY %s %s FROM STDIN WITH CSV;", 
+                    INGEST_BENCHMARK_TABLE, 
+                    ingest_benchmark_columns);
+
+            return copy_ingest_benchmark_rows(db_conn, 
+                                              sql, 
+                                              buf, 
+                                              position - buf);
+
+        case INGEST_STRATEGY_BINARY_COPY:
+
+            /* Signature, flags and length of the header extension */
+            memcpy(position, "PGCOPY\n\377\r\n\0", 11);
+            position += 11;
+            position = put_binary_integer(position, 0, 4);
+            position = put_binary_integer(position, 0, 4);
+
+            for(i = first_row; i < first_row + number_of_rows; i++){
+
+                get_ingest_benchmark_row(i, &row);
+
+                position = put_binary_integer(
+                    position, NUMBER_OF_INGEST_BENCHMARK_COLUMNS, 2);
+
+                for(j = 0; j < NUMBER_OF_INGEST_BENCHMARK_COLUMNS; j++){
+
+                    position = put_binary_field(
+                        position, 
+                        benchmark->column_types[j],
+                        row.texts[j],
+                        row.numbers[j]);
+
+                    if(NULL == position){
+                        zlog_error(category_debug, 
+                                   "binary COPY does not support the type " \
+                                   "[%d] of %s", 
+                                   benchmark->column_types[j],
+                                   ingest_benchmark_column_names[j]);
+                        return E_INPUT_PARAMETER;
+                    }
+                }
+            }
+
+            /* The trailer */
+            position = put_binary_integer(position, -1, 2);
+
+            sprintf(sql, "COPY %s %s FROM STDIN WITH (FORMAT binary);", 
+                    INGEST_BENCHMARK_TABLE, 
+                    ingest_benchmark_columns);
+
+            return copy_ingest_benchmark_rows(db_conn, 
+                                              sql, 
+                                              buf, 
+                                              position - buf);
+
+        case INGEST_STRATEGY_MULTI_ROW_INSERT:
+
+            position += sprintf(position, "INSERT INTO %s %s VALUES ", 
+                                INGEST_BENCHMARK_TABLE, 
+                                ingest_benchmark_columns);
+
+            for(i = first_row; i < first_row + number_of_rows; i++){
+
+                get_ingest_benchmark_row(i, &row);
+
+                position += sprintf(position, 
+                                    "%s(\'%s\',\'%s\',%s,%s,%s," \
+                                    "\'%s\',\'%s\',%s)",
+                                    (i == first_row) ? "" : ",",
+                                    row.texts[0], row.texts[1], 
+                                    row.texts[2], row.texts[3], 
+                                    row.texts[4], row.texts[5], 
+                                    row.texts[6], row.texts[7]);
+            }
+            strcat(position, ";");
+
+            return execute_ingest_benchmark_sql(db_conn, buf);
+
+        case INGEST_STRATEGY_PREPARED_INSERT:
+
+            if(number_of_rows > 1 &&
+               WORK_SUCCESSFULLY != 
+               execute_ingest_benchmark_sql(db_conn, "BEGIN;")){
+                return E_SQL_EXECUTE;
+            }
+
+            for(i = first_row; 
+                i < first_row + number_of_rows && 
+                WORK_SUCCESSFULLY == ret_val; 
+                i++){
+
+                get_ingest_benchmark_row(i, &row);
+
+                for(j = 0; j < NUMBER_OF_INGEST_BENCHMARK_COLUMNS; j++){
+                    values[j] = row.texts[j];
+                }
+
+                res = PQexecPrepared(db_conn, 
+                                     INGEST_BENCHMARK_STATEMENT, 
+                                     NUMBER_OF_INGEST_BENCHMARK_COLUMNS,
+                                     values, 
+                                     NULL, 
+                                     NULL, 
+                                     0);
+
+                if(PQresultStatus(res) != PGRES_COMMAND_OK){
+                    zlog_error(category_debug, 
+                               "ingest benchmark insert failed: %s", 
+                               PQerrorMessage(db_conn));
+                    ret_val = E_SQL_EXECUTE;
+                }
+                PQclear(res);
+            }
+
+            if(number_of_rows > 1){
+                if(WORK_SUCCESSFULLY == ret_val){
+                    ret_val = execute_ingest_benchmark_sql(db_conn, 
+                                                           "COMMIT;");
+                }else{
+                    execute_ingest_benchmark_sql(db_conn, "ROLLBACK;");
+                }
+            }
+
+            return ret_val;
+
+        default:
+            return E_INPUT_PARAMETER;
+    }
+}
+
+static void *ingest_benchmark_worker(void *_worker){
+
+    IngestBenchmarkWorker *worker = (IngestBenchmarkWorker *)_worker;
+    char filename[MAX_PATH];
+    char *buf = NULL;
+    int current_row = worker->first_row;
+    int last_row = worker->first_row + worker->number_of_rows;
+    int number_of_rows = 0;
+    long long start_time = 0;
+
+    worker->result = WORK_SUCCESSFULLY;
+    worker->number_of_batches = 0;
+
+    buf = malloc((worker->batch_size + 1) * LENGTH_OF_INGEST_BENCHMARK_ROW);
+    if(NULL == buf){
+        worker->result = E_MALLOC;
+        return (void *)NULL;
+    }
+
+    memset(filename, 0, sizeof(filename));
+    sprintf(filename, "%s/ingest_benchmark_%d", 
+            worker->benchmark->temp_directory,
+            worker->connection_index);
+
+    while(current_row < last_row && WORK_SUCCESSFULLY == worker->result){
+
+        number_of_rows = last_row - current_row;
+        if(number_of_rows > worker->batch_size){
+            number_of_rows = worker->batch_size;
+        }
+
+        start_time = get_monotonic_time_in_us();
+
+        worker->result = write_ingest_benchmark_batch(worker, 
+                                                      current_row, 
+                                                      number_of_rows,
+                                                      buf,
+                                                      filename);
+
+        worker->latencies[worker->number_of_batches] = 
+            (unsigned long)(get_monotonic_time_in_us() - start_time);
+        worker->number_of_batches++;
+
+        current_row += number_of_rows;
+    }
+
+    free(buf);
+
+    return (void *)NULL;
+}
+
+/* The concurrency doubles up to the number of connections, which is 
+   always measured */
+static int get_next_concurrency(int concurrency, int max_concurrency){
+
+    if(concurrency < max_concurrency && concurrency * 2 > max_concurrency){
+        return max_concurrency;
+    }
+
+    return concurrency * 2;
+}
+
+static int compare_latencies(const void *first, const void *second){
+
+    unsigned long first_latency = *(const unsigned long *)first;
+    unsigned long second_latency = *(const unsigned long *)second;
+
+    if(first_latency < second_latency){
+        return -1;
+    }
+    return (first_latency > second_latency) ? 1 : 0;
+}
+
+static void run_ingest_benchmark_case(IngestBenchmark *benchmark,
+                                      IngestStrategy strategy,
+                                      int batch_size,
+                                      int concurrency,
+                                      FILE *report_file){
+
+    IngestBenchmarkWorker workers[MAX_INGEST_BENCHMARK_CONCURRENCY];
+    pthread_t worker_threads[MAX_INGEST_BENCHMARK_CONCURRENCY];
+    bool is_started[MAX_INGEST_BENCHMARK_CONCURRENCY];
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    unsigned long *latencies = NULL;
+    int number_of_latencies = 0;
+    int rows_per_worker = benchmark->rows_per_case;
+    long long total_rows = 0;
+    int first_row = 0;
+    long long start_time = 0;
+    long long elapsed_time_in_us = 0;
+    long cpu_time_before = 0;
+    long cpu_time_after = 0;
+    long cpu_time = -1;
+    bool is_failed = false;
+    int i;
+    int j;
+
+    /* Each connection writes a whole number of full batches, and enough of 
+       them for the latency percentiles */
+    if(rows_per_worker < 
+       batch_size * INGEST_BENCHMARK_MIN_BATCHES_PER_CONNECTION){
+        rows_per_worker = 
+            batch_size * INGEST_BENCHMARK_MIN_BATCHES_PER_CONNECTION;
+    }
+
+    /* The rows of a case are capped, so a case at a large batch size and 
+       concurrency does not fill the database */
+    if((long long)rows_per_worker * concurrency > 
+       INGEST_BENCHMARK_MAX_ROWS_PER_CASE){
+        rows_per_worker = INGEST_BENCHMARK_MAX_ROWS_PER_CASE / concurrency;
+    }
+    rows_per_worker -= rows_per_worker % batch_size;
+    if(rows_per_worker < batch_size){
+        rows_per_worker = batch_size;
+    }
+
+    total_rows = (long long)rows_per_worker * concurrency;
+
+    memset(sql, 0, sizeof(sql));
+    sprintf(sql, "TRUNCATE %s;", INGEST_BENCHMARK_TABLE);
+
+    if(WORK_SUCCESSFULLY != 
+       execute_ingest_benchmark_sql(benchmark->db_conns[0], sql)){
+        is_failed = true;
+    }
+
+    latencies = malloc(sizeof(unsigned long) * 
+                       (rows_per_worker / batch_size + 1) * concurrency);
+
+    for(i = 0; i < concurrency; i++){
+
+        workers[i].benchmark = benchmark;
+        workers[i].connection_index = i;
+        workers[i].strategy = strategy;
+        workers[i].batch_size = batch_size;
+        workers[i].first_row = first_row;
+        workers[i].number_of_rows = rows_per_worker;
+        workers[i].number_of_batches = 0;
+        workers[i].result = WORK_SUCCESSFULLY;
+
+        workers[i].latencies = 
+            malloc(sizeof(unsigned long) * 
+                   (workers[i].number_of_rows / batch_size + 1));
+
+        if(NULL == workers[i].latencies){
+            is_failed = true;
+        }
+
+        first_row += workers[i].number_of_rows;
+        is_started[i] = false;
+    }
+
+    if(NULL == latencies){
+        is_failed = true;
+    }
+
+    cpu_time_before = get_database_cpu_time_in_ms(benchmark, concurrency);
+
+    start_time = get_monotonic_time_in_us();
+
+    for(i = 0; i < concurrency && false == is_failed; i++){
+
+        if(WORK_SUCCESSFULLY != startThread(&worker_threads[i], 
+                                            ingest_benchmark_worker, 
+                                            &workers[i])){
+            is_failed = true;
+            break;
+        }
+        is_started[i] = true;
+    }
+
+    for(i = 0; i < concurrency; i++){
+        if(true == is_started[i]){
+            pthread_join(worker_threads[i], NULL);
+        }
+    }
+
+    elapsed_time_in_us = get_monotonic_time_in_us() - start_time;
+    if(elapsed_time_in_us <= 0){
+        elapsed_time_in_us = 1;
+    }
+
+    cpu_time_after = get_database_cpu_time_in_ms(benchmark, concurrency);
+    if(cpu_time_before >= 0 && cpu_time_after >= 0){
+        cpu_time = cpu_time_after - cpu_time_before;
+    }
+
+    for(i = 0; i < concurrency; i++){
+
+        if(true != is_started[i] || 
+           WORK_SUCCESSFULLY != workers[i].result){
+            is_failed = true;
+        }
+
+        for(j = 0; 
+            NULL != latencies && j < workers[i].number_of_batches; 
+            j++){
+            latencies[number_of_latencies++] = workers[i].latencies[j];
+        }
+
+        free(workers[i].latencies);
+    }
+
+    if(number_of_latencies > 0){
+
+        qsort(latencies, number_of_latencies, sizeof(unsigned long), 
+              compare_latencies);
+
+        fprintf(report_file, 
+                "%s,%d,%d,%lld,%d,%ld,%ld,%lu,%lu,%lu,%ld,%s\n",
+                ingest_strategy_names[strategy],
+                batch_size,
+                concurrency,
+                total_rows,
+                number_of_latencies,
+                (long)(elapsed_time_in_us / 1000),
+                (long)(total_rows * 1000000 / elapsed_time_in_us),
+                latencies[(number_of_latencies - 1) * 50 / 100],
+                latencies[(number_of_latencies - 1) * 99 / 100],
+                latencies[number_of_latencies - 1],
+                cpu_time,
+                (true == is_failed) ? "failed" : "ok");
+    }else{
+        fprintf(report_file, "%s,%d,%d,%lld,0,0,0,0,0,0,-1,failed\n",
+                ingest_strategy_names[strategy],
+                batch_size,
+                concurrency,
+                total_rows);
+    }
+    fflush(report_file);
+
+    free(latencies);
+}
+
+static ErrorCode prepare_ingest_benchmark_table(IngestBenchmark *benchmark,
+                                                int number_of_connections){
+
+    PGconn *db_conn = benchmark->db_conns[0];
+    PGresult *res = NULL;
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    const char *is_superuser = NULL;
+    bool is_hypertable = false;
+    int i;
+
+    /* COPY FROM a file of the database server needs a superuser */
+    is_superuser = PQparameterStatus(db_conn, "is_superuser");
+
+    benchmark->is_server_file_copy_allowed = 
+        (NULL != is_superuser && strcmp(is_superuser, "on") == 0);
+
+    memset(sql, 0, sizeof(sql));
+    sprintf(sql, "DROP TABLE IF EXISTS %s; " \
+                 "CREATE TABLE %s " \
+                 "(LIKE tracking_table INCLUDING DEFAULTS INCLUDING INDEXES);",
+            INGEST_BENCHMARK_TABLE,
+            INGEST_BENCHMARK_TABLE);
+
+    if(WORK_SUCCESSFULLY != execute_ingest_benchmark_sql(db_conn, sql)){
+        return E_SQL_EXECUTE;
+    }
+
+    /* The benchmark table is chunked like tracking_table, so the cost of 
+       writing into a hypertable is included */
+    res = PQexec(db_conn, 
+                 "SELECT 1 FROM _timescaledb_catalog.hypertable " \
+                 "WHERE table_name = \'tracking_table\';");
+
+    if(PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0){
+        is_hypertable = true;
+    }
+    PQclear(res);
+
+    if(true == is_hypertable){
+        memset(sql, 0, sizeof(sql));
+        sprintf(sql, "SELECT create_hypertable(\'%s\', " \
+                     "\'final_timestamp\');",
+                INGEST_BENCHMARK_TABLE);
+
+        if(WORK_SUCCESSFULLY != execute_ingest_benchmark_sql(db_conn, sql)){
+            zlog_error(category_debug, 
+                       "ingest benchmark table is not a hypertable");
+        }
+    }
+
+    /* Binary COPY sends each column in the format of its type */
+    for(i = 0; i < NUMBER_OF_INGEST_BENCHMARK_COLUMNS; i++){
+
+        benchmark->column_types[i] = 0;
+
+        memset(sql, 0, sizeof(sql));
+        sprintf(sql, "SELECT atttypid FROM pg_attribute " \
+                     "WHERE attrelid = \'%s\'::regclass " \
+                     "AND attname = \'%s\';",
+                INGEST_BENCHMARK_TABLE,
+                ingest_benchmark_column_names[i]);
+
+        res = PQexec(db_conn, sql);
+
+        if(PQresultStatus(res) == PGRES_TUPLES_OK && PQntuples(res) > 0){
+            benchmark->column_types[i] = 
+                (Oid)strtoul(PQgetvalue(res, 0, 0), NULL, 10);
+        }
+        PQclear(res);
+    }
+
+    memset(sql, 0, sizeof(sql));
+    sprintf(sql, "INSERT INTO %s %s VALUES ($1, $2, $3, $4, $5, $6, $7, $8);",
+            INGEST_BENCHMARK_TABLE,
+            ingest_benchmark_columns);
+
+    for(i = 0; i < number_of_connections; i++){
+
+        res = PQprepare(benchmark->db_conns[i], 
+                        INGEST_BENCHMARK_STATEMENT, 
+                        sql, 
+                        NUMBER_OF_INGEST_BENCHMARK_COLUMNS, 
+                        NULL);
+
+        if(PQresultStatus(res) != PGRES_COMMAND_OK){
+            zlog_error(category_debug, "ingest benchmark prepare failed: %s",
+                       PQerrorMessage(benchmark->db_conns[i]));
+        }
+        PQclear(res);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+static void *ingest_benchmark_routine(void *_benchmark){
+
+    IngestBenchmark *benchmark = (IngestBenchmark *)_benchmark;
+    FILE *report_file = NULL;
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    int number_of_connections = 0;
+    int concurrency = 0;
+    int strategy = 0;
+    int batch_index = 0;
+    int i;
+
+    report_file = fopen(benchmark->report_path, "w");
+    if(NULL == report_file){
+        zlog_error(category_debug, "cannot open filepath %s", 
+                   benchmark->report_path);
+        benchmark->is_running = false;
+        return (void *)NULL;
+    }
+
+    for(i = 0; i < benchmark->max_concurrency; i++){
+
+        benchmark->db_conns[i] = PQconnectdb(benchmark->conninfo);
+
+        if(PQstatus(benchmark->db_conns[i]) != CONNECTION_OK){
+
+            zlog_error(category_debug, 
+                       "ingest benchmark connection [%d] failed: %s", 
+                       i, PQerrorMessage(benchmark->db_conns[i]));
+
+            PQfinish(benchmark->db_conns[i]);
+            benchmark->db_conns[i] = NULL;
+            break;
+        }
+
+        /* The host may come from the environment of libpq, so the host 
+           actually connected to is checked as well */
+        if(false == is_local_database(benchmark->db_conns[i])){
+
+            zlog_error(category_debug, 
+                       "ingest benchmark refused the host [%s]", 
+                       PQhost(benchmark->db_conns[i]));
+
+            PQfinish(benchmark->db_conns[i]);
+            benchmark->db_conns[i] = NULL;
+            break;
+        }
+        number_of_connections++;
+    }
+
+    if(0 == number_of_connections ||
+       WORK_SUCCESSFULLY != 
+       prepare_ingest_benchmark_table(benchmark, number_of_connections)){
+
+        fprintf(report_file, "# ingest benchmark failed to start\n");
+        number_of_connections = 0;
+    }else{
+
+        fprintf(report_file, 
+                "# rows_per_connection=%d,min_batches_per_connection=%d," \
+                "max_rows_per_case=%d,max_concurrency=%d," \
+                "server_version=%d,base_time=%d\n",
+                benchmark->rows_per_case,
+                INGEST_BENCHMARK_MIN_BATCHES_PER_CONNECTION,
+                INGEST_BENCHMARK_MAX_ROWS_PER_CASE,
+                number_of_connections,
+                PQserverVersion(benchmark->db_conns[0]),
+                INGEST_BENCHMARK_BASE_TIME);
+
+        fprintf(report_file, 
+                "strategy,batch_size,concurrency,rows,batches,elapsed_ms," \
+                "rows_per_sec,latency_p50_us,latency_p99_us," \
+                "latency_max_us,db_cpu_ms,status\n");
+    }
+
+    for(strategy = 0; 
+        strategy < NUMBER_OF_INGEST_STRATEGIES && 
+        number_of_connections > 0 && true == ready_to_work; 
+        strategy++){
+
+        for(batch_index = 0; 
+            batch_index < NUMBER_OF_INGEST_BENCHMARK_BATCH_SIZES && 
+            true == ready_to_work; 
+            batch_index++){
+
+            for(concurrency = 1; 
+                concurrency <= number_of_connections && 
+                true == ready_to_work;
+                concurrency = get_next_concurrency(concurrency, 
+                                                   number_of_connections)){
+
+                if(INGEST_STRATEGY_TEMP_FILE_COPY == strategy &&
+                   false == benchmark->is_server_file_copy_allowed){
+
+                    fprintf(report_file, 
+                            "%s,%d,%d,0,0,0,0,0,0,0,-1,skipped\n",
+                            ingest_strategy_names[strategy],
+                            ingest_benchmark_batch_sizes[batch_index],
+                            concurrency);
+                }else{
+
+                    run_ingest_benchmark_case(
+                        benchmark,
+                        (IngestStrategy)strategy,
+                        ingest_benchmark_batch_sizes[batch_index],
+                        concurrency,
+                        report_file);
+                }
+
+                benchmark->number_of_finished_cases++;
+            }
+        }
+    }
+
+    if(number_of_connections > 0){
+        memset(sql, 0, sizeof(sql));
+        sprintf(sql, "DROP TABLE IF EXISTS %s;", INGEST_BENCHMARK_TABLE);
+
+        execute_ingest_benchmark_sql(benchmark->db_conns[0], sql);
+    }
+
+    for(i = 0; i < number_of_connections; i++){
+        PQfinish(benchmark->db_conns[i]);
+        benchmark->db_conns[i] = NULL;
+    }
+
+    fclose(report_file);
+
+    zlog_info(category_debug, "ingest benchmark finished [%d] cases, " \
+              "report [%s]", 
+              benchmark->number_of_finished_cases, 
+              benchmark->report_path);
+
+    benchmark->is_running = false;
+
+    return (void *)NULL;
+}
+
+ErrorCode start_ingest_benchmark(IngestBenchmark *benchmark,
+                                 char *conninfo,
+                                 int max_concurrency,
+                                 int rows_per_case,
+                                 char *temp_directory,
+                                 char *report_path){
+
+    pthread_t benchmark_thread;
+    int number_of_concurrency_levels = 0;
+    int concurrency = 0;
+
+    if(true == benchmark->is_running){
+        return E_INPUT_PARAMETER;
+    }
+
+    if(false == is_local_conninfo(conninfo)){
+        zlog_error(category_debug, 
+                   "ingest benchmark only runs on a local database");
+        return E_INPUT_PARAMETER;
+    }
+
+    if(max_concurrency < 1){
+        max_concurrency = 1;
+    }
+    if(max_concurrency > MAX_INGEST_BENCHMARK_CONCURRENCY){
+        max_concurrency = MAX_INGEST_BENCHMARK_CONCURRENCY;
+    }
+
+    memset(benchmark->conninfo, 0, sizeof(benchmark->conninfo));
+    strncpy(benchmark->conninfo, conninfo, sizeof(benchmark->conninfo) - 1);
+
+    memset(benchmark->temp_directory, 0, sizeof(benchmark->temp_directory));
+    strncpy(benchmark->temp_directory, temp_directory, 
+            sizeof(benchmark->temp_directory) - 1);
+
+    memset(benchmark->report_path, 0, sizeof(benchmark->report_path));
+    strncpy(benchmark->report_path, report_path, 
+            sizeof(benchmark->report_path) - 1);
+
+    benchmark->max_concurrency = max_concurrency;
+    benchmark->rows_per_case = 
+        (rows_per_case > 0) ? rows_per_case : INGEST_BENCHMARK_ROWS_PER_CASE;
+    if(benchmark->rows_per_case > INGEST_BENCHMARK_MAX_ROWS_PER_CASE){
+        benchmark->rows_per_case = INGEST_BENCHMARK_MAX_ROWS_PER_CASE;
+    }
+
+    for(concurrency = 1; 
+        concurrency <= max_concurrency; 
+        concurrency = get_next_concurrency(concurrency, max_concurrency)){
+        number_of_concurrency_levels++;
+    }
+
+    benchmark->number_of_cases = NUMBER_OF_INGEST_STRATEGIES * 
+                                 NUMBER_OF_INGEST_BENCHMARK_BATCH_SIZES *
+                                 number_of_concurrency_levels;
+    benchmark->number_of_finished_cases = 0;
+    benchmark->is_running = true;
+
+    if(WORK_SUCCESSFULLY != startThread(&benchmark_thread, 
+                                        ingest_benchmark_routine, 
+                                        benchmark)){
+        benchmark->is_running = false;
+        return E_INITIALIZATION_FAIL;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+void get_ingest_benchmark_report(IngestBenchmark *benchmark, 
+                                 char *buf, 
+                                 size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+
+    memset(report, 0, sizeof(report));
+
+    sprintf(report, 
+            "ingest_benchmark=%s;ingest_benchmark_cases=%d/%d;" \
+            "ingest_benchmark_report=%s;",
+            (true == benchmark->is_running) ? "running" : "finished",
+            benchmark->number_of_finished_cases,
+            benchmark->number_of_cases,
+            benchmark->report_path);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
@@ -0,0 +1,238 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     IngestBenchmark.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in IngestBenchmark.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef INGEST_BENCHMARK_H
+#define INGEST_BENCHMARK_H
+
+#include "BeDIS.h"
+#include "SqlWrapper.h"
+
+/* The table the benchmark writes to. It is created like tracking_table and 
+dropped when the benchmark ends. */
+#define INGEST_BENCHMARK_TABLE "tracking_benchmark_table"
+
+/* File path of the report of the last benchmark, relative to the server 
+installation path */
+#define INGEST_BENCHMARK_REPORT_FILE "temp/ingest_benchmark.csv"
+
+/* Number of rows written through each connection by each case of the 
+benchmark */
+#define INGEST_BENCHMARK_ROWS_PER_CASE 20000
+
+/* Minimum number of batches written through each connection by each case. 
+Large batch sizes write more rows than INGEST_BENCHMARK_ROWS_PER_CASE, so 
+their latency percentiles are taken from enough batches. */
+#define INGEST_BENCHMARK_MIN_BATCHES_PER_CONNECTION 20
+
+/* Maximum number of rows written by each case over all its connections. It 
+takes precedence over INGEST_BENCHMARK_MIN_BATCHES_PER_CONNECTION, but each 
+connection writes at least one batch. */
+#define INGEST_BENCHMARK_MAX_ROWS_PER_CASE 200000
+
+/* Maximum number of connections written through concurrently */
+#define MAX_INGEST_BENCHMARK_CONCURRENCY 16
+
+/* Number of batch sizes measured for each strategy */
+#define NUMBER_OF_INGEST_BENCHMARK_BATCH_SIZES 5
+
+/* Number of distinct LBeacons and objects in the generated rows */
+#define INGEST_BENCHMARK_NUMBER_OF_LBEACONS 64
+#define INGEST_BENCHMARK_NUMBER_OF_OBJECTS 4096
+
+/* The event time in seconds since epoch of the first generated row. It is 
+fixed, so every run writes the same rows. */
+#define INGEST_BENCHMARK_BASE_TIME 1571100000
+
+/* Number of columns of tracking_table written by the server */
+#define NUMBER_OF_INGEST_BENCHMARK_COLUMNS 8
+
+/* Length of the SQL statement of one row in bytes */
+#define LENGTH_OF_INGEST_BENCHMARK_ROW 256
+
+/* Length of the text of one column of a generated row in bytes */
+#define LENGTH_OF_INGEST_BENCHMARK_FIELD 40
+
+/* Name of the prepared statement of the single-row INSERT */
+#define INGEST_BENCHMARK_STATEMENT "ingest_benchmark_insert"
+
+/* The strategies of writing tracking data */
+typedef enum _IngestStrategy{
+
+    /* COPY from a temporary CSV file read by the database server, as 
+       SQL_update_object_tracking_data does */
+    INGEST_STRATEGY_TEMP_FILE_COPY = 0,
+
+    /* COPY FROM STDIN in CSV format */
+    INGEST_STRATEGY_COPY_STDIN = 1,
+
+    /* COPY FROM STDIN in binary format */
+    INGEST_STRATEGY_BINARY_COPY = 2,
+
+    /* One INSERT statement with a VALUES list of all rows of a batch */
+    INGEST_STRATEGY_MULTI_ROW_INSERT = 3,
+
+    /* A prepared single-row INSERT executed for each row, in one 
+       transaction for each batch */
+    INGEST_STRATEGY_PREPARED_INSERT = 4,
+
+    NUMBER_OF_INGEST_STRATEGIES = 5
+
+} IngestStrategy;
+
+typedef struct {
+
+    /* The connection string of the database */
+    char conninfo[SQL_TEMP_BUFFER_LENGTH];
+
+    /* The directory of the temporary CSV files */
+    char temp_directory[MAX_PATH];
+
+    /* The file path of the report */
+    char report_path[MAX_PATH];
+
+    /* The largest number of connections written through concurrently */
+    int max_concurrency;
+
+    /* The number of rows written through each connection by each case, 
+       unless the batch size needs more */
+    int rows_per_case;
+
+    /* The connections of the benchmark. They are not taken from the 
+       connection pool, so the server keeps working during the benchmark. */
+    PGconn *db_conns[MAX_INGEST_BENCHMARK_CONCURRENCY];
+
+    /* The type of each written column of the benchmark table, used to 
+       encode binary COPY */
+    Oid column_types[NUMBER_OF_INGEST_BENCHMARK_COLUMNS];
+
+    /* The flag of the database user reading files of the database server, 
+       which INGEST_STRATEGY_TEMP_FILE_COPY needs */
+    bool is_server_file_copy_allowed;
+
+    /* The state of the benchmark */
+    volatile bool is_running;
+    volatile int number_of_finished_cases;
+    int number_of_cases;
+
+} IngestBenchmark;
+
+/* global variables */
+
+/* The ingestion benchmark started from the control channel */
+IngestBenchmark ingest_benchmark;
+
+/*
+  start_ingest_benchmark:
+
+     This function starts a thread measuring each strategy of writing 
+     tracking data at each batch size and number of concurrent connections.
+     The rows written are generated from their index only, and the table is
+     emptied before each case, so runs against the same database are 
+     comparable. Every connection of a case writes the same number of rows 
+     in batches of the full batch size, so the batch size is the same at 
+     every concurrency. Each line of the report holds the strategy, batch 
+     size, concurrency, total rows, number of batches, elapsed time, rows 
+     per second, the 50th and 99th percentile and maximum batch latency and 
+     the CPU time of the database backends. The benchmark drops and creates 
+     its table, so conninfo must name a database of its own on the local 
+     host, which holds a tracking_table to copy the columns from. 
+     INGEST_STRATEGY_TEMP_FILE_COPY is reported as skipped unless the 
+     database user is a superuser.
+
+  Parameters:
+
+     benchmark - The pointer to the benchmark
+
+     conninfo - The connection string of the database
+
+     max_concurrency - The largest number of concurrent connections. It is 
+                       at most MAX_INGEST_BENCHMARK_CONCURRENCY.
+
+     rows_per_case - The number of rows written through each connection by 
+                     each case. It is raised to 
+                     INGEST_BENCHMARK_MIN_BATCHES_PER_CONNECTION batches of 
+                     large batch sizes, within 
+                     INGEST_BENCHMARK_MAX_ROWS_PER_CASE.
+
+     temp_directory - The directory of the temporary CSV files
+
+     report_path - The file path of the report
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: a benchmark is already running, or the 
+                                    database is not on the local host.
+                 E_INITIALIZATION_FAIL: the thread cannot be started.
+
+ */
+
+ErrorCode start_ingest_benchmark(IngestBenchmark *benchmark,
+                                 char *conninfo,
+                                 int max_concurrency,
+                                 int rows_per_case,
+                                 char *temp_directory,
+                                 char *report_path);
+
+/*
+  get_ingest_benchmark_report:
+
+     This function writes the progress of the benchmark into buf.
+
+  Parameters:
+
+     benchmark - The pointer to the benchmark
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_ingest_benchmark_report(IngestBenchmark *benchmark, 
+                                 char *buf, 
+                                 size_t buf_len);
+
+#endif
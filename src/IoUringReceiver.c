@@ -0,0 +1,643 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     IoUringReceiver.c
+
+  File Description:
+
+     This file provides an optional receiver of gateway packets built on
+     io_uring. It is only available on Linux when the server is built with
+     BOT_SERVER_USE_IO_URING defined and linked with liburing, which 
+     "make IO_URING=1" does.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "IoUringReceiver.h"
+#include "ClockCache.h"
+
+#ifdef IO_URING_RECEIVER_SUPPORTED
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static char *get_receive_buffer(IoUringReceiver *receiver, int buffer_id){
+
+    return receiver->buffers + (size_t)buffer_id * IO_URING_BUFFER_SIZE;
+}
+
+static void recycle_receive_buffer(IoUringReceiver *receiver, int buffer_id){
+
+    io_uring_buf_ring_add(receiver->buffer_ring,
+                          get_receive_buffer(receiver, buffer_id),
+                          IO_URING_BUFFER_SIZE,
+                          buffer_id,
+                          io_uring_buf_ring_mask(IO_URING_NUMBER_OF_BUFFERS),
+                          0);
+
+    io_uring_buf_ring_advance(receiver->buffer_ring, 1);
+}
+
+static ErrorCode arm_multishot_receive(IoUringReceiver *receiver){
+
+    struct io_uring_sqe *sqe = NULL;
+
+    sqe = io_uring_get_sqe(&receiver->ring);
+    if(NULL == sqe){
+        zlog_error(category_debug, "io_uring_get_sqe failed");
+        return E_INITIALIZATION_FAIL;
+    }
+
+    io_uring_prep_recvmsg_multishot(sqe, 
+                                    receiver->socket_fd, 
+                                    &receiver->msg, 
+                                    0);
+
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = IO_URING_BUFFER_GROUP_ID;
+
+    return WORK_SUCCESSFULLY;
+}
+
+static void process_receive_completion(IoUringReceiver *receiver,
+                                       struct io_uring_cqe *cqe);
+
+/* The multishot receive keeps taking packets from the socket until it is 
+   cancelled. Packets it took before the cancellation completes are not left 
+   in the socket for the process the socket was handed off to, so they are 
+   processed here. */
+static void drain_multishot_receive(IoUringReceiver *receiver){
+
+    struct io_uring_sqe *sqe = NULL;
+    struct io_uring_cqe *cqe = NULL;
+    struct __kernel_timespec timeout;
+    bool is_receive_terminated = false;
+    int retry_times = 0;
+
+    sqe = io_uring_get_sqe(&receiver->ring);
+    if(NULL == sqe){
+        zlog_error(category_debug, "io_uring_get_sqe failed");
+        return;
+    }
+
+    io_uring_prep_cancel_fd(sqe, receiver->socket_fd, 0);
+    io_uring_sqe_set_data64(sqe, IO_URING_CANCEL_USER_DATA);
+
+    retry_times = MEMORY_ALLOCATE_RETRIES;
+    while(false == is_receive_terminated && retry_times --){
+
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = IO_URING_WAIT_TIMEOUT_IN_MS * 1000000LL;
+
+        /* A timeout leaves no completion to peek */
+        io_uring_submit_and_wait_timeout(&receiver->ring, 
+                                         &cqe, 
+                                         1, 
+                                         &timeout, 
+                                         NULL);
+        receiver->number_of_syscalls++;
+
+        while(0 == io_uring_peek_cqe(&receiver->ring, &cqe)){
+
+            if(IO_URING_CANCEL_USER_DATA != io_uring_cqe_get_data64(cqe)){
+
+                process_receive_completion(receiver, cqe);
+
+                if(0 == (cqe->flags & IORING_CQE_F_MORE)){
+                    is_receive_terminated = true;
+                }
+            }
+
+            io_uring_cqe_seen(&receiver->ring, cqe);
+        }
+    }
+}
+
+/* The caller holds send_lock */
+static void submit_queued_sends(IoUringReceiver *receiver){
+
+    struct io_uring_sqe *sqe = NULL;
+    struct io_uring_cqe *cqe = NULL;
+    int number_of_submitted = 0;
+    int i;
+
+    for(i = 0; i < receiver->number_of_queued_sends; i++){
+
+        sqe = io_uring_get_sqe(&receiver->send_ring);
+        if(NULL == sqe){
+            break;
+        }
+
+        io_uring_prep_sendmsg(sqe, 
+                              receiver->socket_fd, 
+                              &receiver->send_slots[i].msg, 
+                              0);
+        number_of_submitted++;
+    }
+
+    receiver->number_of_failed_sends += 
+        receiver->number_of_queued_sends - number_of_submitted;
+    receiver->number_of_queued_sends = 0;
+
+    if(0 == number_of_submitted){
+        return;
+    }
+
+    /* The slots are reused by the next batch, so the batch is waited for. 
+       UDP sends complete as soon as the packets are queued in the socket. */
+    io_uring_submit_and_wait(&receiver->send_ring, number_of_submitted);
+    receiver->number_of_send_syscalls++;
+
+    for(i = 0; i < number_of_submitted; i++){
+
+        if(0 != io_uring_wait_cqe(&receiver->send_ring, &cqe)){
+            receiver->number_of_failed_sends += number_of_submitted - i;
+            break;
+        }
+
+        if(cqe->res < 0){
+            receiver->number_of_failed_sends++;
+            zlog_error(category_debug, 
+                       "io_uring send failed, error=[%d]", -cqe->res);
+        }else{
+            receiver->number_of_sent_packets++;
+        }
+
+        io_uring_cqe_seen(&receiver->send_ring, cqe);
+    }
+}
+
+static void process_receive_completion(IoUringReceiver *receiver,
+                                       struct io_uring_cqe *cqe){
+
+    struct io_uring_recvmsg_out *out = NULL;
+    struct sockaddr_in *source = NULL;
+    char content[WIFI_MESSAGE_LENGTH];
+    char address[NETWORK_ADDR_LENGTH];
+    unsigned int payload_length = 0;
+    int buffer_id = 0;
+
+    if(cqe->res < 0){
+        if(-ENOBUFS == cqe->res){
+            receiver->number_of_buffer_exhaustions++;
+        }else{
+            zlog_error(category_debug, 
+                       "io_uring receive failed, error=[%d]", -cqe->res);
+        }
+        return;
+    }
+
+    if(0 == (cqe->flags & IORING_CQE_F_BUFFER)){
+        return;
+    }
+
+    buffer_id = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+    out = io_uring_recvmsg_validate(get_receive_buffer(receiver, buffer_id),
+                                    cqe->res,
+                                    &receiver->msg);
+
+    if(NULL != out && 
+       0 == (out->flags & MSG_TRUNC) &&
+       out->namelen >= sizeof(struct sockaddr_in)){
+
+        payload_length = io_uring_recvmsg_payload_length(out, 
+                                                         cqe->res, 
+                                                         &receiver->msg);
+
+        if(payload_length < sizeof(content)){
+
+            memset(content, 0, sizeof(content));
+            memcpy(content, 
+                   io_uring_recvmsg_payload(out, &receiver->msg), 
+                   payload_length);
+
+            source = (struct sockaddr_in *)io_uring_recvmsg_name(out);
+
+            memset(address, 0, sizeof(address));
+            inet_ntop(AF_INET, &source->sin_addr, address, sizeof(address));
+
+            receiver->last_packet_time = get_cached_clock_time();
+            if(0 == receiver->number_of_packets){
+                receiver->first_packet_time = receiver->last_packet_time;
+            }
+            receiver->number_of_packets++;
+            receiver->number_of_bytes += payload_length;
+
+            /* The buffer is returned to the kernel only after the payload 
+               is copied out */
+            recycle_receive_buffer(receiver, buffer_id);
+
+            receiver->handler(content, address, ntohs(source->sin_port));
+
+            return;
+        }
+    }
+
+    zlog_error(category_debug, "io_uring receive dropped a malformed packet");
+
+    recycle_receive_buffer(receiver, buffer_id);
+}
+
+ErrorCode init_io_uring_receiver(IoUringReceiver *receiver,
+                                 int port,
+                                 int inherited_socket_fd,
+                                 ReceivedPacketHandler handler){
+
+    struct sockaddr_in local_address;
+    struct io_uring_cqe *cqe = NULL;
+    int ret = 0;
+    int i;
+
+    memset(receiver, 0, sizeof(IoUringReceiver));
+
+    receiver->handler = handler;
+    receiver->port = port;
+    receiver->socket_fd = -1;
+
+    if(inherited_socket_fd >= 0){
+        receiver->socket_fd = dup(inherited_socket_fd);
+    }else{
+        receiver->socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    }
+    if(receiver->socket_fd < 0){
+        zlog_error(category_debug, "io_uring receiver socket failed");
+        return E_INITIALIZATION_FAIL;
+    }
+
+    memset(&local_address, 0, sizeof(local_address));
+    local_address.sin_family = AF_INET;
+    local_address.sin_addr.s_addr = htonl(INADDR_ANY);
+    local_address.sin_port = htons(port);
+
+    /* A handed off socket is already bound, and the port is still held by 
+       the process which handed it off */
+    if(inherited_socket_fd < 0 &&
+       bind(receiver->socket_fd, 
+            (struct sockaddr *)&local_address, 
+            sizeof(local_address)) < 0){
+
+        zlog_error(category_debug, 
+                   "io_uring receiver cannot bind port [%d]", port);
+        close(receiver->socket_fd);
+        receiver->socket_fd = -1;
+        return E_INITIALIZATION_FAIL;
+    }
+
+    ret = io_uring_queue_init(IO_URING_QUEUE_DEPTH, &receiver->ring, 0);
+    if(ret < 0){
+        zlog_error(category_debug, 
+                   "io_uring_queue_init failed, error=[%d]", -ret);
+        close(receiver->socket_fd);
+        receiver->socket_fd = -1;
+        return E_INITIALIZATION_FAIL;
+    }
+
+    ret = io_uring_queue_init(IO_URING_SEND_BATCH_SIZE, 
+                              &receiver->send_ring, 
+                              0);
+    if(ret < 0){
+        zlog_error(category_debug, 
+                   "io_uring_queue_init failed, error=[%d]", -ret);
+        io_uring_queue_exit(&receiver->ring);
+        close(receiver->socket_fd);
+        receiver->socket_fd = -1;
+        return E_INITIALIZATION_FAIL;
+    }
+
+    pthread_mutex_init( &receiver->send_lock, 0);
+
+    receiver->buffers = malloc((size_t)IO_URING_NUMBER_OF_BUFFERS * 
+                               IO_URING_BUFFER_SIZE);
+    receiver->send_slots = malloc(IO_URING_SEND_BATCH_SIZE * 
+                                  sizeof(IoUringSendSlot));
+    if(NULL == receiver->buffers || NULL == receiver->send_slots){
+        zlog_error(category_debug, "io_uring buffers malloc failed");
+        release_io_uring_receiver(receiver);
+        return E_MALLOC;
+    }
+
+    /* Each slot sends its own payload to its own address */
+    memset(receiver->send_slots, 0, 
+           IO_URING_SEND_BATCH_SIZE * sizeof(IoUringSendSlot));
+    for(i = 0; i < IO_URING_SEND_BATCH_SIZE; i++){
+        receiver->send_slots[i].iov.iov_base = 
+            receiver->send_slots[i].content;
+        receiver->send_slots[i].msg.msg_name = 
+            &receiver->send_slots[i].address;
+        receiver->send_slots[i].msg.msg_namelen = sizeof(struct sockaddr_in);
+        receiver->send_slots[i].msg.msg_iov = &receiver->send_slots[i].iov;
+        receiver->send_slots[i].msg.msg_iovlen = 1;
+    }
+
+    receiver->buffer_ring = 
+        io_uring_setup_buf_ring(&receiver->ring,
+                                IO_URING_NUMBER_OF_BUFFERS,
+                                IO_URING_BUFFER_GROUP_ID,
+                                0,
+                                &ret);
+    if(NULL == receiver->buffer_ring){
+        zlog_error(category_debug, 
+                   "io_uring_setup_buf_ring failed, error=[%d]", -ret);
+        release_io_uring_receiver(receiver);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    for(i = 0; i < IO_URING_NUMBER_OF_BUFFERS; i++){
+        io_uring_buf_ring_add(receiver->buffer_ring,
+                              get_receive_buffer(receiver, i),
+                              IO_URING_BUFFER_SIZE,
+                              i,
+                              io_uring_buf_ring_mask(
+                                  IO_URING_NUMBER_OF_BUFFERS),
+                              i);
+    }
+    io_uring_buf_ring_advance(receiver->buffer_ring, 
+                              IO_URING_NUMBER_OF_BUFFERS);
+
+    /* Only the source address is requested besides the payload */
+    memset(&receiver->msg, 0, sizeof(receiver->msg));
+    receiver->msg.msg_namelen = sizeof(struct sockaddr_in);
+
+    if(WORK_SUCCESSFULLY != arm_multishot_receive(receiver)){
+        release_io_uring_receiver(receiver);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    io_uring_submit(&receiver->ring);
+    receiver->number_of_syscalls++;
+
+    /* Kernels without multishot receive reject the request right at 
+       submission, so the server can still fall back to the UDP API */
+    if(0 == io_uring_peek_cqe(&receiver->ring, &cqe) && 
+       cqe->res < 0 && -ENOBUFS != cqe->res){
+
+        zlog_error(category_debug, 
+                   "io_uring multishot receive is not supported, " \
+                   "error=[%d]", -cqe->res);
+        io_uring_cqe_seen(&receiver->ring, cqe);
+        release_io_uring_receiver(receiver);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    zlog_info(category_debug, 
+              "io_uring receiver is listening on port [%d]", port);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void release_io_uring_receiver(IoUringReceiver *receiver){
+
+    if(receiver->socket_fd < 0){
+        return;
+    }
+
+    if(NULL != receiver->buffer_ring){
+        io_uring_free_buf_ring(&receiver->ring,
+                               receiver->buffer_ring,
+                               IO_URING_NUMBER_OF_BUFFERS,
+                               IO_URING_BUFFER_GROUP_ID);
+        receiver->buffer_ring = NULL;
+    }
+
+    io_uring_queue_exit(&receiver->ring);
+    io_uring_queue_exit(&receiver->send_ring);
+    pthread_mutex_destroy( &receiver->send_lock);
+
+    if(NULL != receiver->buffers){
+        free(receiver->buffers);
+        receiver->buffers = NULL;
+    }
+
+    if(NULL != receiver->send_slots){
+        free(receiver->send_slots);
+        receiver->send_slots = NULL;
+    }
+
+    close(receiver->socket_fd);
+    receiver->socket_fd = -1;
+}
+
+void run_io_uring_receiver(IoUringReceiver *receiver){
+
+    struct io_uring_cqe *cqe = NULL;
+    struct __kernel_timespec timeout;
+    unsigned int head = 0;
+    unsigned int number_of_completions = 0;
+    bool is_receive_terminated = false;
+    int ret = 0;
+
+    while(true == ready_to_work && false == receiver->is_stopped){
+
+        timeout.tv_sec = 0;
+        timeout.tv_nsec = IO_URING_WAIT_TIMEOUT_IN_MS * 1000000LL;
+
+        /* Submitting the re-armed receive and waiting for completions take 
+           a single system call */
+        ret = io_uring_submit_and_wait_timeout(&receiver->ring, 
+                                               &cqe, 
+                                               1, 
+                                               &timeout, 
+                                               NULL);
+        receiver->number_of_syscalls++;
+
+        if(ret < 0 && -ETIME != ret && -EINTR != ret){
+            zlog_error(category_debug, 
+                       "io_uring_submit_and_wait_timeout failed, " \
+                       "error=[%d]", -ret);
+        }
+
+        number_of_completions = 0;
+        is_receive_terminated = false;
+
+        io_uring_for_each_cqe(&receiver->ring, head, cqe){
+
+            process_receive_completion(receiver, cqe);
+
+            if(0 == (cqe->flags & IORING_CQE_F_MORE)){
+                is_receive_terminated = true;
+            }
+
+            number_of_completions++;
+        }
+
+        io_uring_cq_advance(&receiver->ring, number_of_completions);
+
+        if(true == is_receive_terminated){
+            arm_multishot_receive(receiver);
+        }
+    }
+
+    if(true == receiver->is_stopped){
+        drain_multishot_receive(receiver);
+    }
+}
+
+int get_io_uring_receiver_socket(IoUringReceiver *receiver){
+
+    return receiver->socket_fd;
+}
+
+ErrorCode queue_io_uring_send(IoUringReceiver *receiver,
+                              char *address,
+                              int port,
+                              char *content,
+                              int content_size){
+
+    IoUringSendSlot *slot = NULL;
+    struct in_addr destination;
+
+    if(content_size <= 0 || content_size > WIFI_MESSAGE_LENGTH ||
+       1 != inet_pton(AF_INET, address, &destination)){
+        return E_INPUT_PARAMETER;
+    }
+
+    pthread_mutex_lock( &receiver->send_lock);
+
+    if(IO_URING_SEND_BATCH_SIZE == receiver->number_of_queued_sends){
+        submit_queued_sends(receiver);
+    }
+
+    slot = &receiver->send_slots[receiver->number_of_queued_sends];
+
+    slot->address.sin_family = AF_INET;
+    slot->address.sin_addr = destination;
+    slot->address.sin_port = htons(port);
+
+    memcpy(slot->content, content, content_size);
+    slot->iov.iov_len = content_size;
+
+    receiver->number_of_queued_sends++;
+
+    pthread_mutex_unlock( &receiver->send_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void flush_io_uring_sends(IoUringReceiver *receiver){
+
+    pthread_mutex_lock( &receiver->send_lock);
+
+    submit_queued_sends(receiver);
+
+    pthread_mutex_unlock( &receiver->send_lock);
+}
+
+#else
+
+ErrorCode init_io_uring_receiver(IoUringReceiver *receiver,
+                                 int port,
+                                 int inherited_socket_fd,
+                                 ReceivedPacketHandler handler){
+
+    memset(receiver, 0, sizeof(IoUringReceiver));
+
+    receiver->handler = handler;
+    receiver->port = port;
+
+    zlog_error(category_debug, 
+               "io_uring receiver is not supported by this build");
+
+    return E_INITIALIZATION_FAIL;
+}
+
+void release_io_uring_receiver(IoUringReceiver *receiver){
+
+    return;
+}
+
+void run_io_uring_receiver(IoUringReceiver *receiver){
+
+    return;
+}
+
+int get_io_uring_receiver_socket(IoUringReceiver *receiver){
+
+    return -1;
+}
+
+ErrorCode queue_io_uring_send(IoUringReceiver *receiver,
+                              char *address,
+                              int port,
+                              char *content,
+                              int content_size){
+
+    return E_INITIALIZATION_FAIL;
+}
+
+void flush_io_uring_sends(IoUringReceiver *receiver){
+
+    return;
+}
+
+#endif
+
+void get_io_uring_receiver_report(IoUringReceiver *receiver,
+                                  char *buf,
+                                  size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+    double syscalls_per_packet = 0;
+    double packets_per_second = 0;
+    int duration = 0;
+
+    if(receiver->number_of_packets > 0){
+        syscalls_per_packet = (double)receiver->number_of_syscalls / 
+                              receiver->number_of_packets;
+    }
+
+    duration = receiver->last_packet_time - receiver->first_packet_time;
+    if(duration > 0){
+        packets_per_second = (double)receiver->number_of_packets / duration;
+    }
+
+    memset(report, 0, sizeof(report));
+    sprintf(report, 
+            "io_uring_packets=%llu;io_uring_bytes=%llu;" \
+            "io_uring_syscalls=%llu;io_uring_syscalls_per_packet=%.3f;" \
+            "io_uring_packets_per_sec=%.1f;io_uring_buffer_exhaustions=%llu;" \
+            "io_uring_sent_packets=%llu;io_uring_failed_sends=%llu;" \
+            "io_uring_send_syscalls=%llu;",
+            receiver->number_of_packets,
+            receiver->number_of_bytes,
+            receiver->number_of_syscalls,
+            syscalls_per_packet,
+            packets_per_second,
+            receiver->number_of_buffer_exhaustions,
+            receiver->number_of_sent_packets,
+            receiver->number_of_failed_sends,
+            receiver->number_of_send_syscalls);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
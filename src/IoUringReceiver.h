@@ -0,0 +1,338 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     IoUringReceiver.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in IoUringReceiver.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef IO_URING_RECEIVER_H
+#define IO_URING_RECEIVER_H
+
+#include "BeDIS.h"
+
+#if defined(BOT_SERVER_USE_IO_URING) && defined(__linux__)
+#define IO_URING_RECEIVER_SUPPORTED
+#include <liburing.h>
+#include <netinet/in.h>
+#endif
+
+/* Number of entries in the submission queue of the io_uring instance */
+#define IO_URING_QUEUE_DEPTH 256
+
+/* Number of receive buffers provided to the kernel. It must be a power of 
+two. */
+#define IO_URING_NUMBER_OF_BUFFERS 1024
+
+/* Length in number of bytes of each provided receive buffer. Besides the 
+payload, the kernel places the message header and the source address at the 
+start of the buffer. */
+#define IO_URING_BUFFER_SIZE (WIFI_MESSAGE_LENGTH + 128)
+
+/* The id of the group of provided receive buffers */
+#define IO_URING_BUFFER_GROUP_ID 1
+
+/* The user data of the request cancelling the multishot receive. The 
+receive itself has user data 0. */
+#define IO_URING_CANCEL_USER_DATA 1
+
+/* Time in milliseconds to wait for completions before checking whether the 
+receiver should stop */
+#define IO_URING_WAIT_TIMEOUT_IN_MS 100
+
+/* Number of packets queued to be sent before they are submitted together. 
+It is also the depth of the io_uring instance used to send. */
+#define IO_URING_SEND_BATCH_SIZE 32
+
+#ifdef IO_URING_RECEIVER_SUPPORTED
+/* One packet queued to be sent from the socket of the receiver */
+typedef struct {
+
+    struct msghdr msg;
+
+    struct iovec iov;
+
+    struct sockaddr_in address;
+
+    char content[WIFI_MESSAGE_LENGTH];
+
+} IoUringSendSlot;
+#endif
+
+/* The function to parse and dispatch one packet received from gateways */
+typedef ErrorCode (*ReceivedPacketHandler)(char *content,
+                                           char *address,
+                                           int port);
+
+typedef struct {
+
+    /* The function to process each received packet */
+    ReceivedPacketHandler handler;
+
+    /* The UDP port the receiver is listening on */
+    int port;
+
+#ifdef IO_URING_RECEIVER_SUPPORTED
+    /* The UDP socket bound to port */
+    int socket_fd;
+
+    struct io_uring ring;
+
+    /* The ring of receive buffers provided to the kernel */
+    struct io_uring_buf_ring *buffer_ring;
+
+    /* The memory of the provided receive buffers */
+    char *buffers;
+
+    /* The message header template used by the multishot receive */
+    struct msghdr msg;
+
+    /* The io_uring instance used to send from socket_fd. The receive ring 
+       is only driven by the receiving thread, so senders have their own. */
+    struct io_uring send_ring;
+
+    /* The lock serializing the threads queueing and submitting sends */
+    pthread_mutex_t send_lock;
+
+    /* The packets queued to be sent and the number of them */
+    IoUringSendSlot *send_slots;
+    int number_of_queued_sends;
+#endif
+
+    /* The number of packets received */
+    unsigned long long number_of_packets;
+
+    /* The number of payload bytes received */
+    unsigned long long number_of_bytes;
+
+    /* The number of system calls made to submit requests and reap 
+       completions */
+    unsigned long long number_of_syscalls;
+
+    /* The number of times the kernel ran out of provided buffers */
+    unsigned long long number_of_buffer_exhaustions;
+
+    /* The number of packets sent, the number of them which failed and the 
+       number of system calls made to send them */
+    unsigned long long number_of_sent_packets;
+    unsigned long long number_of_failed_sends;
+    unsigned long long number_of_send_syscalls;
+
+    /* The clock time in seconds of the first and the latest packets */
+    int first_packet_time;
+    int last_packet_time;
+
+    /* The flag asking the receiver to stop before ready_to_work becomes 
+       false, when its socket was handed off to another process */
+    volatile bool is_stopped;
+
+} IoUringReceiver;
+
+/* global variables */
+
+/* The optional io_uring receiver of gateway packets */
+IoUringReceiver io_uring_receiver;
+
+/*
+  init_io_uring_receiver:
+
+     This function binds a UDP socket to the specified port, creates the 
+     io_uring instances to receive and to send, registers the ring of 
+     provided receive buffers and arms a multishot receive on the socket. A 
+     socket already bound to the port by another process is duplicated 
+     instead.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+     port - The UDP port to listen on
+
+     inherited_socket_fd - The socket bound to port and handed off by 
+                           another process, or -1 to bind a new socket
+
+     handler - The function to process each received packet
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INITIALIZATION_FAIL: io_uring is not supported by this 
+                                        build or by the kernel. The caller 
+                                        keeps using the UDP API.
+
+ */
+
+ErrorCode init_io_uring_receiver(IoUringReceiver *receiver,
+                                 int port,
+                                 int inherited_socket_fd,
+                                 ReceivedPacketHandler handler);
+
+/*
+  release_io_uring_receiver:
+
+     This function closes the socket and releases the io_uring instance and 
+     the provided receive buffers.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+  Return value:
+
+     None
+
+ */
+
+void release_io_uring_receiver(IoUringReceiver *receiver);
+
+/*
+  run_io_uring_receiver:
+
+     This function reaps the completions of the multishot receive and passes 
+     each packet to the handler until ready_to_work becomes false. The 
+     receive is re-armed when the kernel terminates it. When the receiver is 
+     stopped, the receive is cancelled and the packets it already took from 
+     the socket are still passed to the handler.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+  Return value:
+
+     None
+
+ */
+
+void run_io_uring_receiver(IoUringReceiver *receiver);
+
+/*
+  get_io_uring_receiver_socket:
+
+     This function returns the UDP socket of the receiver.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+  Return value:
+
+     int - The socket, or -1 if io_uring is not supported by this build
+
+ */
+
+int get_io_uring_receiver_socket(IoUringReceiver *receiver);
+
+/*
+  queue_io_uring_send:
+
+     This function copies a packet into the send queue of the receiver, so 
+     it is sent from the socket bound to the port of the receiver. Gateways 
+     then see replies and polls coming from the port they send to. The 
+     queue is submitted when it is full or when flush_io_uring_sends is 
+     called.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+     address - The IPv4 address of the destination
+
+     port - The UDP port of the destination
+
+     content - The payload to send
+
+     content_size - Length in number of bytes of content
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the address or the size is invalid.
+                 E_INITIALIZATION_FAIL: io_uring is not supported by this 
+                                        build.
+
+ */
+
+ErrorCode queue_io_uring_send(IoUringReceiver *receiver,
+                              char *address,
+                              int port,
+                              char *content,
+                              int content_size);
+
+/*
+  flush_io_uring_sends:
+
+     This function submits all queued packets with one system call, and 
+     waits until the kernel completes them so their slots can be reused.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+  Return value:
+
+     None
+
+ */
+
+void flush_io_uring_sends(IoUringReceiver *receiver);
+
+/*
+  get_io_uring_receiver_report:
+
+     This function writes the counters of the receiver into buf, including 
+     the number of system calls per packet and the throughput in packets per 
+     second.
+
+  Parameters:
+
+     receiver - The pointer to the io_uring receiver
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_io_uring_receiver_report(IoUringReceiver *receiver,
+                                  char *buf,
+                                  size_t buf_len);
+
+#endif
@@ -0,0 +1,371 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ObjectMirror.c
+
+  File Description:
+
+     This file provides APIs to keep an in-memory mirror of the monitor type,
+     area and room of objects in object_table, so the hot paths can skip
+     the database work for objects which are not monitored.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "ObjectMirror.h"
+
+static int get_object_mirror_bucket(unsigned long long packed_mac_address){
+
+    return (int)((packed_mac_address ^ (packed_mac_address >> 24)) % 
+                 NUMBER_OF_OBJECT_MIRROR_BUCKETS);
+}
+
+/* Returns the node of the object, or NULL if the object is not in the 
+   mirror. The caller must hold the list lock. */
+static ObjectMirrorNode *find_object_mirror_node(
+    ObjectMirror *mirror,
+    unsigned long long packed_mac_address){
+
+    List_Entry *current_list_entry = NULL;
+    ObjectMirrorNode *current_list_ptr = NULL;
+    int bucket = 0;
+
+    bucket = get_object_mirror_bucket(packed_mac_address);
+
+    list_for_each(current_list_entry, &mirror->bucket_list_head[bucket]){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     ObjectMirrorNode,
+                                     bucket_list_entry);
+
+        if(current_list_ptr->packed_mac_address == packed_mac_address){
+            return current_list_ptr;
+        }
+    }
+
+    return NULL;
+}
+
+unsigned long long pack_mac_address(char *mac_address){
+
+    unsigned long long packed_mac_address = 0;
+    char *current_char = mac_address;
+    int digit = 0;
+
+    while(*current_char != '\0'){
+
+        if(*current_char >= '0' && *current_char <= '9'){
+            digit = *current_char - '0';
+        }else if(*current_char >= 'a' && *current_char <= 'f'){
+            digit = *current_char - 'a' + 10;
+        }else if(*current_char >= 'A' && *current_char <= 'F'){
+            digit = *current_char - 'A' + 10;
+        }else{
+            current_char++;
+            continue;
+        }
+
+        packed_mac_address = (packed_mac_address << 4) | digit;
+        current_char++;
+    }
+
+    return packed_mac_address;
+}
+
+void init_object_mirror(ObjectMirror *mirror){
+
+    int i;
+
+    pthread_mutex_init(&mirror->list_lock, 0);
+
+    for(i = 0; i < NUMBER_OF_OBJECT_MIRROR_BUCKETS; i++){
+        init_entry(&mirror->bucket_list_head[i]);
+    }
+
+    mirror->is_loaded = false;
+    mirror->generation = 0;
+    mirror->number_of_objects = 0;
+}
+
+void destroy_object_mirror(ObjectMirror *mirror){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    ObjectMirrorNode *current_list_ptr = NULL;
+    int i;
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    for(i = 0; i < NUMBER_OF_OBJECT_MIRROR_BUCKETS; i++){
+
+        list_for_each_safe(current_list_entry,
+                           next_list_entry,
+                           &mirror->bucket_list_head[i]){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         ObjectMirrorNode,
+                                         bucket_list_entry);
+
+            remove_list_node(&current_list_ptr->bucket_list_entry);
+
+            mp_free(&object_mirror_mempool, current_list_ptr);
+        }
+    }
+
+    mirror->is_loaded = false;
+    mirror->number_of_objects = 0;
+
+    pthread_mutex_unlock(&mirror->list_lock);
+}
+
+int begin_object_mirror_load(ObjectMirror *mirror){
+
+    int generation = 0;
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    mirror->generation++;
+    generation = mirror->generation;
+
+    pthread_mutex_unlock(&mirror->list_lock);
+
+    return generation;
+}
+
+ErrorCode update_object_mirror(ObjectMirror *mirror,
+                               int generation,
+                               char *mac_address,
+                               int monitor_type,
+                               int area_id,
+                               char *room){
+
+    ObjectMirrorNode *current_node = NULL;
+    unsigned long long packed_mac_address = 0;
+    int bucket = 0;
+    int retry_times = 0;
+
+    if(mac_address == NULL || strlen(mac_address) == 0 ||
+       strlen(mac_address) >= LENGTH_OF_MAC_ADDRESS){
+        return E_INPUT_PARAMETER;
+    }
+
+    packed_mac_address = pack_mac_address(mac_address);
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    current_node = find_object_mirror_node(mirror, packed_mac_address);
+
+    if(NULL == current_node){
+
+        retry_times = MEMORY_ALLOCATE_RETRIES;
+        while(retry_times --){
+            current_node = mp_alloc(&object_mirror_mempool);
+            if(NULL != current_node)
+                break;
+        }
+        if(NULL == current_node){
+            pthread_mutex_unlock(&mirror->list_lock);
+
+            zlog_error(category_debug,
+                       "update_object_mirror (current_node) mp_alloc " \
+                       "failed, abort this data");
+            return E_MALLOC;
+        }
+
+        memset(current_node, 0, sizeof(ObjectMirrorNode));
+
+        init_entry(&current_node->bucket_list_entry);
+
+        current_node->packed_mac_address = packed_mac_address;
+
+        bucket = get_object_mirror_bucket(packed_mac_address);
+        insert_list_tail(&current_node->bucket_list_entry,
+                         &mirror->bucket_list_head[bucket]);
+
+        mirror->number_of_objects++;
+    }
+
+    strcpy(current_node->mac_address, mac_address);
+    current_node->monitor_type = monitor_type;
+    current_node->area_id = area_id;
+
+    memset(current_node->room, 0, sizeof(current_node->room));
+    if(room != NULL){
+        strncpy(current_node->room, room, sizeof(current_node->room) - 1);
+    }
+
+    current_node->generation = generation;
+
+    pthread_mutex_unlock(&mirror->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void finish_object_mirror_load(ObjectMirror *mirror, int generation){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    ObjectMirrorNode *current_list_ptr = NULL;
+    int i;
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    /* Remove the objects deleted from object_table since the previous 
+       load */
+    for(i = 0; i < NUMBER_OF_OBJECT_MIRROR_BUCKETS; i++){
+
+        list_for_each_safe(current_list_entry,
+                           next_list_entry,
+                           &mirror->bucket_list_head[i]){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         ObjectMirrorNode,
+                                         bucket_list_entry);
+
+            if(current_list_ptr->generation == generation){
+                continue;
+            }
+
+            remove_list_node(&current_list_ptr->bucket_list_entry);
+
+            mp_free(&object_mirror_mempool, current_list_ptr);
+
+            mirror->number_of_objects--;
+        }
+    }
+
+    mirror->is_loaded = true;
+
+    pthread_mutex_unlock(&mirror->list_lock);
+}
+
+bool is_object_monitored(ObjectMirror *mirror,
+                         char *mac_address,
+                         int monitor_type){
+
+    ObjectMirrorNode *current_node = NULL;
+    bool is_monitored = true;
+
+    if(mac_address == NULL){
+        return true;
+    }
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    if(true == mirror->is_loaded){
+
+        current_node = find_object_mirror_node(mirror,
+                                               pack_mac_address(mac_address));
+
+        is_monitored = (NULL != current_node && 
+                        0 != (current_node->monitor_type & monitor_type));
+    }
+
+    pthread_mutex_unlock(&mirror->list_lock);
+
+    return is_monitored;
+}
+
+bool has_monitored_objects(ObjectMirror *mirror, int monitor_type){
+
+    List_Entry *current_list_entry = NULL;
+    ObjectMirrorNode *current_list_ptr = NULL;
+    bool is_monitored = false;
+    int i;
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    if(false == mirror->is_loaded){
+        pthread_mutex_unlock(&mirror->list_lock);
+        return true;
+    }
+
+    for(i = 0; i < NUMBER_OF_OBJECT_MIRROR_BUCKETS && !is_monitored; i++){
+
+        list_for_each(current_list_entry, &mirror->bucket_list_head[i]){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         ObjectMirrorNode,
+                                         bucket_list_entry);
+
+            if(0 != (current_list_ptr->monitor_type & monitor_type)){
+                is_monitored = true;
+                break;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&mirror->list_lock);
+
+    return is_monitored;
+}
+
+ErrorCode dump_mac_address_under_monitor(ObjectMirror *mirror,
+                                         int monitor_type,
+                                         char *filename){
+
+    List_Entry *current_list_entry = NULL;
+    ObjectMirrorNode *current_list_ptr = NULL;
+    FILE *file = NULL;
+    int i;
+
+    file = fopen(filename, "wt");
+    if(file == NULL){
+        zlog_error(category_debug, "cannot open filepath %s", filename);
+        return E_OPEN_FILE;
+    }
+
+    pthread_mutex_lock(&mirror->list_lock);
+
+    for(i = 0; i < NUMBER_OF_OBJECT_MIRROR_BUCKETS; i++){
+
+        list_for_each(current_list_entry, &mirror->bucket_list_head[i]){
+
+            current_list_ptr = ListEntry(current_list_entry,
+                                         ObjectMirrorNode,
+                                         bucket_list_entry);
+
+            if(0 == (current_list_ptr->monitor_type & monitor_type)){
+                continue;
+            }
+
+            fprintf(file, "%d;%s;\n", 
+                    current_list_ptr->area_id,
+                    current_list_ptr->mac_address);
+        }
+    }
+
+    pthread_mutex_unlock(&mirror->list_lock);
+
+    fclose(file);
+
+    return WORK_SUCCESSFULLY;
+}
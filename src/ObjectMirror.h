@@ -0,0 +1,308 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ObjectMirror.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in ObjectMirror.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef OBJECT_MIRROR_H
+#define OBJECT_MIRROR_H
+
+#include "BeDIS.h"
+#include "Occupancy.h"
+
+/* Number of hash buckets used to look up objects in the object mirror */
+#define NUMBER_OF_OBJECT_MIRROR_BUCKETS 4096
+
+/* The channel notified by the trigger on object_table. The trigger is 
+expected to run "NOTIFY object_table_changed" after each INSERT, UPDATE or 
+DELETE statement on object_table. */
+#define OBJECT_TABLE_CHANGE_CHANNEL "object_table_changed"
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The hash buckets of the objects keyed by packed MAC address */
+    struct List_Entry bucket_list_head[NUMBER_OF_OBJECT_MIRROR_BUCKETS];
+
+    /* The flag indicating whether the mirror is loaded from object_table. 
+       The lookups fall back to the database before the first load. */
+    bool is_loaded;
+
+    /* The generation of the latest load. Objects not seen by the latest 
+       load are removed from the mirror. */
+    int generation;
+
+    /* The number of objects in the mirror */
+    int number_of_objects;
+
+} ObjectMirror;
+
+typedef struct {
+
+    /* The 48-bit MAC address packed into an integer */
+    unsigned long long packed_mac_address;
+
+    /* The MAC address as stored in object_table */
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+
+    /* The bitmask of ObjectMonitorType */
+    int monitor_type;
+
+    int area_id;
+
+    char room[LENGTH_OF_ROOM];
+
+    /* The generation of the load which last saw the object */
+    int generation;
+
+    /* The list entry for inserting the node into its hash bucket */
+    List_Entry bucket_list_entry;
+
+} ObjectMirrorNode;
+
+/* global variables */
+
+/* The mempool for the object mirror node structures */
+Memory_Pool object_mirror_mempool;
+
+/* The in-memory mirror of object_table */
+ObjectMirror object_mirror;
+
+/*
+  pack_mac_address:
+
+     This function packs the hexadecimal digits of a MAC address into an 
+     integer. Separators and letter case are ignored, so the same MAC address 
+     in different notations is packed into the same integer.
+
+  Parameters:
+
+     mac_address - The MAC address in text form
+
+  Return value:
+
+     unsigned long long - The packed MAC address
+
+ */
+
+unsigned long long pack_mac_address(char *mac_address);
+
+/*
+  init_object_mirror:
+
+     This function initializes the object mirror. The mirror stays unloaded 
+     until the first call to finish_object_mirror_load.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+  Return value:
+
+     None
+
+ */
+
+void init_object_mirror(ObjectMirror *mirror);
+
+/*
+  destroy_object_mirror:
+
+     This function releases all nodes in the object mirror back to the memory 
+     pool.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_object_mirror(ObjectMirror *mirror);
+
+/*
+  begin_object_mirror_load:
+
+     This function starts a new load of the object mirror. The objects of 
+     the load are then added by update_object_mirror.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+  Return value:
+
+     int - The generation of the new load
+
+ */
+
+int begin_object_mirror_load(ObjectMirror *mirror);
+
+/*
+  update_object_mirror:
+
+     This function inserts or updates an object of a load in the mirror.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+     generation - The generation returned by begin_object_mirror_load
+
+     mac_address - The MAC address of the object
+
+     monitor_type - The bitmask of ObjectMonitorType of the object
+
+     area_id - The area id of the object
+
+     room - The room of the object
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the MAC address is empty.
+                 E_MALLOC: no free node in object_mirror_mempool.
+
+ */
+
+ErrorCode update_object_mirror(ObjectMirror *mirror,
+                               int generation,
+                               char *mac_address,
+                               int monitor_type,
+                               int area_id,
+                               char *room);
+
+/*
+  finish_object_mirror_load:
+
+     This function removes the objects not seen by the load from the mirror 
+     and marks the mirror as loaded. It must only be called after all 
+     objects of the load are added successfully.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+     generation - The generation returned by begin_object_mirror_load
+
+  Return value:
+
+     None
+
+ */
+
+void finish_object_mirror_load(ObjectMirror *mirror, int generation);
+
+/*
+  is_object_monitored:
+
+     This function checks whether an object is monitored with any bit of 
+     monitor_type. It always returns true before the mirror is loaded, so 
+     the callers fall back to checking in the database.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+     mac_address - The MAC address of the object
+
+     monitor_type - The bitmask of ObjectMonitorType to be checked
+
+  Return value:
+
+     bool - true: the object may be monitored.
+            false: the object is known not to be monitored.
+
+ */
+
+bool is_object_monitored(ObjectMirror *mirror,
+                         char *mac_address,
+                         int monitor_type);
+
+/*
+  has_monitored_objects:
+
+     This function checks whether any object is monitored with any bit of 
+     monitor_type. It always returns true before the mirror is loaded.
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+     monitor_type - The bitmask of ObjectMonitorType to be checked
+
+  Return value:
+
+     bool - true: some objects may be monitored.
+            false: no object is monitored.
+
+ */
+
+bool has_monitored_objects(ObjectMirror *mirror, int monitor_type);
+
+/*
+  dump_mac_address_under_monitor:
+
+     This function writes the area id and MAC address of the objects 
+     monitored with any bit of monitor_type into the file, one object per 
+     line in the format of "area_id;mac_address;".
+
+  Parameters:
+
+     mirror - The pointer to the object mirror
+
+     monitor_type - The bitmask of ObjectMonitorType to be checked
+
+     filename - The file path of the dumped objects
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the file cannot be opened.
+
+ */
+
+ErrorCode dump_mac_address_under_monitor(ObjectMirror *mirror,
+                                         int monitor_type,
+                                         char *filename);
+
+#endif
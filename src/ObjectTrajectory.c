@@ -0,0 +1,434 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ObjectTrajectory.c
+
+  File Description:
+
+     This file provides APIs to keep the recent LBeacon transitions of each
+     object in memory, so the trajectory of an object in a time range can be
+     answered without querying the database.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "ObjectTrajectory.h"
+
+static int get_trajectory_bucket(char *mac_address){
+
+    unsigned int hash = 5381;
+    char *current_char = mac_address;
+
+    while(*current_char != '\0'){
+        hash = ((hash << 5) + hash) + (unsigned char) *current_char;
+        current_char++;
+    }
+
+    return hash % NUMBER_OF_TRAJECTORY_BUCKETS;
+}
+
+/* Returns the node of the object, or NULL if the object has no trajectory. 
+   The caller must hold the list lock. */
+static TrajectoryObjectNode *find_trajectory_object(TrajectoryHistory *history,
+                                                    char *mac_address){
+
+    List_Entry *current_list_entry = NULL;
+    TrajectoryObjectNode *current_list_ptr = NULL;
+    int bucket = 0;
+
+    bucket = get_trajectory_bucket(mac_address);
+
+    list_for_each(current_list_entry, &history->bucket_list_head[bucket]){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     TrajectoryObjectNode,
+                                     bucket_list_entry);
+
+        if(strncmp(current_list_ptr->mac_address,
+                   mac_address,
+                   LENGTH_OF_MAC_ADDRESS) == 0){
+
+            return current_list_ptr;
+        }
+    }
+
+    return NULL;
+}
+
+/* Keeps a transition overwritten in the ring of an object for 
+   spill_object_trajectory. The caller must hold the list lock. */
+static void keep_overwritten_trajectory(TrajectoryHistory *history,
+                                        char *mac_address,
+                                        TrajectoryEntry *entry){
+
+    TrajectorySpillNode *new_node = NULL;
+    int retry_times = 0;
+
+    if(false == history->is_spill_enabled){
+        return;
+    }
+
+    retry_times = MEMORY_ALLOCATE_RETRIES;
+    while(retry_times --){
+        new_node = mp_alloc(&trajectory_spill_mempool);
+        if(NULL != new_node)
+            break;
+    }
+    if(NULL == new_node){
+        history->number_of_dropped_entries++;
+        return;
+    }
+
+    memset(new_node, 0, sizeof(TrajectorySpillNode));
+
+    init_entry(&new_node->spill_list_entry);
+
+    strcpy(new_node->mac_address, mac_address);
+    memcpy(&new_node->entry, entry, sizeof(TrajectoryEntry));
+
+    insert_list_tail(&new_node->spill_list_entry, &history->spill_list_head);
+
+    history->number_of_pending_entries++;
+}
+
+void init_object_trajectory_history(TrajectoryHistory *history,
+                                    bool is_spill_enabled){
+
+    int i;
+
+    pthread_mutex_init(&history->list_lock, 0);
+
+    for(i = 0; i < NUMBER_OF_TRAJECTORY_BUCKETS; i++){
+        init_entry(&history->bucket_list_head[i]);
+    }
+
+    init_entry(&history->spill_list_head);
+
+    history->is_spill_enabled = is_spill_enabled;
+    history->number_of_objects = 0;
+    history->number_of_pending_entries = 0;
+    history->number_of_dropped_entries = 0;
+}
+
+void destroy_object_trajectory_history(TrajectoryHistory *history){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    TrajectoryObjectNode *current_object_ptr = NULL;
+    TrajectorySpillNode *current_spill_ptr = NULL;
+    int i;
+
+    pthread_mutex_lock(&history->list_lock);
+
+    for(i = 0; i < NUMBER_OF_TRAJECTORY_BUCKETS; i++){
+
+        list_for_each_safe(current_list_entry,
+                           next_list_entry,
+                           &history->bucket_list_head[i]){
+
+            current_object_ptr = ListEntry(current_list_entry,
+                                           TrajectoryObjectNode,
+                                           bucket_list_entry);
+
+            remove_list_node(&current_object_ptr->bucket_list_entry);
+
+            mp_free(&trajectory_object_mempool, current_object_ptr);
+        }
+    }
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &history->spill_list_head){
+
+        current_spill_ptr = ListEntry(current_list_entry,
+                                      TrajectorySpillNode,
+                                      spill_list_entry);
+
+        remove_list_node(&current_spill_ptr->spill_list_entry);
+
+        mp_free(&trajectory_spill_mempool, current_spill_ptr);
+    }
+
+    history->number_of_objects = 0;
+    history->number_of_pending_entries = 0;
+
+    pthread_mutex_unlock(&history->list_lock);
+}
+
+ErrorCode record_object_trajectory(TrajectoryHistory *history,
+                                   char *mac_address,
+                                   char *uuid,
+                                   int base_x,
+                                   int base_y,
+                                   long long enter_timestamp_in_us,
+                                   long long leave_timestamp_in_us){
+
+    TrajectoryObjectNode *object_node = NULL;
+    TrajectoryEntry *entry = NULL;
+    int bucket = 0;
+    int retry_times = 0;
+
+    if(mac_address == NULL || strlen(mac_address) == 0 ||
+       strlen(mac_address) >= LENGTH_OF_MAC_ADDRESS ||
+       uuid == NULL || strlen(uuid) == 0 || 
+       strlen(uuid) >= LENGTH_OF_UUID){
+        return E_INPUT_PARAMETER;
+    }
+
+    pthread_mutex_lock(&history->list_lock);
+
+    object_node = find_trajectory_object(history, mac_address);
+
+    if(NULL == object_node){
+
+        retry_times = MEMORY_ALLOCATE_RETRIES;
+        while(retry_times --){
+            object_node = mp_alloc(&trajectory_object_mempool);
+            if(NULL != object_node)
+                break;
+        }
+        if(NULL == object_node){
+            pthread_mutex_unlock(&history->list_lock);
+
+            zlog_error(category_debug,
+                       "record_object_trajectory (object_node) mp_alloc " \
+                       "failed, abort this data");
+            return E_MALLOC;
+        }
+
+        memset(object_node, 0, sizeof(TrajectoryObjectNode));
+
+        init_entry(&object_node->bucket_list_entry);
+
+        strcpy(object_node->mac_address, mac_address);
+
+        bucket = get_trajectory_bucket(mac_address);
+        insert_list_tail(&object_node->bucket_list_entry,
+                         &history->bucket_list_head[bucket]);
+
+        history->number_of_objects++;
+    }
+
+    /* Extend the latest transition if the object has not left the LBeacon 
+       since the transition began */
+    if(object_node->number_of_entries > 0){
+
+        entry = &object_node->entries[(object_node->first_entry + 
+                                       object_node->number_of_entries - 1) % 
+                                      LENGTH_OF_OBJECT_TRAJECTORY];
+
+        if(strncmp(entry->uuid, uuid, LENGTH_OF_UUID) == 0 &&
+           entry->enter_timestamp_in_us == enter_timestamp_in_us){
+
+            if(leave_timestamp_in_us > entry->leave_timestamp_in_us){
+                entry->leave_timestamp_in_us = leave_timestamp_in_us;
+            }
+            entry->base_x = base_x;
+            entry->base_y = base_y;
+
+            pthread_mutex_unlock(&history->list_lock);
+            return WORK_SUCCESSFULLY;
+        }
+    }
+
+    /* Overwrite the oldest transition when the ring is full */
+    if(object_node->number_of_entries == LENGTH_OF_OBJECT_TRAJECTORY){
+
+        keep_overwritten_trajectory(
+            history,
+            mac_address,
+            &object_node->entries[object_node->first_entry]);
+
+        object_node->first_entry = (object_node->first_entry + 1) % 
+                                   LENGTH_OF_OBJECT_TRAJECTORY;
+        object_node->number_of_entries--;
+    }
+
+    entry = &object_node->entries[(object_node->first_entry + 
+                                   object_node->number_of_entries) % 
+                                  LENGTH_OF_OBJECT_TRAJECTORY];
+
+    memset(entry, 0, sizeof(TrajectoryEntry));
+    strcpy(entry->uuid, uuid);
+    entry->enter_timestamp_in_us = enter_timestamp_in_us;
+    entry->leave_timestamp_in_us = leave_timestamp_in_us;
+    entry->base_x = base_x;
+    entry->base_y = base_y;
+
+    object_node->number_of_entries++;
+
+    pthread_mutex_unlock(&history->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+int get_object_trajectory(TrajectoryHistory *history,
+                          char *mac_address,
+                          long long start_timestamp_in_us,
+                          long long end_timestamp_in_us,
+                          TrajectoryEntry *entries,
+                          int max_entries){
+
+    TrajectoryObjectNode *object_node = NULL;
+    TrajectoryEntry *entry = NULL;
+    int number_of_entries = 0;
+    int i;
+
+    if(mac_address == NULL || strlen(mac_address) == 0 ||
+       strlen(mac_address) >= LENGTH_OF_MAC_ADDRESS){
+        return 0;
+    }
+
+    pthread_mutex_lock(&history->list_lock);
+
+    object_node = find_trajectory_object(history, mac_address);
+
+    if(NULL != object_node){
+
+        for(i = 0; i < object_node->number_of_entries; i++){
+
+            if(number_of_entries >= max_entries){
+                break;
+            }
+
+            entry = &object_node->entries[(object_node->first_entry + i) % 
+                                          LENGTH_OF_OBJECT_TRAJECTORY];
+
+            if(entry->leave_timestamp_in_us < start_timestamp_in_us ||
+               entry->enter_timestamp_in_us > end_timestamp_in_us){
+                continue;
+            }
+
+            memcpy(&entries[number_of_entries], entry, 
+                   sizeof(TrajectoryEntry));
+            number_of_entries++;
+        }
+    }
+
+    pthread_mutex_unlock(&history->list_lock);
+
+    return number_of_entries;
+}
+
+ErrorCode spill_object_trajectory(TrajectoryHistory *history,
+                                  char *archive_directory){
+
+    List_Entry spill_list_head;
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    TrajectorySpillNode *current_list_ptr = NULL;
+    char filename[MAX_PATH];
+    char date[80];
+    time_t rawtime;
+    struct tm ts;
+    FILE *file = NULL;
+    int number_of_spilled_entries = 0;
+
+    pthread_mutex_lock(&history->list_lock);
+
+    if(0 == history->number_of_pending_entries){
+        pthread_mutex_unlock(&history->list_lock);
+        return WORK_SUCCESSFULLY;
+    }
+
+    pthread_mutex_unlock(&history->list_lock);
+
+    rawtime = time(NULL);
+    ts = *gmtime(&rawtime);
+
+    memset(date, 0, sizeof(date));
+    strftime(date, sizeof(date), "%Y%m%d", &ts);
+
+    memset(filename, 0, sizeof(filename));
+    sprintf(filename, "%s/%s%s.csv", 
+            archive_directory, 
+            OBJECT_TRAJECTORY_SPILL_FILE_PREFIX,
+            date);
+
+    file = fopen(filename, "a");
+    if(file == NULL){
+        zlog_error(category_debug, "cannot open filepath %s", filename);
+        return E_OPEN_FILE;
+    }
+
+    /* Take the pending transitions out of the history, so the file is 
+       written without holding the list lock */
+    init_entry(&spill_list_head);
+
+    pthread_mutex_lock(&history->list_lock);
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &history->spill_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     TrajectorySpillNode,
+                                     spill_list_entry);
+
+        remove_list_node(&current_list_ptr->spill_list_entry);
+        insert_list_tail(&current_list_ptr->spill_list_entry, 
+                         &spill_list_head);
+    }
+
+    history->number_of_pending_entries = 0;
+
+    pthread_mutex_unlock(&history->list_lock);
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &spill_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     TrajectorySpillNode,
+                                     spill_list_entry);
+
+        fprintf(file, "%s,%s,%lld,%lld,%d,%d\n",
+                current_list_ptr->mac_address,
+                current_list_ptr->entry.uuid,
+                current_list_ptr->entry.enter_timestamp_in_us,
+                current_list_ptr->entry.leave_timestamp_in_us,
+                current_list_ptr->entry.base_x,
+                current_list_ptr->entry.base_y);
+
+        remove_list_node(&current_list_ptr->spill_list_entry);
+
+        mp_free(&trajectory_spill_mempool, current_list_ptr);
+
+        number_of_spilled_entries++;
+    }
+
+    fclose(file);
+
+    zlog_info(category_debug, "Spilled [%d] trajectory entries to %s",
+              number_of_spilled_entries, filename);
+
+    return WORK_SUCCESSFULLY;
+}
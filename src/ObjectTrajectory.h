@@ -0,0 +1,280 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ObjectTrajectory.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in ObjectTrajectory.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef OBJECT_TRAJECTORY_H
+#define OBJECT_TRAJECTORY_H
+
+#include "BeDIS.h"
+
+/* Number of hash buckets used to look up objects in the trajectory history */
+#define NUMBER_OF_TRAJECTORY_BUCKETS 1024
+
+/* Number of LBeacon transitions kept in memory for each object. The oldest 
+transition is overwritten when the ring of an object is full. */
+#define LENGTH_OF_OBJECT_TRAJECTORY 32
+
+/* The file name prefix of the files storing the transitions overwritten in 
+the rings. The date of spilling and ".csv" are appended to the prefix. */
+#define OBJECT_TRAJECTORY_SPILL_FILE_PREFIX "trajectory_"
+
+/* One LBeacon transition of an object. The object stayed under the LBeacon 
+from enter_timestamp_in_us to leave_timestamp_in_us. */
+typedef struct {
+
+    char uuid[LENGTH_OF_UUID];
+
+    /* The time in microseconds since epoch the object was first and last 
+       seen under the LBeacon */
+    long long enter_timestamp_in_us;
+    long long leave_timestamp_in_us;
+
+    /* The latest base location of the object under the LBeacon */
+    int base_x;
+    int base_y;
+
+} TrajectoryEntry;
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The hash buckets of the objects with trajectory */
+    struct List_Entry bucket_list_head[NUMBER_OF_TRAJECTORY_BUCKETS];
+
+    /* The list of transitions overwritten in the rings and waiting to be 
+       written to the archive */
+    struct List_Entry spill_list_head;
+
+    /* The flag indicating whether the overwritten transitions are kept for 
+       spill_object_trajectory */
+    bool is_spill_enabled;
+
+    /* The number of objects with trajectory */
+    int number_of_objects;
+
+    /* The number of transitions in the spill list */
+    int number_of_pending_entries;
+
+    /* The number of overwritten transitions which are neither spilled nor 
+       kept because no free node in trajectory_spill_mempool */
+    int number_of_dropped_entries;
+
+} TrajectoryHistory;
+
+typedef struct {
+
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+
+    /* The ring of transitions. first_entry is the index of the oldest 
+       transition. */
+    TrajectoryEntry entries[LENGTH_OF_OBJECT_TRAJECTORY];
+    int first_entry;
+    int number_of_entries;
+
+    /* The list entry for inserting the node into its hash bucket */
+    List_Entry bucket_list_entry;
+
+} TrajectoryObjectNode;
+
+typedef struct {
+
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+
+    TrajectoryEntry entry;
+
+    /* The list entry for inserting the node into the spill list */
+    List_Entry spill_list_entry;
+
+} TrajectorySpillNode;
+
+/* global variables */
+
+/* The mempool for the trajectory object node structures */
+Memory_Pool trajectory_object_mempool;
+
+/* The mempool for the trajectory spill node structures */
+Memory_Pool trajectory_spill_mempool;
+
+/*
+  init_object_trajectory_history:
+
+     This function initializes the trajectory history of objects.
+
+  Parameters:
+
+     history - The pointer to the trajectory history
+
+     is_spill_enabled - The flag indicating whether the transitions 
+                        overwritten in the rings are kept to be written to 
+                        the archive
+
+  Return value:
+
+     None
+
+ */
+
+void init_object_trajectory_history(TrajectoryHistory *history,
+                                    bool is_spill_enabled);
+
+/*
+  destroy_object_trajectory_history:
+
+     This function releases all object and spill nodes back to the memory 
+     pools. The transitions not yet spilled are discarded.
+
+  Parameters:
+
+     history - The pointer to the trajectory history
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_object_trajectory_history(TrajectoryHistory *history);
+
+/*
+  record_object_trajectory:
+
+     This function records the current LBeacon of an object. The latest 
+     transition of the object is extended if the object is still under the 
+     same LBeacon since the same enter time. Otherwise a new transition is 
+     appended to the ring of the object.
+
+  Parameters:
+
+     history - The pointer to the trajectory history
+
+     mac_address - The MAC address of the object
+
+     uuid - The UUID of the LBeacon the object is located at
+
+     base_x - The base location x of the object
+
+     base_y - The base location y of the object
+
+     enter_timestamp_in_us - The time in microseconds since epoch the 
+                             object was first seen under the LBeacon
+
+     leave_timestamp_in_us - The time in microseconds since epoch the 
+                             object was last seen under the LBeacon
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the MAC address or UUID is invalid.
+                 E_MALLOC: no free node in trajectory_object_mempool.
+
+ */
+
+ErrorCode record_object_trajectory(TrajectoryHistory *history,
+                                   char *mac_address,
+                                   char *uuid,
+                                   int base_x,
+                                   int base_y,
+                                   long long enter_timestamp_in_us,
+                                   long long leave_timestamp_in_us);
+
+/*
+  get_object_trajectory:
+
+     This function copies the transitions of an object which overlap the 
+     time range into entries in chronological order. Only the transitions 
+     still in the ring of the object are returned.
+
+  Parameters:
+
+     history - The pointer to the trajectory history
+
+     mac_address - The MAC address of the object
+
+     start_timestamp_in_us - The beginning of the time range in 
+                             microseconds since epoch
+
+     end_timestamp_in_us - The end of the time range in microseconds since 
+                           epoch
+
+     entries - The output array of transitions
+
+     max_entries - The number of elements of entries
+
+  Return value:
+
+     int - The number of transitions copied into entries
+
+ */
+
+int get_object_trajectory(TrajectoryHistory *history,
+                          char *mac_address,
+                          long long start_timestamp_in_us,
+                          long long end_timestamp_in_us,
+                          TrajectoryEntry *entries,
+                          int max_entries);
+
+/*
+  spill_object_trajectory:
+
+     This function appends the transitions overwritten in the rings to the 
+     spill file of the current date under the archive directory, one 
+     transition per line in the format of 
+     "mac_address,uuid,enter_timestamp_in_us,leave_timestamp_in_us,base_x,
+     base_y".
+
+  Parameters:
+
+     history - The pointer to the trajectory history
+
+     archive_directory - The directory to store the spill files
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the spill file cannot be opened. The 
+                              transitions are kept for the next call.
+
+ */
+
+ErrorCode spill_object_trajectory(TrajectoryHistory *history,
+                                  char *archive_directory);
+
+#endif
@@ -0,0 +1,440 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Occupancy.c
+
+  File Description:
+
+     This file provides APIs to maintain the number of objects in each area,
+     each room and of each object type. The counters are updated
+     incrementally when the location summarization moves an object to
+     another LBeacon.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "Occupancy.h"
+
+static int get_occupancy_bucket(char *mac_address){
+
+    unsigned int hash = 5381;
+    char *current_char = mac_address;
+
+    while(*current_char != '\0'){
+        hash = ((hash << 5) + hash) + (unsigned char) *current_char;
+        current_char++;
+    }
+
+    return hash % NUMBER_OF_OCCUPANCY_BUCKETS;
+}
+
+static int get_area_id_of_uuid(char *uuid){
+
+    char lbeacon_area[LENGTH_OF_UUID];
+
+    memset(lbeacon_area, 0, sizeof(lbeacon_area));
+    strncpy(lbeacon_area, uuid, FIRST_N_CHARACTERS_OF_UUID_FOR_AREA_ID);
+
+    return atoi(lbeacon_area);
+}
+
+/* Adds delta to the counter of the key, creating the counter when absent. 
+   The caller must hold list_lock. */
+static void adjust_occupancy_counter(OccupancyCounters *occupancy_counters,
+                                     OccupancyScope scope,
+                                     int area_id,
+                                     char *room,
+                                     int object_type,
+                                     int delta){
+
+    List_Entry *current_list_entry = NULL;
+    OccupancyCounterNode *current_list_ptr = NULL;
+    OccupancyCounterNode *new_node = NULL;
+    int retry_times = 0;
+
+    list_for_each(current_list_entry, 
+                  &occupancy_counters->counter_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     OccupancyCounterNode,
+                                     counter_list_entry);
+
+        if(current_list_ptr->scope != scope || 
+           current_list_ptr->area_id != area_id){
+            continue;
+        }
+
+        if((OCCUPANCY_SCOPE_AREA == scope) ||
+           (OCCUPANCY_SCOPE_ROOM == scope && 
+            strncmp(current_list_ptr->room, room, LENGTH_OF_ROOM) == 0) ||
+           (OCCUPANCY_SCOPE_OBJECT_TYPE == scope && 
+            current_list_ptr->object_type == object_type)){
+
+            current_list_ptr->number_of_objects += delta;
+            return;
+        }
+    }
+
+    retry_times = MEMORY_ALLOCATE_RETRIES;
+    while(retry_times --){
+        new_node = mp_alloc(&occupancy_counter_mempool);
+        if(NULL != new_node)
+            break;
+    }
+    if(NULL == new_node){
+        zlog_error(category_debug,
+                   "adjust_occupancy_counter (new_node) mp_alloc failed, " \
+                   "abort this data");
+        return;
+    }
+
+    memset(new_node, 0, sizeof(OccupancyCounterNode));
+
+    init_entry(&new_node->counter_list_entry);
+
+    new_node->scope = scope;
+    new_node->area_id = area_id;
+    if(OCCUPANCY_SCOPE_ROOM == scope){
+        strncpy(new_node->room, room, sizeof(new_node->room) - 1);
+    }
+    if(OCCUPANCY_SCOPE_OBJECT_TYPE == scope){
+        new_node->object_type = object_type;
+    }
+    new_node->number_of_objects = delta;
+
+    insert_list_tail(&new_node->counter_list_entry,
+                     &occupancy_counters->counter_list_head);
+}
+
+static void adjust_object_occupancy(OccupancyCounters *occupancy_counters,
+                                    OccupancyObjectNode *object_node,
+                                    int delta){
+
+    adjust_occupancy_counter(occupancy_counters, OCCUPANCY_SCOPE_AREA,
+                             object_node->area_id, NULL, 0, delta);
+
+    adjust_occupancy_counter(occupancy_counters, OCCUPANCY_SCOPE_ROOM,
+                             object_node->area_id, object_node->room, 0, 
+                             delta);
+
+    adjust_occupancy_counter(occupancy_counters, OCCUPANCY_SCOPE_OBJECT_TYPE,
+                             object_node->area_id, NULL, 
+                             object_node->object_type, delta);
+}
+
+void init_occupancy_counters(OccupancyCounters *occupancy_counters){
+
+    int i;
+
+    pthread_mutex_init(&occupancy_counters->list_lock, 0);
+
+    for(i = 0; i < NUMBER_OF_OCCUPANCY_BUCKETS; i++){
+        init_entry(&occupancy_counters->bucket_list_head[i]);
+    }
+
+    init_entry(&occupancy_counters->counter_list_head);
+
+    occupancy_counters->number_of_objects = 0;
+}
+
+void destroy_occupancy_counters(OccupancyCounters *occupancy_counters){
+
+    List_Entry *current_list_entry = NULL;
+    List_Entry *next_list_entry = NULL;
+    OccupancyObjectNode *current_object_ptr = NULL;
+    OccupancyCounterNode *current_counter_ptr = NULL;
+    int i;
+
+    pthread_mutex_lock(&occupancy_counters->list_lock);
+
+    for(i = 0; i < NUMBER_OF_OCCUPANCY_BUCKETS; i++){
+
+        list_for_each_safe(current_list_entry,
+                           next_list_entry,
+                           &occupancy_counters->bucket_list_head[i]){
+
+            current_object_ptr = ListEntry(current_list_entry,
+                                           OccupancyObjectNode,
+                                           bucket_list_entry);
+
+            remove_list_node(&current_object_ptr->bucket_list_entry);
+
+            mp_free(&occupancy_object_mempool, current_object_ptr);
+        }
+    }
+
+    list_for_each_safe(current_list_entry,
+                       next_list_entry,
+                       &occupancy_counters->counter_list_head){
+
+        current_counter_ptr = ListEntry(current_list_entry,
+                                        OccupancyCounterNode,
+                                        counter_list_entry);
+
+        remove_list_node(&current_counter_ptr->counter_list_entry);
+
+        mp_free(&occupancy_counter_mempool, current_counter_ptr);
+    }
+
+    occupancy_counters->number_of_objects = 0;
+
+    pthread_mutex_unlock(&occupancy_counters->list_lock);
+}
+
+ErrorCode update_object_occupancy(OccupancyCounters *occupancy_counters,
+                                  char *mac_address,
+                                  char *uuid,
+                                  char *room,
+                                  int object_type){
+
+    int bucket = 0;
+    List_Entry *current_list_entry = NULL;
+    OccupancyObjectNode *current_list_ptr = NULL;
+    OccupancyObjectNode *object_node = NULL;
+    int retry_times = 0;
+
+    if(mac_address == NULL || strlen(mac_address) == 0 ||
+       strlen(mac_address) >= LENGTH_OF_MAC_ADDRESS ||
+       uuid == NULL || strlen(uuid) == 0 || strlen(uuid) >= LENGTH_OF_UUID){
+        return E_INPUT_PARAMETER;
+    }
+
+    if(room == NULL){
+        room = "";
+    }
+
+    bucket = get_occupancy_bucket(mac_address);
+
+    pthread_mutex_lock(&occupancy_counters->list_lock);
+
+    list_for_each(current_list_entry,
+                  &occupancy_counters->bucket_list_head[bucket]){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     OccupancyObjectNode,
+                                     bucket_list_entry);
+
+        if(strncmp(current_list_ptr->mac_address,
+                   mac_address,
+                   LENGTH_OF_MAC_ADDRESS) == 0){
+
+            object_node = current_list_ptr;
+            break;
+        }
+    }
+
+    if(NULL != object_node){
+
+        /* Nothing changes if the object stays at the same LBeacon */
+        if(strncmp(object_node->uuid, uuid, LENGTH_OF_UUID) == 0 &&
+           strncmp(object_node->room, room, LENGTH_OF_ROOM - 1) == 0 &&
+           object_node->object_type == object_type){
+
+            pthread_mutex_unlock(&occupancy_counters->list_lock);
+            return WORK_SUCCESSFULLY;
+        }
+
+        adjust_object_occupancy(occupancy_counters, object_node, -1);
+
+    }else{
+
+        retry_times = MEMORY_ALLOCATE_RETRIES;
+        while(retry_times --){
+            object_node = mp_alloc(&occupancy_object_mempool);
+            if(NULL != object_node)
+                break;
+        }
+        if(NULL == object_node){
+            pthread_mutex_unlock(&occupancy_counters->list_lock);
+
+            zlog_error(category_debug,
+                       "update_object_occupancy (object_node) mp_alloc " \
+                       "failed, abort this data");
+            return E_MALLOC;
+        }
+
+        memset(object_node, 0, sizeof(OccupancyObjectNode));
+
+        init_entry(&object_node->bucket_list_entry);
+
+        strcpy(object_node->mac_address, mac_address);
+
+        insert_list_tail(&object_node->bucket_list_entry,
+                         &occupancy_counters->bucket_list_head[bucket]);
+
+        occupancy_counters->number_of_objects++;
+    }
+
+    memset(object_node->uuid, 0, sizeof(object_node->uuid));
+    strcpy(object_node->uuid, uuid);
+
+    memset(object_node->room, 0, sizeof(object_node->room));
+    strncpy(object_node->room, room, sizeof(object_node->room) - 1);
+
+    object_node->area_id = get_area_id_of_uuid(uuid);
+    object_node->object_type = object_type;
+
+    adjust_object_occupancy(occupancy_counters, object_node, 1);
+
+    pthread_mutex_unlock(&occupancy_counters->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+int get_occupancy_report(OccupancyCounters *occupancy_counters,
+                         char *buf,
+                         size_t buf_len){
+
+    List_Entry *current_list_entry = NULL;
+    OccupancyCounterNode *current_list_ptr = NULL;
+    char one_counter[LENGTH_OF_ROOM + 64];
+    int number_of_counters = 0;
+    size_t used_len = 0;
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&occupancy_counters->list_lock);
+
+    list_for_each(current_list_entry, &occupancy_counters->counter_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     OccupancyCounterNode,
+                                     counter_list_entry);
+
+        memset(one_counter, 0, sizeof(one_counter));
+
+        switch(current_list_ptr->scope){
+            case OCCUPANCY_SCOPE_AREA:
+                sprintf(one_counter, "area=%d:%d;", 
+                        current_list_ptr->area_id,
+                        current_list_ptr->number_of_objects);
+                break;
+            case OCCUPANCY_SCOPE_ROOM:
+                sprintf(one_counter, "room=%d/%s:%d;", 
+                        current_list_ptr->area_id,
+                        current_list_ptr->room,
+                        current_list_ptr->number_of_objects);
+                break;
+            case OCCUPANCY_SCOPE_OBJECT_TYPE:
+                sprintf(one_counter, "type=%d/%d:%d;", 
+                        current_list_ptr->area_id,
+                        current_list_ptr->object_type,
+                        current_list_ptr->number_of_objects);
+                break;
+        }
+
+        if(used_len + strlen(one_counter) + 1 > buf_len){
+            break;
+        }
+
+        strcpy(buf + used_len, one_counter);
+        used_len += strlen(one_counter);
+        number_of_counters++;
+    }
+
+    pthread_mutex_unlock(&occupancy_counters->list_lock);
+
+    return number_of_counters;
+}
+
+int get_occupancy_rollup_rows(OccupancyCounters *occupancy_counters,
+                              char *rollup_timestamp,
+                              int first_row,
+                              char *buf,
+                              size_t buf_len){
+
+    List_Entry *current_list_entry = NULL;
+    OccupancyCounterNode *current_list_ptr = NULL;
+    char one_row[2 * LENGTH_OF_ROOM + 128];
+    char quoted_room[2 * LENGTH_OF_ROOM + 3];
+    char *current_char = NULL;
+    char *quoted_char = NULL;
+    int current_row = 0;
+    int number_of_rows = 0;
+    size_t used_len = 0;
+
+    if(strlen(rollup_timestamp) >= 64){
+        return 0;
+    }
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&occupancy_counters->list_lock);
+
+    list_for_each(current_list_entry, &occupancy_counters->counter_list_head){
+
+        /* The counters written by the previous calls are skipped */
+        if(current_row < first_row){
+            current_row++;
+            continue;
+        }
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     OccupancyCounterNode,
+                                     counter_list_entry);
+
+        /* Quote the room name as a CSV field by doubling the quotes in it */
+        memset(quoted_room, 0, sizeof(quoted_room));
+        quoted_char = quoted_room;
+        *quoted_char++ = '"';
+        for(current_char = current_list_ptr->room; 
+            *current_char != '\0'; 
+            current_char++){
+
+            if(*current_char == '"'){
+                *quoted_char++ = '"';
+            }
+            *quoted_char++ = *current_char;
+        }
+        *quoted_char = '"';
+
+        memset(one_row, 0, sizeof(one_row));
+        sprintf(one_row, "%s,%d,%d,%s,%d,%d\n", 
+                rollup_timestamp,
+                current_list_ptr->scope,
+                current_list_ptr->area_id,
+                quoted_room,
+                current_list_ptr->object_type,
+                current_list_ptr->number_of_objects);
+
+        if(used_len + strlen(one_row) + 1 > buf_len){
+            break;
+        }
+
+        strcpy(buf + used_len, one_row);
+        used_len += strlen(one_row);
+        number_of_rows++;
+    }
+
+    pthread_mutex_unlock(&occupancy_counters->list_lock);
+
+    return number_of_rows;
+}
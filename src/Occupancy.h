@@ -0,0 +1,251 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     Occupancy.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in Occupancy.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "BeDIS.h"
+
+/* Number of hash buckets used to look up objects in the occupancy counters */
+#define NUMBER_OF_OCCUPANCY_BUCKETS 1024
+
+/* Length of room name in byte */
+#define LENGTH_OF_ROOM 64
+
+/* Number of leading characters of LBeacon UUID which denote the area id */
+#define FIRST_N_CHARACTERS_OF_UUID_FOR_AREA_ID 4
+
+/* The kinds of occupancy counters */
+typedef enum _OccupancyScope{
+    OCCUPANCY_SCOPE_AREA = 0,
+    OCCUPANCY_SCOPE_ROOM = 1,
+    OCCUPANCY_SCOPE_OBJECT_TYPE = 2,
+} OccupancyScope;
+
+typedef struct {
+
+    pthread_mutex_t list_lock;
+
+    /* The hash buckets of the objects whose location is known */
+    struct List_Entry bucket_list_head[NUMBER_OF_OCCUPANCY_BUCKETS];
+
+    /* The list of counters of all scopes */
+    struct List_Entry counter_list_head;
+
+    /* The number of objects whose location is known */
+    int number_of_objects;
+
+} OccupancyCounters;
+
+typedef struct {
+
+    char mac_address[LENGTH_OF_MAC_ADDRESS];
+
+    /* The current location of the object */
+    char uuid[LENGTH_OF_UUID];
+    int area_id;
+    char room[LENGTH_OF_ROOM];
+
+    int object_type;
+
+    /* The list entry for inserting the node into its hash bucket */
+    List_Entry bucket_list_entry;
+
+} OccupancyObjectNode;
+
+typedef struct {
+
+    OccupancyScope scope;
+
+    /* The area the counter belongs to. Counters of rooms and object types 
+       are kept per area as well. */
+    int area_id;
+
+    /* The room of an OCCUPANCY_SCOPE_ROOM counter */
+    char room[LENGTH_OF_ROOM];
+
+    /* The object type of an OCCUPANCY_SCOPE_OBJECT_TYPE counter */
+    int object_type;
+
+    int number_of_objects;
+
+    /* The list entry for inserting the node into the list of counters */
+    List_Entry counter_list_entry;
+
+} OccupancyCounterNode;
+
+/* global variables */
+
+/* The mempool for the occupancy object node structures */
+Memory_Pool occupancy_object_mempool;
+
+/* The mempool for the occupancy counter node structures */
+Memory_Pool occupancy_counter_mempool;
+
+/*
+  init_occupancy_counters:
+
+     This function initializes the occupancy counters with no objects.
+
+  Parameters:
+
+     occupancy_counters - The pointer to the occupancy counters
+
+  Return value:
+
+     None
+
+ */
+
+void init_occupancy_counters(OccupancyCounters *occupancy_counters);
+
+/*
+  destroy_occupancy_counters:
+
+     This function releases all objects and counters back to the memory 
+     pools.
+
+  Parameters:
+
+     occupancy_counters - The pointer to the occupancy counters
+
+  Return value:
+
+     None
+
+ */
+
+void destroy_occupancy_counters(OccupancyCounters *occupancy_counters);
+
+/*
+  update_object_occupancy:
+
+     This function records the current LBeacon of an object. If the object 
+     moved to another LBeacon, the counters of its previous area, room and 
+     object type are decremented and those of the new ones are incremented.
+
+  Parameters:
+
+     occupancy_counters - The pointer to the occupancy counters
+
+     mac_address - The MAC address of the object
+
+     uuid - The UUID of the LBeacon the object is located at
+
+     room - The room of the LBeacon
+
+     object_type - The object type of the object
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the MAC address or UUID is invalid.
+                 E_MALLOC: no free node in the memory pools.
+
+ */
+
+ErrorCode update_object_occupancy(OccupancyCounters *occupancy_counters,
+                                  char *mac_address,
+                                  char *uuid,
+                                  char *room,
+                                  int object_type);
+
+/*
+  get_occupancy_report:
+
+     This function writes the counters into buf in the form of 
+     "area=<area_id>:<count>;", "room=<area_id>/<room>:<count>;" and 
+     "type=<area_id>/<object_type>:<count>;". Counters which do not fit in 
+     buf are left out.
+
+  Parameters:
+
+     occupancy_counters - The pointer to the occupancy counters
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     int - The number of counters written into buf
+
+ */
+
+int get_occupancy_report(OccupancyCounters *occupancy_counters,
+                         char *buf,
+                         size_t buf_len);
+
+/*
+  get_occupancy_rollup_rows:
+
+     This function writes the counters into buf as CSV rows of 
+     rollup_timestamp, scope, area_id, room, object_type and 
+     number_of_objects, which can be copied into the rollup table directly. 
+     Counters which do not fit in buf are left for the next call, which 
+     starts from the first of them. Counters are only appended to the list, 
+     so calls with increasing first_row never skip a counter.
+
+  Parameters:
+
+     occupancy_counters - The pointer to the occupancy counters
+
+     rollup_timestamp - The time of the snapshot written into each row
+
+     first_row - The number of counters written by the previous calls
+
+     buf - The output buffer of the rows
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     int - The number of rows written into buf
+
+ */
+
+int get_occupancy_rollup_rows(OccupancyCounters *occupancy_counters,
+                              char *rollup_timestamp,
+                              int first_row,
+                              char *buf,
+                              size_t buf_len);
+
+#endif
@@ -0,0 +1,179 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ProtocolSchema.c
+
+  File Description:
+
+     This file provides the codecs of the messages between the server and the
+     gateways, generated from the lists of fields in ProtocolSchema.h.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+
+#include "ProtocolSchema.h"
+
+/* The field taken beyond the end of a message */
+static char protocol_empty_field[] = "";
+
+/* The layouts of the tracked objects in the order of their first API 
+   versions. A new layout is added by its list of fields, an entry in 
+   PROTOCOL_MESSAGES and an entry here. */
+static const ProtocolVersionSchema protocol_version_schemas[] = {
+    {PROTOCOL_API_VERSION_21,
+     NUMBER_OF_TRACKED_OBJECT_FIELDS_V21,
+     decode_tracked_object_v21,
+     encode_tracked_object_v21}
+};
+
+#define NUMBER_OF_PROTOCOL_VERSION_SCHEMAS \
+    ((int)(sizeof(protocol_version_schemas) / \
+           sizeof(protocol_version_schemas[0])))
+
+PROTOCOL_MESSAGES(PROTOCOL_DEFINE_CODECS)
+
+void open_protocol_cursor(ProtocolCursor *cursor, char *buf){
+
+    cursor->begin = buf;
+    cursor->next = buf;
+    cursor->end = buf + strlen(buf);
+    cursor->is_out_of_bounds = false;
+}
+
+void open_protocol_writer(ProtocolCursor *cursor, char *buf, size_t buf_len){
+
+    cursor->begin = buf;
+    cursor->next = buf;
+    cursor->end = buf + buf_len - 1;
+    cursor->is_out_of_bounds = false;
+
+    *buf = '\0';
+}
+
+char *take_protocol_field(ProtocolCursor *cursor){
+
+    char *field = cursor->next;
+    char *delimiter = NULL;
+
+    if(cursor->next >= cursor->end){
+        cursor->is_out_of_bounds = true;
+        return protocol_empty_field;
+    }
+
+    delimiter = memchr(field, DELIMITER_SEMICOLON[0], cursor->end - field);
+
+    /* The last field may come without the delimiter */
+    if(NULL == delimiter){
+        cursor->next = cursor->end;
+        return field;
+    }
+
+    *delimiter = '\0';
+    cursor->next = delimiter + 1;
+
+    return field;
+}
+
+void put_protocol_field(ProtocolCursor *cursor, char *field){
+
+    size_t field_len = strlen(field);
+
+    /* Keep room for the delimiter */
+    if(true == cursor->is_out_of_bounds ||
+       NULL != strchr(field, DELIMITER_SEMICOLON[0]) ||
+       field_len + 1 > (size_t)(cursor->end - cursor->next)){
+
+        cursor->is_out_of_bounds = true;
+        return;
+    }
+
+    memcpy(cursor->next, field, field_len);
+    cursor->next += field_len;
+
+    *cursor->next = DELIMITER_SEMICOLON[0];
+    cursor->next++;
+    *cursor->next = '\0';
+}
+
+ErrorCode decode_protocol_count(ProtocolCursor *cursor, 
+                                char *field, 
+                                int fields_per_item, 
+                                int *count){
+
+    char *current_char = field;
+    long number = 0;
+    long remaining_len = cursor->end - cursor->next;
+
+    *count = 0;
+
+    if(true == cursor->is_out_of_bounds || '\0' == *field ||
+       fields_per_item <= 0){
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    /* The conversion stops as soon as the items cannot fit, so the number 
+       never overflows */
+    while('\0' != *current_char){
+
+        if(*current_char < '0' || *current_char > '9'){
+            return E_API_PROTOCOL_FORMAT;
+        }
+
+        number = number * 10 + (*current_char - '0');
+
+        if(number * fields_per_item > remaining_len){
+            return E_API_PROTOCOL_FORMAT;
+        }
+
+        current_char++;
+    }
+
+    *count = (int)number;
+
+    return WORK_SUCCESSFULLY;
+}
+
+const ProtocolVersionSchema *get_protocol_version_schema(float API_version){
+
+    const ProtocolVersionSchema *schema = NULL;
+    int i;
+
+    for(i = 0; i < NUMBER_OF_PROTOCOL_VERSION_SCHEMAS; i++){
+
+        if((float)atof(protocol_version_schemas[i].first_API_version) <= 
+           API_version){
+            schema = &protocol_version_schemas[i];
+        }
+    }
+
+    return schema;
+}
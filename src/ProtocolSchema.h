@@ -0,0 +1,417 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ProtocolSchema.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in ProtocolSchema.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef PROTOCOL_SCHEMA_H
+#define PROTOCOL_SCHEMA_H
+
+#include "BeDIS.h"
+
+/* The first API version of each layout of the tracked objects */
+#define PROTOCOL_API_VERSION_21 "2.1"
+
+/* The lists of fields of the messages. Each list names the fields of a 
+message in the order they are sent, and X is applied to every field. The 
+structures and the codecs of the messages are generated from these lists, so 
+changing a message only changes its list. */
+
+/* "pkt_direction;pkt_type;API_version;" in front of every packet */
+#define PACKET_HEADER_FIELDS(X) \
+    X(pkt_direction) \
+    X(pkt_type) \
+    X(API_version)
+
+/* The join request is followed by number_of_lbeacons items of 
+LBEACON_REGISTRATION_ITEM_FIELDS */
+#define LBEACON_REGISTRATION_HEADER_FIELDS(X) \
+    X(number_of_lbeacons) \
+    X(gateway_ip)
+
+#define LBEACON_REGISTRATION_ITEM_FIELDS(X) \
+    X(uuid) \
+    X(registered_timestamp) \
+    X(lbeacon_ip)
+
+/* The gateway registration record is followed by number_of_gateways items 
+of GATEWAY_REGISTRATION_ITEM_FIELDS */
+#define GATEWAY_REGISTRATION_HEADER_FIELDS(X) \
+    X(number_of_gateways)
+
+#define GATEWAY_REGISTRATION_ITEM_FIELDS(X) \
+    X(ip_address)
+
+#define GATEWAY_HEALTH_REPORT_FIELDS(X) \
+    X(gateway_ip) \
+    X(health_status)
+
+#define LBEACON_HEALTH_REPORT_FIELDS(X) \
+    X(lbeacon_uuid) \
+    X(lbeacon_timestamp) \
+    X(lbeacon_ip) \
+    X(health_status)
+
+/* The tracking data is followed by one group of objects for each object 
+type. Each group is followed by number_of_objects tracked objects laid out 
+as the API version of the packet specifies. */
+#define TRACKING_DATA_HEADER_FIELDS(X) \
+    X(lbeacon_uuid) \
+    X(lbeacon_timestamp) \
+    X(lbeacon_ip)
+
+#define OBJECT_GROUP_FIELDS(X) \
+    X(object_type) \
+    X(number_of_objects)
+
+/* The tracked object since API version 2.1, which added the battery 
+voltage */
+#define TRACKED_OBJECT_FIELDS_V21(X) \
+    X(mac_address) \
+    X(initial_timestamp) \
+    X(final_timestamp) \
+    X(rssi) \
+    X(panic_button) \
+    X(battery_voltage)
+
+/* The structure of tracked objects holds the fields of the newest layout. A 
+layout of an older version only fills in the fields it names. */
+#define TRACKED_OBJECT_FIELDS(X) TRACKED_OBJECT_FIELDS_V21(X)
+
+/* The helpers applied to the lists of fields */
+#define PROTOCOL_DECLARE_FIELD(name) char *name;
+
+#define PROTOCOL_COUNT_FIELD(name) + 1
+
+#define NUMBER_OF_LBEACON_REGISTRATION_ITEM_FIELDS \
+    (0 LBEACON_REGISTRATION_ITEM_FIELDS(PROTOCOL_COUNT_FIELD))
+
+#define NUMBER_OF_GATEWAY_REGISTRATION_ITEM_FIELDS \
+    (0 GATEWAY_REGISTRATION_ITEM_FIELDS(PROTOCOL_COUNT_FIELD))
+
+#define NUMBER_OF_TRACKED_OBJECT_FIELDS_V21 \
+    (0 TRACKED_OBJECT_FIELDS_V21(PROTOCOL_COUNT_FIELD))
+
+#define PROTOCOL_DECODE_FIELD(name) \
+    fields->name = take_protocol_field(cursor);
+
+#define PROTOCOL_ENCODE_FIELD(name) \
+    put_protocol_field(cursor, fields->name);
+
+/* The messages with their codecs: M(name, structure, list of fields) */
+#define PROTOCOL_MESSAGES(M) \
+    M(packet_header, PacketHeaderFields, PACKET_HEADER_FIELDS) \
+    M(lbeacon_registration_header, \
+      LBeaconRegistrationHeaderFields, \
+      LBEACON_REGISTRATION_HEADER_FIELDS) \
+    M(lbeacon_registration_item, \
+      LBeaconRegistrationItemFields, \
+      LBEACON_REGISTRATION_ITEM_FIELDS) \
+    M(gateway_registration_header, \
+      GatewayRegistrationHeaderFields, \
+      GATEWAY_REGISTRATION_HEADER_FIELDS) \
+    M(gateway_registration_item, \
+      GatewayRegistrationItemFields, \
+      GATEWAY_REGISTRATION_ITEM_FIELDS) \
+    M(gateway_health_report, \
+      GatewayHealthReportFields, \
+      GATEWAY_HEALTH_REPORT_FIELDS) \
+    M(lbeacon_health_report, \
+      LBeaconHealthReportFields, \
+      LBEACON_HEALTH_REPORT_FIELDS) \
+    M(tracking_data_header, \
+      TrackingDataHeaderFields, \
+      TRACKING_DATA_HEADER_FIELDS) \
+    M(object_group, ObjectGroupFields, OBJECT_GROUP_FIELDS) \
+    M(tracked_object_v21, TrackedObjectFields, TRACKED_OBJECT_FIELDS_V21)
+
+/* The decoder takes the fields one after another without checking each of 
+them, and checks the cursor once after the last field */
+#define PROTOCOL_DECLARE_CODECS(name, structure, FIELDS) \
+    ErrorCode decode_##name(ProtocolCursor *cursor, structure *fields); \
+    ErrorCode encode_##name(ProtocolCursor *cursor, structure *fields);
+
+#define PROTOCOL_DEFINE_CODECS(name, structure, FIELDS) \
+    ErrorCode decode_##name(ProtocolCursor *cursor, structure *fields){ \
+        FIELDS(PROTOCOL_DECODE_FIELD) \
+        return (true == cursor->is_out_of_bounds) ? \
+               E_API_PROTOCOL_FORMAT : WORK_SUCCESSFULLY; \
+    } \
+    ErrorCode encode_##name(ProtocolCursor *cursor, structure *fields){ \
+        FIELDS(PROTOCOL_ENCODE_FIELD) \
+        return (true == cursor->is_out_of_bounds) ? \
+               E_INPUT_PARAMETER : WORK_SUCCESSFULLY; \
+    }
+
+typedef struct {
+
+    /* The beginning of the buffer */
+    char *begin;
+
+    /* The next field to be taken or put */
+    char *next;
+
+    /* The end of the message being decoded, or the last byte of the buffer 
+       being encoded, which is kept for the terminating character */
+    char *end;
+
+    /* Whether a field was taken beyond the end of the message or did not 
+       fit in the buffer. The flag stays set for the rest of the message. */
+    bool is_out_of_bounds;
+
+} ProtocolCursor;
+
+typedef struct {
+    PACKET_HEADER_FIELDS(PROTOCOL_DECLARE_FIELD)
+} PacketHeaderFields;
+
+typedef struct {
+    LBEACON_REGISTRATION_HEADER_FIELDS(PROTOCOL_DECLARE_FIELD)
+} LBeaconRegistrationHeaderFields;
+
+typedef struct {
+    LBEACON_REGISTRATION_ITEM_FIELDS(PROTOCOL_DECLARE_FIELD)
+} LBeaconRegistrationItemFields;
+
+typedef struct {
+    GATEWAY_REGISTRATION_HEADER_FIELDS(PROTOCOL_DECLARE_FIELD)
+} GatewayRegistrationHeaderFields;
+
+typedef struct {
+    GATEWAY_REGISTRATION_ITEM_FIELDS(PROTOCOL_DECLARE_FIELD)
+} GatewayRegistrationItemFields;
+
+typedef struct {
+    GATEWAY_HEALTH_REPORT_FIELDS(PROTOCOL_DECLARE_FIELD)
+} GatewayHealthReportFields;
+
+typedef struct {
+    LBEACON_HEALTH_REPORT_FIELDS(PROTOCOL_DECLARE_FIELD)
+} LBeaconHealthReportFields;
+
+typedef struct {
+    TRACKING_DATA_HEADER_FIELDS(PROTOCOL_DECLARE_FIELD)
+} TrackingDataHeaderFields;
+
+typedef struct {
+    OBJECT_GROUP_FIELDS(PROTOCOL_DECLARE_FIELD)
+} ObjectGroupFields;
+
+typedef struct {
+    TRACKED_OBJECT_FIELDS(PROTOCOL_DECLARE_FIELD)
+} TrackedObjectFields;
+
+/* The codec of the tracked objects in one layout */
+typedef ErrorCode (*TrackedObjectCodec)(ProtocolCursor *cursor, 
+                                        TrackedObjectFields *fields);
+
+typedef struct {
+
+    /* The first API version sending tracked objects in this layout */
+    char *first_API_version;
+
+    /* Number of fields of a tracked object in this layout */
+    int number_of_tracked_object_fields;
+
+    TrackedObjectCodec decode_tracked_object;
+
+    TrackedObjectCodec encode_tracked_object;
+
+} ProtocolVersionSchema;
+
+/*
+  decode_<message> and encode_<message>:
+
+     The functions generated by PROTOCOL_DEFINE_CODECS for every message in 
+     PROTOCOL_MESSAGES. The decoder points the fields into the message being
+     decoded, and the encoder appends the fields to the message being 
+     encoded.
+
+  Parameters:
+
+     cursor - The pointer to the cursor in the message
+
+     fields - The pointer to the fields of the message
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_API_PROTOCOL_FORMAT: the message being decoded ends 
+                 before the last field.
+                 E_INPUT_PARAMETER: the fields do not fit in the buffer or 
+                 contain the delimiter.
+
+ */
+
+PROTOCOL_MESSAGES(PROTOCOL_DECLARE_CODECS)
+
+/*
+  open_protocol_cursor:
+
+     This function prepares a cursor to decode the message in buf. The 
+     decoders replace the delimiters in buf with terminating characters, so 
+     the fields point into buf without copying.
+
+  Parameters:
+
+     cursor - The pointer to the cursor
+
+     buf - The message terminated by a terminating character
+
+  Return value:
+
+     None
+
+ */
+
+void open_protocol_cursor(ProtocolCursor *cursor, char *buf);
+
+/*
+  open_protocol_writer:
+
+     This function prepares a cursor to encode a message into buf.
+
+  Parameters:
+
+     cursor - The pointer to the cursor
+
+     buf - The output buffer of the message
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void open_protocol_writer(ProtocolCursor *cursor, char *buf, size_t buf_len);
+
+/*
+  take_protocol_field:
+
+     This function takes the next field of the message. Beyond the end of 
+     the message, it returns an empty field and marks the cursor out of 
+     bounds instead of returning NULL, so the decoders need not check every 
+     field.
+
+  Parameters:
+
+     cursor - The pointer to the cursor
+
+  Return value:
+
+     char * - The field terminated by a terminating character
+
+ */
+
+char *take_protocol_field(ProtocolCursor *cursor);
+
+/*
+  put_protocol_field:
+
+     This function appends a field and the delimiter to the message. A field 
+     which does not fit in the buffer or contains the delimiter is not 
+     appended, and the cursor is marked out of bounds.
+
+  Parameters:
+
+     cursor - The pointer to the cursor
+
+     field - The field to be appended
+
+  Return value:
+
+     None
+
+ */
+
+void put_protocol_field(ProtocolCursor *cursor, char *field);
+
+/*
+  decode_protocol_count:
+
+     This function converts the number of items of a repeated part of the 
+     message. Each field takes at least one byte, so a number larger than 
+     the rest of the message can hold is rejected before any item is 
+     decoded.
+
+  Parameters:
+
+     cursor - The pointer to the cursor after the field of the number
+
+     field - The field of the number
+
+     fields_per_item - Number of fields in each item
+
+     count - The output number of items
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_API_PROTOCOL_FORMAT: the field is not a number, or the 
+                 rest of the message cannot hold the items.
+
+ */
+
+ErrorCode decode_protocol_count(ProtocolCursor *cursor, 
+                                char *field, 
+                                int fields_per_item, 
+                                int *count);
+
+/*
+  get_protocol_version_schema:
+
+     This function finds the layout of the messages in an API version. It is 
+     the layout with the latest first API version not later than the API 
+     version.
+
+  Parameters:
+
+     API_version - The API version of the packet
+
+  Return value:
+
+     ProtocolVersionSchema * - The layout, or NULL if the API version is 
+                               earlier than every layout
+
+ */
+
+const ProtocolVersionSchema *get_protocol_version_schema(float API_version);
+
+#endif
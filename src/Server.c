@@ -54,6 +54,28 @@ int main(int argc, char **argv)
     /* The command message to be sent */
     char command_msg[WIFI_MESSAGE_LENGTH];
 
+    /* The time the flow control level was last updated */
+    int last_flow_control_update_time;
+
+    /* The current flow control level of gateways */
+    FlowControlLevel flow_control_level;
+
+    /* The interval in seconds between two consecutive polls of tracked 
+       object data at the current flow control level */
+    int polling_interval_in_sec;
+
+    /* The workers taking received packets in the order of their deadlines */
+    pthread_t deadline_worker_threads[MAX_NUMBER_OF_DEADLINE_WORKERS];
+    int number_of_deadline_workers = 0;
+
+    /* The routines processing join requests and health reports */
+    DeadlineRoutine NSI_routine = Server_NSI_routine;
+    DeadlineRoutine BHM_routine = Server_BHM_routine;
+
+    /* The instance name of this process in the name of its control channel */
+    char *control_channel_instance = CONTROL_CHANNEL_INSTANCE_ALL;
+    int i;
+
     int uptime;
 
     /* The main thread of the communication Unit */
@@ -80,6 +102,54 @@ int main(int argc, char **argv)
     /* The thread to listen for messages from Wi-Fi interface */
     pthread_t wifi_listener_thread;
 
+    /* The thread to listen for time-critical messages on the dedicated 
+       port */
+    pthread_t time_critical_listener_thread;
+
+    /* The thread to process geo-fence packets with the time-critical 
+       worker role */
+    pthread_t time_critical_worker_thread;
+
+    /* The thread to refresh the clock cache */
+    pthread_t clock_cache_thread;
+
+    /* The thread to serve requests from the local control channel */
+    pthread_t control_channel_thread;
+
+    /* The UDP port the UDP API is bound to */
+    int udp_recv_port;
+
+    /* The flag indicating whether gateway packets are received with 
+       io_uring */
+    bool is_io_uring_receiving;
+
+    /* The flag indicating whether the dedicated time-critical port is 
+       received on */
+    bool is_time_critical_receiving;
+
+    /* The flag indicating whether the shared ring is opened */
+    bool is_shared_ring_opened;
+
+    /* The flag indicating whether recv_port is received by 
+       recv_port_receiver */
+    bool is_recv_port_receiving;
+
+    /* The sockets taken over from the previous server process */
+    int handoff_socket_fds[SOCKET_HANDOFF_MAX_SOCKETS];
+    int handoff_ports[SOCKET_HANDOFF_MAX_SOCKETS];
+
+    /* The thread to hand off the sockets to the next server process */
+    pthread_t socket_handoff_thread;
+
+    /* The flag indicating whether the handoff socket is listened on */
+    bool is_socket_handoff_listening;
+
+    /* The thread to sample the server during a soak run */
+    pthread_t soak_monitor_thread;
+
+    /* The thread to replay the simulation script as the soak load */
+    pthread_t soak_load_thread;
+
     /* Initialize flags */
     NSI_initialization_complete      = false;
     CommUnit_initialization_complete = false;
@@ -153,6 +223,77 @@ int main(int argc, char **argv)
         return E_MALLOC;
     }
 
+    /* Initialize the memory pool for objects waiting for location 
+       summarization */
+    if(MEMORY_POOL_SUCCESS != mp_init( &dirty_object_mempool, 
+                                       sizeof(DirtyObjectNode), 
+                                       SLOTS_IN_MEM_POOL_DIRTY_OBJECT))
+    {
+        return E_MALLOC;
+    }
+
+    /* Initialize the memory pool for clock offsets of LBeacons */
+    if(MEMORY_POOL_SUCCESS != mp_init( &clock_offset_mempool, 
+                                       sizeof(ClockOffsetNode), 
+                                       SLOTS_IN_MEM_POOL_CLOCK_OFFSET))
+    {
+        return E_MALLOC;
+    }
+
+    /* Initialize the memory pools for occupancy counters */
+    if(MEMORY_POOL_SUCCESS != mp_init( &occupancy_object_mempool, 
+                                       sizeof(OccupancyObjectNode), 
+                                       SLOTS_IN_MEM_POOL_OCCUPANCY_OBJECT))
+    {
+        return E_MALLOC;
+    }
+
+    if(MEMORY_POOL_SUCCESS != mp_init( &occupancy_counter_mempool, 
+                                       sizeof(OccupancyCounterNode), 
+                                       SLOTS_IN_MEM_POOL_OCCUPANCY_COUNTER))
+    {
+        return E_MALLOC;
+    }
+
+    /* Initialize the memory pools for the trajectory of objects */
+    if(MEMORY_POOL_SUCCESS != mp_init( &trajectory_object_mempool, 
+                                       sizeof(TrajectoryObjectNode), 
+                                       SLOTS_IN_MEM_POOL_TRAJECTORY_OBJECT))
+    {
+        return E_MALLOC;
+    }
+
+    if(MEMORY_POOL_SUCCESS != mp_init( &trajectory_spill_mempool, 
+                                       sizeof(TrajectorySpillNode), 
+                                       SLOTS_IN_MEM_POOL_TRAJECTORY_SPILL))
+    {
+        return E_MALLOC;
+    }
+
+    /* Initialize the memory pool for the mirror of object_table */
+    if(MEMORY_POOL_SUCCESS != mp_init( &object_mirror_mempool, 
+                                       sizeof(ObjectMirrorNode), 
+                                       SLOTS_IN_MEM_POOL_OBJECT_MIRROR))
+    {
+        return E_MALLOC;
+    }
+
+    /* Initialize the memory pool for reports reassembled from fragments */
+    if(MEMORY_POOL_SUCCESS != mp_init( &fragment_reassembly_mempool, 
+                                       sizeof(ReassemblyNode), 
+                                       SLOTS_IN_MEM_POOL_FRAGMENT_REASSEMBLY))
+    {
+        return E_MALLOC;
+    }
+
+    /* Initialize the memory pool for SQL coroutines */
+    if(MEMORY_POOL_SUCCESS != mp_init( &sql_coroutine_mempool, 
+                                       sizeof(SqlCoroutine), 
+                                       SLOTS_IN_MEM_POOL_SQL_COROUTINE))
+    {
+        return E_MALLOC;
+    }
+
     zlog_info(category_debug,"Mempool Initialized");
 
     /* Create the config from input serverconfig file */
@@ -166,11 +307,91 @@ int main(int argc, char **argv)
         return E_OPEN_FILE;
     }
 
+    /* Parse the CPU set of each thread role and report the topology */
+    init_thread_role_profiles( &config.thread_role_profiles);
+
     zlog_info(category_debug,"Initialize buffer lists");
 
     /* Initialize the address map*/
     init_Address_Map( &Gateway_address_map);
 
+    /* Initialize the set of objects waiting for location summarization */
+    init_dirty_object_set( &config.dirty_object_set_head);
+
+    /* Initialize the list of clock offsets of LBeacons */
+    init_clock_offset_list( &config.clock_offset_list_head);
+
+    /* Initialize the occupancy counters */
+    init_occupancy_counters( &config.occupancy_counters);
+
+    /* Initialize the trajectory history. The overwritten transitions are 
+       only kept when they can be spilled to the archive. */
+    init_object_trajectory_history( &config.trajectory_history,
+                                    config.is_enabled_tracking_archive);
+
+    /* Initialize the mirror of object_table */
+    init_object_mirror( &object_mirror);
+
+    /* Initialize the reports being reassembled from fragments */
+    init_fragment_reassembly( &config.fragment_reassembly_head,
+                              config.fragment_reassembly_timeout_in_sec);
+
+    /* Initialize the event-time watermarks of gateways */
+    init_event_watermark( &config.event_watermark,
+                          config.event_watermark_allowed_lateness_in_sec);
+
+    /* A soak run reports stage latencies, so it measures the stages */
+    init_stage_profiler( &stage_profiler, 
+                         config.is_enabled_stage_profiler ||
+                         config.is_enabled_soak_monitor);
+
+    /* Initialize the deadline scheduler with the latency budget and the 
+       routine of each class of received packets */
+    init_deadline_scheduler( &config.deadline_scheduler);
+
+    /* Join requests and health reports mostly wait for the database, so 
+       they run as coroutines when enabled. A simulation stores each packet
+       before the simulated clock moves on, so it keeps them blocking. */
+    if(config.is_enabled_simulation){
+        config.is_enabled_sql_coroutines = 0;
+    }
+
+    if(config.is_enabled_sql_coroutines){
+        NSI_routine = Server_submit_NSI_coroutine;
+        BHM_routine = Server_submit_BHM_coroutine;
+    }
+
+    set_deadline_class( &config.deadline_scheduler,
+                        DEADLINE_CLASS_TIME_CRITICAL,
+                        config.edf_budget_in_sec[DEADLINE_CLASS_TIME_CRITICAL],
+                        process_tracked_data_from_geofence_gateway);
+    set_deadline_class( &config.deadline_scheduler,
+                        DEADLINE_CLASS_JOIN_REQUEST,
+                        config.edf_budget_in_sec[DEADLINE_CLASS_JOIN_REQUEST],
+                        NSI_routine);
+    set_deadline_class( &config.deadline_scheduler,
+                        DEADLINE_CLASS_IPC_COMMAND,
+                        config.edf_budget_in_sec[DEADLINE_CLASS_IPC_COMMAND],
+                        process_commands);
+    set_deadline_class( &config.deadline_scheduler,
+                        DEADLINE_CLASS_TRACKED_OBJECT_DATA,
+                        config.edf_budget_in_sec[
+                            DEADLINE_CLASS_TRACKED_OBJECT_DATA],
+                        Server_LBeacon_routine);
+    set_deadline_class( &config.deadline_scheduler,
+                        DEADLINE_CLASS_HEALTH_REPORT,
+                        config.edf_budget_in_sec[DEADLINE_CLASS_HEALTH_REPORT],
+                        BHM_routine);
+
+    /* Initialize the flow control state. The receive queues hold buffer 
+       nodes from node_mempool. */
+    init_flow_control( &config.flow_control,
+                       SLOTS_IN_MEM_POOL_BUFFER_NODE,
+                       config.flow_control_high_watermark_in_percent,
+                       config.flow_control_low_watermark_in_percent,
+                       config.flow_control_critical_watermark_in_percent,
+                       config.period_between_RFTOD);
+
     /* Initialize buffer_list_heads and add to the head in to the priority 
        list.
      */
@@ -183,11 +404,11 @@ int main(int argc, char **argv)
     insert_list_tail( &command_buffer_list_head.priority_list_entry,
                       &priority_list_head.priority_list_entry);
 
+    /* The time-critical worker drains this buffer list, so it is added to 
+       the priority list only if that thread fails to start */
     init_buffer( &Geo_fence_receive_buffer_list_head,
                 (void *) process_tracked_data_from_geofence_gateway, 
                 common_config.time_critical_priority);
-    insert_list_tail( &Geo_fence_receive_buffer_list_head.priority_list_entry,
-                      &priority_list_head.priority_list_entry);
 
     init_buffer( &data_receive_buffer_list_head,
                 (void *) Server_LBeacon_routine, 
@@ -202,13 +423,13 @@ int main(int argc, char **argv)
                       &priority_list_head.priority_list_entry);
 
     init_buffer( &NSI_receive_buffer_list_head,
-                (void *) Server_NSI_routine, 
+                (void *) NSI_routine, 
                 common_config.high_priority);
     insert_list_tail( &NSI_receive_buffer_list_head.priority_list_entry,
                       &priority_list_head.priority_list_entry);
 
     init_buffer( &BHM_receive_buffer_list_head,
-                (void *) Server_BHM_routine, 
+                (void *) BHM_routine, 
                 common_config.low_priority);
     insert_list_tail( &BHM_receive_buffer_list_head.priority_list_entry,
                       &priority_list_head.priority_list_entry);
@@ -250,7 +471,8 @@ int main(int argc, char **argv)
     if(WORK_SUCCESSFULLY != 
        SQL_create_database_connection_pool(database_argument, 
                                            &config.db_connection_list_head, 
-                                           config.number_of_database_connection)){ 
+                                           config.number_of_database_connection,
+                                           config.number_of_dedicated_database_connection)){ 
        
             SQL_destroy_database_connection_pool(
                 &config.db_connection_list_head);
@@ -260,8 +482,218 @@ int main(int argc, char **argv)
             return E_SQL_OPEN_DATABASE;
     }
 
+    /* The executors of SQL coroutines open their own connections */
+    if(config.is_enabled_sql_coroutines &&
+       WORK_SUCCESSFULLY != 
+       init_sql_coroutine_scheduler( 
+           &sql_coroutine_scheduler,
+           database_argument,
+           config.number_of_sql_coroutine_executors,
+           config.sql_coroutine_connections_per_executor)){
+
+        zlog_error(category_debug, 
+                   "Failed to initialize SQL coroutine scheduler");
+        return E_INITIALIZATION_FAIL;
+    }
+
+    /* Continue the generation number of location summarization from the 
+       last run */
+    pthread_mutex_init( &location_summary_lock, 0);
+
+    location_summary_generation = 0;
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_location_summary_generation(&config.db_connection_list_head,
+                                           &location_summary_generation)){
+        zlog_error(category_debug,
+                   "SQL_get_location_summary_generation failed");
+    }
+
+    /* Count the objects at their last known location. The counters are 
+       updated incrementally by the location summarization afterwards. */
+    if(WORK_SUCCESSFULLY != 
+       SQL_load_object_occupancy(&config.db_connection_list_head,
+                                 &config.occupancy_counters)){
+        zlog_error(category_debug,
+                   "SQL_load_object_occupancy failed");
+    }
+
+    /* The rollup table is created by the server, so its columns always 
+       match the rows flushed by SQL_flush_occupancy_rollup */
+    if(config.period_between_occupancy_rollup_in_sec > 0 &&
+       WORK_SUCCESSFULLY != 
+       SQL_create_occupancy_rollup_table(&config.db_connection_list_head)){
+        zlog_error(category_debug,
+                   "SQL_create_occupancy_rollup_table failed");
+    }
+
+    /* Load the mirror of object_table before the geo-fence objects are 
+       dumped from it */
+    if(config.period_between_object_mirror_refresh_in_sec > 0){
+        if(WORK_SUCCESSFULLY != 
+           SQL_load_object_mirror(&config.db_connection_list_head,
+                                  &object_mirror)){
+            zlog_error(category_debug,
+                       "SQL_load_object_mirror failed");
+        }
+    }
+
+    /* Initialize the clock cache before any thread reads it */
+    init_clock_cache();
+
+    return_value = startThread( &clock_cache_thread, 
+                                clock_cache_ticker, 
+                                NULL);
+
+    if(return_value != WORK_SUCCESSFULLY)
+    {
+        zlog_error(category_health_report, "Clock cache ticker fail");
+        zlog_error(category_debug, "Clock cache ticker fail");
+        return return_value;
+    }
+
+    /* The local control channel is optional. The server keeps running 
+       without it. */
+    if(SERVER_PROCESS_ROLE_INGEST == config.server_process_role){
+        control_channel_instance = CONTROL_CHANNEL_INSTANCE_INGEST;
+    }else if(SERVER_PROCESS_ROLE_ANALYTICS == config.server_process_role){
+        control_channel_instance = CONTROL_CHANNEL_INSTANCE_ANALYTICS;
+    }
+
+    if(WORK_SUCCESSFULLY == 
+       init_control_channel( &control_channel, 
+                             control_channel_instance,
+                             Server_process_control_request,
+                             Server_process_control_job)){
+
+        return_value = startThread( &control_channel_thread, 
+                                    control_channel_routine, 
+                                    &control_channel);
+
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_debug, "Control channel fail");
+            release_control_channel( &control_channel, false);
+        }
+    }else{
+        zlog_error(category_debug, "Fail to initialize control channel");
+    }
+
+    /* A simulation replays a script through the processing pipeline on a 
+       simulated clock instead of receiving packets from gateways */
+    if(config.is_enabled_simulation){
+
+        return_value = Server_run_simulation();
+
+        ready_to_work = false;
+
+        release_control_channel( &control_channel, false);
+
+        SQL_destroy_database_connection_pool(&config.db_connection_list_head);
+
+        return return_value;
+    }
+
+    /* An ingest process and an analytics process share the ring of 
+       received packets. A ring left by an earlier process is attached with 
+       its pending records. */
+    is_shared_ring_opened = false;
+
+    if(SERVER_PROCESS_ROLE_ALL != config.server_process_role){
+        if(WORK_SUCCESSFULLY != 
+           open_shared_ring( &shared_ring, 
+                             config.shared_ring_name, 
+                             config.shared_ring_size_in_records)){
+
+            zlog_error(category_health_report, 
+                       "Fail to open shared ring");
+            zlog_error(category_debug, "Fail to open shared ring");
+
+            return E_INITIALIZATION_FAIL;
+        }
+        is_shared_ring_opened = true;
+    }
+
+    /* Receive on recv_port with io_uring if it is enabled and supported. The 
+       UDP API is then bound to an ephemeral port, and packets to gateways 
+       are sent from the socket receiving recv_port instead. Otherwise the 
+       server falls back to receiving with the UDP API. The 
+       analytics process receives from the shared ring instead, and gateways 
+       only talk to the ingest process. */
+    udp_recv_port = config.recv_port;
+    is_io_uring_receiving = false;
+    is_recv_port_receiving = false;
+    server_send_path = SERVER_SEND_PATH_UDP_API;
+
+    /* A new build takes over the bound sockets and the warm state of the 
+       running server process, so packets sent to recv_port during the 
+       upgrade wait in the socket instead of being dropped */
+    for(i = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+        handoff_socket_fds[i] = -1;
+    }
+    handoff_ports[SOCKET_HANDOFF_RECV_PORT] = config.recv_port;
+    handoff_ports[SOCKET_HANDOFF_TIME_CRITICAL_PORT] = 
+        config.time_critical_recv_port;
+
+    if(SERVER_PROCESS_ROLE_ANALYTICS != config.server_process_role &&
+       config.is_enabled_socket_handoff){
+
+        if(WORK_SUCCESSFULLY == 
+           request_socket_handoff(config.socket_handoff_path,
+                                  handoff_ports,
+                                  handoff_socket_fds,
+                                  &warm_state_snapshot)){
+
+            Server_restore_warm_state_snapshot( &warm_state_snapshot);
+        }
+    }
+
+    if(SERVER_PROCESS_ROLE_ANALYTICS == config.server_process_role){
+        udp_recv_port = 0;
+    }else if(config.is_enabled_io_uring_receive){
+        if(WORK_SUCCESSFULLY == 
+           init_io_uring_receiver( &io_uring_receiver, 
+                                   config.recv_port, 
+                                   handoff_socket_fds[
+                                       SOCKET_HANDOFF_RECV_PORT],
+                                   Server_dispatch_received_packet)){
+
+            udp_recv_port = 0;
+            is_io_uring_receiving = true;
+            server_send_path = SERVER_SEND_PATH_IO_URING;
+        }else{
+            zlog_error(category_debug, 
+                       "Fail to initialize io_uring receiver, " \
+                       "use the UDP API instead");
+        }
+    }
+
+    /* The socket of the UDP API cannot be handed off, so with socket 
+       handoff recv_port is received by a socket owned by the server */
+    if(SERVER_PROCESS_ROLE_ANALYTICS != config.server_process_role &&
+       false == is_io_uring_receiving &&
+       config.is_enabled_socket_handoff){
+
+        if(WORK_SUCCESSFULLY == 
+           init_time_critical_receiver( 
+               &recv_port_receiver, 
+               config.recv_port, 
+               0,
+               handoff_socket_fds[SOCKET_HANDOFF_RECV_PORT],
+               Server_dispatch_received_packet)){
+
+            udp_recv_port = 0;
+            is_recv_port_receiving = true;
+            server_send_path = SERVER_SEND_PATH_RECV_PORT_RECEIVER;
+        }else{
+            zlog_error(category_debug, 
+                       "Fail to initialize recv_port receiver, " \
+                       "use the UDP API instead");
+        }
+    }
+
     /* Initialize the Wifi connection */
-    if(udp_initial( &udp_config, config.recv_port) != WORK_SUCCESSFULLY){
+    if(udp_initial( &udp_config, udp_recv_port) != WORK_SUCCESSFULLY){
 
         /* Error handling and return */
         initialization_failed = true;
@@ -271,9 +703,23 @@ int main(int argc, char **argv)
         return E_WIFI_INIT_FAIL;
     }
 
-    return_value = startThread( &wifi_listener_thread, 
-                               (void *)Server_process_wifi_receive,
-                               NULL);
+    if(SERVER_PROCESS_ROLE_ANALYTICS == config.server_process_role){
+        return_value = startThread( &wifi_listener_thread, 
+                                   (void *)Server_process_shared_ring_receive,
+                                   NULL);
+    }else if(true == is_io_uring_receiving){
+        return_value = startThread( &wifi_listener_thread, 
+                                   (void *)Server_process_io_uring_receive,
+                                   NULL);
+    }else if(true == is_recv_port_receiving){
+        return_value = startThread( &wifi_listener_thread, 
+                                   (void *)Server_process_recv_port_receive,
+                                   NULL);
+    }else{
+        return_value = startThread( &wifi_listener_thread, 
+                                   (void *)Server_process_wifi_receive,
+                                   NULL);
+    }
 
     if(return_value != WORK_SUCCESSFULLY)
     {
@@ -281,6 +727,44 @@ int main(int argc, char **argv)
         return E_WIFI_INIT_FAIL;
     }
 
+    /* Geo-fence gateways may send time-critical tracked object data to a 
+       dedicated port served by its own thread and socket buffer. A failure 
+       here is not fatal, because these packets are still accepted on 
+       recv_port. */
+    is_time_critical_receiving = false;
+    is_time_critical_worker_running = false;
+
+    if(SERVER_PROCESS_ROLE_ANALYTICS != config.server_process_role &&
+       config.time_critical_recv_port > 0){
+        if(WORK_SUCCESSFULLY == 
+           init_time_critical_receiver( 
+               &time_critical_receiver, 
+               config.time_critical_recv_port, 
+               config.time_critical_recv_buffer_size_in_bytes,
+               handoff_socket_fds[SOCKET_HANDOFF_TIME_CRITICAL_PORT],
+               Server_dispatch_received_packet)){
+
+            if(WORK_SUCCESSFULLY == 
+               startThread( &time_critical_listener_thread, 
+                           (void *)Server_process_time_critical_receive,
+                           NULL)){
+
+                is_time_critical_receiving = true;
+            }else{
+                release_time_critical_receiver( &time_critical_receiver);
+            }
+        }
+
+        if(false == is_time_critical_receiving){
+            zlog_error(category_debug, 
+                       "Fail to initialize time-critical receiver, " \
+                       "receive on recv_port only");
+        }
+    }
+
+    /* The receivers duplicated the sockets they took over */
+    close_socket_handoff_sockets(handoff_socket_fds);
+
     zlog_info(category_debug,"Sockets initialized");
 
     NSI_initialization_complete = true;
@@ -303,6 +787,30 @@ int main(int argc, char **argv)
 
     zlog_info(category_debug,"Initialize Communication Unit");
 
+    /* Geo-fence packets are processed on their own thread, so the worker 
+       threads of the Communication Unit keep the normal worker role. It is 
+       started before the Communication Unit, which takes the buffer list 
+       over if the thread cannot be created. */
+    if(SERVER_PROCESS_ROLE_ANALYTICS != config.server_process_role){
+        if(WORK_SUCCESSFULLY == 
+           startThread( &time_critical_worker_thread, 
+                       (void *)Server_process_time_critical_worker,
+                       NULL)){
+
+            is_time_critical_worker_running = true;
+        }else{
+            zlog_error(category_debug, 
+                       "Time-critical worker Create Fail, geo-fence " \
+                       "packets are processed by the Communication Unit");
+        }
+    }
+
+    if(false == is_time_critical_worker_running){
+        insert_list_tail( 
+            &Geo_fence_receive_buffer_list_head.priority_list_entry,
+            &priority_list_head.priority_list_entry);
+    }
+
     /* Create the main thread of Communication Unit  */
     return_value = startThread( &CommUnit_thread, CommUnit_routine, NULL);
 
@@ -313,6 +821,31 @@ int main(int argc, char **argv)
         return return_value;
     }
 
+    /* In EDF scheduling mode the received packets bypass the buffer lists 
+       of the Communication Unit, which then only sends packets */
+    if(config.is_enabled_edf_scheduling){
+
+        for(i = 0; 
+            i < common_config.number_worker_threads && 
+            i < MAX_NUMBER_OF_DEADLINE_WORKERS; 
+            i++){
+
+            if(WORK_SUCCESSFULLY != 
+               startThread( &deadline_worker_threads[i], 
+                           (void *)Server_process_deadline_worker,
+                           NULL)){
+
+                zlog_error(category_debug, 
+                           "Deadline worker [%d] Create Fail", i);
+                break;
+            }
+            number_of_deadline_workers++;
+        }
+
+        zlog_info(category_debug, "[%d] deadline workers started", 
+                  number_of_deadline_workers);
+    }
+
     /* Create thread to maintain database */
     return_value = startThread( &database_maintenance_thread, 
                                 maintain_database, 
@@ -325,74 +858,113 @@ int main(int argc, char **argv)
         return return_value;
     }
 
-    /* Create thread to summarize location information */
-    return_value = startThread( &location_information_thread, 
-                                Server_summarize_location_information, 
-                                NULL);
-
-    if(return_value != WORK_SUCCESSFULLY)
+    /* The ingest process only receives packets, answers join requests and 
+       polls gateways. The analytics threads run in the analytics process. */
+    if(SERVER_PROCESS_ROLE_INGEST != config.server_process_role)
     {
-        zlog_error(category_health_report, 
-                   "Server_summarize_location_information fail");
-        zlog_error(category_debug, 
-                   "Server_summarize_location_information fail");
-        return return_value;
-    }
+        /* Create thread to summarize location information */
+        return_value = startThread( &location_information_thread, 
+                                    Server_summarize_location_information, 
+                                    NULL);
 
-    /* Create thread to monitor object violations */
-    return_value = startThread( &monitor_object_violation_thread, 
-                                Server_monitor_object_violations, 
-                                NULL);
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_health_report, 
+                       "Server_summarize_location_information fail");
+            zlog_error(category_debug, 
+                       "Server_summarize_location_information fail");
+            return return_value;
+        }
 
-    if(return_value != WORK_SUCCESSFULLY)
-    {
-        zlog_error(category_health_report, 
-                   "Server_monitor_object_violations fail");
-        zlog_error(category_debug, 
-                   "Server_monitor_object_violations fail");
-        return return_value;
-    }
+        /* Create thread to monitor object violations */
+        return_value = startThread( &monitor_object_violation_thread, 
+                                    Server_monitor_object_violations, 
+                                    NULL);
 
-    /* Create thread to reload monitoring configuration */
-    return_value = startThread( &reload_monitor_config_thread, 
-                                Server_reload_monitor_config, 
-                                NULL);
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_health_report, 
+                       "Server_monitor_object_violations fail");
+            zlog_error(category_debug, 
+                       "Server_monitor_object_violations fail");
+            return return_value;
+        }
 
-    if(return_value != WORK_SUCCESSFULLY)
-    {
-        zlog_error(category_health_report, 
-                   "Server_reload_monitor_config fail");
-        zlog_error(category_debug, 
-                   "Server_reload_monitor_config fail");
-        return return_value;
-    }
+        /* Create thread to reload monitoring configuration */
+        return_value = startThread( &reload_monitor_config_thread, 
+                                    Server_reload_monitor_config, 
+                                    NULL);
 
-    /* Create thread to collect notification events */
-    return_value = startThread( &collect_violation_thread, 
-                                Server_collect_violation_event, 
-                                NULL);
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_health_report, 
+                       "Server_reload_monitor_config fail");
+            zlog_error(category_debug, 
+                       "Server_reload_monitor_config fail");
+            return return_value;
+        }
 
-    if(return_value != WORK_SUCCESSFULLY)
-    {
-        zlog_error(category_health_report, 
-                   "Server_collect_violation_event fail");
-        zlog_error(category_debug, 
-                   "Server_collect_violation_event fail");
-        return return_value;
+        /* Create thread to collect notification events */
+        return_value = startThread( &collect_violation_thread, 
+                                    Server_collect_violation_event, 
+                                    NULL);
+
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_health_report, 
+                       "Server_collect_violation_event fail");
+            zlog_error(category_debug, 
+                       "Server_collect_violation_event fail");
+            return return_value;
+        }
+
+        /* Create thread to collect notification events */
+        return_value = startThread( &send_notification_thread, 
+                                    Server_send_notification, 
+                                    NULL);
+
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_health_report, 
+                       "Server_send_notification fail");
+            zlog_error(category_debug, 
+                       "Server_send_notification fail");
+            return return_value;
+        }
     }
 
-    /* Create thread to collect notification events */
-    return_value = startThread( &send_notification_thread, 
-                                Server_send_notification, 
-                                NULL);
+    if(config.is_enabled_soak_monitor)
+    {
+        init_soak_monitor( &soak_monitor, 
+                           config.soak_sample_interval_in_sec,
+                           config.soak_report_path);
 
-    if(return_value != WORK_SUCCESSFULLY)
+        Server_add_soak_gauges( &soak_monitor);
+
+        /* Create thread to sample the server during the soak run */
+        return_value = startThread( &soak_monitor_thread, 
+                                    soak_monitor_routine, 
+                                    &soak_monitor);
+
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_debug, "soak_monitor_routine fail");
+            return return_value;
+        }
+    }
+
+    if(config.is_enabled_soak_load)
     {
-        zlog_error(category_health_report, 
-                   "Server_send_notification fail");
-        zlog_error(category_debug, 
-                   "Server_send_notification fail");
-        return return_value;
+        /* Create thread to replay the soak load */
+        return_value = startThread( &soak_load_thread, 
+                                    Server_replay_soak_load, 
+                                    NULL);
+
+        if(return_value != WORK_SUCCESSFULLY)
+        {
+            zlog_error(category_debug, "Server_replay_soak_load fail");
+            return return_value;
+        }
     }
 
     zlog_info(category_debug,"Start Communication");
@@ -413,18 +985,101 @@ int main(int argc, char **argv)
         }
     }
 
+    /* Listen for the next server process only after this one works, so a 
+       failed upgrade never takes the sockets from a working process */
+    is_socket_handoff_listening = false;
+
+    if(SERVER_PROCESS_ROLE_ANALYTICS != config.server_process_role &&
+       config.is_enabled_socket_handoff &&
+       WORK_SUCCESSFULLY == init_socket_handoff( &config.socket_handoff,
+                                                 config.socket_handoff_path)){
+
+        if(true == is_io_uring_receiving){
+            config.socket_handoff.socket_fds[SOCKET_HANDOFF_RECV_PORT] = 
+                get_io_uring_receiver_socket( &io_uring_receiver);
+            config.socket_handoff.ports[SOCKET_HANDOFF_RECV_PORT] = 
+                config.recv_port;
+        }else if(true == is_recv_port_receiving){
+            config.socket_handoff.socket_fds[SOCKET_HANDOFF_RECV_PORT] = 
+                recv_port_receiver.socket_fd;
+            config.socket_handoff.ports[SOCKET_HANDOFF_RECV_PORT] = 
+                config.recv_port;
+        }
+
+        if(true == is_time_critical_receiving){
+            config.socket_handoff.socket_fds[
+                SOCKET_HANDOFF_TIME_CRITICAL_PORT] = 
+                time_critical_receiver.socket_fd;
+            config.socket_handoff.ports[SOCKET_HANDOFF_TIME_CRITICAL_PORT] = 
+                config.time_critical_recv_port;
+        }
+
+        if(WORK_SUCCESSFULLY == startThread( &socket_handoff_thread, 
+                                            Server_process_socket_handoff, 
+                                            NULL)){
+            is_socket_handoff_listening = true;
+        }else{
+            zlog_error(category_debug, "Server_process_socket_handoff fail");
+            release_socket_handoff( &config.socket_handoff);
+        }
+    }
+
     last_polling_object_tracking_time = 0;
     last_polling_LBeacon_for_HR_time = 0;
+    last_flow_control_update_time = 0;
 
     /* The while loop that keeps the program running */
     while(ready_to_work == true)
     {
-        uptime = get_clock_time();
+        uptime = get_cached_clock_time();
+
+        /* Gateways are polled by the ingest process, and by the new 
+           process after the sockets are handed off */
+        if(SERVER_PROCESS_ROLE_ANALYTICS == config.server_process_role ||
+           true == config.socket_handoff.is_handed_off)
+        {
+            sleep_t(BUSY_WAITING_TIME_IN_MS);
+            continue;
+        }
+
+        /* Ask gateways to slow down when the receive queues fill up, and 
+           repeat the request while it lasts */
+        if(uptime != last_flow_control_update_time)
+        {
+            last_flow_control_update_time = uptime;
+
+            if(update_flow_control_level(&config.flow_control,
+                                         get_number_of_queued_buffer_nodes(),
+                                         uptime))
+            {
+                memset(command_msg, 0, WIFI_MESSAGE_LENGTH);
+                sprintf(command_msg, "%d;%d;%s;%d;%d;", 
+                        from_server, 
+                        FLOW_CONTROL_PKT_TYPE, 
+                        BOT_SERVER_API_VERSION_LATEST,
+                        get_flow_control_level(&config.flow_control),
+                        FLOW_CONTROL_SLOW_DOWN_FACTOR);
+
+                broadcast_to_gateway(&Gateway_address_map, command_msg,
+                                     strlen(command_msg));
+            }
+        }
 
+        /* Gateways which ignore flow control messages are slowed down by 
+           polling them less often, and not at all for non-critical data */
+        flow_control_level = get_flow_control_level(&config.flow_control);
+
+        polling_interval_in_sec = config.period_between_RFTOD;
+        if(FLOW_CONTROL_SLOW_DOWN == flow_control_level)
+        {
+            polling_interval_in_sec = config.period_between_RFTOD * 
+                                      FLOW_CONTROL_SLOW_DOWN_FACTOR;
+        }
 
         /* If it is the time to poll track object data from LBeacons, do it */
-        if(uptime - last_polling_object_tracking_time >=
-           config.period_between_RFTOD)
+        if(FLOW_CONTROL_DEFER_NON_CRITICAL != flow_control_level &&
+           uptime - last_polling_object_tracking_time >=
+           polling_interval_in_sec)
         {
             /* Poll object tracking object data */
             /* set the pkt type */
@@ -450,7 +1105,8 @@ int main(int argc, char **argv)
         /* Since period_between_RFTOD is short, we only allow one type 
            of data to be sent at a time except for tracked object data. 
          */
-        if(uptime - last_polling_LBeacon_for_HR_time >=
+        if(FLOW_CONTROL_DEFER_NON_CRITICAL != flow_control_level &&
+           uptime - last_polling_LBeacon_for_HR_time >=
                 config.period_between_RFHR)
         {
             /* Polling for health reports. */
@@ -480,16 +1136,61 @@ int main(int argc, char **argv)
     /* Release the Wifi elements and close the connection. */
     udp_release( &udp_config);
 
-    mp_destroy(&node_mempool);
+    if(true == is_shared_ring_opened){
+        if(SERVER_PROCESS_ROLE_ANALYTICS == config.server_process_role){
+            /* Wait for the consumer to commit its last record before 
+               unmapping the ring */
+            pthread_join(wifi_listener_thread, NULL);
+        }
+        close_shared_ring( &shared_ring);
+    }
 
-    SQL_destroy_database_connection_pool(&config.db_connection_list_head);
+    if(true == is_socket_handoff_listening){
+        pthread_join(socket_handoff_thread, NULL);
+        release_socket_handoff( &config.socket_handoff);
+    }
 
-    if(config.is_enabled_geofence_monitor){
-        destroy_geo_fence_list(&config.geo_fence_list_head,
-                               true,
-                               0);
+    if(true == is_io_uring_receiving){
+        /* Wait for the receiver to leave the ring before releasing it */
+        pthread_join(wifi_listener_thread, NULL);
+        release_io_uring_receiver( &io_uring_receiver);
+    }
 
-        destroy_objects_list_under_geo_fence_monitoring(
+    if(true == is_recv_port_receiving){
+        pthread_join(wifi_listener_thread, NULL);
+        release_time_critical_receiver( &recv_port_receiver);
+    }
+
+    if(true == is_time_critical_receiving){
+        /* Wait for the receiver to leave recvfrom before closing the 
+           socket */
+        pthread_join(time_critical_listener_thread, NULL);
+        release_time_critical_receiver( &time_critical_receiver);
+    }
+
+    release_control_channel( &control_channel, 
+                             config.socket_handoff.is_handed_off);
+
+    for(i = 0; i < number_of_deadline_workers; i++){
+        pthread_join(deadline_worker_threads[i], NULL);
+    }
+
+    if(true == is_time_critical_worker_running){
+        pthread_join(time_critical_worker_thread, NULL);
+    }
+
+    destroy_deadline_scheduler( &config.deadline_scheduler);
+
+    mp_destroy(&node_mempool);
+
+    SQL_destroy_database_connection_pool(&config.db_connection_list_head);
+
+    if(config.is_enabled_geofence_monitor){
+        destroy_geo_fence_list(&config.geo_fence_list_head,
+                               true,
+                               0);
+
+        destroy_objects_list_under_geo_fence_monitoring(
             &config.objects_under_geo_fence_list_head,
             true,
             0);
@@ -505,10 +1206,103 @@ int main(int argc, char **argv)
 
     mp_destroy(&notification_mempool);
 
+    destroy_dirty_object_set(&config.dirty_object_set_head);
+
+    mp_destroy(&dirty_object_mempool);
+
+    destroy_clock_offset_list(&config.clock_offset_list_head);
+
+    mp_destroy(&clock_offset_mempool);
+
+    destroy_occupancy_counters(&config.occupancy_counters);
+
+    mp_destroy(&occupancy_object_mempool);
+
+    mp_destroy(&occupancy_counter_mempool);
+
+    destroy_object_trajectory_history(&config.trajectory_history);
+
+    mp_destroy(&trajectory_object_mempool);
+
+    mp_destroy(&trajectory_spill_mempool);
+
+    destroy_object_mirror(&object_mirror);
+
+    mp_destroy(&object_mirror_mempool);
+
+    destroy_fragment_reassembly(&config.fragment_reassembly_head);
+
+    mp_destroy(&fragment_reassembly_mempool);
+
+    mp_destroy(&sql_coroutine_mempool);
+
     return WORK_SUCCESSFULLY;
 }
 
 
+/* Read the value of the next line of the config file into value. The line 
+   must hold the specified key. The config file is read by position, so a 
+   missing or misplaced key would otherwise be read into another setting. 
+   Nothing is read after the first mismatch, which is kept in ret_val. */
+static void fetch_server_config_value(FILE *file, 
+                                      char *key, 
+                                      char *value, 
+                                      size_t value_len,
+                                      ErrorCode *ret_val){
+
+    char line[CONFIG_BUFFER_SIZE];
+    char *line_ptr = line;
+    char *delimiter = NULL;
+    size_t line_len = 0;
+
+    memset(value, 0, value_len);
+
+    if(WORK_SUCCESSFULLY != *ret_val){
+        return;
+    }
+
+    memset(line, 0, sizeof(line));
+    if(NULL == fgets(line, sizeof(line), file)){
+
+        zlog_error(category_health_report, 
+                   "Config key [%s] is missing", key);
+        zlog_error(category_debug, "Config key [%s] is missing", key);
+
+        *ret_val = E_INPUT_PARAMETER;
+        return;
+    }
+
+    line_len = strlen(line);
+    while(line_len > 0 && 
+          (line[line_len - 1] == '\n' || line[line_len - 1] == '\r' ||
+           line[line_len - 1] == ' ')){
+        line[--line_len] = '\0';
+    }
+
+    /* The file may start with the byte order mark of UTF-8 */
+    if(0 == strncmp(line_ptr, "\xEF\xBB\xBF", 3)){
+        line_ptr += 3;
+    }
+
+    delimiter = strchr(line_ptr, '=');
+    if(NULL == delimiter || 
+       (size_t)(delimiter - line_ptr) != strlen(key) ||
+       0 != strncmp(line_ptr, key, strlen(key))){
+
+        zlog_error(category_health_report, 
+                   "Config key [%s] is expected, but [%s] is found", 
+                   key, line_ptr);
+        zlog_error(category_debug, 
+                   "Config key [%s] is expected, but [%s] is found", 
+                   key, line_ptr);
+
+        *ret_val = E_INPUT_PARAMETER;
+        return;
+    }
+
+    strncpy(value, delimiter + 1, value_len - 1);
+}
+
 ErrorCode get_server_config(ServerConfig *config, 
                             CommonConfig *common_config, 
                             char *file_name) 
@@ -522,6 +1316,8 @@ ErrorCode get_server_config(ServerConfig *config,
     int number_notification_settings = 0;
     int i = 0;
     char *save_ptr = NULL;
+    char notification_key[CONFIG_BUFFER_SIZE];
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
 
     List_Entry *current_list_entry = NULL;
     GeoFenceSettingNode *current_list_ptr = NULL;
@@ -533,87 +1329,111 @@ ErrorCode get_server_config(ServerConfig *config,
         return E_OPEN_FILE;
     }
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "installation_path", config_message, 
+                              sizeof(config_message), &ret_val);
     memcpy(config->server_installation_path, config_message,
            sizeof(config->server_installation_path));
     zlog_info(category_debug,"Server Installation Path [%s]", 
               config->server_installation_path);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "IP_address", config_message, 
+                              sizeof(config_message), &ret_val);
     memcpy(config->server_ip, config_message, sizeof(config->server_ip));
     zlog_info(category_debug,"Server IP [%s]", config->server_ip);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "database_IP", config_message, 
+                              sizeof(config_message), &ret_val);
     memcpy(config->db_ip, config_message, sizeof(config->db_ip));
     zlog_info(category_debug,"Database IP [%s]", config->db_ip);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "period_between_RFHR", config_message, 
+                              sizeof(config_message), &ret_val);
     config->period_between_RFHR = atoi(config_message);
     zlog_info(category_debug,
               "Periods between request for health report " \
               "period_between_RFHR [%d]",
               config->period_between_RFHR);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "period_between_RFTOD", config_message, 
+                              sizeof(config_message), &ret_val);
     config->period_between_RFTOD = atoi(config_message);
     zlog_info(category_debug,
               "Periods between request for tracked object data " \
               "period_between_RFTOD [%d]",
               config->period_between_RFTOD);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "period_between_check_object_movement_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->period_between_check_object_movement_in_sec = atoi(config_message);
     zlog_info(category_debug,
               "period_between_check_object_movement_in_sec [%d]",
               config->period_between_check_object_movement_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "server_localtime_against_UTC_in_hour", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->server_localtime_against_UTC_in_hour = atoi(config_message);
     zlog_info(category_debug,
               "server_localtime_against_UTC_in_hour [%d]",
               config->server_localtime_against_UTC_in_hour);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "number_worker_thread", config_message, 
+                              sizeof(config_message), &ret_val);
     common_config->number_worker_threads = atoi(config_message);
     zlog_info(category_debug,
               "Number of worker threads [%d]",
               common_config->number_worker_threads);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "min_age_out_of_date_packet_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     common_config->min_age_out_of_date_packet_in_sec = atoi(config_message);
     zlog_info(category_debug,
               "min_age_out_of_date_packet_in_sec in seconds [%d]",
               common_config->min_age_out_of_date_packet_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "send_port", config_message, 
+                              sizeof(config_message), &ret_val);
     config->send_port = atoi(config_message);
     zlog_info(category_debug,
               "The destination port when sending [%d]", 
               config->send_port);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "recv_port", config_message, 
+                              sizeof(config_message), &ret_val);
     config->recv_port = atoi(config_message);
     zlog_info(category_debug,
               "The received port [%d]", config->recv_port);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "database_port", config_message, 
+                              sizeof(config_message), &ret_val);
     config->database_port = atoi(config_message);
     zlog_info(category_debug, 
               "The database port [%d]", config->database_port);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "database_name", config_message, 
+                              sizeof(config_message), &ret_val);
     memcpy(config->database_name, config_message, 
            sizeof(config->database_name));
     zlog_info(category_debug,
               "Database Name [%s]", config->database_name);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "database_account", config_message, 
+                              sizeof(config_message), &ret_val);
     memcpy(config->database_account, config_message, \
            sizeof(config->database_account));
     zlog_info(category_debug,
               "Database Account [%s]", config->database_account);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "database_password", config_message, 
+                              sizeof(config_message), &ret_val);
     memcpy(config->database_password, config_message, 
            sizeof(config->database_password));
     
@@ -626,134 +1446,198 @@ ErrorCode get_server_config(ServerConfig *config,
             config->db_ip,
             config->database_port );
 
-    memset(config->database_password, 0, sizeof(config->database_password));
-
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "database_keep_hours", config_message, 
+                              sizeof(config_message), &ret_val);
     config->database_keep_hours = atoi(config_message);
     zlog_info(category_debug,
               "Database database_keep_hours [%d]", 
               config->database_keep_hours);
 
-    fetch_next_string(file, config_message, sizeof(config_message));
+    fetch_server_config_value(file, 
+                              "number_of_database_connection", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->number_of_database_connection = atoi(config_message);
     zlog_info(category_debug,
               "The number_of_database_connection is [%d]",
               config->number_of_database_connection);
-        
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+
+    fetch_server_config_value(file, "critical_priority", config_message, 
+                              sizeof(config_message), &ret_val);
     common_config->time_critical_priority = atoi(config_message);
     zlog_info(category_debug,
               "The nice of time critical priority is [%d]",
               common_config->time_critical_priority);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "high_priority", config_message, 
+                              sizeof(config_message), &ret_val);
     common_config->high_priority = atoi(config_message);
     zlog_info(category_debug,
               "The nice of high priority is [%d]", 
               common_config->high_priority);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "normal_priority", config_message, 
+                              sizeof(config_message), &ret_val);
     common_config->normal_priority = atoi(config_message);
     zlog_info(category_debug,
               "The nice of normal priority is [%d]",
               common_config->normal_priority);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "low_priority", config_message, 
+                              sizeof(config_message), &ret_val);
     common_config->low_priority = atoi(config_message);
     zlog_info(category_debug,
               "The nice of low priority is [%d]", 
               common_config->low_priority);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "database_pre_filter_time_window_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->database_pre_filter_time_window_in_sec = atoi(config_message);
     zlog_info(category_debug,
               "The database_pre_filter_time_window_in_sec is [%d]", 
               config->database_pre_filter_time_window_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "location_time_interval_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->location_time_interval_in_sec = atoi(config_message);
     zlog_info(category_debug,
               "The location_time_interval_in_sec is [%d]", 
               config->location_time_interval_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message));
+    fetch_server_config_value(file, 
+                              "rssi_difference_of_location_accuracy_tolerance", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->rssi_difference_of_location_accuracy_tolerance = 
         atoi(config_message);
     zlog_info(category_debug,
               "The rssi_difference_of_location_accuracy_tolerance is [%d]",
               config->rssi_difference_of_location_accuracy_tolerance);
 
-    fetch_next_string(file, config_message, sizeof(config_message));
+    fetch_server_config_value(file, 
+                              "base_location_tolerance_in_millimeter", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->base_location_tolerance_in_millimeter = 
         atoi(config_message);
     zlog_info(category_debug,
               "The base_location_tolerance_in_millimeter is [%d]",
               config->base_location_tolerance_in_millimeter);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "is_enabled_panic_button_monitor", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->is_enabled_panic_button_monitor = atoi(config_message);
     zlog_info(category_debug,
               "The is_enabled_panic_button_monitor is [%d]", 
               config->is_enabled_panic_button_monitor);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "is_enabled_geofence_monitor", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->is_enabled_geofence_monitor = atoi(config_message);
     zlog_info(category_debug,
               "The is_enabled_geofence_monitor is [%d]", 
               config->is_enabled_geofence_monitor);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "perimeter_valid_duration_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->perimeter_valid_duration_in_sec = atoi(config_message);
     zlog_info(category_debug,
               "The perimeter_valid_duration_in_sec is [%d]", 
               config->perimeter_valid_duration_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "is_enabled_location_monitor", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->is_enabled_location_monitor = atoi(config_message);
     zlog_info(category_debug,
               "The is_enabled_location_monitor is [%d]", 
               config->is_enabled_location_monitor);
-    
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+
+    fetch_server_config_value(file, 
+                              "is_enabled_movement_monitor", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->is_enabled_movement_monitor = atoi(config_message);
     zlog_info(category_debug,
               "The is_enabled_movement_monitor is [%d]", 
               config->is_enabled_movement_monitor);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "movement_time_interval_in_min", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->movement_monitor_config.monitor_interval_in_min = atoi(config_message);
     zlog_info(category_debug,
               "The time_interval_in_min is [%d]", 
               config->movement_monitor_config.
               monitor_interval_in_min);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "movement_each_time_slot_in_min", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->movement_monitor_config.each_time_slot_in_min = atoi(config_message);
     zlog_info(category_debug,
               "The each_time_slot_in_min is [%d]", 
               config->movement_monitor_config.
               each_time_slot_in_min);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, "movement_rssi_delta", config_message, 
+                              sizeof(config_message), &ret_val);
     config->movement_monitor_config.rssi_delta = atoi(config_message);
     zlog_info(category_debug,
               "The rssi_delta is [%d]", 
               config->movement_monitor_config.
               rssi_delta);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "is_enabled_collect_violation_event", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->is_enabled_collect_violation_event = atoi(config_message);
     zlog_info(category_debug,
               "The is_enabled_collect_violation_event is [%d]", 
               config->is_enabled_collect_violation_event);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "collect_violation_event_time_interval_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->collect_violation_event_time_interval_in_sec = atoi(config_message);
     zlog_info(category_debug,
               "The collect_violation_event_time_interval_in_sec is [%d]", 
               config->collect_violation_event_time_interval_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "granularity_for_continuous_violations_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->granularity_for_continuous_violations_in_sec = 
         atoi(config_message);
     zlog_info(category_debug,
@@ -761,7 +1645,11 @@ ErrorCode get_server_config(ServerConfig *config,
               "is [%d]", 
               config->granularity_for_continuous_violations_in_sec);
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "is_enabled_send_notification_alarm", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     config->is_enabled_send_notification_alarm = atoi(config_message);
     zlog_info(category_debug,
               "The is_enabled_send_notification_alarm is [%d]", 
@@ -773,12 +1661,24 @@ ErrorCode get_server_config(ServerConfig *config,
        settings */
     init_entry( &(config->notification_list_head));
 
-    fetch_next_string(file, config_message, sizeof(config_message)); 
+    fetch_server_config_value(file, 
+                              "number_of_notification_settings", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
     number_notification_settings = atoi(config_message);
 
     for(i = 0; i < number_notification_settings ; i++){
           
-        fetch_next_string(file, config_message, sizeof(config_message)); 
+        memset(notification_key, 0, sizeof(notification_key));
+        sprintf(notification_key, "notification_%d", i + 1);
+
+        fetch_server_config_value(file, notification_key, config_message, 
+                                  sizeof(config_message), &ret_val);
+        if(WORK_SUCCESSFULLY != ret_val){
+            break;
+        }
+
         add_notification_to_the_notification_list(
             &(config->notification_list_head), 
             config_message);
@@ -786,29 +1686,538 @@ ErrorCode get_server_config(ServerConfig *config,
        
     zlog_info(category_debug, "notification list initialized");
 
+    /* The settings added after the first release follow the notification 
+       settings, so a config file of an earlier release is reported as 
+       missing them instead of being read into the wrong settings */
+    fetch_server_config_value(file, 
+                              "is_enabled_tracking_archive", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->is_enabled_tracking_archive = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_tracking_archive is [%d]", 
+              config->is_enabled_tracking_archive);
+
+    fetch_server_config_value(file, 
+                              "number_of_dedicated_database_connection", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->number_of_dedicated_database_connection = atoi(config_message);
+    zlog_info(category_debug,
+              "The number_of_dedicated_database_connection is [%d]",
+              config->number_of_dedicated_database_connection);
+
+    fetch_server_config_value(file, 
+                              "min_interval_between_location_summary_in_ms", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->min_interval_between_location_summary_in_ms = 
+        atoi(config_message);
+    zlog_info(category_debug,
+              "The min_interval_between_location_summary_in_ms is [%d]",
+              config->min_interval_between_location_summary_in_ms);
+
+    fetch_server_config_value(file, 
+                              "period_between_occupancy_rollup_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->period_between_occupancy_rollup_in_sec = atoi(config_message);
+    zlog_info(category_debug,
+              "The period_between_occupancy_rollup_in_sec is [%d]",
+              config->period_between_occupancy_rollup_in_sec);
+
+    fetch_server_config_value(file, 
+                              "period_between_object_mirror_refresh_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->period_between_object_mirror_refresh_in_sec = atoi(config_message);
+    zlog_info(category_debug,
+              "The period_between_object_mirror_refresh_in_sec is [%d]",
+              config->period_between_object_mirror_refresh_in_sec);
+
+    fetch_server_config_value(file, 
+                              "flow_control_high_watermark_in_percent", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->flow_control_high_watermark_in_percent = atoi(config_message);
+    zlog_info(category_debug,
+              "The flow_control_high_watermark_in_percent is [%d]",
+              config->flow_control_high_watermark_in_percent);
+
+    fetch_server_config_value(file, 
+                              "flow_control_critical_watermark_in_percent", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->flow_control_critical_watermark_in_percent = atoi(config_message);
+    zlog_info(category_debug,
+              "The flow_control_critical_watermark_in_percent is [%d]",
+              config->flow_control_critical_watermark_in_percent);
+
+    fetch_server_config_value(file, 
+                              "flow_control_low_watermark_in_percent", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->flow_control_low_watermark_in_percent = atoi(config_message);
+    zlog_info(category_debug,
+              "The flow_control_low_watermark_in_percent is [%d]",
+              config->flow_control_low_watermark_in_percent);
+
+    fetch_server_config_value(file, 
+                              "cpu_set_of_receiver_threads", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memcpy(config->thread_role_profiles.cpu_set[THREAD_ROLE_RECEIVER], 
+           config_message, 
+           sizeof(config->thread_role_profiles.cpu_set[THREAD_ROLE_RECEIVER]));
+    zlog_info(category_debug,
+              "The cpu_set_of_receiver_threads is [%s]", 
+              config->thread_role_profiles.cpu_set[THREAD_ROLE_RECEIVER]);
+
+    fetch_server_config_value(file, 
+                              "cpu_set_of_time_critical_worker_threads", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memcpy(config->thread_role_profiles.cpu_set[THREAD_ROLE_TIME_CRITICAL_WORKER], 
+           config_message, 
+           sizeof(config->thread_role_profiles.cpu_set[THREAD_ROLE_TIME_CRITICAL_WORKER]));
+    zlog_info(category_debug,
+              "The cpu_set_of_time_critical_worker_threads is [%s]", 
+              config->thread_role_profiles.cpu_set[THREAD_ROLE_TIME_CRITICAL_WORKER]);
+
+    fetch_server_config_value(file, 
+                              "cpu_set_of_normal_worker_threads", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memcpy(config->thread_role_profiles.cpu_set[THREAD_ROLE_NORMAL_WORKER], 
+           config_message, 
+           sizeof(config->thread_role_profiles.cpu_set[THREAD_ROLE_NORMAL_WORKER]));
+    zlog_info(category_debug,
+              "The cpu_set_of_normal_worker_threads is [%s]", 
+              config->thread_role_profiles.cpu_set[THREAD_ROLE_NORMAL_WORKER]);
+
+    fetch_server_config_value(file, 
+                              "cpu_set_of_db_monitor_threads", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memcpy(config->thread_role_profiles.cpu_set[THREAD_ROLE_DB_MONITOR], 
+           config_message, 
+           sizeof(config->thread_role_profiles.cpu_set[THREAD_ROLE_DB_MONITOR]));
+    zlog_info(category_debug,
+              "The cpu_set_of_db_monitor_threads is [%s]", 
+              config->thread_role_profiles.cpu_set[THREAD_ROLE_DB_MONITOR]);
+
+    fetch_server_config_value(file, 
+                              "is_enabled_realtime_scheduling", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->thread_role_profiles.is_enabled_realtime_scheduling = 
+        atoi(config_message);
+    zlog_info(category_debug,
+              "The is_enabled_realtime_scheduling is [%d]", 
+              config->thread_role_profiles.is_enabled_realtime_scheduling);
+
+    fetch_server_config_value(file, 
+                              "is_enabled_io_uring_receive", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->is_enabled_io_uring_receive = atoi(config_message);
+    zlog_info(category_debug,
+              "The is_enabled_io_uring_receive is [%d]", 
+              config->is_enabled_io_uring_receive);
+
+    fetch_server_config_value(file, "time_critical_recv_port", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->time_critical_recv_port = atoi(config_message);
+    zlog_info(category_debug,
+              "The time_critical_recv_port is [%d]", 
+              config->time_critical_recv_port);
+
+    fetch_server_config_value(file, 
+                              "time_critical_recv_buffer_size_in_bytes", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->time_critical_recv_buffer_size_in_bytes = atoi(config_message);
+    zlog_info(category_debug,
+              "The time_critical_recv_buffer_size_in_bytes is [%d]", 
+              config->time_critical_recv_buffer_size_in_bytes);
+
+    fetch_server_config_value(file, 
+                              "fragment_reassembly_timeout_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->fragment_reassembly_timeout_in_sec = atoi(config_message);
+    zlog_info(category_debug,
+              "The fragment_reassembly_timeout_in_sec is [%d]", 
+              config->fragment_reassembly_timeout_in_sec);
+
+    fetch_server_config_value(file, 
+                              "event_watermark_allowed_lateness_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->event_watermark_allowed_lateness_in_sec = atoi(config_message);
+    zlog_info(category_debug,
+              "The event_watermark_allowed_lateness_in_sec is [%d]", 
+              config->event_watermark_allowed_lateness_in_sec);
+
+    fetch_server_config_value(file, 
+                              "is_enabled_edf_scheduling", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->is_enabled_edf_scheduling = atoi(config_message);
+    zlog_info(category_debug,
+              "The is_enabled_edf_scheduling is [%d]", 
+              config->is_enabled_edf_scheduling);
+
+    fetch_server_config_value(file, 
+                              "edf_budget_of_time_critical_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->edf_budget_in_sec[DEADLINE_CLASS_TIME_CRITICAL] = atoi(config_message);
+    zlog_info(category_debug,
+              "The edf_budget_of_time_critical_in_sec is [%d]", 
+              config->edf_budget_in_sec[DEADLINE_CLASS_TIME_CRITICAL]);
+
+    fetch_server_config_value(file, 
+                              "edf_budget_of_join_request_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->edf_budget_in_sec[DEADLINE_CLASS_JOIN_REQUEST] = atoi(config_message);
+    zlog_info(category_debug,
+              "The edf_budget_of_join_request_in_sec is [%d]", 
+              config->edf_budget_in_sec[DEADLINE_CLASS_JOIN_REQUEST]);
+
+    fetch_server_config_value(file, 
+                              "edf_budget_of_ipc_command_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->edf_budget_in_sec[DEADLINE_CLASS_IPC_COMMAND] = atoi(config_message);
+    zlog_info(category_debug,
+              "The edf_budget_of_ipc_command_in_sec is [%d]", 
+              config->edf_budget_in_sec[DEADLINE_CLASS_IPC_COMMAND]);
+
+    fetch_server_config_value(file, 
+                              "edf_budget_of_tracked_object_data_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->edf_budget_in_sec[DEADLINE_CLASS_TRACKED_OBJECT_DATA] = atoi(config_message);
+    zlog_info(category_debug,
+              "The edf_budget_of_tracked_object_data_in_sec is [%d]", 
+              config->edf_budget_in_sec[DEADLINE_CLASS_TRACKED_OBJECT_DATA]);
+
+    fetch_server_config_value(file, 
+                              "edf_budget_of_health_report_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->edf_budget_in_sec[DEADLINE_CLASS_HEALTH_REPORT] = atoi(config_message);
+    zlog_info(category_debug,
+              "The edf_budget_of_health_report_in_sec is [%d]", 
+              config->edf_budget_in_sec[DEADLINE_CLASS_HEALTH_REPORT]);
+
+    fetch_server_config_value(file, "server_process_role", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->server_process_role = atoi(config_message);
+    zlog_info(category_debug, 
+              "The server_process_role is [%d]", 
+              config->server_process_role);
+
+    fetch_server_config_value(file, "shared_ring_name", config_message, 
+                              sizeof(config_message), &ret_val);
+    memset(config->shared_ring_name, 0, sizeof(config->shared_ring_name));
+    strncpy(config->shared_ring_name, config_message, 
+            sizeof(config->shared_ring_name) - 1);
+    zlog_info(category_debug, 
+              "The shared_ring_name is [%s]", 
+              config->shared_ring_name);
+
+    fetch_server_config_value(file, 
+                              "shared_ring_size_in_records", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->shared_ring_size_in_records = atoi(config_message);
+    zlog_info(category_debug, 
+              "The shared_ring_size_in_records is [%d]", 
+              config->shared_ring_size_in_records);
+
+    fetch_server_config_value(file, 
+                              "is_enabled_socket_handoff", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->is_enabled_socket_handoff = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_socket_handoff is [%d]", 
+              config->is_enabled_socket_handoff);
+
+    fetch_server_config_value(file, "socket_handoff_path", config_message, 
+                              sizeof(config_message), &ret_val);
+    memset(config->socket_handoff_path, 0, 
+           sizeof(config->socket_handoff_path));
+    strncpy(config->socket_handoff_path, config_message, 
+            sizeof(config->socket_handoff_path) - 1);
+    zlog_info(category_debug, 
+              "The socket_handoff_path is [%s]", 
+              config->socket_handoff_path);
+
+    fetch_server_config_value(file, 
+                              "is_enabled_stage_profiler", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->is_enabled_stage_profiler = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_stage_profiler is [%d]", 
+              config->is_enabled_stage_profiler);
+
+    fetch_server_config_value(file, "is_enabled_simulation", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->is_enabled_simulation = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_simulation is [%d]", 
+              config->is_enabled_simulation);
+
+    fetch_server_config_value(file, "simulation_script_path", config_message, 
+                              sizeof(config_message), &ret_val);
+    memset(config->simulation_script_path, 0, 
+           sizeof(config->simulation_script_path));
+    strncpy(config->simulation_script_path, config_message, 
+            sizeof(config->simulation_script_path) - 1);
+    zlog_info(category_debug, 
+              "The simulation_script_path is [%s]", 
+              config->simulation_script_path);
+
+    fetch_server_config_value(file, "simulation_start_time", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->simulation_start_time = atoi(config_message);
+    zlog_info(category_debug, 
+              "The simulation_start_time is [%d]", 
+              config->simulation_start_time);
+
+    fetch_server_config_value(file, "simulation_step_in_sec", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->simulation_step_in_sec = atoi(config_message);
+    zlog_info(category_debug, 
+              "The simulation_step_in_sec is [%d]", 
+              config->simulation_step_in_sec);
+
+    fetch_server_config_value(file, "is_enabled_soak_monitor", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->is_enabled_soak_monitor = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_soak_monitor is [%d]", 
+              config->is_enabled_soak_monitor);
+
+    fetch_server_config_value(file, 
+                              "soak_sample_interval_in_sec", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->soak_sample_interval_in_sec = atoi(config_message);
+    zlog_info(category_debug, 
+              "The soak_sample_interval_in_sec is [%d]", 
+              config->soak_sample_interval_in_sec);
+
+    fetch_server_config_value(file, "soak_report_path", config_message, 
+                              sizeof(config_message), &ret_val);
+    memset(config->soak_report_path, 0, sizeof(config->soak_report_path));
+    strncpy(config->soak_report_path, config_message, 
+            sizeof(config->soak_report_path) - 1);
+    zlog_info(category_debug, 
+              "The soak_report_path is [%s]", 
+              config->soak_report_path);
+
+    fetch_server_config_value(file, "is_enabled_soak_load", config_message, 
+                              sizeof(config_message), &ret_val);
+    config->is_enabled_soak_load = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_soak_load is [%d]", 
+              config->is_enabled_soak_load);
+
+    fetch_server_config_value(file, 
+                              "is_enabled_sql_coroutines", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->is_enabled_sql_coroutines = atoi(config_message);
+    zlog_info(category_debug, 
+              "The is_enabled_sql_coroutines is [%d]", 
+              config->is_enabled_sql_coroutines);
+
+    fetch_server_config_value(file, 
+                              "number_of_sql_coroutine_executors", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->number_of_sql_coroutine_executors = atoi(config_message);
+    zlog_info(category_debug, 
+              "The number_of_sql_coroutine_executors is [%d]", 
+              config->number_of_sql_coroutine_executors);
+
+    fetch_server_config_value(file, 
+                              "sql_coroutine_connections_per_executor", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    config->sql_coroutine_connections_per_executor = atoi(config_message);
+    zlog_info(category_debug, 
+              "The sql_coroutine_connections_per_executor is [%d]", 
+              config->sql_coroutine_connections_per_executor);
+
+    fetch_server_config_value(file, 
+                              "simulation_database_name", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memcpy(config->simulation_database_name, config_message, 
+           sizeof(config->simulation_database_name));
+    zlog_info(category_debug, 
+              "The simulation_database_name is [%s]", 
+              config->simulation_database_name);
+
+    fetch_server_config_value(file, 
+                              "simulation_expected_report_path", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memset(config->simulation_expected_report_path, 0, 
+           sizeof(config->simulation_expected_report_path));
+    strncpy(config->simulation_expected_report_path, config_message, 
+            sizeof(config->simulation_expected_report_path) - 1);
+    zlog_info(category_debug, 
+              "The simulation_expected_report_path is [%s]", 
+              config->simulation_expected_report_path);
+
+    fetch_server_config_value(file, 
+                              "ingest_benchmark_database_name", 
+                              config_message, 
+                              sizeof(config_message), 
+                              &ret_val);
+    memcpy(config->ingest_benchmark_database_name, config_message, 
+           sizeof(config->ingest_benchmark_database_name));
+    zlog_info(category_debug, 
+              "The ingest_benchmark_database_name is [%s]", 
+              config->ingest_benchmark_database_name);
 
     fclose(file);
 
+    if(WORK_SUCCESSFULLY != ret_val){
+        memset(config->database_password, 0, 
+               sizeof(config->database_password));
+
+        zlog_error(category_health_report, 
+                   "Config file [%s] does not match this server", file_name);
+        zlog_error(category_debug, 
+                   "Config file [%s] does not match this server", file_name);
+        return ret_val;
+    }
+
+    /* A simulation writes tracking data and marks violation events, so it 
+       never runs on the production database */
+    if(config->is_enabled_simulation){
+
+        if(0 == strlen(config->simulation_database_name) ||
+           0 == strcmp(config->simulation_database_name, 
+                       config->database_name)){
+
+            memset(config->database_password, 0, 
+                   sizeof(config->database_password));
+
+            zlog_error(category_health_report, 
+                       "Simulation needs a database other than [%s]", 
+                       config->database_name);
+            zlog_error(category_debug, 
+                       "Simulation needs a database other than [%s]", 
+                       config->database_name);
+            return E_INPUT_PARAMETER;
+        }
+
+        memset(database_argument, 0, SQL_TEMP_BUFFER_LENGTH);
+
+        sprintf(database_argument, 
+                "dbname=%s user=%s password=%s host=%s port=%d",
+                config->simulation_database_name, 
+                config->database_account,
+                config->database_password, 
+                config->db_ip,
+                config->database_port );
+    }
+
+    memset(config->database_password, 0, sizeof(config->database_password));
+
     return WORK_SUCCESSFULLY;
 }
 
 void *maintain_database()
 {
     ErrorCode ret = WORK_SUCCESSFULLY;
+    char archive_directory[MAX_PATH];
+
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_DB_MONITOR);
 
     while(true == ready_to_work){
-        zlog_info(category_debug, 
-                  "SQL_delete_old_data with database_keep_hours=[%d]", 
-                  config.database_keep_hours); 
+        SQL_report_database_connection_metrics(
+            &config.db_connection_list_head);
 
-        ret = SQL_delete_old_data(&config.db_connection_list_head, 
-                                  config.database_keep_hours);
+        ret = WORK_SUCCESSFULLY;
 
-        if(WORK_SUCCESSFULLY != ret){
-            zlog_error(category_debug, 
-                       "SQL_delete_old_data failed ret=[%d]", 
-                       ret); 
+        if(config.is_enabled_tracking_archive){
+
+            memset(archive_directory, 0, sizeof(archive_directory));
+            sprintf(archive_directory, "%s/%s", 
+                    config.server_installation_path, 
+                    TRACKING_ARCHIVE_DIRECTORY);
+
+            ret = SQL_archive_expiring_tracking_data(
+                &config.db_connection_list_head,
+                config.database_keep_hours,
+                archive_directory);
+
+            if(WORK_SUCCESSFULLY != ret){
+                zlog_error(category_debug, 
+                           "SQL_archive_expiring_tracking_data failed " \
+                           "ret=[%d]", ret); 
+            }
+        }
+
+        /* Keep the expired data until it is archived successfully */
+        if(WORK_SUCCESSFULLY == ret){
+
+            zlog_info(category_debug, 
+                      "SQL_delete_old_data with database_keep_hours=[%d]", 
+                      config.database_keep_hours); 
 
+            ret = SQL_delete_old_data(&config.db_connection_list_head, 
+                                      config.database_keep_hours);
+
+            if(WORK_SUCCESSFULLY != ret){
+                zlog_error(category_debug, 
+                           "SQL_delete_old_data failed ret=[%d]", 
+                           ret); 
+
+            }
         }
 
         zlog_info(category_debug, "SQL_vacuum_database");
@@ -828,54 +2237,162 @@ void *maintain_database()
     return (void *)NULL;
 }
 
+int summarize_dirty_objects(){
+    char mac_address_list[SQL_TEMP_BUFFER_LENGTH];
+    int number_of_objects = 0;
+    int number_of_summarized_objects = 0;
+    int watermark = 0;
+    ErrorCode ret = WORK_SUCCESSFULLY;
+
+    pthread_mutex_lock(&location_summary_lock);
+
+    /* All batches use the same watermark, so the objects summarized 
+       together see the same closed windows */
+    watermark = get_event_watermark(&config.event_watermark);
+
+    while(0 < (number_of_objects = 
+               collect_dirty_objects(&config.dirty_object_set_head,
+                                     mac_address_list,
+                                     sizeof(mac_address_list),
+                                     MAXIMUM_OBJECTS_IN_LOCATION_SUMMARY_BATCH,
+                                     watermark))){
+
+        /* Each batch uses a new generation number, so the stable tags 
+           updated by this batch can be told apart from the objects 
+           updated by previous batches. */
+        location_summary_generation++;
+        if(location_summary_generation > MAXIMUM_LOCATION_SUMMARY_GENERATION){
+            location_summary_generation = 1;
+        }
+
+        ret = SQL_summarize_object_location(
+                  &config.db_connection_list_head,
+                  mac_address_list,
+                  location_summary_generation,
+                  watermark,
+                  config.database_pre_filter_time_window_in_sec,
+                  config.location_time_interval_in_sec,
+                  config.rssi_difference_of_location_accuracy_tolerance,
+                  config.base_location_tolerance_in_millimeter,
+                  &config.occupancy_counters,
+                  &config.trajectory_history);
+
+        /* The objects of a failed batch are marked again and left to the 
+           next run, because this run would only collect them again */
+        if(WORK_SUCCESSFULLY != ret){
+
+            number_of_objects = 
+                mark_objects_dirty(&config.dirty_object_set_head,
+                                   mac_address_list,
+                                   watermark);
+
+            zlog_error(category_debug, 
+                       "SQL_summarize_object_location failed ret=[%d], " \
+                       "[%d] objects are kept dirty", 
+                       ret, number_of_objects);
+            break;
+        }
+
+        number_of_summarized_objects += number_of_objects;
+    }
+
+    pthread_mutex_unlock(&location_summary_lock);
+
+    return number_of_summarized_objects;
+}
+
 void *Server_summarize_location_information(){
-    
+
+    int uptime = 0;
+    int last_occupancy_rollup_time = 0;
+    char archive_directory[MAX_PATH];
+
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_DB_MONITOR);
+
+    last_occupancy_rollup_time = get_cached_clock_time();
+
     while(true == ready_to_work){
-    
-        SQL_summarize_object_location(&config.db_connection_list_head,
-                                      config.database_pre_filter_time_window_in_sec,
-                                      config.location_time_interval_in_sec,
-                                      config.rssi_difference_of_location_accuracy_tolerance,
-                                      config.base_location_tolerance_in_millimeter);
 
-        sleep_t(BUSY_WAITING_TIME_IN_MS);
+        uptime = get_cached_clock_time();
+
+        if(config.period_between_occupancy_rollup_in_sec > 0 &&
+           uptime - last_occupancy_rollup_time >= 
+           config.period_between_occupancy_rollup_in_sec){
+
+            SQL_flush_occupancy_rollup(&config.db_connection_list_head,
+                                       &config.occupancy_counters);
+
+            last_occupancy_rollup_time = uptime;
+        }
+
+        /* Nothing to summarize if no object received new tracking data */
+        if(0 == get_number_of_dirty_objects(&config.dirty_object_set_head)){
+
+            sleep_t(BUSY_WAITING_TIME_IN_MS);
+            continue;
+        }
+
+        summarize_dirty_objects();
+
+        if(config.is_enabled_tracking_archive){
+
+            memset(archive_directory, 0, sizeof(archive_directory));
+            sprintf(archive_directory, "%s/%s", 
+                    config.server_installation_path, 
+                    TRACKING_ARCHIVE_DIRECTORY);
+
+            spill_object_trajectory(&config.trajectory_history, 
+                                    archive_directory);
+        }
+
+        sleep_t(config.min_interval_between_location_summary_in_ms);
     }
 
     return (void *)NULL;
 }
 
+void monitor_object_violations(int uptime, 
+                               int *last_monitor_movement_timestamp){
+
+    /* Skip the detectors when no object is monitored by them */
+    if(config.is_enabled_location_monitor &&
+       has_monitored_objects(&object_mirror, MONITOR_LOCATION)){
+            
+        SQL_identify_location_not_stay_room(
+            &config.db_connection_list_head);
+
+        SQL_identify_location_long_stay_in_danger(
+            &config.db_connection_list_head);
+    }
+
+    if(config.is_enabled_movement_monitor &&
+       (uptime - *last_monitor_movement_timestamp >= 
+        config.period_between_check_object_movement_in_sec) &&
+       has_monitored_objects(&object_mirror, MONITOR_MOVEMENT)){
+
+        *last_monitor_movement_timestamp = uptime;
+
+        SQL_identify_last_movement_status(
+            &config.db_connection_list_head, 
+            config.movement_monitor_config.monitor_interval_in_min, 
+            config.movement_monitor_config.each_time_slot_in_min,
+            config.movement_monitor_config.rssi_delta);    
+    }
+}
+
 void *Server_monitor_object_violations(){
     int uptime = 0;
     int last_monitor_movement_timestamp = 0;
    
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_DB_MONITOR);
 
-    uptime = get_clock_time();
+    uptime = get_cached_clock_time();
     
     while(true == ready_to_work){
     
-        uptime = get_clock_time();
+        uptime = get_cached_clock_time();
 
-        if(config.is_enabled_location_monitor){
-                
-            SQL_identify_location_not_stay_room(
-                &config.db_connection_list_head);
- 
-            SQL_identify_location_long_stay_in_danger(
-                &config.db_connection_list_head);
-        }
-
-        if(config.is_enabled_movement_monitor &&
-           (uptime - last_monitor_movement_timestamp >= 
-            config.period_between_check_object_movement_in_sec)){
-    
-            last_monitor_movement_timestamp = uptime;
-
-            SQL_identify_last_movement_status(
-                &config.db_connection_list_head, 
-                config.movement_monitor_config.monitor_interval_in_min, 
-                config.movement_monitor_config.each_time_slot_in_min,
-                config.movement_monitor_config.rssi_delta);    
-        }
+        monitor_object_violations(uptime, &last_monitor_movement_timestamp);
        
         sleep_t(BUSY_WAITING_TIME_IN_MS);
     }
@@ -885,12 +2402,43 @@ void *Server_monitor_object_violations(){
 
 
 void *Server_reload_monitor_config(){
+
+    int uptime = 0;
+    int last_object_mirror_load_time = 0;
+    bool is_object_table_changed = false;
     
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_DB_MONITOR);
+
+    last_object_mirror_load_time = get_cached_clock_time();
+
     while(true == ready_to_work){
        
         SQL_reload_monitor_config(&config.db_connection_list_head, 
                                   config.server_localtime_against_UTC_in_hour);
 
+        /* Reload the mirror of object_table when it is notified as changed, 
+           and periodically in case a notification is missed */
+        if(config.period_between_object_mirror_refresh_in_sec > 0){
+
+            uptime = get_cached_clock_time();
+
+            is_object_table_changed = false;
+            SQL_check_object_table_changes(&config.db_connection_list_head,
+                                           &is_object_table_changed);
+
+            if(true == is_object_table_changed ||
+               uptime - last_object_mirror_load_time >= 
+               config.period_between_object_mirror_refresh_in_sec){
+
+                if(WORK_SUCCESSFULLY == 
+                   SQL_load_object_mirror(&config.db_connection_list_head,
+                                          &object_mirror)){
+
+                    last_object_mirror_load_time = uptime;
+                }
+            }
+        }
+
         sleep_t(NORMAL_WAITING_TIME_IN_MS);
 
     }
@@ -899,40 +2447,46 @@ void *Server_reload_monitor_config(){
     
 }
 
+void collect_violation_events(){
+
+    if(config.is_enabled_geofence_monitor){
+        SQL_collect_violation_events(
+            &config.db_connection_list_head,
+            MONITOR_GEO_FENCE,
+            config.collect_violation_event_time_interval_in_sec,
+            config.granularity_for_continuous_violations_in_sec);
+    }
+    if(config.is_enabled_panic_button_monitor){
+        SQL_collect_violation_events(
+            &config.db_connection_list_head,
+            MONITOR_PANIC,
+            config.collect_violation_event_time_interval_in_sec,
+            config.granularity_for_continuous_violations_in_sec);
+    }
+    if(config.is_enabled_movement_monitor){
+        SQL_collect_violation_events(
+            &config.db_connection_list_head,
+            MONITOR_MOVEMENT,
+            config.collect_violation_event_time_interval_in_sec,
+            config.granularity_for_continuous_violations_in_sec);
+    }
+    if(config.is_enabled_location_monitor){
+        SQL_collect_violation_events(
+            &config.db_connection_list_head,
+            MONITOR_LOCATION,
+            config.collect_violation_event_time_interval_in_sec,
+            config.granularity_for_continuous_violations_in_sec);
+    }
+}
+
 void *Server_collect_violation_event(){
 
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_DB_MONITOR);
+
     while(true == ready_to_work){
 
         if(config.is_enabled_collect_violation_event){
-          
-            if(config.is_enabled_geofence_monitor){
-                SQL_collect_violation_events(
-                    &config.db_connection_list_head,
-                    MONITOR_GEO_FENCE,
-                    config.collect_violation_event_time_interval_in_sec,
-                    config.granularity_for_continuous_violations_in_sec);
-            }
-            if(config.is_enabled_panic_button_monitor){
-                SQL_collect_violation_events(
-                    &config.db_connection_list_head,
-                    MONITOR_PANIC,
-                    config.collect_violation_event_time_interval_in_sec,
-                    config.granularity_for_continuous_violations_in_sec);
-            }
-            if(config.is_enabled_movement_monitor){
-                SQL_collect_violation_events(
-                    &config.db_connection_list_head,
-                    MONITOR_MOVEMENT,
-                    config.collect_violation_event_time_interval_in_sec,
-                    config.granularity_for_continuous_violations_in_sec);
-            }
-            if(config.is_enabled_location_monitor){
-                SQL_collect_violation_events(
-                    &config.db_connection_list_head,
-                    MONITOR_LOCATION,
-                    config.collect_violation_event_time_interval_in_sec,
-                    config.granularity_for_continuous_violations_in_sec);
-            }
+            collect_violation_events();
         }
       
         sleep_t(BUSY_WAITING_TIME_IN_MS);
@@ -945,6 +2499,7 @@ void *Server_collect_violation_event(){
 void *Server_send_notification(){
     char violation_info[WIFI_MESSAGE_LENGTH];
 
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_DB_MONITOR);
 
     while(true == ready_to_work){
 
@@ -973,34 +2528,232 @@ void *Server_send_notification(){
     return (void *)NULL;
 }
 
-void send_notification_alarm_to_gateway(){
+void Server_simulation_step(int simulated_time){
 
-    List_Entry * current_list_entry = NULL;
-    NotificationListNode *current_list_ptr = NULL;
-    char command_msg[WIFI_MESSAGE_LENGTH];
+    char violation_info[WIFI_MESSAGE_LENGTH];
 
-    list_for_each(current_list_entry, &(config.notification_list_head)){
+    summarize_dirty_objects();
 
-        current_list_ptr = ListEntry(current_list_entry,
-                                     NotificationListNode,
-                                     notification_list_entry);
+    monitor_object_violations(get_cached_clock_time(), 
+                              &last_simulated_movement_check_time);
 
-        memset(command_msg, 0, sizeof(command_msg));
+    if(config.is_enabled_collect_violation_event){
+        collect_violation_events();
+    }
 
-        sprintf(command_msg, "%d;%d;%s;%d;%d;%s;", 
-                from_server, 
-                notification_alarm, 
-                BOT_SERVER_API_VERSION_LATEST,
-                current_list_ptr->alarm_type,
-                current_list_ptr->alarm_duration_in_sec,
+    if(config.is_enabled_send_notification_alarm){
+
+        memset(violation_info, 0, sizeof(violation_info));
+
+        SQL_get_and_update_violation_events(
+            &config.db_connection_list_head, 
+            violation_info, 
+            sizeof(violation_info));
+
+        if(strlen(violation_info) > 0){
+            zlog_debug(category_debug, 
+                       "simulated notification at [%d] for [%s]", 
+                       simulated_time, violation_info);
+            number_of_simulated_notifications++;
+        }
+    }
+}
+
+ErrorCode Server_run_simulation(){
+
+    SimulationDriver driver;
+    char report[CONFIG_BUFFER_SIZE];
+    int start_time = 0;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    /* The split roles pass packets through the shared ring, which the 
+       simulation does not open */
+    config.server_process_role = SERVER_PROCESS_ROLE_ALL;
+
+    /* Packets processed inline may answer gateways. They are counted 
+       instead of sent, so no socket is opened. */
+    server_send_path = SERVER_SEND_PATH_SIMULATION;
+    number_of_simulated_sent_packets = 0;
+
+    if(config.is_enabled_geofence_monitor){
+        construct_geo_fence_list(&config.db_connection_list_head, 
+                                 &config.geo_fence_list_head,
+                                 true,
+                                 0);
+    
+        construct_objects_list_under_geo_fence_monitoring(
+            &config.db_connection_list_head, 
+            &config.objects_under_geo_fence_list_head,
+            true,
+            0);
+    }
+
+    SQL_reload_monitor_config(&config.db_connection_list_head, 
+                              config.server_localtime_against_UTC_in_hour);
+
+    start_time = config.simulation_start_time;
+    if(start_time <= 0){
+        start_time = get_cached_system_time();
+    }
+
+    number_of_simulated_notifications = 0;
+    last_simulated_movement_check_time = 0;
+
+    init_simulation_driver( &driver,
+                            start_time,
+                            config.simulation_step_in_sec,
+                            Server_dispatch_received_packet,
+                            Server_simulation_step);
+
+    zlog_info(category_debug, "Start simulation script [%s] at [%d]", 
+              config.simulation_script_path, start_time);
+
+    ret_val = run_simulation_script( &driver, config.simulation_script_path);
+
+    if(WORK_SUCCESSFULLY == ret_val){
+
+        get_simulation_report( &driver, report, sizeof(report));
+
+        zlog_info(category_debug, "Simulation finished %s" \
+                  "simulation_notifications=%d;simulation_sent_packets=%d;", 
+                  report, number_of_simulated_notifications,
+                  number_of_simulated_sent_packets);
+
+        if(strlen(config.simulation_expected_report_path) > 0){
+            ret_val = check_simulation_outcome( 
+                          &driver, 
+                          config.simulation_expected_report_path);
+        }
+    }
+
+    if(config.is_enabled_geofence_monitor){
+        destroy_geo_fence_list(&config.geo_fence_list_head,
+                               true,
+                               0);
+
+        destroy_objects_list_under_geo_fence_monitoring(
+            &config.objects_under_geo_fence_list_head,
+            true,
+            0);
+    }
+
+    return ret_val;
+}
+
+void *Server_replay_soak_load(){
+
+    SimulationDriver driver;
+    char report[CONFIG_BUFFER_SIZE];
+
+    /* The periodic work runs in its own threads during a soak run */
+    init_simulation_driver( &driver,
+                            get_cached_system_time(),
+                            config.simulation_step_in_sec,
+                            Server_dispatch_received_packet,
+                            NULL);
+
+    zlog_info(category_debug, "Start soak load from script [%s]", 
+              config.simulation_script_path);
+
+    if(WORK_SUCCESSFULLY == replay_simulation_script( 
+                                &driver, 
+                                config.simulation_script_path)){
+
+        get_simulation_report( &driver, report, sizeof(report));
+
+        zlog_info(category_debug, "Soak load finished %s", report);
+    }
+
+    return (void *)NULL;
+}
+
+void Server_add_soak_gauges(SoakMonitor *monitor){
+
+    add_soak_gauge(monitor, "queued_buffer_nodes", 
+                   get_soak_queued_buffer_nodes);
+    add_soak_gauge(monitor, "dirty_objects", 
+                   get_soak_dirty_objects);
+    add_soak_gauge(monitor, "geofence_violations", 
+                   get_soak_geofence_violations);
+    add_soak_gauge(monitor, "pending_fragment_reports", 
+                   get_soak_pending_fragment_reports);
+    add_soak_gauge(monitor, "pending_trajectory_entries", 
+                   get_soak_pending_trajectory_entries);
+    add_soak_gauge(monitor, "dedicated_db_connections", 
+                   get_soak_dedicated_db_connections);
+}
+
+long get_soak_queued_buffer_nodes(){
+
+    return get_number_of_queued_buffer_nodes();
+}
+
+long get_soak_dirty_objects(){
+
+    return get_number_of_dirty_objects( &config.dirty_object_set_head);
+}
+
+long get_soak_geofence_violations(){
+
+    List_Entry *current_list_entry = NULL;
+    long number_of_violations = 0;
+
+    pthread_mutex_lock( &config.geo_fence_violation_list_head.list_lock);
+
+    list_for_each(current_list_entry, 
+                  &config.geo_fence_violation_list_head.list_head){
+        number_of_violations++;
+    }
+
+    pthread_mutex_unlock( &config.geo_fence_violation_list_head.list_lock);
+
+    return number_of_violations;
+}
+
+long get_soak_pending_fragment_reports(){
+
+    return config.fragment_reassembly_head.number_of_pending_reports;
+}
+
+long get_soak_pending_trajectory_entries(){
+
+    return config.trajectory_history.number_of_pending_entries;
+}
+
+long get_soak_dedicated_db_connections(){
+
+    return config.db_connection_list_head.number_of_dedicated_connections;
+}
+
+void send_notification_alarm_to_gateway(){
+
+    List_Entry * current_list_entry = NULL;
+    NotificationListNode *current_list_ptr = NULL;
+    char command_msg[WIFI_MESSAGE_LENGTH];
+
+    list_for_each(current_list_entry, &(config.notification_list_head)){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     NotificationListNode,
+                                     notification_list_entry);
+
+        memset(command_msg, 0, sizeof(command_msg));
+
+        sprintf(command_msg, "%d;%d;%s;%d;%d;%s;", 
+                from_server, 
+                notification_alarm, 
+                BOT_SERVER_API_VERSION_LATEST,
+                current_list_ptr->alarm_type,
+                current_list_ptr->alarm_duration_in_sec,
                 current_list_ptr->agents_list);
 
-        udp_addpkt(&udp_config,
-                   current_list_ptr->gateway_ip,
-                   config.send_port,
-                   command_msg,
-                   strlen(command_msg));
+        Server_queue_packet(current_list_ptr->gateway_ip,
+                            config.send_port,
+                            command_msg,
+                            strlen(command_msg));
     }
+
+    Server_flush_packets();
 }
 
 void *Server_NSI_routine(void *_buffer_node)
@@ -1008,16 +2761,23 @@ void *Server_NSI_routine(void *_buffer_node)
     BufferNode *current_node = (BufferNode *)_buffer_node;
 
     char gateway_record[WIFI_MESSAGE_LENGTH];
+    ProtocolCursor cursor;
+    GatewayRegistrationHeaderFields gateway_header;
+    GatewayRegistrationItemFields gateway_item;
 
-    JoinStatus join_status = JOIN_UNKNOWN;
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_NORMAL_WORKER);
+
+    SQL_bind_dedicated_database_connection(&config.db_connection_list_head);
 
     zlog_info(category_debug, "Start join...(%s)", 
               current_node -> net_address);
 
-    memset(gateway_record, 0, sizeof(gateway_record));
+    gateway_header.number_of_gateways = "1";
+    gateway_item.ip_address = current_node -> net_address;
 
-    sprintf(gateway_record, "1;%s;%d;", current_node -> net_address,
-            S_NORMAL_STATUS);
+    open_protocol_writer(&cursor, gateway_record, sizeof(gateway_record));
+    encode_gateway_registration_header(&cursor, &gateway_header);
+    encode_gateway_registration_item(&cursor, &gateway_item);
    
     SQL_update_gateway_registration_status(
         &config.db_connection_list_head, 
@@ -1030,6 +2790,15 @@ void *Server_NSI_routine(void *_buffer_node)
         strlen(current_node->content),
         current_node -> net_address);
 
+    Server_answer_join_request(current_node);
+    
+    return (void *)NULL;
+}
+
+void Server_answer_join_request(BufferNode *current_node)
+{
+    JoinStatus join_status = JOIN_UNKNOWN;
+
      /* Put the address into Gateway_address_map */
     if (true == Gateway_join_request(&Gateway_address_map, 
                                      current_node -> net_address) ){
@@ -1054,16 +2823,84 @@ void *Server_NSI_routine(void *_buffer_node)
     pthread_mutex_unlock( &NSI_send_buffer_list_head.list_lock);
 
     zlog_info(category_debug, "%s join success", current_node -> net_address);
-    
+}
+
+void *Server_submit_NSI_coroutine(void *_buffer_node)
+{
+    BufferNode *current_node = (BufferNode *)_buffer_node;
+
+    if(WORK_SUCCESSFULLY != 
+       submit_sql_coroutine( &sql_coroutine_scheduler,
+                             SQL_update_registration_status_coroutine,
+                             Server_finish_NSI_coroutine,
+                             current_node,
+                             current_node -> content,
+                             strlen(current_node -> content),
+                             current_node -> net_address)){
+
+        return Server_NSI_routine(current_node);
+    }
+
+    zlog_info(category_debug, "Start join...(%s)", 
+              current_node -> net_address);
+
+    return (void *)NULL;
+}
+
+void *Server_submit_BHM_coroutine(void *_buffer_node)
+{
+    BufferNode *current_node = (BufferNode *)_buffer_node;
+    SqlCoroutineRoutine routine = NULL;
+
+    if(current_node->pkt_direction == from_gateway){
+
+        if(current_node->pkt_type == gateway_health_report){
+            routine = SQL_update_gateway_health_status_coroutine;
+        }
+        else if(current_node->pkt_type == beacon_health_report){
+            routine = SQL_update_lbeacon_health_status_coroutine;
+        }
+    }
+
+    if(NULL == routine){
+        mp_free( &node_mempool, current_node);
+        return (void *)NULL;
+    }
+
+    if(WORK_SUCCESSFULLY != 
+       submit_sql_coroutine( &sql_coroutine_scheduler,
+                             routine,
+                             Server_finish_BHM_coroutine,
+                             current_node,
+                             current_node -> content,
+                             current_node -> content_size,
+                             current_node -> net_address)){
+
+        return Server_BHM_routine(current_node);
+    }
+
     return (void *)NULL;
 }
 
+void Server_finish_NSI_coroutine(SqlCoroutine *co)
+{
+    Server_answer_join_request((BufferNode *)co -> argument);
+}
+
+void Server_finish_BHM_coroutine(SqlCoroutine *co)
+{
+    mp_free( &node_mempool, co -> argument);
+}
+
 
 void *Server_BHM_routine(void *_buffer_node)
 {
     BufferNode *current_node = (BufferNode *)_buffer_node;
     
-   
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_NORMAL_WORKER);
+
+    SQL_bind_dedicated_database_connection(&config.db_connection_list_head);
+
     if(current_node->pkt_direction == from_gateway){
 
         if(current_node->pkt_type == gateway_health_report){
@@ -1090,28 +2927,69 @@ void *Server_BHM_routine(void *_buffer_node)
 void *Server_LBeacon_routine(void *_buffer_node)
 {
     BufferNode *current_node = (BufferNode *)_buffer_node;
+    ReassemblyNode *report = NULL;
+    long long profile_start_time = 0;
     
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_NORMAL_WORKER);
+
+    SQL_bind_dedicated_database_connection(&config.db_connection_list_head);
+
+    profile_start_time = begin_profile_stage( &stage_profiler);
 
     if(current_node -> pkt_type == tracked_object_data)
     {
-        // Server should support backward compatibility.
-        if(atof(BOT_SERVER_API_VERSION_20) == current_node -> API_version){
-            /*[obsoleted-20200109]
-            SQL_update_object_tracking_data(db,
-                                            current_node -> content,
-                                            strlen(current_node -> content));
-                                            */
-        }else{
-            SQL_update_object_tracking_data_with_battery_voltage(
-                &config.db_connection_list_head,
-                current_node -> content,
-                strlen(current_node -> content),
-                config.server_installation_path,
-                config.is_enabled_panic_button_monitor);
-        }
+        /* The layout of the tracked objects follows the API version of the 
+           packet */
+        SQL_update_object_tracking_data_with_battery_voltage(
+            &config.db_connection_list_head,
+            current_node -> content,
+            strlen(current_node -> content),
+            current_node -> API_version,
+            config.server_installation_path,
+            config.is_enabled_panic_button_monitor,
+            &config.dirty_object_set_head,
+            &config.clock_offset_list_head,
+            &object_mirror,
+            &config.event_watermark,
+            current_node -> net_address);
+    }
+    else if(current_node -> pkt_type == FRAGMENTED_REPORT_PKT_TYPE)
+    {
+        report = take_completed_report(&config.fragment_reassembly_head);
+
+        if(NULL != report){
+
+            /* The whole report is stored by one bulk insertion */
+            if(report -> pkt_type == tracked_object_data){
+
+                SQL_update_object_tracking_data_with_battery_voltage(
+                    &config.db_connection_list_head,
+                    report -> content,
+                    report -> content_size,
+                    report -> API_version,
+                    config.server_installation_path,
+                    config.is_enabled_panic_button_monitor,
+                    &config.dirty_object_set_head,
+                    &config.clock_offset_list_head,
+                    &object_mirror,
+                    &config.event_watermark,
+                    report -> net_address);
+            }else{
+                zlog_error(category_debug, 
+                           "Drop reassembled report of pkt_type [%d] " \
+                           "from [%s]", 
+                           report -> pkt_type, 
+                           report -> net_address);
+            }
 
+            release_completed_report(report);
+        }
     }
 
+    end_profile_stage( &stage_profiler, 
+                       PROFILE_STAGE_TRACKED_OBJECT_DATA, 
+                       profile_start_time);
+
     mp_free( &node_mempool, current_node);
 
     return (void* )NULL;
@@ -1126,6 +3004,8 @@ void *process_commands(void *_buffer_node){
     char *ipc_command = NULL;
     IPCCommand command = CMD_NONE;
 
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_NORMAL_WORKER);
+
     zlog_debug(category_debug, ">>process_commands [%s]", 
                current_node->content);
    
@@ -1153,97 +3033,484 @@ void *process_commands(void *_buffer_node){
     return (void* )NULL;
 }
 
-void *process_tracked_data_from_geofence_gateway(void *_buffer_node)
-{
-    BufferNode *current_node = (BufferNode *)_buffer_node;
+ErrorCode Server_process_control_request(char *request, 
+                                         char *response, 
+                                         size_t response_len){
+    char buf[CONTROL_MESSAGE_LENGTH];
+    char *save_ptr = NULL;
+    char *request_type = NULL;
+    char *ipc_command = NULL;
+    IPCCommand command = CMD_NONE;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    char *mac_address = NULL;
+    char *start_timestamp = NULL;
+    char *end_timestamp = NULL;
+    TrajectoryEntry trajectory_entries[LENGTH_OF_OBJECT_TRAJECTORY];
+    int number_of_entries = 0;
+    char trajectory_entry[CONTROL_MESSAGE_LENGTH];
+    char *profile_argument = NULL;
+    char temp_directory[MAX_PATH];
+    char report_path[MAX_PATH];
+    char conninfo[SQL_TEMP_BUFFER_LENGTH];
+    int i;
 
-    
-    if(current_node -> pkt_type == time_critical_tracked_object_data){
-       
-        if(config.is_enabled_geofence_monitor){
+    memset(buf, 0, sizeof(buf));
+    strncpy(buf, request, sizeof(buf) - 1);
 
-            check_geo_fence_violations(current_node, 
-                                       &config.db_connection_list_head,
-                                       &config.geo_fence_list_head, 
-                                       &config.objects_under_geo_fence_list_head,
-                                       &config.geo_fence_violation_list_head,
-                                       config.perimeter_valid_duration_in_sec,
-                                       config.granularity_for_continuous_violations_in_sec);
+    request_type = strtok_save(buf, DELIMITER_SEMICOLON, &save_ptr);
+    if(request_type == NULL){
+        sprintf(response, "%s;empty request;", CONTROL_RESPONSE_ERROR);
+        return E_INPUT_PARAMETER;
+    }
+
+    if(strcmp(request_type, CONTROL_REQUEST_RELOAD) == 0){
+
+        /* The remaining part of the request is the IPC command. It is 
+           copied because reload_geo_fence_settings tokenizes its input. */
+        ipc_command = "";
+        if(strlen(request) > strlen(CONTROL_REQUEST_RELOAD)){
+            ipc_command = request + strlen(CONTROL_REQUEST_RELOAD) + 
+                          strlen(DELIMITER_SEMICOLON);
         }
 
-        // Server should support backward compatibility.
-        if(atof(BOT_SERVER_API_VERSION_20) == current_node -> API_version){
-            /*[obsoleted-20200109]
-            SQL_update_object_tracking_data(db,
-                                            current_node -> content,
-                                            strlen(current_node -> content));
-                                            */
-        }else{
-            SQL_update_object_tracking_data_with_battery_voltage(
-                &config.db_connection_list_head,
-                current_node -> content,
-                strlen(current_node -> content),
-                config.server_installation_path,
-                config.is_enabled_panic_button_monitor);
+        memset(buf, 0, sizeof(buf));
+        strncpy(buf, ipc_command, sizeof(buf) - 1);
+        command = (IPCCommand) atoi(buf);
+
+        switch (command){
+            case CMD_RELOAD_GEO_FENCE_SETTING:
+                ret_val = reload_geo_fence_settings(
+                    buf, 
+                    &config.db_connection_list_head,
+                    &config.geo_fence_list_head, 
+                    &config.objects_under_geo_fence_list_head);
+                break;
+            case CMD_RELOAD_MONITOR_SETTING:
+                ret_val = SQL_reload_monitor_config(
+                    &config.db_connection_list_head,
+                    config.server_localtime_against_UTC_in_hour);
+                break;
+            default:
+                sprintf(response, "%s;unknown ipc command;", 
+                        CONTROL_RESPONSE_ERROR);
+                return E_INPUT_PARAMETER;
         }
-        
-    }
 
-    mp_free( &node_mempool, current_node);
+        sprintf(response, "%s;reload;%d;", 
+                (WORK_SUCCESSFULLY == ret_val) ? 
+                CONTROL_RESPONSE_OK : CONTROL_RESPONSE_ERROR,
+                ret_val);
 
-    return (void *)NULL;
-}
+        return ret_val;
 
-bool Gateway_join_request(AddressMapArray *address_map, char *address)
-{
-    int not_in_use = -1;
-    int n;
-    int answer = -1;
+    }else if(strcmp(request_type, CONTROL_REQUEST_STATS) == 0){
 
-    zlog_info(category_debug, 
-              "Enter Gateway_join_request address [%s]", address);
+        sprintf(response, 
+                "%s;dirty_objects=%d;summary_generation=%d;" \
+                "dedicated_db_connections=%d;shared_db_hits=%d;" \
+                "db_lock_acquisitions=%d;db_failures=%d;",
+                CONTROL_RESPONSE_OK,
+                get_number_of_dirty_objects(&config.dirty_object_set_head),
+                location_summary_generation,
+                config.db_connection_list_head.number_of_dedicated_connections,
+                config.db_connection_list_head.number_of_shared_hits,
+                config.db_connection_list_head.number_of_lock_acquisitions,
+                config.db_connection_list_head.number_of_failures);
 
-    pthread_mutex_lock( &address_map -> list_lock);
-    /* Copy all the necessary information received from the LBeacon to the
-       address map. */
+        get_flow_control_report(&config.flow_control, false,
+                                buf, sizeof(buf));
 
-    /* Find the first unused address map location and use the location to store
-       the new joined LBeacon. */
+        if(strlen(response) + strlen(buf) < response_len){
+            strcat(response, buf);
+        }
 
-    zlog_info(category_debug, "Check whether joined");
+        if(config.is_enabled_io_uring_receive){
+            get_io_uring_receiver_report(&io_uring_receiver, 
+                                         buf, 
+                                         sizeof(buf));
 
-    answer = is_in_Address_Map(address_map, address, 0);
-    if(answer >=0)
-    {
-        /* Need to update last request time for each gateway */
-        address_map -> address_map_list[answer].last_request_time =
-            get_system_time();
+            if(strlen(response) + strlen(buf) < response_len){
+                strcat(response, buf);
+            }
+        }
 
-        pthread_mutex_unlock( &address_map -> list_lock);
-        zlog_info(category_debug, "Exist and Return");
+        if(config.time_critical_recv_port > 0){
+            get_time_critical_receiver_report(&time_critical_receiver, 
+                                              buf, 
+                                              sizeof(buf));
 
-        return true;
-    }
+            if(strlen(response) + strlen(buf) < response_len){
+                strcat(response, buf);
+            }
+        }
 
-    for(n = 0 ; n < MAX_NUMBER_NODES ; n ++){
-        if(address_map -> in_use[n] == false && not_in_use == -1)
-        {
-            not_in_use = n;
-            break;
+        get_fragment_reassembly_report(&config.fragment_reassembly_head,
+                                       buf, sizeof(buf));
+
+        if(strlen(response) + strlen(buf) < response_len){
+            strcat(response, buf);
         }
-    }
 
-    zlog_info(category_debug, "Start join...(%s)", address);
+        get_event_watermark_report(&config.event_watermark, false,
+                                   buf, sizeof(buf));
 
-    /* If still has space for the LBeacon to register */
-    if (not_in_use != -1)
-    {
-        address_map -> in_use[not_in_use] = true;
+        if(strlen(response) + strlen(buf) < response_len){
+            strcat(response, buf);
+        }
 
-        memset(address_map->address_map_list[not_in_use].net_address, 0, 
-               NETWORK_ADDR_LENGTH);
-        strncpy(address_map->address_map_list[not_in_use].net_address, 
-                address, strlen(address));
+        if(config.is_enabled_edf_scheduling){
+            get_deadline_scheduler_report(&config.deadline_scheduler,
+                                          buf, sizeof(buf));
+
+            if(strlen(response) + strlen(buf) < response_len){
+                strcat(response, buf);
+            }
+        }
+
+        if(SERVER_PROCESS_ROLE_ALL != config.server_process_role){
+            get_shared_ring_report(&shared_ring, buf, sizeof(buf));
+
+            if(strlen(response) + strlen(buf) < response_len){
+                strcat(response, buf);
+            }
+        }
+
+        if(config.is_enabled_sql_coroutines){
+            get_sql_coroutine_report(&sql_coroutine_scheduler, 
+                                     buf, 
+                                     sizeof(buf));
+
+            if(strlen(response) + strlen(buf) < response_len){
+                strcat(response, buf);
+            }
+        }
+
+        if(config.is_enabled_soak_monitor){
+            get_soak_monitor_report(&soak_monitor, buf, sizeof(buf));
+
+            if(strlen(response) + strlen(buf) < response_len){
+                strcat(response, buf);
+            }
+        }
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_OCCUPANCY) == 0){
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_OK);
+
+        get_occupancy_report(&config.occupancy_counters,
+                             response + strlen(response),
+                             response_len - strlen(response));
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_TRAJECTORY) == 0){
+
+        mac_address = strtok_save(NULL, DELIMITER_SEMICOLON, &save_ptr);
+        start_timestamp = strtok_save(NULL, DELIMITER_SEMICOLON, &save_ptr);
+        end_timestamp = strtok_save(NULL, DELIMITER_SEMICOLON, &save_ptr);
+
+        if(mac_address == NULL || start_timestamp == NULL || 
+           end_timestamp == NULL){
+
+            sprintf(response, "%s;invalid trajectory request;", 
+                    CONTROL_RESPONSE_ERROR);
+            return E_INPUT_PARAMETER;
+        }
+
+        number_of_entries = 
+            get_object_trajectory(&config.trajectory_history,
+                                  mac_address,
+                                  strtoll(start_timestamp, NULL, 10),
+                                  strtoll(end_timestamp, NULL, 10),
+                                  trajectory_entries,
+                                  LENGTH_OF_OBJECT_TRAJECTORY);
+
+        sprintf(response, "%s;%d;", CONTROL_RESPONSE_OK, number_of_entries);
+
+        for(i = 0; i < number_of_entries; i++){
+
+            sprintf(trajectory_entry, "%s,%lld,%lld,%d,%d;",
+                    trajectory_entries[i].uuid,
+                    trajectory_entries[i].enter_timestamp_in_us,
+                    trajectory_entries[i].leave_timestamp_in_us,
+                    trajectory_entries[i].base_x,
+                    trajectory_entries[i].base_y);
+
+            if(strlen(response) + strlen(trajectory_entry) >= response_len){
+                break;
+            }
+            strcat(response, trajectory_entry);
+        }
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_FLOW_CONTROL) == 0){
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_OK);
+
+        get_flow_control_report(&config.flow_control, true,
+                                response + strlen(response),
+                                response_len - strlen(response));
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_WATERMARK) == 0){
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_OK);
+
+        get_event_watermark_report(&config.event_watermark, true,
+                                   response + strlen(response),
+                                   response_len - strlen(response));
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_PROFILE) == 0){
+
+        profile_argument = strtok_save(NULL, DELIMITER_SEMICOLON, &save_ptr);
+
+        if(profile_argument != NULL && strcmp(profile_argument, "on") == 0){
+            stage_profiler.is_enabled = true;
+        }else if(profile_argument != NULL && 
+                 strcmp(profile_argument, "off") == 0){
+            stage_profiler.is_enabled = false;
+        }
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_OK);
+
+        get_stage_profiler_report( &stage_profiler,
+                                   response + strlen(response),
+                                   response_len - strlen(response));
+
+        if(profile_argument != NULL && 
+           strcmp(profile_argument, PROFILE_REQUEST_RESET) == 0){
+            reset_stage_profiler( &stage_profiler);
+        }
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_INGEST_BENCHMARK) == 0){
+
+        /* The benchmark takes minutes, so it runs in its own thread and a 
+           request during the run shows its progress. It drops and creates 
+           its table, so it never runs on the production database. */
+        if(false == ingest_benchmark.is_running &&
+           (0 == strlen(config.ingest_benchmark_database_name) ||
+            0 == strcmp(config.ingest_benchmark_database_name, 
+                        config.database_name) ||
+            strlen(database_argument) + 
+            strlen(config.ingest_benchmark_database_name) + 
+            strlen(" dbname=") >= sizeof(conninfo))){
+
+            sprintf(response, "%s;ingest benchmark needs its own database;", 
+                    CONTROL_RESPONSE_ERROR);
+            return E_INPUT_PARAMETER;
+        }
+
+        if(false == ingest_benchmark.is_running){
+
+            /* The later dbname replaces the one of database_argument */
+            memset(conninfo, 0, sizeof(conninfo));
+            sprintf(conninfo, "%s dbname=%s", 
+                    database_argument, 
+                    config.ingest_benchmark_database_name);
+
+            memset(temp_directory, 0, sizeof(temp_directory));
+            sprintf(temp_directory, "%s/temp", 
+                    config.server_installation_path);
+
+            memset(report_path, 0, sizeof(report_path));
+            sprintf(report_path, "%s/%s", 
+                    config.server_installation_path,
+                    INGEST_BENCHMARK_REPORT_FILE);
+
+            if(WORK_SUCCESSFULLY != 
+               start_ingest_benchmark( &ingest_benchmark,
+                                       conninfo,
+                                       config.number_of_database_connection,
+                                       INGEST_BENCHMARK_ROWS_PER_CASE,
+                                       temp_directory,
+                                       report_path)){
+
+                sprintf(response, "%s;ingest benchmark failed;", 
+                        CONTROL_RESPONSE_ERROR);
+                return E_INITIALIZATION_FAIL;
+            }
+        }
+
+        sprintf(response, "%s;", CONTROL_RESPONSE_OK);
+
+        get_ingest_benchmark_report( &ingest_benchmark,
+                                     response + strlen(response),
+                                     response_len - strlen(response));
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_RING_BENCHMARK) == 0 ||
+             strcmp(request_type, CONTROL_REQUEST_FLUSH) == 0){
+
+        /* These requests take long, so they run in the job thread and the 
+           control channel keeps serving other requests */
+        return submit_control_job( &control_channel, 
+                                   request, 
+                                   response, 
+                                   response_len);
+    }
+
+    sprintf(response, "%s;unknown request;", CONTROL_RESPONSE_ERROR);
+
+    return E_INPUT_PARAMETER;
+}
+
+ErrorCode Server_process_control_job(char *request, 
+                                     char *response, 
+                                     size_t response_len){
+    char buf[CONTROL_MESSAGE_LENGTH];
+    char *save_ptr = NULL;
+    char *request_type = NULL;
+    int number_of_objects = 0;
+    int records_per_second = 0;
+
+    memset(buf, 0, sizeof(buf));
+    strncpy(buf, request, sizeof(buf) - 1);
+
+    request_type = strtok_save(buf, DELIMITER_SEMICOLON, &save_ptr);
+    if(request_type == NULL){
+        sprintf(response, "%s;empty request;", CONTROL_RESPONSE_ERROR);
+        return E_INPUT_PARAMETER;
+    }
+
+    if(strcmp(request_type, CONTROL_REQUEST_RING_BENCHMARK) == 0){
+
+        if(WORK_SUCCESSFULLY != 
+           benchmark_shared_ring(SHARED_RING_BENCHMARK_RECORDS, 
+                                 &records_per_second)){
+
+            sprintf(response, "%s;ring benchmark failed;", 
+                    CONTROL_RESPONSE_ERROR);
+            return E_INITIALIZATION_FAIL;
+        }
+
+        sprintf(response, "%s;ring_records=%d;ring_records_per_second=%d;", 
+                CONTROL_RESPONSE_OK,
+                SHARED_RING_BENCHMARK_RECORDS,
+                records_per_second);
+
+        return WORK_SUCCESSFULLY;
+
+    }else if(strcmp(request_type, CONTROL_REQUEST_FLUSH) == 0){
+
+        number_of_objects = summarize_dirty_objects();
+
+        sprintf(response, "%s;flush;summarized_objects=%d;", 
+                CONTROL_RESPONSE_OK,
+                number_of_objects);
+
+        return WORK_SUCCESSFULLY;
+    }
+
+    sprintf(response, "%s;unknown request;", CONTROL_RESPONSE_ERROR);
+
+    return E_INPUT_PARAMETER;
+}
+
+void *process_tracked_data_from_geofence_gateway(void *_buffer_node)
+{
+    BufferNode *current_node = (BufferNode *)_buffer_node;
+    long long profile_start_time = 0;
+
+    SQL_bind_dedicated_database_connection(&config.db_connection_list_head);
+
+    if(current_node -> pkt_type == time_critical_tracked_object_data){
+       
+        if(config.is_enabled_geofence_monitor){
+
+            profile_start_time = begin_profile_stage( &stage_profiler);
+
+            check_geo_fence_violations(current_node, 
+                                       &config.db_connection_list_head,
+                                       &config.geo_fence_list_head, 
+                                       &config.objects_under_geo_fence_list_head,
+                                       &config.geo_fence_violation_list_head,
+                                       config.perimeter_valid_duration_in_sec,
+                                       config.granularity_for_continuous_violations_in_sec);
+
+            end_profile_stage( &stage_profiler, 
+                               PROFILE_STAGE_GEO_FENCE, 
+                               profile_start_time);
+        }
+
+        SQL_update_object_tracking_data_with_battery_voltage(
+            &config.db_connection_list_head,
+            current_node -> content,
+            strlen(current_node -> content),
+            current_node -> API_version,
+            config.server_installation_path,
+            config.is_enabled_panic_button_monitor,
+            &config.dirty_object_set_head,
+            &config.clock_offset_list_head,
+            &object_mirror,
+            &config.event_watermark,
+            current_node -> net_address);
+        
+    }
+
+    mp_free( &node_mempool, current_node);
+
+    return (void *)NULL;
+}
+
+bool Gateway_join_request(AddressMapArray *address_map, char *address)
+{
+    int not_in_use = -1;
+    int n;
+    int answer = -1;
+
+    zlog_info(category_debug, 
+              "Enter Gateway_join_request address [%s]", address);
+
+    pthread_mutex_lock( &address_map -> list_lock);
+    /* Copy all the necessary information received from the LBeacon to the
+       address map. */
+
+    /* Find the first unused address map location and use the location to store
+       the new joined LBeacon. */
+
+    zlog_info(category_debug, "Check whether joined");
+
+    answer = is_in_Address_Map(address_map, address, 0);
+    if(answer >=0)
+    {
+        /* Need to update last request time for each gateway */
+        address_map -> address_map_list[answer].last_request_time =
+            get_cached_system_time();
+
+        pthread_mutex_unlock( &address_map -> list_lock);
+        zlog_info(category_debug, "Exist and Return");
+
+        return true;
+    }
+
+    for(n = 0 ; n < MAX_NUMBER_NODES ; n ++){
+        if(address_map -> in_use[n] == false && not_in_use == -1)
+        {
+            not_in_use = n;
+            break;
+        }
+    }
+
+    zlog_info(category_debug, "Start join...(%s)", address);
+
+    /* If still has space for the LBeacon to register */
+    if (not_in_use != -1)
+    {
+        address_map -> in_use[not_in_use] = true;
+
+        memset(address_map->address_map_list[not_in_use].net_address, 0, 
+               NETWORK_ADDR_LENGTH);
+        strncpy(address_map->address_map_list[not_in_use].net_address, 
+                address, strlen(address));
 
         pthread_mutex_unlock( &address_map -> list_lock);
 
@@ -1276,27 +3543,173 @@ void broadcast_to_gateway(AddressMapArray *address_map, char *msg, int size)
         {
             if (address_map -> in_use[current_index] == true)
             {
-                /* Add the content of the buffer node to the UDP to be sent to
-                   the server */
-                udp_addpkt( &udp_config,
-                            address_map ->
-                            address_map_list[current_index].net_address,
-                            config.send_port,
-                            msg,
-                            size);
+                /* Queue the content to be sent to the gateway */
+                Server_queue_packet(address_map ->
+                                    address_map_list[current_index].net_address,
+                                    config.send_port,
+                                    msg,
+                                    size);
             }
         }
+
+        Server_flush_packets();
     }
 
     pthread_mutex_unlock( &address_map -> list_lock);
 }
 
 
+void Server_queue_packet(char *address, 
+                         int port, 
+                         char *content, 
+                         int content_size){
+
+    switch(server_send_path){
+
+        case SERVER_SEND_PATH_IO_URING:
+            if(WORK_SUCCESSFULLY != 
+               queue_io_uring_send( &io_uring_receiver,
+                                    address,
+                                    port,
+                                    content,
+                                    content_size)){
+                zlog_error(category_debug, 
+                           "Fail to queue a packet to [%s:%d]", 
+                           address, port);
+            }
+            break;
+
+        case SERVER_SEND_PATH_RECV_PORT_RECEIVER:
+            send_time_critical_receiver_packet( &recv_port_receiver,
+                                                address,
+                                                port,
+                                                content,
+                                                content_size);
+            break;
+
+        case SERVER_SEND_PATH_SIMULATION:
+            zlog_debug(category_debug, 
+                       "simulated packet of [%d] bytes to [%s:%d]", 
+                       content_size, address, port);
+            number_of_simulated_sent_packets++;
+            break;
+
+        default:
+            udp_addpkt( &udp_config, address, port, content, content_size);
+            break;
+    }
+}
+
+
+void Server_flush_packets(){
+
+    if(SERVER_SEND_PATH_IO_URING == server_send_path){
+        flush_io_uring_sends( &io_uring_receiver);
+    }
+}
+
+
+void Server_take_warm_state_snapshot(WarmStateSnapshot *snapshot)
+{
+    int n;
+
+    memset(snapshot, 0, sizeof(WarmStateSnapshot));
+
+    pthread_mutex_lock( &Gateway_address_map.list_lock);
+
+    for(n = 0 ; n < MAX_NUMBER_NODES ; n ++)
+    {
+        if(Gateway_address_map.in_use[n] == true)
+        {
+            memcpy(snapshot->gateway_addresses[snapshot->number_of_gateways],
+                   Gateway_address_map.address_map_list[n].net_address,
+                   NETWORK_ADDR_LENGTH);
+            snapshot->number_of_gateways++;
+        }
+    }
+
+    pthread_mutex_unlock( &Gateway_address_map.list_lock);
+
+    pthread_mutex_lock( &config.event_watermark.list_lock);
+
+    snapshot->watermark = config.event_watermark.watermark;
+    memcpy(snapshot->watermark_gateways, 
+           config.event_watermark.gateways,
+           sizeof(snapshot->watermark_gateways));
+
+    pthread_mutex_unlock( &config.event_watermark.list_lock);
+}
+
+void Server_restore_warm_state_snapshot(WarmStateSnapshot *snapshot)
+{
+    int n;
+
+    for(n = 0 ; n < snapshot->number_of_gateways ; n ++)
+    {
+        snapshot->gateway_addresses[n][NETWORK_ADDR_LENGTH - 1] = '\0';
+
+        Gateway_join_request(&Gateway_address_map, 
+                             snapshot->gateway_addresses[n]);
+    }
+
+    /* The watermark never moves backwards, so windows closed by the 
+       previous process are not reopened */
+    pthread_mutex_lock( &config.event_watermark.list_lock);
+
+    if(snapshot->watermark > config.event_watermark.watermark)
+    {
+        config.event_watermark.watermark = snapshot->watermark;
+    }
+    memcpy(config.event_watermark.gateways, 
+           snapshot->watermark_gateways,
+           sizeof(config.event_watermark.gateways));
+
+    pthread_mutex_unlock( &config.event_watermark.list_lock);
+}
+
+int get_number_of_queued_buffer_nodes()
+{
+    BufferListHead *buffer_list_heads[] = {
+        &command_buffer_list_head,
+        &Geo_fence_receive_buffer_list_head,
+        &data_receive_buffer_list_head,
+        &NSI_send_buffer_list_head,
+        &NSI_receive_buffer_list_head,
+        &BHM_receive_buffer_list_head,
+        &BHM_send_buffer_list_head
+    };
+    List_Entry *current_list_entry = NULL;
+    int number_of_queued_nodes = 0;
+    int i;
+
+    for(i = 0; 
+        i < (int)(sizeof(buffer_list_heads) / sizeof(buffer_list_heads[0])); 
+        i++)
+    {
+        pthread_mutex_lock( &buffer_list_heads[i] -> list_lock);
+
+        list_for_each(current_list_entry, &buffer_list_heads[i] -> list_head)
+        {
+            number_of_queued_nodes++;
+        }
+
+        pthread_mutex_unlock( &buffer_list_heads[i] -> list_lock);
+    }
+
+    number_of_queued_nodes += 
+        get_number_of_deadline_packets( &config.deadline_scheduler);
+
+    return number_of_queued_nodes;
+}
+
+
 void *Server_process_wifi_send(void *_buffer_node)
 {
     BufferNode *current_node = (BufferNode *)_buffer_node;
     char content[WIFI_MESSAGE_LENGTH];
 
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_NORMAL_WORKER);
+
 #ifdef debugging
     zlog_info(category_debug, 
               "Start Send pkt\naddress [%s]\nport [%d]\nmsg [%s]\nsize [%d]",
@@ -1316,13 +3729,12 @@ void *Server_process_wifi_send(void *_buffer_node)
     strcpy(current_node->content, content);
     current_node -> content_size =  strlen(current_node->content);
   
-    /* Add the content of the buffer node to the UDP to be sent to the 
-       destination */
-    udp_addpkt(&udp_config, 
-               current_node -> net_address, 
-               current_node -> port,
-               current_node -> content,
-               current_node -> content_size);
+    /* Send the content of the buffer node to the destination */
+    Server_queue_packet(current_node -> net_address, 
+                        current_node -> port,
+                        current_node -> content,
+                        current_node -> content_size);
+    Server_flush_packets();
 
     mp_free( &node_mempool, current_node);
 
@@ -1332,206 +3744,449 @@ void *Server_process_wifi_send(void *_buffer_node)
 }
 
 
-void *Server_process_wifi_receive()
+void Server_enqueue_received_packet(BufferListHead *buffer_list_head,
+                                    DeadlineClass deadline_class,
+                                    BufferNode *buffer_node)
 {
-    BufferNode *new_node;
+    DeadlineRoutine routine = NULL;
+
+    /* The analytics process processes a packet before its record is 
+       committed, so no record is lost if the process stops. A simulation 
+       processes each packet before the simulated clock moves on. */
+    if(SERVER_PROCESS_ROLE_ANALYTICS == config.server_process_role ||
+       true == clock_cache.is_simulated){
+        routine = config.deadline_scheduler.queues[deadline_class].routine;
+
+        /* The routine releases the buffer node */
+        if(NULL != routine){
+            routine(buffer_node);
+        }else{
+            mp_free( &node_mempool, buffer_node);
+        }
+        return;
+    }
 
-    sPkt temppkt;
+    /* Geo-fence packets stay on their buffer list for the time-critical 
+       worker, so no deadline worker switches roles for them */
+    if(config.is_enabled_edf_scheduling &&
+       (DEADLINE_CLASS_TIME_CRITICAL != deadline_class ||
+        false == is_time_critical_worker_running)){
+        enqueue_deadline_packet( &config.deadline_scheduler,
+                                 deadline_class,
+                                 buffer_node);
+        return;
+    }
 
-    int retry_times = 0;
-    char buf[WIFI_MESSAGE_LENGTH];
-    char *saveptr = NULL;
-    char *from_direction = NULL;
-    char *request_type = NULL;
-    char *API_version = NULL;
-    char *remain_string = NULL;
+    pthread_mutex_lock( &buffer_list_head -> list_lock);
+    insert_list_tail( &buffer_node -> buffer_entry,
+                      &buffer_list_head -> list_head);
+    pthread_mutex_unlock( &buffer_list_head -> list_lock);
+}
 
+void *Server_process_deadline_worker()
+{
+    deadline_worker_routine( &config.deadline_scheduler);
 
-    while (ready_to_work == true)
-    {
-        temppkt = udp_getrecv( &udp_config);
+    return (void *)NULL;
+}
 
-        /* If there is no pkt received */
-        if(temppkt.is_null == true)
-        {
-            sleep_t(BUSY_WAITING_TIME_IN_WIFI_REXEIVE_PACKET_IN_MS);
-            continue;
-        }
+void *Server_process_time_critical_worker()
+{
+    List_Entry *current_list_entry = NULL;
+    BufferNode *current_node = NULL;
+
+    apply_thread_role(&config.thread_role_profiles, 
+                      THREAD_ROLE_TIME_CRITICAL_WORKER);
 
-        /* Allocate memory from node_mempool a buffer node for received data
-           and copy the data from Wi-Fi receive queue to the node. */
-        new_node = NULL;
+    while(true == ready_to_work){
 
-        retry_times = MEMORY_ALLOCATE_RETRIES;
-        while(retry_times --){
-            new_node = mp_alloc( &node_mempool);
+        current_node = NULL;
 
-            if(NULL != new_node)
-                break;
+        pthread_mutex_lock( &Geo_fence_receive_buffer_list_head.list_lock);
+
+        current_list_entry = Geo_fence_receive_buffer_list_head.list_head.next;
+        if(current_list_entry != 
+           &Geo_fence_receive_buffer_list_head.list_head){
+
+            current_node = ListEntry(current_list_entry,
+                                     BufferNode,
+                                     buffer_entry);
+
+            remove_list_node( &current_node -> buffer_entry);
         }
-        if(NULL == new_node){
-             zlog_info(category_debug, 
-                       "Server_process_wifi_receive (new_node) mp_alloc " \
-                       "failed, abort this data");
-             continue;
+
+        pthread_mutex_unlock( &Geo_fence_receive_buffer_list_head.list_lock);
+
+        if(NULL == current_node){
+            sleep_t(TIME_CRITICAL_WORKER_IDLE_WAITING_TIME_IN_MS);
+            continue;
         }
 
-        memset(new_node, 0, sizeof(BufferNode));
+        /* The routine releases the buffer node */
+        process_tracked_data_from_geofence_gateway(current_node);
+    }
+
+    return (void *)NULL;
+}
+
+ErrorCode Server_dispatch_received_packet(char *content, 
+                                          char *address, 
+                                          int port)
+{
+    BufferNode *new_node;
 
-        /* Initialize the entry of the buffer node */
-        init_entry( &new_node -> buffer_entry);
+    int retry_times = 0;
+    char buf[WIFI_MESSAGE_LENGTH];
+    ProtocolCursor cursor;
+    PacketHeaderFields header;
+    bool is_report_completed = false;
+    int pkt_direction = 0;
+    int pkt_type = 0;
+    long long profile_start_time = 0;
 
-        new_node -> uptime_at_receive = get_clock_time();
+    /* The ingest process answers join requests itself and appends the other 
+       packets to the shared ring unparsed */
+    if(SERVER_PROCESS_ROLE_INGEST == config.server_process_role){
 
-        memset(buf, 0, sizeof(buf));
-        strcpy(buf, temppkt.content);
+        sscanf(content, "%d;%d;", &pkt_direction, &pkt_type);
 
-        remain_string = buf;
+        if(from_gateway != pkt_direction || request_to_join != pkt_type){
 
-        from_direction = strtok_save(buf, DELIMITER_SEMICOLON, &saveptr);
-        if(from_direction == NULL)
-        {
-             mp_free( &node_mempool, new_node);
-             continue;
-        }
-        remain_string = remain_string + strlen(from_direction) + 
-                        strlen(DELIMITER_SEMICOLON);         
-        sscanf(from_direction, "%d", &new_node -> pkt_direction);
-     
-        request_type = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-        if(request_type == NULL)
-        {
-             mp_free( &node_mempool, new_node);
-             continue;
-        }
-        remain_string = remain_string + strlen(request_type) + 
-                        strlen(DELIMITER_SEMICOLON);
-        sscanf(request_type, "%d", &new_node -> pkt_type);
+            if(WORK_SUCCESSFULLY != push_shared_ring_record(&shared_ring, 
+                                                            content, 
+                                                            address, 
+                                                            port)){
 
-        API_version = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-        if(API_version == NULL)
-        {
-             mp_free( &node_mempool, new_node);
-             continue;
+                record_flow_control_allocation_failure( &config.flow_control);
+
+                zlog_info(category_debug, 
+                          "Server_dispatch_received_packet shared ring " \
+                          "full, abort this data");
+                return E_MALLOC;
+            }
+            return WORK_SUCCESSFULLY;
         }
-        remain_string = remain_string + strlen(API_version) + 
-                        strlen(DELIMITER_SEMICOLON);
-        sscanf(API_version, "%f", &new_node -> API_version);
-       
-        /* Copy the content to the buffer_node */
-        strcpy(new_node->content, remain_string);
-        zlog_debug(category_debug, "pkt_direction=[%d], pkt_type=[%d], " \
-                   "API_version=[%f]", new_node->pkt_direction, 
-                   new_node->pkt_type, new_node->API_version);
+    }
 
-        new_node -> content_size = strlen(new_node->content);
+    profile_start_time = begin_profile_stage( &stage_profiler);
 
-        new_node -> port = temppkt.port;
+    /* Allocate memory from node_mempool a buffer node for received data
+       and copy the data from Wi-Fi receive queue to the node. */
+    new_node = NULL;
 
-        memcpy(new_node -> net_address, temppkt.address,    
-               NETWORK_ADDR_LENGTH);
+    retry_times = MEMORY_ALLOCATE_RETRIES;
+    while(retry_times --){
+        new_node = mp_alloc( &node_mempool);
+
+        if(NULL != new_node)
+            break;
+    }
+    if(NULL == new_node){
+         record_flow_control_allocation_failure( &config.flow_control);
+
+         zlog_info(category_debug, 
+                   "Server_dispatch_received_packet (new_node) mp_alloc " \
+                   "failed, abort this data");
+         return E_MALLOC;
+    }
+
+    memset(new_node, 0, sizeof(BufferNode));
+
+    /* Initialize the entry of the buffer node */
+    init_entry( &new_node -> buffer_entry);
 
-        /* Insert the node to the specified buffer, and release
-           list_lock. */
+    new_node -> uptime_at_receive = get_cached_clock_time();
 
-        if (from_gateway == new_node -> pkt_direction) 
+    memset(buf, 0, sizeof(buf));
+    strncpy(buf, content, sizeof(buf) - 1);
+
+    open_protocol_cursor(&cursor, buf);
+
+    if(WORK_SUCCESSFULLY != decode_packet_header(&cursor, &header))
+    {
+         mp_free( &node_mempool, new_node);
+         return E_API_PROTOCOL_FORMAT;
+    }
+    sscanf(header.pkt_direction, "%d", &new_node -> pkt_direction);
+    sscanf(header.pkt_type, "%d", &new_node -> pkt_type);
+    sscanf(header.API_version, "%f", &new_node -> API_version);
+   
+    /* Copy the content after the header to the buffer_node */
+    strcpy(new_node->content, cursor.next);
+    zlog_debug(category_debug, "pkt_direction=[%d], pkt_type=[%d], " \
+               "API_version=[%f]", new_node->pkt_direction, 
+               new_node->pkt_type, new_node->API_version);
+
+    new_node -> content_size = strlen(new_node->content);
+
+    new_node -> port = port;
+
+    memcpy(new_node -> net_address, address,    
+           NETWORK_ADDR_LENGTH);
+
+    end_profile_stage( &stage_profiler, 
+                       PROFILE_STAGE_RECEIVE, 
+                       profile_start_time);
+
+    /* Insert the node to the specified buffer, and release
+       list_lock. */
+
+    if (from_gateway == new_node -> pkt_direction) 
+    {
+        record_flow_control_packet( &config.flow_control,
+                                    new_node -> net_address,
+                                    new_node -> pkt_type,
+                                    new_node -> uptime_at_receive);
+
+        switch (new_node -> pkt_type) 
         {
-            switch (new_node -> pkt_type) 
-            {
-                case request_to_join:
+            case request_to_join:
 #ifdef debugging
-                    display_time();
+                display_time();
 #endif
-                    zlog_info(category_debug, "Get Join request from "
-                              "Gateway");
-
-                    pthread_mutex_lock(&NSI_receive_buffer_list_head
-                                       .list_lock);
-                    insert_list_tail(&new_node -> buffer_entry,
-                                     &NSI_receive_buffer_list_head
-                                     .list_head);
-                    pthread_mutex_unlock(&NSI_receive_buffer_list_head
-                                         .list_lock);
-                    break;
+                zlog_info(category_debug, "Get Join request from "
+                          "Gateway");
+
+                Server_enqueue_received_packet(
+                    &NSI_receive_buffer_list_head,
+                    DEADLINE_CLASS_JOIN_REQUEST,
+                    new_node);
+                break;
 
-                case time_critical_tracked_object_data:
+            case time_critical_tracked_object_data:
 #ifdef debugging
-                    display_time();
+                display_time();
 #endif
-                    zlog_info(category_debug, "Get tracked object data from "
-                              "geofence Gateway");
-                 
-                    pthread_mutex_lock(&Geo_fence_receive_buffer_list_head
-                                       .list_lock);
-                    insert_list_tail(&new_node -> buffer_entry,
-                                     &Geo_fence_receive_buffer_list_head
-                                     .list_head);
-                    pthread_mutex_unlock(&Geo_fence_receive_buffer_list_head
-                                         .list_lock);
+                zlog_info(category_debug, "Get tracked object data from "
+                          "geofence Gateway");
+             
+                Server_enqueue_received_packet(
+                    &Geo_fence_receive_buffer_list_head,
+                    DEADLINE_CLASS_TIME_CRITICAL,
+                    new_node);
 
-                    break;
+                break;
 
-                case tracked_object_data:
+            case tracked_object_data:
 #ifdef debugging
-                    display_time();
+                display_time();
 #endif
-                    zlog_info(category_debug, "Get Tracked Object Data from "
-                              "normal Gateway");
-
-                    pthread_mutex_lock(&data_receive_buffer_list_head
-                                       .list_lock);
-                    insert_list_tail(&new_node -> buffer_entry, 
-                                     &data_receive_buffer_list_head
-                                     .list_head);
-                    pthread_mutex_unlock(&data_receive_buffer_list_head
-                                         .list_lock);
-                        
+                zlog_info(category_debug, "Get Tracked Object Data from "
+                          "normal Gateway");
+
+                Server_enqueue_received_packet(
+                    &data_receive_buffer_list_head,
+                    DEADLINE_CLASS_TRACKED_OBJECT_DATA,
+                    new_node);
+                    
+                break;
+
+            case FRAGMENTED_REPORT_PKT_TYPE:
+                if(WORK_SUCCESSFULLY != 
+                   add_report_fragment(&config.fragment_reassembly_head,
+                                       new_node -> net_address,
+                                       new_node -> API_version,
+                                       new_node -> content,
+                                       &is_report_completed)){
+
+                    zlog_error(category_debug, "Drop fragment from " \
+                               "Gateway [%s]", new_node -> net_address);
+                }
+
+                if(false == is_report_completed){
+                    mp_free( &node_mempool, new_node);
                     break;
+                }
 
-                case gateway_health_report:
-                case beacon_health_report:
+                /* The buffer node only tells a worker that a completed 
+                   report is waiting in the reassembly lists. Only tracked 
+                   object data may span several fragments. */
+                zlog_info(category_debug, "Get reassembled report from " \
+                          "Gateway");
+
+                Server_enqueue_received_packet(
+                    &data_receive_buffer_list_head,
+                    DEADLINE_CLASS_TRACKED_OBJECT_DATA,
+                    new_node);
+
+                break;
+
+            case gateway_health_report:
+            case beacon_health_report:
 #ifdef debugging
-                    display_time();
+                display_time();
 #endif
-                    zlog_info(category_debug, "Get Health Report from " \
-                                              "Gateway");
-
-                    pthread_mutex_lock(&BHM_receive_buffer_list_head
-                                       .list_lock);
-                    insert_list_tail(&new_node -> buffer_entry,
-                                     &BHM_receive_buffer_list_head.list_head);
-                    pthread_mutex_unlock(&BHM_receive_buffer_list_head
-                                         .list_lock);
-                    break;
-                default:
-                    mp_free( &node_mempool, new_node);
-                    break;
-            }
+                zlog_info(category_debug, "Get Health Report from " \
+                                          "Gateway");
+
+                Server_enqueue_received_packet(
+                    &BHM_receive_buffer_list_head,
+                    DEADLINE_CLASS_HEALTH_REPORT,
+                    new_node);
+                break;
+            default:
+                mp_free( &node_mempool, new_node);
+                break;
         }
-        else if(from_gui == new_node -> pkt_direction){
-            switch(new_node -> pkt_type){
-                case ipc_command:
+    }
+    else if(from_gui == new_node -> pkt_direction){
+        switch(new_node -> pkt_type){
+            case ipc_command:
 #ifdef debugging
-                    display_time();
+                display_time();
 #endif
-                    zlog_info(category_debug, "Get IPC command from " \
-                                              "GUI");
-                    pthread_mutex_lock(&command_buffer_list_head.list_lock);
-                    insert_list_tail(&new_node -> buffer_entry,
-                                     &command_buffer_list_head.list_head);
-                    pthread_mutex_unlock(&command_buffer_list_head.list_lock);
-                    break;
-                default:
-                    mp_free( &node_mempool, new_node);
-                    break;
-            }
-        }else{
-            mp_free( &node_mempool, new_node);
+                zlog_info(category_debug, "Get IPC command from " \
+                                          "GUI");
+                Server_enqueue_received_packet(
+                    &command_buffer_list_head,
+                    DEADLINE_CLASS_IPC_COMMAND,
+                    new_node);
+                break;
+            default:
+                mp_free( &node_mempool, new_node);
+                break;
+        }
+    }else{
+        mp_free( &node_mempool, new_node);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+void *Server_process_wifi_receive()
+{
+    sPkt temppkt;
+
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_RECEIVER);
+
+    while (ready_to_work == true)
+    {
+        temppkt = udp_getrecv( &udp_config);
+
+        /* If there is no pkt received */
+        if(temppkt.is_null == true)
+        {
+            sleep_t(BUSY_WAITING_TIME_IN_WIFI_REXEIVE_PACKET_IN_MS);
+            continue;
         }
+
+        Server_dispatch_received_packet(temppkt.content, 
+                                        temppkt.address, 
+                                        temppkt.port);
     }
     return (void *)NULL;
 }
 
+void *Server_process_io_uring_receive()
+{
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_RECEIVER);
+
+    run_io_uring_receiver( &io_uring_receiver);
+
+    return (void *)NULL;
+}
+
+void *Server_process_recv_port_receive()
+{
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_RECEIVER);
+
+    time_critical_receiver_routine( &recv_port_receiver);
+
+    return (void *)NULL;
+}
+
+void *Server_process_socket_handoff()
+{
+    int connection_fd = -1;
+    int drain_start_time = 0;
+
+    while (ready_to_work == true)
+    {
+        connection_fd = accept_socket_handoff( &config.socket_handoff);
+        if(connection_fd < 0)
+        {
+            continue;
+        }
+
+        Server_take_warm_state_snapshot( &warm_state_snapshot);
+
+        if(WORK_SUCCESSFULLY == send_socket_handoff( &config.socket_handoff,
+                                                     connection_fd,
+                                                     &warm_state_snapshot))
+        {
+            break;
+        }
+    }
+
+    if(ready_to_work == false)
+    {
+        return (void *)NULL;
+    }
+
+    /* The new process receives on the sockets from now on. The packets 
+       already received by this process are processed before it stops. */
+    config.socket_handoff.is_handed_off = true;
+
+    io_uring_receiver.is_stopped = true;
+    recv_port_receiver.is_stopped = true;
+    time_critical_receiver.is_stopped = true;
+
+    zlog_info(category_debug, "Sockets handed off, drain receive queues");
+
+    drain_start_time = get_cached_clock_time();
+
+    while(get_number_of_queued_buffer_nodes() > 0 &&
+          get_cached_clock_time() - drain_start_time < 
+          SOCKET_HANDOFF_DRAIN_TIMEOUT_IN_SEC)
+    {
+        sleep_t(BUSY_WAITING_TIME_IN_MS);
+    }
+
+    zlog_info(category_debug, 
+              "Stop after handoff with [%d] queued buffer nodes", 
+              get_number_of_queued_buffer_nodes());
+
+    ready_to_work = false;
+
+    return (void *)NULL;
+}
+
+void *Server_process_shared_ring_receive()
+{
+    SharedRingRecord *record = NULL;
+
+    apply_thread_role(&config.thread_role_profiles, THREAD_ROLE_RECEIVER);
+
+    while (ready_to_work == true)
+    {
+        record = peek_shared_ring_record( &shared_ring);
+
+        /* If there is no record in the ring */
+        if(NULL == record)
+        {
+            sleep_t(BUSY_WAITING_TIME_IN_WIFI_REXEIVE_PACKET_IN_MS);
+            continue;
+        }
+
+        Server_dispatch_received_packet(record -> content, 
+                                        record -> address, 
+                                        record -> port);
+
+        commit_shared_ring_record( &shared_ring);
+    }
+    return (void *)NULL;
+}
+
+void *Server_process_time_critical_receive()
+{
+    apply_thread_role(&config.thread_role_profiles, 
+                      THREAD_ROLE_TIME_CRITICAL_WORKER);
+
+    time_critical_receiver_routine( &time_critical_receiver);
+
+    return (void *)NULL;
+}
+
 
 
 ErrorCode add_notification_to_the_notification_list(
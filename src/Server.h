@@ -51,6 +51,21 @@
 #include "BeDIS.h"
 #include "SqlWrapper.h"
 #include "GeoFence.h"
+#include "CpuAffinity.h"
+#include "ControlChannel.h"
+#include "IoUringReceiver.h"
+#include "TimeCriticalReceiver.h"
+#include "FlowControl.h"
+#include "FragmentReassembly.h"
+#include "EventWatermark.h"
+#include "DeadlineScheduler.h"
+#include "SharedRing.h"
+#include "SocketHandoff.h"
+#include "StageProfiler.h"
+#include "SimulationDriver.h"
+#include "IngestBenchmark.h"
+#include "SoakMonitor.h"
+#include "ProtocolSchema.h"
 
 /* When debugging is needed */
 //#define debugging
@@ -90,6 +105,64 @@ memory pool. */
 /* The number of slots in the memory pool for notification */
 #define SLOTS_IN_MEM_POOL_NOTIFICATION 512
 
+/* The number of slots in the memory pool for objects waiting for location 
+summarization. Each object with new tracking data occupies a slot in this 
+memory pool until it is summarized. */
+#define SLOTS_IN_MEM_POOL_DIRTY_OBJECT 4096
+
+/* The number of slots in the memory pool for clock offsets. Each LBeacon 
+reporting tracking data occupies a slot in this memory pool. */
+#define SLOTS_IN_MEM_POOL_CLOCK_OFFSET 1024
+
+/* The number of slots in the memory pool for the current location of objects 
+counted in the occupancy counters. Each object in object_summary_table 
+occupies a slot in this memory pool. */
+#define SLOTS_IN_MEM_POOL_OCCUPANCY_OBJECT 8192
+
+/* The number of slots in the memory pool for occupancy counters. Each area, 
+room and object type in an area occupies a slot in this memory pool. */
+#define SLOTS_IN_MEM_POOL_OCCUPANCY_COUNTER 2048
+
+/* The number of slots in the memory pool for the trajectory of objects. Each 
+object with trajectory occupies a slot in this memory pool. */
+#define SLOTS_IN_MEM_POOL_TRAJECTORY_OBJECT 8192
+
+/* The number of slots in the memory pool for the transitions overwritten in 
+the trajectory rings and waiting to be spilled to the archive */
+#define SLOTS_IN_MEM_POOL_TRAJECTORY_SPILL 4096
+
+/* The number of slots in the memory pool for the in-memory mirror of 
+object_table. Each object in object_table occupies a slot in this memory 
+pool. */
+#define SLOTS_IN_MEM_POOL_OBJECT_MIRROR 8192
+
+/* The number of slots in the memory pool for reports being reassembled from 
+fragments. Each slot holds LENGTH_OF_REASSEMBLED_REPORT bytes of content, so 
+this memory pool is kept small. */
+#define SLOTS_IN_MEM_POOL_FRAGMENT_REASSEMBLY 64
+
+/* The number of slots in the memory pool for SQL coroutines. Each coroutine 
+carries the content of one buffer node, so this memory pool is as large as 
+the memory pool of buffer nodes. */
+#define SLOTS_IN_MEM_POOL_SQL_COROUTINE 2048
+
+/* The time in milliseconds the time-critical worker waits when no geo-fence 
+packet is queued. It is short because these packets have the tightest 
+latency budget. */
+#define TIME_CRITICAL_WORKER_IDLE_WAITING_TIME_IN_MS 1
+
+/* The socket packets to gateways are sent from */
+typedef enum _ServerSendPath{
+    /* The UDP API, which also receives recv_port */
+    SERVER_SEND_PATH_UDP_API = 0,
+    /* The socket of io_uring_receiver, in batches */
+    SERVER_SEND_PATH_IO_URING = 1,
+    /* The socket of recv_port_receiver */
+    SERVER_SEND_PATH_RECV_PORT_RECEIVER = 2,
+    /* No socket. A simulation counts the packets instead of sending them. */
+    SERVER_SEND_PATH_SIMULATION = 3
+} ServerSendPath;
+
 typedef struct {
     /* The length of the time window in which the movements of an object is 
        monitored. */
@@ -172,9 +245,19 @@ typedef struct {
     /* The number of hours in which data are kept in the database */
     int database_keep_hours;
 
+    /* The flag of archiving tracking data into local files before it is 
+       dropped from the database */
+    int is_enabled_tracking_archive;
+
     /* The number of database connection in the connection pool */
     int number_of_database_connection;
 
+    /* The maximum number of database connections owned by worker threads 
+       processing packets from gateways. These connections are not shared, so
+       the workers do not contend for the lock of the connection pool. 0 
+       disables dedicated connections. */
+    int number_of_dedicated_database_connection;
+
     /* The list head of the database connection pool */
     DBConnectionListHead db_connection_list_head;
 
@@ -197,6 +280,47 @@ typedef struct {
     and its coordinate x and y will not be updated on map. */
     int base_location_tolerance_in_millimeter;
 
+    /* The minimum time interval in milliseconds between two consecutive 
+       location summarizations. New tracking data received within this 
+       interval is summarized in the next run. */
+    int min_interval_between_location_summary_in_ms;
+
+    /* The set of objects which received new tracking data and are waiting 
+       for location summarization */
+    DirtyObjectSetHead dirty_object_set_head;
+
+    /* The list of smoothed clock offsets of LBeacons used to convert the 
+       tracking data timestamps into server time */
+    ClockOffsetListHead clock_offset_list_head;
+
+    /* The number of objects in each area, room and object type */
+    OccupancyCounters occupancy_counters;
+
+    /* The time interval in seconds between two consecutive snapshots of the 
+       occupancy counters flushed to occupancy_rollup_table. Zero disables 
+       the flush. */
+    int period_between_occupancy_rollup_in_sec;
+
+    /* The time interval in seconds between two consecutive reloads of the 
+       in-memory mirror of object_table when no change is notified. Zero 
+       disables the mirror, and the monitored objects are always checked in 
+       the database. */
+    int period_between_object_mirror_refresh_in_sec;
+
+    /* The recent LBeacon transitions of each object */
+    TrajectoryHistory trajectory_history;
+
+    /* The occupancy in percent of the receive queues at which gateways are 
+       asked to slow down, to defer non-critical packets, and at which they 
+       are allowed back to their normal rate. Zero high watermark disables 
+       flow control. */
+    int flow_control_high_watermark_in_percent;
+    int flow_control_critical_watermark_in_percent;
+    int flow_control_low_watermark_in_percent;
+
+    /* The flow control state of gateways */
+    FlowControlState flow_control;
+
     /* The flag indicating whether panic button monitor is enabled. */
     int is_enabled_panic_button_monitor;
 
@@ -241,6 +365,128 @@ typedef struct {
     /* The flag of enable sending notification alarms */
     int is_enabled_send_notification_alarm;
 
+    /* The CPU set and scheduling profile of each thread role */
+    ThreadRoleProfiles thread_role_profiles;
+
+    /* The flag of receiving gateway packets on recv_port with io_uring 
+       instead of the UDP API. It takes effect only on Linux builds with 
+       BOT_SERVER_USE_IO_URING defined, see "make IO_URING=1". */
+    int is_enabled_io_uring_receive;
+
+    /* The dedicated UDP port for time_critical_tracked_object_data from 
+       geo-fence gateways. Zero disables the dedicated port, and these 
+       packets are then received on recv_port only. */
+    int time_critical_recv_port;
+
+    /* The size in bytes of the socket receive buffer of the dedicated 
+       time-critical port */
+    int time_critical_recv_buffer_size_in_bytes;
+
+    /* The time in seconds a report split into fragments waits for its 
+       missing fragments before it is discarded */
+    int fragment_reassembly_timeout_in_sec;
+
+    /* The reports being reassembled from fragments */
+    FragmentReassemblyHead fragment_reassembly_head;
+
+    /* The time in seconds a tracking row may be older than the latest row 
+       of its gateway and still be summarized. Zero disables event-time 
+       watermarks, and the time windows of summarization end at NOW(). */
+    int event_watermark_allowed_lateness_in_sec;
+
+    /* The event-time watermark state of gateways */
+    EventWatermarkState event_watermark;
+
+    /* The flag of processing received packets in the order of their 
+       deadlines instead of by the static priority of their buffer lists */
+    int is_enabled_edf_scheduling;
+
+    /* The latency budget in seconds of each class of received packets */
+    int edf_budget_in_sec[NUMBER_OF_DEADLINE_CLASSES];
+
+    /* The queues of received packets in EDF scheduling mode */
+    DeadlineScheduler deadline_scheduler;
+
+    /* The role of this process. An ingest process and an analytics process 
+       pass packets through the shared ring named shared_ring_name. */
+    int server_process_role;
+
+    /* The name of the shared memory of the ring */
+    char shared_ring_name[LENGTH_OF_SHARED_RING_NAME];
+
+    /* The number of records in the shared ring */
+    int shared_ring_size_in_records;
+
+    /* The flag of taking over the bound sockets and the warm state from a 
+       running server process at startup, and of handing them off to the 
+       next one. It takes effect only on POSIX builds. */
+    int is_enabled_socket_handoff;
+
+    /* The path of the Unix domain socket the sockets are handed off on */
+    char socket_handoff_path[LENGTH_OF_SOCKET_HANDOFF_PATH];
+
+    /* The handoff state of this process */
+    SocketHandoff socket_handoff;
+
+    /* The flag of measuring the time spent in each processing stage at 
+       startup */
+    int is_enabled_stage_profiler;
+
+    /* The flag of replaying the simulation script on a simulated clock 
+       instead of receiving packets from gateways. The server stops when the 
+       script ends. */
+    int is_enabled_simulation;
+
+    /* The path of the simulation script */
+    char simulation_script_path[LENGTH_OF_SIMULATION_SCRIPT_PATH];
+
+    /* The simulated wall time in seconds since epoch at which the script 
+       starts. 0 starts the script at the current time. */
+    int simulation_start_time;
+
+    /* The number of simulated seconds between two consecutive runs of the 
+       periodic monitors during the simulation */
+    int simulation_step_in_sec;
+
+    /* The name of the database a simulation works on. It must differ from 
+       database_name, because the simulation writes tracking data and marks 
+       violation events. */
+    char simulation_database_name[MAXIMUM_DATABASE_INFO];
+
+    /* The path of the expected report of the simulation script. An empty 
+       path skips the comparison. */
+    char simulation_expected_report_path[LENGTH_OF_SIMULATION_SCRIPT_PATH];
+
+    /* The flag of sampling memory, queue depths and stage latencies at 
+       intervals during a long run. It also enables the stage profiler. */
+    int is_enabled_soak_monitor;
+
+    /* The interval in seconds between two samples of the soak monitor */
+    int soak_sample_interval_in_sec;
+
+    /* The file path of the samples of the soak monitor */
+    char soak_report_path[MAX_PATH];
+
+    /* The flag of replaying the simulation script in a loop on the real 
+       clock as the load of a soak run */
+    int is_enabled_soak_load;
+
+    /* The flag of running the database work of join requests and health 
+       reports as coroutines on the executor threads, instead of holding a 
+       worker thread while the statements run */
+    int is_enabled_sql_coroutines;
+
+    /* The number of executor threads of SQL coroutines */
+    int number_of_sql_coroutine_executors;
+
+    /* The number of database connections of each executor thread */
+    int sql_coroutine_connections_per_executor;
+
+    /* The name of the database the ingestion benchmark works on. It must 
+       differ from database_name, because the benchmark drops and creates 
+       its table. An empty name disables the benchmark. */
+    char ingest_benchmark_database_name[MAXIMUM_DATABASE_INFO];
+
     /* The list head of the notification list */
     struct List_Entry notification_list_head;
 
@@ -260,10 +506,24 @@ Memory_Pool notification_mempool;
 /* An array of address maps */
 AddressMapArray Gateway_address_map;
 
+/* The receiver of recv_port when socket handoff is enabled and io_uring is 
+   not used, because the socket of the UDP API cannot be handed off */
+TimeCriticalReceiver recv_port_receiver;
+
+/* The socket packets to gateways are sent from. It is always the socket 
+   receiving recv_port, so gateways see polls and replies coming from the 
+   port they send to. */
+ServerSendPath server_send_path;
+
 /* The head of a list of buffers holding message from LBeacons that are parts 
-   of GeoFences */
+   of GeoFences. It is drained by the time-critical worker rather than by 
+   the Communication Unit. */
 BufferListHead Geo_fence_receive_buffer_list_head;
 
+/* The flag indicating whether the time-critical worker drains 
+   Geo_fence_receive_buffer_list_head */
+bool is_time_critical_worker_running;
+
 /* The head of a list of command buffer nodes */
 BufferListHead command_buffer_list_head;
 
@@ -273,12 +533,31 @@ BufferListHead command_buffer_list_head;
 int last_polling_LBeacon_for_HR_time;
 int last_polling_object_tracking_time;
 
+/* The generation number of the latest location summarization batch */
+int location_summary_generation;
+
+/* The lock serializing location summarization between the summarization 
+   thread and requests from the control channel */
+pthread_mutex_t location_summary_lock;
+
+/* The number of notification alarms raised during the simulation */
+int number_of_simulated_notifications;
+
+/* The number of packets to gateways counted instead of sent during the 
+   simulation */
+int number_of_simulated_sent_packets;
+
+/* The last simulated time in seconds the movement monitor ran at */
+int last_simulated_movement_check_time;
+
 /*
   get_server_config:
 
      This function reads the specified config file line by line until the
      end of file and copies the data in each line into an element of the
-     ServerConfig struct global variable.
+     ServerConfig struct global variable. The lines are read by position, 
+     and the key of each line must match the expected key. The settings 
+     added after the first release follow the notification settings.
 
   Parameters:
      config - Server related configration settings
@@ -289,6 +568,9 @@ int last_polling_object_tracking_time;
 
      ErrorCode - WORK_SUCCESSFULLY: work successfully.
                  E_OPEN_FILE: config file  fail to open.
+                 E_INPUT_PARAMETER: a key is missing or misplaced, or a 
+                                    simulation is enabled without a 
+                                    database of its own.
  */
 
 ErrorCode get_server_config(ServerConfig *config, 
@@ -350,6 +632,102 @@ void *Server_NSI_routine(void *_buffer_node);
 
 void *Server_BHM_routine(void *_buffer_node);
 
+/*
+  Server_answer_join_request:
+
+     This function adds the gateway of a join request to the gateway 
+     address map and queues the join response in the buffer node to the NSI
+     send buffer list.
+
+  Parameters:
+
+     current_node - The pointer points to the buffer node.
+
+  Return value:
+
+     None
+
+ */
+
+void Server_answer_join_request(BufferNode *current_node);
+
+/*
+  Server_submit_NSI_coroutine:
+
+     This function replaces Server_NSI_routine when SQL coroutines are 
+     enabled. It submits the registration of the gateway and its LBeacons 
+     as a coroutine and returns at once, and the join request is answered 
+     when the coroutine ends. If the coroutine cannot be submitted, the 
+     buffer node is processed by Server_NSI_routine.
+
+  Parameters:
+
+     _buffer_node - The pointer points to the buffer node.
+
+  Return value:
+
+     None
+
+ */
+
+void *Server_submit_NSI_coroutine(void *_buffer_node);
+
+/*
+  Server_submit_BHM_coroutine:
+
+     This function replaces Server_BHM_routine when SQL coroutines are 
+     enabled. It submits the update of the health report as a coroutine and
+     returns at once. If the coroutine cannot be submitted, the buffer node 
+     is processed by Server_BHM_routine.
+
+  Parameters:
+
+     _buffer_node - The pointer points to the buffer node.
+
+  Return value:
+
+     None
+
+ */
+
+void *Server_submit_BHM_coroutine(void *_buffer_node);
+
+/*
+  Server_finish_NSI_coroutine:
+
+     This function is the continuation of the registration coroutine. It 
+     answers the join request in the argument of the coroutine.
+
+  Parameters:
+
+     co - The pointer to the finished coroutine
+
+  Return value:
+
+     None
+
+ */
+
+void Server_finish_NSI_coroutine(SqlCoroutine *co);
+
+/*
+  Server_finish_BHM_coroutine:
+
+     This function is the continuation of the health report coroutines. It
+     releases the buffer node in the argument of the coroutine.
+
+  Parameters:
+
+     co - The pointer to the finished coroutine
+
+  Return value:
+
+     None
+
+ */
+
+void Server_finish_BHM_coroutine(SqlCoroutine *co);
+
 
 /*
   Server_LBeacon_routine:
@@ -446,6 +824,105 @@ bool Gateway_join_request(AddressMapArray *address_map, char *address);
 
 void broadcast_to_gateway(AddressMapArray *address_map, char *msg, int size);
 
+/*
+  Server_queue_packet:
+
+     This function queues a packet to a gateway on the socket chosen by 
+     server_send_path. Packets queued on the io_uring receiver are sent 
+     together by Server_flush_packets.
+
+  Parameters:
+
+     address - The IPv4 address of the destination
+
+     port - The UDP port of the destination
+
+     content - The payload to send
+
+     content_size - Length in number of bytes of content
+
+  Return value:
+
+     None
+
+ */
+
+void Server_queue_packet(char *address, 
+                         int port, 
+                         char *content, 
+                         int content_size);
+
+/*
+  Server_flush_packets:
+
+     This function sends the packets queued by Server_queue_packet which are 
+     still waiting in a batch.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+
+ */
+
+void Server_flush_packets();
+
+/*
+  get_number_of_queued_buffer_nodes:
+
+     This function counts the buffer nodes waiting in the receive and send 
+     buffer lists. Each of them occupies a slot in node_mempool.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     int - The number of queued buffer nodes
+
+ */
+
+int get_number_of_queued_buffer_nodes();
+
+/*
+  Server_take_warm_state_snapshot:
+
+     This function copies the joined gateways and the event-time watermark 
+     state into the snapshot handed off to a new server process.
+
+  Parameters:
+
+     snapshot - The output warm state
+
+  Return value:
+
+     None
+ */
+
+void Server_take_warm_state_snapshot(WarmStateSnapshot *snapshot);
+
+/*
+  Server_restore_warm_state_snapshot:
+
+     This function joins the gateways in the snapshot and restores the 
+     event-time watermark state, so the server polls the gateways without 
+     waiting for them to join again.
+
+  Parameters:
+
+     snapshot - The warm state received from the previous server process
+
+  Return value:
+
+     None
+ */
+
+void Server_restore_warm_state_snapshot(WarmStateSnapshot *snapshot);
+
 
 /*
   Server_process_wifi_send:
@@ -465,6 +942,96 @@ void broadcast_to_gateway(AddressMapArray *address_map, char *msg, int size);
 void *Server_process_wifi_send(void *_buffer_node);
 
 
+/*
+  Server_dispatch_received_packet:
+
+     This function parses the header of a packet received from gateways or 
+     the GUI, copies the packet into a buffer node and pushes the node into 
+     the buffer list of its packet type.
+
+  Parameters:
+
+     content - The content of the received packet
+
+     address - The IP address of the sender
+
+     port - The port of the sender
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_MALLOC: no free buffer node in node_mempool.
+                 E_API_PROTOCOL_FORMAT: the packet header is malformed.
+ */
+
+ErrorCode Server_dispatch_received_packet(char *content, 
+                                          char *address, 
+                                          int port);
+
+
+/*
+  Server_enqueue_received_packet:
+
+     This function appends a received buffer node to its buffer list, or to 
+     the queue of its class in the deadline scheduler when EDF scheduling is 
+     enabled.
+
+  Parameters:
+
+     buffer_list_head - The buffer list of the packet
+
+     deadline_class - The class of the packet in the deadline scheduler
+
+     buffer_node - The buffer node of the packet
+
+  Return value:
+
+     None
+ */
+
+void Server_enqueue_received_packet(BufferListHead *buffer_list_head,
+                                    DeadlineClass deadline_class,
+                                    BufferNode *buffer_node);
+
+/*
+  Server_process_deadline_worker:
+
+     This function takes received packets from the deadline scheduler in the 
+     order of their deadlines and processes them until ready_to_work becomes 
+     false.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_deadline_worker();
+
+/*
+  Server_process_time_critical_worker:
+
+     This function processes the geo-fence packets queued in 
+     Geo_fence_receive_buffer_list_head until ready_to_work becomes false. 
+     It applies the time-critical worker role once on its own thread, so 
+     the worker threads of the Communication Unit and the deadline workers 
+     keep the normal worker role and never switch CPU set or scheduling 
+     policy between packets.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_time_critical_worker();
+
 /*
   Server_process_wifi_receive:
 
@@ -482,6 +1049,102 @@ void *Server_process_wifi_send(void *_buffer_node);
 
 void *Server_process_wifi_receive();
 
+/*
+  Server_process_io_uring_receive:
+
+     This function receives packets from gateways with the io_uring receiver 
+     and dispatches each of them by Server_dispatch_received_packet. It is 
+     used instead of Server_process_wifi_receive when the io_uring receiver 
+     is initialized successfully.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_io_uring_receive();
+
+/*
+  Server_process_recv_port_receive:
+
+     This function receives packets on recv_port with the socket owned by 
+     recv_port_receiver and dispatches each of them by 
+     Server_dispatch_received_packet. It is used instead of 
+     Server_process_wifi_receive when socket handoff is enabled and the 
+     io_uring receiver is not used.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_recv_port_receive();
+
+/*
+  Server_process_socket_handoff:
+
+     This function waits for a new server process on the handoff socket. 
+     When one connects, it hands off the bound sockets and the warm state, 
+     stops the receivers of this process, waits for the received packets to 
+     be processed and then stops the server.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_socket_handoff();
+
+/*
+  Server_process_shared_ring_receive:
+
+     This function consumes packets from the shared ring in the analytics 
+     process and dispatches each of them by Server_dispatch_received_packet. 
+     A record is committed only after it is processed, so the records left 
+     by a stopped analytics process are processed again after it restarts.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_shared_ring_receive();
+
+/*
+  Server_process_time_critical_receive:
+
+     This function receives packets on the dedicated time-critical port and 
+     dispatches each of them by Server_dispatch_received_packet. It runs 
+     with the time-critical worker role, so geo-fence packets do not wait 
+     behind bulk tracked object data queued on recv_port.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+ */
+
+void *Server_process_time_critical_receive();
+
 /*
   Server_summarize_location_information:
 
@@ -500,6 +1163,240 @@ void *Server_process_wifi_receive();
 
 void *Server_summarize_location_information(); 
 
+/*
+  summarize_dirty_objects:
+
+     This function summarizes the location information of all objects which
+     received new tracking data since the last summarization.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     int - The number of objects summarized
+
+ */
+
+int summarize_dirty_objects();
+
+/*
+  monitor_object_violations:
+
+     This function runs the location and movement detectors once. The 
+     movement detector runs only if its period has passed since 
+     last_monitor_movement_timestamp.
+
+  Parameters:
+
+     uptime - The current monotonic time in seconds
+
+     last_monitor_movement_timestamp - The pointer to the time the movement
+                                       detector last ran at
+
+  Return value:
+
+     None
+
+ */
+
+void monitor_object_violations(int uptime, 
+                               int *last_monitor_movement_timestamp);
+
+/*
+  collect_violation_events:
+
+     This function collects the violations of each enabled monitor type 
+     into notification_table once.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+
+ */
+
+void collect_violation_events();
+
+/*
+  Server_simulation_step:
+
+     This function runs the periodic work of the server at one step of the 
+     simulated clock. It summarizes location information, runs the 
+     detectors, collects violation events and counts the notification 
+     alarms instead of sending them to gateways.
+
+  Parameters:
+
+     simulated_time - The simulated wall time in seconds since epoch
+
+  Return value:
+
+     None
+
+ */
+
+void Server_simulation_step(int simulated_time);
+
+/*
+  Server_run_simulation:
+
+     This function replays the simulation script through the processing 
+     pipeline on a simulated clock. Packets are processed inline, so every 
+     run of the same script against the same database sees the same order 
+     of events. The server works on the database named by 
+     simulation_database_name, and packets to gateways are counted instead 
+     of sent, so a simulation never touches the production database or the 
+     network. The outcome is compared with the expected report if 
+     simulation_expected_report_path is set.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the script or the expected report cannot be 
+                              opened.
+                 E_INPUT_PARAMETER: the outcome differs from the expected 
+                                    report.
+
+ */
+
+ErrorCode Server_run_simulation();
+
+/*
+  Server_replay_soak_load:
+
+     This function is executed by the soak load thread. It replays the 
+     simulation script in a loop on the real clock through 
+     Server_dispatch_received_packet until the server stops.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     None
+
+ */
+
+void *Server_replay_soak_load();
+
+/*
+  Server_add_soak_gauges:
+
+     This function registers the queue depths and the sizes of the 
+     structures holding pool slots as gauges of the soak monitor, so a 
+     leaked slot shows as a value which keeps growing.
+
+  Parameters:
+
+     monitor - The pointer to the soak monitor
+
+  Return value:
+
+     None
+
+ */
+
+void Server_add_soak_gauges(SoakMonitor *monitor);
+
+/*
+  get_soak_queued_buffer_nodes:
+  get_soak_dirty_objects:
+  get_soak_geofence_violations:
+  get_soak_pending_fragment_reports:
+  get_soak_pending_trajectory_entries:
+  get_soak_dedicated_db_connections:
+
+     These functions return the values sampled by the soak monitor: the 
+     queued buffer nodes, the objects waiting to be summarized, the 
+     recorded geo-fence violations, the reports being reassembled, the 
+     trajectory entries waiting to be archived and the database connections
+     held by threads.
+
+  Parameters:
+
+     None
+
+  Return value:
+
+     long - The current value
+
+ */
+
+long get_soak_queued_buffer_nodes();
+long get_soak_dirty_objects();
+long get_soak_geofence_violations();
+long get_soak_pending_fragment_reports();
+long get_soak_pending_trajectory_entries();
+long get_soak_dedicated_db_connections();
+
+/*
+  Server_process_control_request:
+
+     This function processes a request received from the local control 
+     channel. The supported requests are CONTROL_REQUEST_RELOAD followed by 
+     an IPC command, CONTROL_REQUEST_STATS, CONTROL_REQUEST_FLUSH, 
+     CONTROL_REQUEST_OCCUPANCY, CONTROL_REQUEST_TRAJECTORY, 
+     CONTROL_REQUEST_FLOW_CONTROL, CONTROL_REQUEST_WATERMARK, 
+     CONTROL_REQUEST_RING_BENCHMARK, CONTROL_REQUEST_PROFILE and 
+     CONTROL_REQUEST_INGEST_BENCHMARK. CONTROL_REQUEST_FLUSH and 
+     CONTROL_REQUEST_RING_BENCHMARK are handed to the job thread of the 
+     control channel.
+
+  Parameters:
+
+     request - The request string
+
+     response - The buffer for the response string
+
+     response_len - Length in number of bytes of the response buffer
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the request is not supported.
+
+ */
+
+ErrorCode Server_process_control_request(char *request, 
+                                         char *response, 
+                                         size_t response_len);
+
+/*
+  Server_process_control_job:
+
+     This function processes a control request which takes long in the job 
+     thread of the control channel: CONTROL_REQUEST_FLUSH and 
+     CONTROL_REQUEST_RING_BENCHMARK.
+
+  Parameters:
+
+     request - The request string
+
+     response - The buffer for the response string
+
+     response_len - Length in number of bytes of the response buffer
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the request is not supported.
+
+ */
+
+ErrorCode Server_process_control_job(char *request, 
+                                     char *response, 
+                                     size_t response_len);
+
 /*
   Server_monitor_object_violations:
 
@@ -0,0 +1,553 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SharedRing.c
+
+  File Description:
+
+     This file provides APIs of a single-producer single-consumer ring of
+     received packets in shared memory. The ingest process appends packets
+     and the analytics process consumes them, so either process can be
+     restarted without losing the packets in the ring.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "SharedRing.h"
+#include "ClockCache.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+/* The ring and the number of records used by the producer thread of the 
+   benchmark */
+typedef struct {
+
+    SharedRing *ring;
+
+    int number_of_records;
+
+} SharedRingBenchmark;
+
+static unsigned long get_monotonic_time_in_ms(){
+
+#ifdef _WIN32
+    return GetTickCount();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+static void lock_shared_ring_producer(SharedRing *ring){
+
+#ifdef _WIN32
+    /* WAIT_ABANDONED also grants the mutex */
+    WaitForSingleObject(ring->producer_mutex, INFINITE);
+#else
+    /* A producer process stopped while holding the lock. The record it was 
+       writing is not published, because write_index is advanced last. */
+    if(EOWNERDEAD == pthread_mutex_lock( &ring->header->producer_lock)){
+        pthread_mutex_consistent( &ring->header->producer_lock);
+    }
+#endif
+}
+
+static void unlock_shared_ring_producer(SharedRing *ring){
+
+#ifdef _WIN32
+    ReleaseMutex(ring->producer_mutex);
+#else
+    pthread_mutex_unlock( &ring->header->producer_lock);
+#endif
+}
+
+static void initialize_shared_ring_header(SharedRing *ring,
+                                          int number_of_records){
+
+#ifndef _WIN32
+    pthread_mutexattr_t producer_lock_attr;
+#endif
+
+    ring->header->number_of_records = number_of_records;
+    ring->header->write_index = 0;
+    ring->header->read_index = 0;
+    ring->header->number_of_dropped_records = 0;
+    ring->header->consumer_heartbeat = 0;
+
+#ifndef _WIN32
+    pthread_mutexattr_init( &producer_lock_attr);
+    pthread_mutexattr_setpshared( &producer_lock_attr, 
+                                  PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust( &producer_lock_attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init( &ring->header->producer_lock, &producer_lock_attr);
+    pthread_mutexattr_destroy( &producer_lock_attr);
+#endif
+
+    /* The header must be complete before another process sees the magic */
+    SHARED_RING_MEMORY_BARRIER();
+
+    ring->header->magic = SHARED_RING_MAGIC;
+}
+
+static ErrorCode attach_shared_ring_header(SharedRing *ring,
+                                           int number_of_records){
+
+    int wait_times = SHARED_RING_INITIALIZATION_WAIT_TIMES;
+
+    /* A new shared memory is filled with zero. Only the process which 
+       swaps the magic initializes the ring. */
+    if(0 == SHARED_RING_COMPARE_AND_SWAP( &ring->header->magic, 
+                                          0, 
+                                          SHARED_RING_INITIALIZING)){
+
+        initialize_shared_ring_header(ring, number_of_records);
+
+        zlog_info(category_debug, 
+                  "shared ring [%s] initialized with [%d] records", 
+                  ring->name, number_of_records);
+
+        return WORK_SUCCESSFULLY;
+    }
+
+    while(SHARED_RING_MAGIC != ring->header->magic && 0 < wait_times--){
+        sleep_t(SHARED_RING_INITIALIZATION_WAIT_TIME_IN_MS);
+    }
+
+    SHARED_RING_MEMORY_BARRIER();
+
+    if(SHARED_RING_MAGIC != ring->header->magic){
+        zlog_error(category_debug, 
+                   "shared ring [%s] is not initialized, remove it and " \
+                   "restart the server processes", 
+                   ring->name);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    /* The ring is kept as it is, because another process may use it */
+    if(number_of_records != ring->header->number_of_records){
+        zlog_error(category_debug, 
+                   "shared ring [%s] has [%d] records but [%d] are " \
+                   "configured", 
+                   ring->name, 
+                   ring->header->number_of_records, 
+                   number_of_records);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    /* A ring created by an earlier process keeps its records, so a 
+       restarted process continues where it stopped */
+    zlog_info(category_debug, 
+              "shared ring [%s] attached with [%u] pending records", 
+              ring->name, 
+              ring->header->write_index - ring->header->read_index);
+
+    return WORK_SUCCESSFULLY;
+}
+
+static int round_up_to_power_of_two(int number){
+
+    int power = 1;
+
+    while(power < number){
+        power <<= 1;
+    }
+
+    return power;
+}
+
+ErrorCode open_shared_ring(SharedRing *ring,
+                           char *name,
+                           int number_of_records){
+
+    void *memory = NULL;
+#ifdef _WIN32
+    char mutex_name[LENGTH_OF_SHARED_RING_NAME + 
+                    sizeof(SHARED_RING_PRODUCER_MUTEX_SUFFIX)];
+#else
+    struct stat shared_memory_stat;
+#endif
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    memset(ring, 0, sizeof(SharedRing));
+
+    number_of_records = round_up_to_power_of_two(number_of_records);
+
+    ring->size = sizeof(SharedRingHeader) + 
+                 (size_t)number_of_records * sizeof(SharedRingRecord);
+
+    if(NULL == name){
+
+        ring->is_private = true;
+
+        memory = malloc(ring->size);
+        if(NULL == memory){
+            return E_MALLOC;
+        }
+        memset(memory, 0, ring->size);
+
+#ifdef _WIN32
+        ring->producer_mutex = CreateMutexA(NULL, FALSE, NULL);
+        if(NULL == ring->producer_mutex){
+            free(memory);
+            return E_MALLOC;
+        }
+#endif
+
+    }else{
+
+        strncpy(ring->name, name, sizeof(ring->name) - 1);
+
+#ifdef _WIN32
+        ring->mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, 
+                                           NULL, 
+                                           PAGE_READWRITE, 
+                                           0, 
+                                           (DWORD)ring->size, 
+                                           ring->name);
+        if(NULL == ring->mapping){
+            zlog_error(category_debug, 
+                       "CreateFileMapping [%s] failed", ring->name);
+            return E_MALLOC;
+        }
+
+        memory = MapViewOfFile(ring->mapping, 
+                               FILE_MAP_ALL_ACCESS, 
+                               0, 
+                               0, 
+                               ring->size);
+        if(NULL == memory){
+            zlog_error(category_debug, 
+                       "MapViewOfFile [%s] failed", ring->name);
+            CloseHandle(ring->mapping);
+            return E_MALLOC;
+        }
+
+        memset(mutex_name, 0, sizeof(mutex_name));
+        sprintf(mutex_name, "%s%s", 
+                ring->name, SHARED_RING_PRODUCER_MUTEX_SUFFIX);
+
+        ring->producer_mutex = CreateMutexA(NULL, FALSE, mutex_name);
+        if(NULL == ring->producer_mutex){
+            zlog_error(category_debug, 
+                       "CreateMutex [%s] failed", mutex_name);
+            UnmapViewOfFile(memory);
+            CloseHandle(ring->mapping);
+            return E_MALLOC;
+        }
+#else
+        ring->fd = shm_open(ring->name, O_CREAT | O_RDWR, 0600);
+        if(ring->fd < 0){
+            zlog_error(category_debug, 
+                       "shm_open [%s] failed errno=[%d]", ring->name, errno);
+            return E_MALLOC;
+        }
+
+        /* Resizing a ring mapped by another process would fault its 
+           accesses beyond the new end, so only a new ring is sized */
+        if(0 != fstat(ring->fd, &shared_memory_stat)){
+            zlog_error(category_debug, 
+                       "fstat [%s] failed errno=[%d]", ring->name, errno);
+            close(ring->fd);
+            return E_MALLOC;
+        }
+
+        if(0 == shared_memory_stat.st_size &&
+           0 != ftruncate(ring->fd, ring->size)){
+            zlog_error(category_debug, 
+                       "ftruncate [%s] failed errno=[%d]", ring->name, errno);
+            close(ring->fd);
+            return E_MALLOC;
+        }
+
+        if(0 != shared_memory_stat.st_size && 
+           ring->size != (size_t)shared_memory_stat.st_size){
+            zlog_error(category_debug, 
+                       "shared ring [%s] has [%ld] bytes but [%lu] are " \
+                       "configured", 
+                       ring->name, 
+                       (long)shared_memory_stat.st_size, 
+                       (unsigned long)ring->size);
+            close(ring->fd);
+            return E_INITIALIZATION_FAIL;
+        }
+
+        memory = mmap(NULL, 
+                      ring->size, 
+                      PROT_READ | PROT_WRITE, 
+                      MAP_SHARED, 
+                      ring->fd, 
+                      0);
+        if(MAP_FAILED == memory){
+            zlog_error(category_debug, 
+                       "mmap [%s] failed errno=[%d]", ring->name, errno);
+            close(ring->fd);
+            return E_MALLOC;
+        }
+#endif
+    }
+
+    ring->header = (SharedRingHeader *)memory;
+    ring->records = (SharedRingRecord *)
+        ((char *)memory + sizeof(SharedRingHeader));
+
+    if(true == ring->is_private){
+        initialize_shared_ring_header(ring, number_of_records);
+        return WORK_SUCCESSFULLY;
+    }
+
+    ret_val = attach_shared_ring_header(ring, number_of_records);
+    if(WORK_SUCCESSFULLY != ret_val){
+        close_shared_ring(ring);
+    }
+
+    return ret_val;
+}
+
+void close_shared_ring(SharedRing *ring){
+
+    if(NULL == ring->header){
+        return;
+    }
+
+#ifdef _WIN32
+    CloseHandle(ring->producer_mutex);
+#endif
+
+    /* The producer lock in shared memory is left to the other processes */
+    if(true == ring->is_private){
+#ifndef _WIN32
+        pthread_mutex_destroy( &ring->header->producer_lock);
+#endif
+        free(ring->header);
+    }else{
+#ifdef _WIN32
+        UnmapViewOfFile(ring->header);
+        CloseHandle(ring->mapping);
+#else
+        munmap(ring->header, ring->size);
+        close(ring->fd);
+#endif
+    }
+
+    ring->header = NULL;
+    ring->records = NULL;
+}
+
+ErrorCode push_shared_ring_record(SharedRing *ring,
+                                  char *content,
+                                  char *address,
+                                  int port){
+
+    SharedRingHeader *header = ring->header;
+    SharedRingRecord *record = NULL;
+    unsigned int write_index = 0;
+    int content_size = strlen(content);
+
+    lock_shared_ring_producer(ring);
+
+    write_index = header->write_index;
+
+    if(write_index - header->read_index >= 
+       (unsigned int)header->number_of_records){
+
+        header->number_of_dropped_records++;
+
+        unlock_shared_ring_producer(ring);
+        return E_MALLOC;
+    }
+
+    if(content_size >= WIFI_MESSAGE_LENGTH){
+        content_size = WIFI_MESSAGE_LENGTH - 1;
+    }
+
+    record = &ring->records[write_index & (header->number_of_records - 1)];
+
+    memset(record->address, 0, sizeof(record->address));
+    strncpy(record->address, address, sizeof(record->address) - 1);
+    record->port = port;
+    record->content_size = content_size;
+    memcpy(record->content, content, content_size);
+    record->content[content_size] = '\0';
+
+    /* The record must be complete before the consumer can see it */
+    SHARED_RING_MEMORY_BARRIER();
+
+    header->write_index = write_index + 1;
+
+    unlock_shared_ring_producer(ring);
+
+    return WORK_SUCCESSFULLY;
+}
+
+SharedRingRecord *peek_shared_ring_record(SharedRing *ring){
+
+    SharedRingHeader *header = ring->header;
+    unsigned int read_index = header->read_index;
+
+    header->consumer_heartbeat = get_cached_clock_time();
+
+    if(read_index == header->write_index){
+        return NULL;
+    }
+
+    /* The record is read only after its index is seen */
+    SHARED_RING_MEMORY_BARRIER();
+
+    return &ring->records[read_index & (header->number_of_records - 1)];
+}
+
+void commit_shared_ring_record(SharedRing *ring){
+
+    /* The record must be read before the producer can overwrite it */
+    SHARED_RING_MEMORY_BARRIER();
+
+    ring->header->read_index = ring->header->read_index + 1;
+}
+
+void get_shared_ring_report(SharedRing *ring, char *buf, size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+    SharedRingHeader *header = ring->header;
+
+    memset(report, 0, sizeof(report));
+
+    if(NULL == header){
+        sprintf(report, "shared_ring=closed;");
+    }else{
+        sprintf(report, 
+                "shared_ring_records=%u;shared_ring_capacity=%d;" \
+                "shared_ring_dropped=%u;shared_ring_consumer_idle=%d;",
+                header->write_index - header->read_index,
+                header->number_of_records,
+                header->number_of_dropped_records,
+                get_cached_clock_time() - header->consumer_heartbeat);
+    }
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
+
+static void *shared_ring_benchmark_producer(void *_benchmark){
+
+    SharedRingBenchmark *benchmark = (SharedRingBenchmark *)_benchmark;
+    char *content = "1;4;2.1;00000000000000000000000000000001;1571100000;" \
+                    "10.0.0.1;0;1;c1:00:00:00:00:01;1571100000;1571100000;" \
+                    "-60;0;3;1;0;";
+    int i = 0;
+
+    while(i < benchmark->number_of_records){
+
+        if(WORK_SUCCESSFULLY == push_shared_ring_record(benchmark->ring, 
+                                                        content, 
+                                                        "127.0.0.1", 
+                                                        0)){
+            i++;
+        }
+    }
+
+    return (void *)NULL;
+}
+
+ErrorCode benchmark_shared_ring(int number_of_records,
+                                int *records_per_second){
+
+    SharedRing ring;
+    SharedRingBenchmark benchmark;
+    SharedRingRecord *record = NULL;
+    pthread_t producer_thread;
+    unsigned long start_time = 0;
+    unsigned long elapsed_time = 0;
+    int number_of_consumed = 0;
+    int checksum = 0;
+
+    *records_per_second = 0;
+
+    if(WORK_SUCCESSFULLY != open_shared_ring(&ring, 
+                                             NULL, 
+                                             SHARED_RING_BENCHMARK_CAPACITY)){
+        return E_MALLOC;
+    }
+
+    benchmark.ring = &ring;
+    benchmark.number_of_records = number_of_records;
+
+    start_time = get_monotonic_time_in_ms();
+
+    if(WORK_SUCCESSFULLY != startThread(&producer_thread, 
+                                        shared_ring_benchmark_producer, 
+                                        &benchmark)){
+        close_shared_ring(&ring);
+        return E_INITIALIZATION_FAIL;
+    }
+
+    /* The consumer reads each record as the analytics process does, so 
+       the copy out of the ring is included in the measurement */
+    while(number_of_consumed < number_of_records){
+
+        record = peek_shared_ring_record(&ring);
+        if(NULL == record){
+            continue;
+        }
+
+        checksum += record->content_size;
+
+        commit_shared_ring_record(&ring);
+        number_of_consumed++;
+    }
+
+    elapsed_time = get_monotonic_time_in_ms() - start_time;
+
+    pthread_join(producer_thread, NULL);
+
+    close_shared_ring(&ring);
+
+    if(0 == elapsed_time){
+        elapsed_time = 1;
+    }
+
+    *records_per_second = (int)((double)number_of_consumed * 1000 / 
+                                elapsed_time);
+
+    zlog_info(category_debug, 
+              "shared ring benchmark [%d] records [%lu] ms checksum [%d]", 
+              number_of_consumed, elapsed_time, checksum);
+
+    return WORK_SUCCESSFULLY;
+}
@@ -0,0 +1,344 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SharedRing.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in SharedRing.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include "BeDIS.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+/* The value in the header of an initialized ring */
+#define SHARED_RING_MAGIC 0x42525247
+
+/* The value in the header of a ring being initialized by one process */
+#define SHARED_RING_INITIALIZING 0x42525249
+
+/* The number of times and the time in milliseconds a process waits for 
+another process to finish initializing a new ring */
+#define SHARED_RING_INITIALIZATION_WAIT_TIMES 100
+#define SHARED_RING_INITIALIZATION_WAIT_TIME_IN_MS 10
+
+/* The suffix of the name of the named mutex serializing the producers of a 
+ring on Windows */
+#define SHARED_RING_PRODUCER_MUTEX_SUFFIX "_producer"
+
+/* Maximum length in bytes of the name of a ring */
+#define LENGTH_OF_SHARED_RING_NAME 64
+
+/* Number of records pushed by the ring benchmark */
+#define SHARED_RING_BENCHMARK_RECORDS 200000
+
+/* Number of records in the ring used by the ring benchmark */
+#define SHARED_RING_BENCHMARK_CAPACITY 4096
+
+/* The order of memory accesses to the ring must be kept across processes */
+#ifdef _WIN32
+#define SHARED_RING_MEMORY_BARRIER() MemoryBarrier()
+#else
+#define SHARED_RING_MEMORY_BARRIER() __sync_synchronize()
+#endif
+
+/* Exactly one of the processes opening a new ring initializes it */
+#ifdef _WIN32
+#define SHARED_RING_COMPARE_AND_SWAP(value, old_value, new_value) \
+    InterlockedCompareExchange((volatile LONG *)(value), \
+                               (new_value), (old_value))
+#else
+#define SHARED_RING_COMPARE_AND_SWAP(value, old_value, new_value) \
+    __sync_val_compare_and_swap((value), (old_value), (new_value))
+#endif
+
+/* The role of a server process */
+typedef enum _ServerProcessRole{
+    /* One process receives and analyzes packets */
+    SERVER_PROCESS_ROLE_ALL = 0,
+    /* The process receives packets, answers join requests and appends the 
+       other packets to the shared ring */
+    SERVER_PROCESS_ROLE_INGEST = 1,
+    /* The process consumes packets from the shared ring and analyzes 
+       them */
+    SERVER_PROCESS_ROLE_ANALYTICS = 2,
+} ServerProcessRole;
+
+typedef struct {
+
+    /* The network address and port the packet was received from */
+    char address[NETWORK_ADDR_LENGTH];
+    int port;
+
+    int content_size;
+
+    char content[WIFI_MESSAGE_LENGTH];
+
+} SharedRingRecord;
+
+/* The header at the beginning of the shared memory. The indexes only grow 
+and wrap around at the range of unsigned int, so the number of records must 
+be a power of two. */
+typedef struct {
+
+    /* SHARED_RING_MAGIC once the ring is initialized. A process opening a 
+       new ring swaps it from zero to SHARED_RING_INITIALIZING, so a ring 
+       is never cleared while another process uses it. */
+    volatile int magic;
+
+    int number_of_records;
+
+#ifndef _WIN32
+    /* The lock serializing the producer threads of all processes. It is 
+       process-shared and robust, so a producer process which stops while 
+       holding it does not block the others. */
+    pthread_mutex_t producer_lock;
+#endif
+
+    /* The index of the next record to be written. Producers advance it 
+       one at a time under the producer lock. */
+    volatile unsigned int write_index;
+
+    /* The index of the next record to be consumed. Only the consumer 
+       advances it, after the record is processed. */
+    volatile unsigned int read_index;
+
+    /* The number of records dropped because the ring was full */
+    volatile unsigned int number_of_dropped_records;
+
+    /* The time the consumer last polled the ring */
+    volatile int consumer_heartbeat;
+
+} SharedRingHeader;
+
+typedef struct {
+
+    char name[LENGTH_OF_SHARED_RING_NAME];
+
+    /* The flag indicating whether the ring is in private memory of this 
+       process instead of shared memory */
+    bool is_private;
+
+    size_t size;
+
+    SharedRingHeader *header;
+
+    SharedRingRecord *records;
+
+#ifdef _WIN32
+    HANDLE mapping;
+
+    /* The named mutex serializing the producer threads of all processes. 
+       A record must be written and published by one thread before another 
+       thread reserves the next slot. */
+    HANDLE producer_mutex;
+#else
+    int fd;
+#endif
+
+} SharedRing;
+
+/* global variables */
+
+/* The ring between the ingest process and the analytics process */
+SharedRing shared_ring;
+
+/*
+  open_shared_ring:
+
+     This function maps the shared ring with the specified name, creating it 
+     if it does not exist. The records already in an existing ring are kept.
+     When several processes open a new ring together, one initializes it 
+     and the others wait for it. An existing ring of another number of 
+     records is not attached.
+
+  Parameters:
+
+     ring - The pointer to the ring
+
+     name - The name of the shared memory. NULL places the ring in private 
+            memory of this process.
+
+     number_of_records - The number of records in the ring. It is rounded 
+                         up to a power of two.
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_MALLOC: the shared memory cannot be created or mapped.
+                 E_INITIALIZATION_FAIL: the existing ring has another number
+                                        of records or is not initialized.
+
+ */
+
+ErrorCode open_shared_ring(SharedRing *ring,
+                           char *name,
+                           int number_of_records);
+
+/*
+  close_shared_ring:
+
+     This function unmaps the ring. The shared memory is not removed, so the 
+     records survive a restart of either process.
+
+  Parameters:
+
+     ring - The pointer to the ring
+
+  Return value:
+
+     None
+
+ */
+
+void close_shared_ring(SharedRing *ring);
+
+/*
+  push_shared_ring_record:
+
+     This function appends a packet to the ring. It may be called from any 
+     number of threads of any number of producer processes, for example 
+     the old and the new ingest process during a socket handoff.
+
+  Parameters:
+
+     ring - The pointer to the ring
+
+     content - The content of the packet
+
+     address - The network address the packet was received from
+
+     port - The port the packet was received from
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_MALLOC: the ring is full and the packet is dropped.
+
+ */
+
+ErrorCode push_shared_ring_record(SharedRing *ring,
+                                  char *content,
+                                  char *address,
+                                  int port);
+
+/*
+  peek_shared_ring_record:
+
+     This function returns the oldest record in the ring without removing 
+     it. It is called by the consumer only.
+
+  Parameters:
+
+     ring - The pointer to the ring
+
+  Return value:
+
+     SharedRingRecord * - The oldest record, or NULL if the ring is empty
+
+ */
+
+SharedRingRecord *peek_shared_ring_record(SharedRing *ring);
+
+/*
+  commit_shared_ring_record:
+
+     This function removes the record returned by peek_shared_ring_record 
+     after it is processed. A record which is not committed is returned 
+     again after the consumer restarts.
+
+  Parameters:
+
+     ring - The pointer to the ring
+
+  Return value:
+
+     None
+
+ */
+
+void commit_shared_ring_record(SharedRing *ring);
+
+/*
+  get_shared_ring_report:
+
+     This function writes the occupancy and counters of the ring into buf.
+
+  Parameters:
+
+     ring - The pointer to the ring
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_shared_ring_report(SharedRing *ring, char *buf, size_t buf_len);
+
+/*
+  benchmark_shared_ring:
+
+     This function measures the throughput of a ring in private memory with 
+     a producer thread and a consumer in the calling thread.
+
+  Parameters:
+
+     number_of_records - The number of records passed through the ring
+
+     records_per_second - The output throughput of the ring
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_MALLOC: the ring cannot be allocated.
+                 E_INITIALIZATION_FAIL: the producer thread cannot be
+                                        started.
+
+ */
+
+ErrorCode benchmark_shared_ring(int number_of_records,
+                                int *records_per_second);
+
+#endif
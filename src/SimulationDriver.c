@@ -0,0 +1,426 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SimulationDriver.c
+
+  File Description:
+
+     This file provides APIs to replay a scripted stream of gateway packets
+     against a simulated clock, so the monitor and violation pipeline can be
+     exercised deterministically and faster than real time.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "SimulationDriver.h"
+
+static unsigned long get_monotonic_time_in_ms(){
+
+#ifdef _WIN32
+    return GetTickCount();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (unsigned long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+static void advance_simulation_to(SimulationDriver *driver, int offset){
+
+    int target_time = driver->start_time + offset;
+    int seconds = 0;
+
+    while(get_cached_system_time() < target_time){
+
+        seconds = target_time - get_cached_system_time();
+        if(seconds > driver->step_in_sec){
+            seconds = driver->step_in_sec;
+        }
+
+        advance_simulated_clock(seconds);
+        driver->number_of_steps++;
+
+        if(NULL != driver->step_routine){
+            driver->step_routine(get_cached_system_time());
+        }
+    }
+
+    driver->simulated_duration_in_sec = 
+        get_cached_system_time() - driver->start_time;
+}
+
+static void fill_simulated_time(char *packet, char *content, size_t len){
+
+    char time_string[LENGTH_OF_EPOCH_TIME_STRING];
+    char *placeholder = NULL;
+    size_t used_len = 0;
+    size_t prefix_len = 0;
+
+    memset(time_string, 0, sizeof(time_string));
+    sprintf(time_string, "%d", get_cached_system_time());
+
+    memset(packet, 0, len);
+
+    while(NULL != (placeholder = strstr(content, 
+                                        SIMULATION_TIME_PLACEHOLDER))){
+
+        prefix_len = placeholder - content;
+
+        if(used_len + prefix_len + strlen(time_string) >= len){
+            return;
+        }
+
+        strncat(packet, content, prefix_len);
+        strcat(packet, time_string);
+        used_len += prefix_len + strlen(time_string);
+
+        content = placeholder + strlen(SIMULATION_TIME_PLACEHOLDER);
+    }
+
+    strncat(packet, content, len - used_len - 1);
+}
+
+/* Splits a line of the script in place. Returns false for blank and 
+   comment lines. */
+static bool split_simulation_line(char *line, 
+                                  int *offset, 
+                                  char **address, 
+                                  char **content){
+
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if(strlen(line) == 0 || SIMULATION_SCRIPT_COMMENT == line[0]){
+        return false;
+    }
+
+    /* The packet itself is delimited by semicolons, so only the offset and 
+       the address are split off the line */
+    *address = NULL;
+    *content = NULL;
+
+    *address = strchr(line, DELIMITER_SEMICOLON[0]);
+    if(NULL != *address){
+        **address = '\0';
+        (*address)++;
+
+        *content = strchr(*address, DELIMITER_SEMICOLON[0]);
+        if(NULL != *content){
+            **content = '\0';
+            (*content)++;
+        }
+    }
+
+    *offset = atoi(line);
+
+    return true;
+}
+
+static void deliver_simulation_packet(SimulationDriver *driver,
+                                      char *address,
+                                      char *content){
+
+    char packet[WIFI_MESSAGE_LENGTH];
+
+    if(strlen(address) == 0 || NULL == content || strlen(content) == 0){
+        driver->number_of_malformed_lines++;
+        return;
+    }
+
+    fill_simulated_time(packet, content, sizeof(packet));
+
+    if(WORK_SUCCESSFULLY != driver->handler(packet, 
+                                            address, 
+                                            SIMULATION_GATEWAY_PORT)){
+        driver->number_of_rejected_packets++;
+    }
+    driver->number_of_packets++;
+}
+
+void init_simulation_driver(SimulationDriver *driver,
+                            int start_time,
+                            int step_in_sec,
+                            ReceivedPacketHandler handler,
+                            SimulationStepRoutine step_routine){
+
+    memset(driver, 0, sizeof(SimulationDriver));
+
+    driver->start_time = start_time;
+    driver->step_in_sec = (step_in_sec > 0) ? step_in_sec : 1;
+    driver->handler = handler;
+    driver->step_routine = step_routine;
+}
+
+ErrorCode run_simulation_script(SimulationDriver *driver, char *script_path){
+
+    FILE *file = NULL;
+    char line[WIFI_MESSAGE_LENGTH];
+    char *address = NULL;
+    char *content = NULL;
+    int offset = 0;
+    int last_offset = 0;
+    unsigned long start_time_in_ms = 0;
+
+    file = fopen(script_path, "r");
+    if(NULL == file){
+        zlog_error(category_debug, "cannot open simulation script %s", 
+                   script_path);
+        return E_OPEN_FILE;
+    }
+
+    driver->number_of_packets = 0;
+    driver->number_of_rejected_packets = 0;
+    driver->number_of_malformed_lines = 0;
+    driver->number_of_steps = 0;
+    driver->number_of_loops = 0;
+    driver->simulated_duration_in_sec = 0;
+
+    start_time_in_ms = get_monotonic_time_in_ms();
+
+    set_simulated_clock(driver->start_time);
+
+    memset(line, 0, sizeof(line));
+
+    while(NULL != fgets(line, sizeof(line), file)){
+
+        if(false == split_simulation_line(line, &offset, &address, &content)){
+            continue;
+        }
+
+        if(offset < last_offset){
+            zlog_error(category_debug, 
+                       "simulation script offset [%d] goes backward, " \
+                       "skip this line", offset);
+            driver->number_of_malformed_lines++;
+            continue;
+        }
+        last_offset = offset;
+
+        advance_simulation_to(driver, offset);
+
+        if(NULL == address){
+            continue;
+        }
+
+        deliver_simulation_packet(driver, address, content);
+    }
+
+    fclose(file);
+
+    /* Let the periodic work observe the state after the last packet */
+    advance_simulation_to(driver, last_offset + driver->step_in_sec);
+
+    stop_simulated_clock();
+
+    driver->elapsed_time_in_ms = get_monotonic_time_in_ms() - 
+                                 start_time_in_ms;
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode replay_simulation_script(SimulationDriver *driver, 
+                                   char *script_path){
+
+    FILE *file = NULL;
+    char line[WIFI_MESSAGE_LENGTH];
+    char *address = NULL;
+    char *content = NULL;
+    int offset = 0;
+    int last_offset = 0;
+    int number_of_lines_in_loop = 0;
+    unsigned long start_time_in_ms = 0;
+    unsigned long loop_start_time_in_ms = 0;
+
+    file = fopen(script_path, "r");
+    if(NULL == file){
+        zlog_error(category_debug, "cannot open simulation script %s", 
+                   script_path);
+        return E_OPEN_FILE;
+    }
+
+    driver->number_of_packets = 0;
+    driver->number_of_rejected_packets = 0;
+    driver->number_of_malformed_lines = 0;
+    driver->number_of_steps = 0;
+    driver->number_of_loops = 0;
+    driver->simulated_duration_in_sec = 0;
+
+    start_time_in_ms = get_monotonic_time_in_ms();
+    loop_start_time_in_ms = start_time_in_ms;
+
+    memset(line, 0, sizeof(line));
+
+    while(true == ready_to_work){
+
+        if(NULL == fgets(line, sizeof(line), file)){
+
+            if(0 == number_of_lines_in_loop){
+                zlog_error(category_debug, 
+                           "simulation script %s has no line to replay", 
+                           script_path);
+                break;
+            }
+
+            /* The next loop starts one step after the last line */
+            loop_start_time_in_ms += 
+                (unsigned long)(last_offset + driver->step_in_sec) * 1000;
+            last_offset = 0;
+            number_of_lines_in_loop = 0;
+            driver->number_of_loops++;
+
+            rewind(file);
+            continue;
+        }
+
+        if(false == split_simulation_line(line, &offset, &address, &content)){
+            continue;
+        }
+
+        if(offset < last_offset){
+            driver->number_of_malformed_lines++;
+            continue;
+        }
+        last_offset = offset;
+        number_of_lines_in_loop++;
+
+        /* Wait in short sleeps, so the replay stops with the server */
+        while(true == ready_to_work &&
+              get_monotonic_time_in_ms() - loop_start_time_in_ms < 
+              (unsigned long)offset * 1000){
+            sleep_t(BUSY_WAITING_TIME_IN_MS);
+        }
+
+        if(NULL == address){
+            continue;
+        }
+
+        deliver_simulation_packet(driver, address, content);
+    }
+
+    fclose(file);
+
+    driver->elapsed_time_in_ms = get_monotonic_time_in_ms() - 
+                                 start_time_in_ms;
+
+    return WORK_SUCCESSFULLY;
+}
+
+void get_simulation_report(SimulationDriver *driver, 
+                           char *buf, 
+                           size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+    unsigned long packets_per_sec = 0;
+
+    if(driver->elapsed_time_in_ms > 0){
+        packets_per_sec = (unsigned long)driver->number_of_packets * 1000 / 
+                          driver->elapsed_time_in_ms;
+    }
+
+    memset(report, 0, sizeof(report));
+
+    sprintf(report, 
+            "simulation_packets=%d;simulation_rejected=%d;" \
+            "simulation_malformed=%d;simulation_steps=%d;" \
+            "simulation_loops=%d;" \
+            "simulation_duration_in_sec=%d;simulation_elapsed_ms=%lu;" \
+            "simulation_packets_per_sec=%lu;",
+            driver->number_of_packets,
+            driver->number_of_rejected_packets,
+            driver->number_of_malformed_lines,
+            driver->number_of_steps,
+            driver->number_of_loops,
+            driver->simulated_duration_in_sec,
+            driver->elapsed_time_in_ms,
+            packets_per_sec);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
+
+ErrorCode check_simulation_outcome(SimulationDriver *driver, 
+                                   char *expected_report_path){
+
+    FILE *file = NULL;
+    char line[CONFIG_BUFFER_SIZE];
+    char outcome[CONFIG_BUFFER_SIZE];
+    bool is_expected_report_found = false;
+
+    file = fopen(expected_report_path, "r");
+    if(NULL == file){
+        zlog_error(category_debug, "cannot open expected report %s", 
+                   expected_report_path);
+        return E_OPEN_FILE;
+    }
+
+    memset(line, 0, sizeof(line));
+
+    while(NULL != fgets(line, sizeof(line), file)){
+
+        line[strcspn(line, "\r\n")] = '\0';
+
+        if(strlen(line) > 0 && SIMULATION_SCRIPT_COMMENT != line[0]){
+            is_expected_report_found = true;
+            break;
+        }
+    }
+
+    fclose(file);
+
+    if(false == is_expected_report_found){
+        memset(line, 0, sizeof(line));
+    }
+
+    memset(outcome, 0, sizeof(outcome));
+
+    sprintf(outcome, 
+            "simulation_packets=%d;simulation_rejected=%d;" \
+            "simulation_malformed=%d;simulation_steps=%d;" \
+            "simulation_duration_in_sec=%d;",
+            driver->number_of_packets,
+            driver->number_of_rejected_packets,
+            driver->number_of_malformed_lines,
+            driver->number_of_steps,
+            driver->simulated_duration_in_sec);
+
+    if(0 != strcmp(outcome, line)){
+        zlog_error(category_debug, 
+                   "simulation outcome [%s] differs from expected report " \
+                   "[%s]", outcome, line);
+        return E_INPUT_PARAMETER;
+    }
+
+    zlog_info(category_debug, "simulation outcome matches %s", 
+              expected_report_path);
+
+    return WORK_SUCCESSFULLY;
+}
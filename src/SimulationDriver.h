@@ -0,0 +1,228 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SimulationDriver.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in SimulationDriver.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef SIMULATION_DRIVER_H
+#define SIMULATION_DRIVER_H
+
+#include "BeDIS.h"
+#include "ClockCache.h"
+#include "IoUringReceiver.h"
+
+/* Length of the path of the simulation script in bytes */
+#define LENGTH_OF_SIMULATION_SCRIPT_PATH 256
+
+/* The character starting a comment line in the simulation script */
+#define SIMULATION_SCRIPT_COMMENT '#'
+
+/* The placeholder in a scripted packet which is replaced by the simulated 
+wall time in seconds since epoch when the packet is delivered */
+#define SIMULATION_TIME_PLACEHOLDER "$T"
+
+/* Length of the decimal string of a time in seconds since epoch in bytes */
+#define LENGTH_OF_EPOCH_TIME_STRING 16
+
+/* The UDP port reported as the source port of scripted packets */
+#define SIMULATION_GATEWAY_PORT 0
+
+/* The function to run the periodic work of the server at each step of the 
+simulated clock */
+typedef void (*SimulationStepRoutine)(int simulated_time);
+
+typedef struct {
+
+    /* The simulated wall time in seconds since epoch at offset 0 of the 
+       script */
+    int start_time;
+
+    /* The number of simulated seconds between two consecutive steps */
+    int step_in_sec;
+
+    /* The function to parse and dispatch each scripted packet */
+    ReceivedPacketHandler handler;
+
+    /* The function to run at each step of the simulated clock */
+    SimulationStepRoutine step_routine;
+
+    /* The counters of the last run */
+    int number_of_packets;
+    int number_of_rejected_packets;
+    int number_of_malformed_lines;
+    int number_of_steps;
+    int number_of_loops;
+    int simulated_duration_in_sec;
+    unsigned long elapsed_time_in_ms;
+
+} SimulationDriver;
+
+/*
+  init_simulation_driver:
+
+     This function initializes the driver of a simulation run.
+
+  Parameters:
+
+     driver - The pointer to the driver
+
+     start_time - The simulated wall time in seconds since epoch at offset 0
+                  of the script
+
+     step_in_sec - The number of simulated seconds between two consecutive 
+                   steps. It is at least 1.
+
+     handler - The function to parse and dispatch each scripted packet
+
+     step_routine - The function to run at each step of the simulated clock
+
+  Return value:
+
+     None
+
+ */
+
+void init_simulation_driver(SimulationDriver *driver,
+                            int start_time,
+                            int step_in_sec,
+                            ReceivedPacketHandler handler,
+                            SimulationStepRoutine step_routine);
+
+/*
+  run_simulation_script:
+
+     This function replays the script on the simulated clock. Each line of 
+     the script is either offset_in_sec;gateway_address;packet, which 
+     delivers the packet at the offset, or offset_in_sec alone, which only 
+     advances the clock. Offsets are in seconds from the start time and must 
+     not decrease. Before a line takes effect, the clock advances step by 
+     step and the step routine runs at each step, so the periodic work sees 
+     the same sequence of times in every run. The clock is reattached to 
+     the real clocks when the script ends.
+
+  Parameters:
+
+     driver - The pointer to the driver
+
+     script_path - The path of the script
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the script cannot be opened.
+
+ */
+
+ErrorCode run_simulation_script(SimulationDriver *driver, char *script_path);
+
+/*
+  replay_simulation_script:
+
+     This function replays the script on the real clock in a loop until the
+     server stops. Each packet is delivered when its offset has passed since
+     the start of the loop, and the next loop starts one step after the last
+     line. The step routine is not called, because the periodic work runs 
+     in its own threads. It is used as the load of a soak run.
+
+  Parameters:
+
+     driver - The pointer to the driver
+
+     script_path - The path of the script
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the script cannot be opened.
+
+ */
+
+ErrorCode replay_simulation_script(SimulationDriver *driver, 
+                                   char *script_path);
+
+/*
+  get_simulation_report:
+
+     This function writes the counters of the last run into buf.
+
+  Parameters:
+
+     driver - The pointer to the driver
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_simulation_report(SimulationDriver *driver, 
+                           char *buf, 
+                           size_t buf_len);
+
+/*
+  check_simulation_outcome:
+
+     This function compares the outcome of the last run with the expected 
+     report. The outcome only holds the counters which do not depend on the 
+     speed of the host: the packets, the rejected packets, the malformed 
+     lines, the steps and the simulated duration. The expected report is 
+     the first line of the file which is neither blank nor a comment.
+
+  Parameters:
+
+     driver - The pointer to the driver
+
+     expected_report_path - The path of the expected report
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: the outcome matches the expected report.
+                 E_OPEN_FILE: the expected report cannot be opened.
+                 E_INPUT_PARAMETER: the outcome differs from the expected 
+                                    report.
+
+ */
+
+ErrorCode check_simulation_outcome(SimulationDriver *driver, 
+                                   char *expected_report_path);
+
+#endif
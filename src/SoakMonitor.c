@@ -0,0 +1,432 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SoakMonitor.c
+
+  File Description:
+
+     This file provides APIs to sample the memory, queue depths and stage
+     latencies of a long-running server and to flag the values which keep
+     growing.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "SoakMonitor.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+static long get_resident_memory_in_kb(){
+
+#ifdef _WIN32
+    return -1;
+#else
+    FILE *file = NULL;
+    long size_in_pages = 0;
+    long resident_in_pages = 0;
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    if(page_size <= 0){
+        return -1;
+    }
+
+    file = fopen("/proc/self/statm", "r");
+    if(NULL == file){
+        return -1;
+    }
+
+    if(2 != fscanf(file, "%ld %ld", &size_in_pages, &resident_in_pages)){
+        fclose(file);
+        return -1;
+    }
+    fclose(file);
+
+    return resident_in_pages * (page_size / 1024);
+#endif
+}
+
+/* Adds a sample to the tracker. Returns true when the sample completes a 
+   window which makes the value drifting. */
+static bool add_soak_drift_sample(SoakDriftTracker *tracker, long value){
+
+    bool was_drifting = tracker->is_drifting;
+    int window = 0;
+    int previous_window = 0;
+    int i;
+
+    /* The value is not available */
+    if(value < 0){
+        return false;
+    }
+
+    if(0 == tracker->number_of_samples_in_window ||
+       value < tracker->window_minimum){
+        tracker->window_minimum = value;
+    }
+    tracker->number_of_samples_in_window++;
+
+    if(tracker->number_of_samples_in_window < 
+       SOAK_MONITOR_SAMPLES_PER_WINDOW){
+        return false;
+    }
+
+    /* Keep the minimum of the completed window in place of the oldest one 
+       once the ring is full */
+    if(tracker->number_of_windows < SOAK_MONITOR_NUMBER_OF_WINDOWS){
+        window = (tracker->oldest_window + tracker->number_of_windows) % 
+                 SOAK_MONITOR_NUMBER_OF_WINDOWS;
+        tracker->number_of_windows++;
+    }else{
+        window = tracker->oldest_window;
+        tracker->oldest_window = (tracker->oldest_window + 1) % 
+                                 SOAK_MONITOR_NUMBER_OF_WINDOWS;
+    }
+    tracker->window_minimums[window] = tracker->window_minimum;
+    tracker->number_of_samples_in_window = 0;
+
+    tracker->is_drifting = false;
+
+    if(tracker->number_of_windows == SOAK_MONITOR_NUMBER_OF_WINDOWS){
+
+        tracker->is_drifting = true;
+
+        for(i = 1; i < SOAK_MONITOR_NUMBER_OF_WINDOWS; i++){
+
+            window = (tracker->oldest_window + i) % 
+                     SOAK_MONITOR_NUMBER_OF_WINDOWS;
+            previous_window = (window + SOAK_MONITOR_NUMBER_OF_WINDOWS - 1) %
+                              SOAK_MONITOR_NUMBER_OF_WINDOWS;
+
+            if(tracker->window_minimums[window] <= 
+               tracker->window_minimums[previous_window]){
+                tracker->is_drifting = false;
+                break;
+            }
+        }
+    }
+
+    return (false == was_drifting && true == tracker->is_drifting);
+}
+
+/* Returns the upper bound in microseconds of the histogram bucket holding 
+   the percentile, or -1 if the stage has no sample */
+static long get_stage_percentile_in_us(ProfileStageCounters *counters, 
+                                       int percentile){
+
+    unsigned long long number_of_samples = 0;
+    unsigned long long rank = 0;
+    unsigned long long count = 0;
+    int i;
+
+    for(i = 0; i < NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS; i++){
+        number_of_samples += counters->histogram[i];
+    }
+
+    if(0 == number_of_samples){
+        return -1;
+    }
+
+    rank = (number_of_samples * percentile + 99) / 100;
+
+    for(i = 0; i < NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS - 1; i++){
+        count += counters->histogram[i];
+        if(count >= rank){
+            break;
+        }
+    }
+
+    return (long)(((unsigned long long)1 << (i + 1)) / 1000);
+}
+
+/* Writes the counters of a stage since the last sample into interval */
+static void get_stage_interval_counters(SoakMonitor *monitor, 
+                                        ProfileStage stage,
+                                        ProfileStageCounters *interval){
+
+    ProfileStageCounters total;
+    ProfileStageCounters *last = &monitor->last_stage_counters[stage];
+    int i;
+
+    get_profile_stage_counters(&stage_profiler, stage, &total);
+
+    memcpy(interval, &total, sizeof(ProfileStageCounters));
+
+    /* The counters were not reset by a profile request since the last 
+       sample, so only the difference belongs to this interval */
+    if(total.number_of_samples >= last->number_of_samples){
+
+        for(i = 0; i < NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS; i++){
+            interval->histogram[i] = 
+                (total.histogram[i] >= last->histogram[i]) ?
+                total.histogram[i] - last->histogram[i] : 0;
+        }
+    }
+
+    memcpy(last, &total, sizeof(ProfileStageCounters));
+}
+
+static void take_soak_sample(SoakMonitor *monitor, FILE *report_file){
+
+    ProfileStageCounters interval;
+    SoakGauge *gauge = NULL;
+    long p50 = 0;
+    long p99 = 0;
+    int stage;
+    int i;
+
+    pthread_mutex_lock(&monitor->list_lock);
+
+    fprintf(report_file, "%d", get_cached_system_time());
+
+    for(i = 0; i < monitor->number_of_gauges; i++){
+
+        gauge = &monitor->gauges[i];
+
+        gauge->last_value = gauge->routine();
+
+        fprintf(report_file, ",%ld", gauge->last_value);
+
+        if(true == add_soak_drift_sample(&gauge->drift, gauge->last_value)){
+            zlog_error(category_debug, 
+                       "soak monitor: [%s] kept growing for [%d] windows, " \
+                       "now [%ld]",
+                       gauge->name, 
+                       SOAK_MONITOR_NUMBER_OF_WINDOWS, 
+                       gauge->last_value);
+        }
+    }
+
+    for(stage = 0; stage < NUMBER_OF_PROFILE_STAGES; stage++){
+
+        get_stage_interval_counters(monitor, (ProfileStage)stage, &interval);
+
+        p50 = get_stage_percentile_in_us(&interval, 50);
+        p99 = get_stage_percentile_in_us(&interval, 99);
+
+        fprintf(report_file, ",%ld,%ld", p50, p99);
+
+        if(true == add_soak_drift_sample(&monitor->stage_drift[stage], p99)){
+            zlog_error(category_debug, 
+                       "soak monitor: [%s] p99 latency kept growing for " \
+                       "[%d] windows, now [%ld] us",
+                       get_profile_stage_name((ProfileStage)stage), 
+                       SOAK_MONITOR_NUMBER_OF_WINDOWS, 
+                       p99);
+        }
+    }
+
+    fprintf(report_file, "\n");
+    fflush(report_file);
+
+    monitor->number_of_samples++;
+
+    pthread_mutex_unlock(&monitor->list_lock);
+}
+
+void init_soak_monitor(SoakMonitor *monitor, 
+                       int sample_interval_in_sec, 
+                       char *report_path){
+
+    memset(monitor, 0, sizeof(SoakMonitor));
+
+    pthread_mutex_init(&monitor->list_lock, 0);
+
+    monitor->sample_interval_in_sec = 
+        (sample_interval_in_sec > 0) ? sample_interval_in_sec : 1;
+
+    strncpy(monitor->report_path, report_path, 
+            sizeof(monitor->report_path) - 1);
+
+    add_soak_gauge(monitor, "rss_kb", get_resident_memory_in_kb);
+}
+
+ErrorCode add_soak_gauge(SoakMonitor *monitor, 
+                         char *name, 
+                         SoakGaugeRoutine routine){
+
+    SoakGauge *gauge = NULL;
+
+    if(NULL == name || strlen(name) >= LENGTH_OF_SOAK_GAUGE_NAME || 
+       NULL == routine){
+        return E_INPUT_PARAMETER;
+    }
+
+    pthread_mutex_lock(&monitor->list_lock);
+
+    if(monitor->number_of_gauges >= MAX_NUMBER_OF_SOAK_GAUGES){
+        pthread_mutex_unlock(&monitor->list_lock);
+
+        zlog_error(category_debug, "soak monitor: no room for gauge [%s]", 
+                   name);
+        return E_INPUT_PARAMETER;
+    }
+
+    gauge = &monitor->gauges[monitor->number_of_gauges];
+
+    memset(gauge, 0, sizeof(SoakGauge));
+    strcpy(gauge->name, name);
+    gauge->routine = routine;
+    gauge->last_value = -1;
+
+    monitor->number_of_gauges++;
+
+    pthread_mutex_unlock(&monitor->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void *soak_monitor_routine(void *_monitor){
+
+    SoakMonitor *monitor = (SoakMonitor *)_monitor;
+    FILE *report_file = NULL;
+    int last_sample_time = 0;
+    int stage;
+    int i;
+
+    report_file = fopen(monitor->report_path, "w");
+    if(NULL == report_file){
+        zlog_error(category_debug, "cannot open soak report %s", 
+                   monitor->report_path);
+        return (void *)NULL;
+    }
+
+    pthread_mutex_lock(&monitor->list_lock);
+
+    fprintf(report_file, "time");
+    for(i = 0; i < monitor->number_of_gauges; i++){
+        fprintf(report_file, ",%s", monitor->gauges[i].name);
+    }
+    for(stage = 0; stage < NUMBER_OF_PROFILE_STAGES; stage++){
+        fprintf(report_file, ",%s_p50_us,%s_p99_us", 
+                get_profile_stage_name((ProfileStage)stage),
+                get_profile_stage_name((ProfileStage)stage));
+    }
+    fprintf(report_file, "\n");
+    fflush(report_file);
+
+    /* The first interval starts now */
+    for(stage = 0; stage < NUMBER_OF_PROFILE_STAGES; stage++){
+        get_profile_stage_counters(&stage_profiler, 
+                                   (ProfileStage)stage, 
+                                   &monitor->last_stage_counters[stage]);
+    }
+
+    pthread_mutex_unlock(&monitor->list_lock);
+
+    monitor->is_running = true;
+
+    zlog_info(category_debug, "soak monitor samples [%d] gauges every " \
+              "[%d] seconds into [%s]", 
+              monitor->number_of_gauges,
+              monitor->sample_interval_in_sec,
+              monitor->report_path);
+
+    last_sample_time = get_cached_clock_time();
+
+    while(true == ready_to_work){
+
+        if(get_cached_clock_time() - last_sample_time < 
+           monitor->sample_interval_in_sec){
+            sleep_t(BUSY_WAITING_TIME_IN_MS);
+            continue;
+        }
+        last_sample_time = get_cached_clock_time();
+
+        take_soak_sample(monitor, report_file);
+    }
+
+    fclose(report_file);
+
+    monitor->is_running = false;
+
+    return (void *)NULL;
+}
+
+void get_soak_monitor_report(SoakMonitor *monitor, 
+                             char *buf, 
+                             size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+    char drifting[CONFIG_BUFFER_SIZE / 2];
+    char one_name[LENGTH_OF_SOAK_GAUGE_NAME + 8];
+    int stage;
+    int i;
+
+    memset(drifting, 0, sizeof(drifting));
+
+    pthread_mutex_lock(&monitor->list_lock);
+
+    for(i = 0; i < monitor->number_of_gauges; i++){
+
+        if(false == monitor->gauges[i].drift.is_drifting){
+            continue;
+        }
+
+        memset(one_name, 0, sizeof(one_name));
+        sprintf(one_name, "%s%s", 
+                (strlen(drifting) > 0) ? DELIMITER_COMMA : "",
+                monitor->gauges[i].name);
+
+        if(strlen(drifting) + strlen(one_name) < sizeof(drifting)){
+            strcat(drifting, one_name);
+        }
+    }
+
+    for(stage = 0; stage < NUMBER_OF_PROFILE_STAGES; stage++){
+
+        if(false == monitor->stage_drift[stage].is_drifting){
+            continue;
+        }
+
+        memset(one_name, 0, sizeof(one_name));
+        sprintf(one_name, "%s%s_p99", 
+                (strlen(drifting) > 0) ? DELIMITER_COMMA : "",
+                get_profile_stage_name((ProfileStage)stage));
+
+        if(strlen(drifting) + strlen(one_name) < sizeof(drifting)){
+            strcat(drifting, one_name);
+        }
+    }
+
+    pthread_mutex_unlock(&monitor->list_lock);
+
+    memset(report, 0, sizeof(report));
+
+    sprintf(report, "soak_monitor=%s;soak_samples=%d;soak_drifting=%s;",
+            (true == monitor->is_running) ? "running" : "stopped",
+            monitor->number_of_samples,
+            drifting);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
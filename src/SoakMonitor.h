@@ -0,0 +1,230 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SoakMonitor.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in SoakMonitor.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef SOAK_MONITOR_H
+#define SOAK_MONITOR_H
+
+#include "BeDIS.h"
+#include "StageProfiler.h"
+#include "ClockCache.h"
+
+/* Maximum number of gauges sampled by the soak monitor */
+#define MAX_NUMBER_OF_SOAK_GAUGES 32
+
+/* Length of the name of a gauge in bytes */
+#define LENGTH_OF_SOAK_GAUGE_NAME 32
+
+/* Number of samples whose minimum is kept as one window. The minimum is the
+floor a value falls back to between bursts, so a leak shows as a rising 
+floor while bursts do not. */
+#define SOAK_MONITOR_SAMPLES_PER_WINDOW 10
+
+/* Number of consecutive windows whose minimums must strictly increase for 
+a value to be flagged as drifting */
+#define SOAK_MONITOR_NUMBER_OF_WINDOWS 6
+
+/* File path of the samples of a soak run, relative to the server 
+installation path */
+#define SOAK_MONITOR_REPORT_FILE "temp/soak_report.csv"
+
+/* The routine returning the current value of a gauge, or a negative value 
+if the value is not available */
+typedef long (*SoakGaugeRoutine)();
+
+typedef struct {
+
+    /* The minimum of the current window */
+    long window_minimum;
+
+    int number_of_samples_in_window;
+
+    /* The minimums of the completed windows in a ring, and the index of the
+       oldest one */
+    long window_minimums[SOAK_MONITOR_NUMBER_OF_WINDOWS];
+    int number_of_windows;
+    int oldest_window;
+
+    bool is_drifting;
+
+} SoakDriftTracker;
+
+typedef struct {
+
+    char name[LENGTH_OF_SOAK_GAUGE_NAME];
+
+    SoakGaugeRoutine routine;
+
+    /* The value of the last sample */
+    long last_value;
+
+    SoakDriftTracker drift;
+
+} SoakGauge;
+
+typedef struct {
+
+    /* The interval in seconds between two samples */
+    int sample_interval_in_sec;
+
+    /* The file path of the samples */
+    char report_path[MAX_PATH];
+
+    /* The lock of the gauges and the drift trackers */
+    pthread_mutex_t list_lock;
+
+    int number_of_gauges;
+    SoakGauge gauges[MAX_NUMBER_OF_SOAK_GAUGES];
+
+    /* The counters of the stage profiler at the last sample, so each sample
+       reports the latencies of its own interval */
+    ProfileStageCounters last_stage_counters[NUMBER_OF_PROFILE_STAGES];
+
+    /* The 99th percentile latency of each stage is tracked for drift like 
+       the gauges */
+    SoakDriftTracker stage_drift[NUMBER_OF_PROFILE_STAGES];
+
+    volatile bool is_running;
+    volatile int number_of_samples;
+
+} SoakMonitor;
+
+/* global variables */
+
+/* The soak monitor of the server */
+SoakMonitor soak_monitor;
+
+/*
+  init_soak_monitor:
+
+     This function initializes the soak monitor and registers the resident 
+     memory of the server as its first gauge, named rss_kb.
+
+  Parameters:
+
+     monitor - The pointer to the soak monitor
+
+     sample_interval_in_sec - The interval in seconds between two samples
+
+     report_path - The file path of the samples
+
+  Return value:
+
+     None
+
+ */
+
+void init_soak_monitor(SoakMonitor *monitor, 
+                       int sample_interval_in_sec, 
+                       char *report_path);
+
+/*
+  add_soak_gauge:
+
+     This function registers a value sampled by the soak monitor. Gauges 
+     should be added before the monitor is started.
+
+  Parameters:
+
+     monitor - The pointer to the soak monitor
+
+     name - The name of the gauge in the samples and the report
+
+     routine - The routine returning the current value of the gauge
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the name is too long or all gauges are 
+                                    used.
+
+ */
+
+ErrorCode add_soak_gauge(SoakMonitor *monitor, 
+                         char *name, 
+                         SoakGaugeRoutine routine);
+
+/*
+  soak_monitor_routine:
+
+     This function is executed by the soak monitor thread until the server 
+     stops. At each interval it appends one CSV line to the report file with
+     the wall time, the value of each gauge, and the 50th and 99th 
+     percentile latency in microseconds of each profiled stage in the 
+     interval. A value which keeps growing is logged when it is first 
+     flagged as drifting.
+
+  Parameters:
+
+     _monitor - The pointer to the soak monitor
+
+  Return value:
+
+     None
+
+ */
+
+void *soak_monitor_routine(void *_monitor);
+
+/*
+  get_soak_monitor_report:
+
+     This function writes the number of samples and the names of the values
+     currently flagged as drifting into buf.
+
+  Parameters:
+
+     monitor - The pointer to the soak monitor
+
+     buf - The output buffer
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_soak_monitor_report(SoakMonitor *monitor, 
+                             char *buf, 
+                             size_t buf_len);
+
+#endif
@@ -0,0 +1,414 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SocketHandoff.c
+
+  File Description:
+
+     This file provides APIs to pass the bound UDP sockets and a snapshot of
+     the warm state from a running server process to a newly started one
+     over a Unix domain socket, so a new build takes over without dropping
+     packets.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "SocketHandoff.h"
+
+#ifndef _WIN32
+
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* The message sent before the warm state. The sockets follow in the order 
+   of the non-zero ports. */
+typedef struct {
+
+    int magic;
+
+    int ports[SOCKET_HANDOFF_MAX_SOCKETS];
+
+    int snapshot_size;
+
+} SocketHandoffHeader;
+
+static void set_socket_handoff_address(struct sockaddr_un *address, 
+                                       char *path){
+
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    strncpy(address->sun_path, path, sizeof(address->sun_path) - 1);
+}
+
+ErrorCode request_socket_handoff(char *path,
+                                 int *ports,
+                                 int *socket_fds,
+                                 WarmStateSnapshot *snapshot){
+
+    struct sockaddr_un address;
+    SocketHandoffHeader header;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg = NULL;
+    char control[CMSG_SPACE(sizeof(int) * SOCKET_HANDOFF_MAX_SOCKETS)];
+    int received_fds[SOCKET_HANDOFF_MAX_SOCKETS];
+    int number_of_received_fds = 0;
+    int connection_fd = -1;
+    ssize_t received_length = 0;
+    size_t snapshot_length = 0;
+    int i;
+    int j;
+
+    for(i = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+        socket_fds[i] = -1;
+    }
+
+    connection_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(connection_fd < 0){
+        return E_OPEN_FILE;
+    }
+
+    set_socket_handoff_address(&address, path);
+
+    /* No server process to take over from is not an error */
+    if(0 != connect(connection_fd, (struct sockaddr *)&address, 
+                    sizeof(address))){
+        close(connection_fd);
+        return E_OPEN_FILE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    received_length = recvmsg(connection_fd, &msg, 0);
+
+    for(cmsg = CMSG_FIRSTHDR(&msg); 
+        NULL != cmsg; 
+        cmsg = CMSG_NXTHDR(&msg, cmsg)){
+
+        if(SOL_SOCKET == cmsg->cmsg_level && SCM_RIGHTS == cmsg->cmsg_type){
+            number_of_received_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / 
+                                     sizeof(int);
+            if(number_of_received_fds > SOCKET_HANDOFF_MAX_SOCKETS){
+                number_of_received_fds = SOCKET_HANDOFF_MAX_SOCKETS;
+            }
+            memcpy(received_fds, CMSG_DATA(cmsg), 
+                   number_of_received_fds * sizeof(int));
+        }
+    }
+
+    if(sizeof(header) != received_length || 
+       SOCKET_HANDOFF_MAGIC != header.magic ||
+       sizeof(WarmStateSnapshot) != header.snapshot_size){
+
+        zlog_error(category_debug, "Invalid socket handoff message");
+
+        for(i = 0; i < number_of_received_fds; i++){
+            close(received_fds[i]);
+        }
+        close(connection_fd);
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    /* Keep only the sockets bound to the ports this process listens on */
+    for(i = 0, j = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+
+        if(0 == header.ports[i] || j >= number_of_received_fds){
+            continue;
+        }
+
+        if(header.ports[i] == ports[i]){
+            socket_fds[i] = received_fds[j];
+        }else{
+            zlog_error(category_debug, 
+                       "Handed off socket of port [%d] is not used on " \
+                       "port [%d]", header.ports[i], ports[i]);
+            close(received_fds[j]);
+        }
+        j++;
+    }
+
+    /* The Unix domain socket is a stream, so the snapshot may arrive in 
+       several pieces */
+    while(snapshot_length < sizeof(WarmStateSnapshot)){
+
+        received_length = recv(connection_fd, 
+                               (char *)snapshot + snapshot_length, 
+                               sizeof(WarmStateSnapshot) - snapshot_length, 
+                               0);
+        if(received_length <= 0){
+            break;
+        }
+        snapshot_length += received_length;
+    }
+
+    close(connection_fd);
+
+    /* The sockets are still usable without the warm state */
+    if(sizeof(WarmStateSnapshot) != snapshot_length){
+        zlog_error(category_debug, "Incomplete warm state snapshot");
+        memset(snapshot, 0, sizeof(WarmStateSnapshot));
+    }
+
+    zlog_info(category_debug, 
+              "Took over [%d] sockets and [%d] gateways from [%s]", 
+              number_of_received_fds, snapshot->number_of_gateways, path);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void close_socket_handoff_sockets(int *socket_fds){
+
+    int i;
+
+    for(i = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+        if(socket_fds[i] >= 0){
+            close(socket_fds[i]);
+            socket_fds[i] = -1;
+        }
+    }
+}
+
+ErrorCode init_socket_handoff(SocketHandoff *handoff, char *path){
+
+    struct sockaddr_un address;
+    int i;
+
+    memset(handoff, 0, sizeof(SocketHandoff));
+
+    for(i = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+        handoff->socket_fds[i] = -1;
+    }
+
+    strncpy(handoff->path, path, sizeof(handoff->path) - 1);
+
+    handoff->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(handoff->listen_fd < 0){
+        return E_OPEN_FILE;
+    }
+
+    set_socket_handoff_address(&address, handoff->path);
+
+    /* The socket file of the process this one took over from, or of a 
+       process which crashed, would make bind fail */
+    unlink(handoff->path);
+
+    if(0 != bind(handoff->listen_fd, (struct sockaddr *)&address, 
+                 sizeof(address)) ||
+       0 != listen(handoff->listen_fd, 1)){
+
+        zlog_error(category_debug, 
+                   "Fail to listen on handoff socket [%s] errno=[%d]", 
+                   handoff->path, errno);
+        close(handoff->listen_fd);
+        handoff->listen_fd = -1;
+        return E_OPEN_FILE;
+    }
+
+    zlog_info(category_debug, "Listen on handoff socket [%s]", 
+              handoff->path);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void release_socket_handoff(SocketHandoff *handoff){
+
+    if(handoff->listen_fd < 0){
+        return;
+    }
+
+    close(handoff->listen_fd);
+    handoff->listen_fd = -1;
+
+    if(false == handoff->is_handed_off){
+        unlink(handoff->path);
+    }
+}
+
+int accept_socket_handoff(SocketHandoff *handoff){
+
+    fd_set read_fds;
+    struct timeval timeout;
+
+    FD_ZERO(&read_fds);
+    FD_SET(handoff->listen_fd, &read_fds);
+
+    timeout.tv_sec = 0;
+    timeout.tv_usec = SOCKET_HANDOFF_ACCEPT_TIMEOUT_IN_MS * 1000;
+
+    if(select(handoff->listen_fd + 1, &read_fds, NULL, NULL, &timeout) <= 0){
+        return -1;
+    }
+
+    return accept(handoff->listen_fd, NULL, NULL);
+}
+
+ErrorCode send_socket_handoff(SocketHandoff *handoff,
+                              int connection_fd,
+                              WarmStateSnapshot *snapshot){
+
+    SocketHandoffHeader header;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg = NULL;
+    char control[CMSG_SPACE(sizeof(int) * SOCKET_HANDOFF_MAX_SOCKETS)];
+    int sent_fds[SOCKET_HANDOFF_MAX_SOCKETS];
+    int number_of_sent_fds = 0;
+    ssize_t sent_length = 0;
+    size_t snapshot_length = 0;
+    int i;
+
+    memset(&header, 0, sizeof(header));
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+
+    header.magic = SOCKET_HANDOFF_MAGIC;
+    header.snapshot_size = sizeof(WarmStateSnapshot);
+
+    for(i = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+        if(handoff->socket_fds[i] >= 0 && handoff->ports[i] > 0){
+            header.ports[i] = handoff->ports[i];
+            sent_fds[number_of_sent_fds] = handoff->socket_fds[i];
+            number_of_sent_fds++;
+        }
+    }
+
+    iov.iov_base = &header;
+    iov.iov_len = sizeof(header);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if(number_of_sent_fds > 0){
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * number_of_sent_fds);
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * number_of_sent_fds);
+        memcpy(CMSG_DATA(cmsg), sent_fds, sizeof(int) * number_of_sent_fds);
+    }
+
+    if(sizeof(header) != sendmsg(connection_fd, &msg, 0)){
+        zlog_error(category_debug, "Fail to send handoff sockets");
+        close(connection_fd);
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    while(snapshot_length < sizeof(WarmStateSnapshot)){
+
+        sent_length = send(connection_fd, 
+                           (char *)snapshot + snapshot_length, 
+                           sizeof(WarmStateSnapshot) - snapshot_length, 
+                           0);
+        if(sent_length <= 0){
+            break;
+        }
+        snapshot_length += sent_length;
+    }
+
+    close(connection_fd);
+
+    /* The new process owns the sockets once it has received them, even 
+       without the complete warm state */
+    if(sizeof(WarmStateSnapshot) != snapshot_length){
+        zlog_error(category_debug, "Fail to send warm state snapshot");
+    }
+
+    zlog_info(category_debug, "Handed off [%d] sockets and [%d] gateways", 
+              number_of_sent_fds, snapshot->number_of_gateways);
+
+    return WORK_SUCCESSFULLY;
+}
+
+#else
+
+ErrorCode request_socket_handoff(char *path,
+                                 int *ports,
+                                 int *socket_fds,
+                                 WarmStateSnapshot *snapshot){
+
+    int i;
+
+    for(i = 0; i < SOCKET_HANDOFF_MAX_SOCKETS; i++){
+        socket_fds[i] = -1;
+    }
+
+    zlog_error(category_debug, 
+               "socket handoff is not supported by this platform");
+
+    return E_INITIALIZATION_FAIL;
+}
+
+void close_socket_handoff_sockets(int *socket_fds){
+
+    return;
+}
+
+ErrorCode init_socket_handoff(SocketHandoff *handoff, char *path){
+
+    memset(handoff, 0, sizeof(SocketHandoff));
+    handoff->listen_fd = -1;
+
+    zlog_error(category_debug, 
+               "socket handoff is not supported by this platform");
+
+    return E_INITIALIZATION_FAIL;
+}
+
+void release_socket_handoff(SocketHandoff *handoff){
+
+    return;
+}
+
+int accept_socket_handoff(SocketHandoff *handoff){
+
+    return -1;
+}
+
+ErrorCode send_socket_handoff(SocketHandoff *handoff,
+                              int connection_fd,
+                              WarmStateSnapshot *snapshot){
+
+    return E_INITIALIZATION_FAIL;
+}
+
+#endif
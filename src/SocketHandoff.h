@@ -0,0 +1,247 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SocketHandoff.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in SocketHandoff.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef SOCKET_HANDOFF_H
+#define SOCKET_HANDOFF_H
+
+#include "BeDIS.h"
+#include "EventWatermark.h"
+
+/* The value in the header of a handoff message */
+#define SOCKET_HANDOFF_MAGIC 0x42534846
+
+/* Maximum length in bytes of the path of the Unix domain socket */
+#define LENGTH_OF_SOCKET_HANDOFF_PATH 108
+
+/* Maximum number of UDP sockets passed in a handoff */
+#define SOCKET_HANDOFF_MAX_SOCKETS 2
+
+/* The index of the socket bound to recv_port */
+#define SOCKET_HANDOFF_RECV_PORT 0
+
+/* The index of the socket bound to the dedicated time-critical port */
+#define SOCKET_HANDOFF_TIME_CRITICAL_PORT 1
+
+/* Time in milliseconds an accept waits for a new process before checking 
+whether the server should stop */
+#define SOCKET_HANDOFF_ACCEPT_TIMEOUT_IN_MS 500
+
+/* Time in seconds the old process waits for its receive queues to drain 
+after the handoff */
+#define SOCKET_HANDOFF_DRAIN_TIMEOUT_IN_SEC 30
+
+/* The state the new process would otherwise rebuild only after gateways 
+join again and send new tracking data */
+typedef struct {
+
+    /* The addresses of joined gateways */
+    int number_of_gateways;
+    char gateway_addresses[MAX_NUMBER_NODES][NETWORK_ADDR_LENGTH];
+
+    /* The event-time watermark and the state of each gateway */
+    int watermark;
+    EventWatermarkGateway watermark_gateways[MAX_NUMBER_NODES];
+
+} WarmStateSnapshot;
+
+typedef struct {
+
+    char path[LENGTH_OF_SOCKET_HANDOFF_PATH];
+
+    /* The listening Unix domain socket */
+    int listen_fd;
+
+    /* The UDP sockets to be passed and the ports they are bound to. An 
+       unused entry has socket -1 and port 0. */
+    int socket_fds[SOCKET_HANDOFF_MAX_SOCKETS];
+    int ports[SOCKET_HANDOFF_MAX_SOCKETS];
+
+    /* The flag indicating whether the sockets were passed to a new 
+       process */
+    volatile bool is_handed_off;
+
+} SocketHandoff;
+
+/* global variables */
+
+/* The snapshot sent to or received from another server process */
+WarmStateSnapshot warm_state_snapshot;
+
+/*
+  request_socket_handoff:
+
+     This function connects to the handoff socket of a running server 
+     process and receives its bound UDP sockets and its warm state. A 
+     socket bound to another port than expected in ports is closed.
+
+  Parameters:
+
+     path - The path of the Unix domain socket
+
+     ports - The array of SOCKET_HANDOFF_MAX_SOCKETS ports this process 
+             expects, indexed by SOCKET_HANDOFF_RECV_PORT and 
+             SOCKET_HANDOFF_TIME_CRITICAL_PORT
+
+     socket_fds - The output array of SOCKET_HANDOFF_MAX_SOCKETS sockets. 
+                  An entry not received is -1.
+
+     snapshot - The output warm state
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: no server process is listening on path.
+                 E_API_PROTOCOL_FORMAT: the handoff message is invalid.
+                 E_INITIALIZATION_FAIL: handoff is not supported by this 
+                                        platform.
+
+ */
+
+ErrorCode request_socket_handoff(char *path,
+                                 int *ports,
+                                 int *socket_fds,
+                                 WarmStateSnapshot *snapshot);
+
+/*
+  close_socket_handoff_sockets:
+
+     This function closes the received sockets which are still open.
+
+  Parameters:
+
+     socket_fds - The array of SOCKET_HANDOFF_MAX_SOCKETS sockets
+
+  Return value:
+
+     None
+
+ */
+
+void close_socket_handoff_sockets(int *socket_fds);
+
+/*
+  init_socket_handoff:
+
+     This function listens on the Unix domain socket for a new server 
+     process. A socket file left by an earlier process is replaced.
+
+  Parameters:
+
+     handoff - The pointer to the handoff state
+
+     path - The path of the Unix domain socket
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the socket cannot be bound to path.
+                 E_INITIALIZATION_FAIL: handoff is not supported by this 
+                                        platform.
+
+ */
+
+ErrorCode init_socket_handoff(SocketHandoff *handoff, char *path);
+
+/*
+  release_socket_handoff:
+
+     This function closes the listening socket. The socket file is removed 
+     only if the sockets were not handed off, because it then belongs to the 
+     new process.
+
+  Parameters:
+
+     handoff - The pointer to the handoff state
+
+  Return value:
+
+     None
+
+ */
+
+void release_socket_handoff(SocketHandoff *handoff);
+
+/*
+  accept_socket_handoff:
+
+     This function waits at most SOCKET_HANDOFF_ACCEPT_TIMEOUT_IN_MS for a 
+     new process to connect.
+
+  Parameters:
+
+     handoff - The pointer to the handoff state
+
+  Return value:
+
+     int - The connected socket, or -1 if no process connected
+
+ */
+
+int accept_socket_handoff(SocketHandoff *handoff);
+
+/*
+  send_socket_handoff:
+
+     This function passes the UDP sockets of the handoff state with 
+     SCM_RIGHTS followed by the warm state, and closes the connection. The 
+     sockets stay open in this process too, so the caller must stop 
+     receiving on them.
+
+  Parameters:
+
+     handoff - The pointer to the handoff state
+
+     connection_fd - The connected socket returned by accept_socket_handoff
+
+     snapshot - The warm state of this process
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_API_PROTOCOL_FORMAT: the message cannot be sent.
+
+ */
+
+ErrorCode send_socket_handoff(SocketHandoff *handoff,
+                              int connection_fd,
+                              WarmStateSnapshot *snapshot);
+
+#endif
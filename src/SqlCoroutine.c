@@ -0,0 +1,493 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SqlCoroutine.c
+
+  File Description:
+
+     This file provides stackless coroutines which wait for the results of
+     their SQL statements without holding a thread, so many database
+     operations are multiplexed on a few executor threads.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "SqlCoroutine.h"
+
+#ifndef _WIN32
+#include <sys/select.h>
+#endif
+
+static SqlCoroutine *take_waiting_sql_coroutine(
+    SqlCoroutineScheduler *scheduler){
+
+    List_Entry *current_list_entry = NULL;
+    SqlCoroutine *co = NULL;
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    list_for_each(current_list_entry, &scheduler->list_head){
+
+        co = ListEntry(current_list_entry, 
+                       SqlCoroutine, 
+                       coroutine_list_entry);
+        break;
+    }
+
+    if(NULL != co){
+        remove_list_node(&co->coroutine_list_entry);
+
+        scheduler->number_of_waiting--;
+    }
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+
+    return co;
+}
+
+static bool open_sql_coroutine_connection(SqlCoroutineExecutor *executor,
+                                          int slot){
+
+    PGconn *db_conn = NULL;
+
+    db_conn = PQconnectdb(executor->scheduler->conninfo);
+
+    if(CONNECTION_OK != PQstatus(db_conn)){
+
+        zlog_error(category_debug, 
+                   "SQL coroutine connect to database failed: %s",
+                   PQerrorMessage(db_conn));
+
+        PQfinish(db_conn);
+        return false;
+    }
+
+    executor->db_conns[slot] = db_conn;
+
+    pthread_mutex_lock(&executor->scheduler->list_lock);
+    executor->scheduler->number_of_live_connections++;
+    pthread_mutex_unlock(&executor->scheduler->list_lock);
+
+    return true;
+}
+
+static void close_sql_coroutine_connection(SqlCoroutineExecutor *executor,
+                                           int slot){
+
+    PQfinish(executor->db_conns[slot]);
+    executor->db_conns[slot] = NULL;
+
+    pthread_mutex_lock(&executor->scheduler->list_lock);
+    executor->scheduler->number_of_live_connections--;
+    pthread_mutex_unlock(&executor->scheduler->list_lock);
+}
+
+/* Consumes the results which arrived on the connection of the coroutine. 
+   Returns true when all results of the awaited statement are consumed. */
+static bool poll_sql_coroutine_statement(SqlCoroutine *co){
+
+    PGresult *res = NULL;
+    ExecStatusType status;
+
+    if(0 == PQconsumeInput(co->db_conn)){
+
+        zlog_error(category_debug, "PQconsumeInput failed: %s", 
+                   PQerrorMessage(co->db_conn));
+
+        co->db_result = E_SQL_EXECUTE;
+        return true;
+    }
+
+    while(0 == PQisBusy(co->db_conn)){
+
+        res = PQgetResult(co->db_conn);
+        if(NULL == res){
+            return true;
+        }
+
+        status = PQresultStatus(res);
+        if(PGRES_COMMAND_OK != status && PGRES_TUPLES_OK != status){
+
+            zlog_error(category_debug, "SQL coroutine statement failed: %s",
+                       PQerrorMessage(co->db_conn));
+
+            co->db_result = E_SQL_EXECUTE;
+        }
+
+        PQclear(res);
+    }
+
+    return false;
+}
+
+/* Runs the coroutine on the connection until it suspends or ends */
+static void run_sql_coroutine(SqlCoroutineExecutor *executor, int slot){
+
+    SqlCoroutine *co = executor->coroutines[slot];
+
+    if(SQL_COROUTINE_WAITING == co->routine(co)){
+        return;
+    }
+
+    if(true == co->is_failed){
+        executor->number_of_failed++;
+    }
+    executor->number_of_finished++;
+    executor->number_of_running--;
+
+    executor->coroutines[slot] = NULL;
+
+    if(NULL != co->completion){
+        co->completion(co);
+    }
+
+    mp_free(&sql_coroutine_mempool, co);
+
+    /* A broken connection is reopened before it takes the next 
+       coroutine. If the reset fails too, the connection is closed and 
+       opened again later, so no coroutine starts on it meanwhile. */
+    if(CONNECTION_BAD == PQstatus(executor->db_conns[slot])){
+
+        zlog_error(category_debug, "reset SQL coroutine connection");
+
+        PQreset(executor->db_conns[slot]);
+
+        if(CONNECTION_BAD == PQstatus(executor->db_conns[slot])){
+
+            zlog_error(category_debug, 
+                       "reset SQL coroutine connection failed: %s",
+                       PQerrorMessage(executor->db_conns[slot]));
+
+            close_sql_coroutine_connection(executor, slot);
+        }
+    }
+}
+
+ErrorCode init_sql_coroutine_scheduler(SqlCoroutineScheduler *scheduler,
+                                       char *conninfo,
+                                       int number_of_executors,
+                                       int connections_per_executor){
+
+    SqlCoroutineExecutor *executor = NULL;
+    int i;
+    int j;
+
+    memset(scheduler, 0, sizeof(SqlCoroutineScheduler));
+
+    pthread_mutex_init(&scheduler->list_lock, 0);
+
+    init_entry(&scheduler->list_head);
+
+    strncpy(scheduler->conninfo, conninfo, sizeof(scheduler->conninfo) - 1);
+
+    if(number_of_executors > MAX_SQL_COROUTINE_EXECUTORS){
+        number_of_executors = MAX_SQL_COROUTINE_EXECUTORS;
+    }
+    if(connections_per_executor <= 0){
+        connections_per_executor = 1;
+    }
+    if(connections_per_executor > MAX_SQL_COROUTINE_CONNECTIONS){
+        connections_per_executor = MAX_SQL_COROUTINE_CONNECTIONS;
+    }
+
+    for(i = 0; i < number_of_executors; i++){
+
+        executor = &scheduler->executors[scheduler->number_of_executors];
+
+        executor->scheduler = scheduler;
+        executor->number_of_connections = connections_per_executor;
+        executor->last_reconnect_time = get_cached_clock_time();
+
+        /* The connections are opened before the thread starts, so a 
+           database which cannot be reached fails the initialization */
+        for(j = 0; j < connections_per_executor; j++){
+            open_sql_coroutine_connection(executor, j);
+        }
+
+        if(WORK_SUCCESSFULLY != startThread(&executor->thread, 
+                                            sql_coroutine_executor, 
+                                            executor)){
+
+            zlog_error(category_debug, 
+                       "SQL coroutine executor [%d] Create Fail", i);
+
+            for(j = 0; j < connections_per_executor; j++){
+                if(NULL != executor->db_conns[j]){
+                    close_sql_coroutine_connection(executor, j);
+                }
+            }
+            break;
+        }
+        scheduler->number_of_executors++;
+    }
+
+    if(0 == scheduler->number_of_executors){
+        return E_INITIALIZATION_FAIL;
+    }
+
+    /* The executors keep running and retry their connections, but a 
+       scheduler which never had a connection is reported as failed */
+    if(0 == scheduler->number_of_live_connections){
+        zlog_error(category_debug, "SQL coroutine executors have no " \
+                   "connection");
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    zlog_info(category_debug, "[%d] SQL coroutine executors started with " \
+              "[%d] connections each", 
+              scheduler->number_of_executors, 
+              connections_per_executor);
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode submit_sql_coroutine(SqlCoroutineScheduler *scheduler,
+                               SqlCoroutineRoutine routine,
+                               SqlCoroutineCompletion completion,
+                               void *argument,
+                               char *content,
+                               int content_size,
+                               char *address){
+
+    SqlCoroutine *co = NULL;
+    int retry_times = 0;
+
+    if(content_size < 0 || content_size >= WIFI_MESSAGE_LENGTH || 
+       strlen(address) >= NETWORK_ADDR_LENGTH){
+        return E_INPUT_PARAMETER;
+    }
+
+    retry_times = MEMORY_ALLOCATE_RETRIES;
+    while(retry_times --){
+        co = mp_alloc(&sql_coroutine_mempool);
+        if(NULL != co)
+            break;
+    }
+    if(NULL == co){
+        zlog_error(category_debug,
+                   "submit_sql_coroutine (co) mp_alloc failed");
+        return E_MALLOC;
+    }
+
+    memset(co, 0, sizeof(SqlCoroutine));
+
+    co->routine = routine;
+    co->completion = completion;
+    co->argument = argument;
+    co->db_result = WORK_SUCCESSFULLY;
+
+    memcpy(co->buf, content, content_size);
+    strcpy(co->address, address);
+
+    init_entry(&co->coroutine_list_entry);
+
+    pthread_mutex_lock(&scheduler->list_lock);
+
+    if(0 == scheduler->number_of_live_connections){
+
+        pthread_mutex_unlock(&scheduler->list_lock);
+
+        mp_free(&sql_coroutine_mempool, co);
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    insert_list_tail(&co->coroutine_list_entry, &scheduler->list_head);
+
+    scheduler->number_of_waiting++;
+
+    pthread_mutex_unlock(&scheduler->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode send_sql_coroutine_statement(SqlCoroutine *co, char *sql){
+
+    /* The connection stays in blocking mode, so the short statement is 
+       written at once and only its result is waited for asynchronously */
+    if(0 == PQsendQuery(co->db_conn, sql)){
+
+        zlog_error(category_debug, "PQsendQuery failed: %s", 
+                   PQerrorMessage(co->db_conn));
+
+        return E_SQL_EXECUTE;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+void *sql_coroutine_executor(void *_executor){
+
+    SqlCoroutineExecutor *executor = (SqlCoroutineExecutor *)_executor;
+    SqlCoroutine *co = NULL;
+    fd_set read_fds;
+    struct timeval timeout;
+    int max_socket = -1;
+    int db_socket = -1;
+    int i;
+
+    while(true == ready_to_work){
+
+        /* The connections which failed to open or were closed are tried 
+           again once in a while */
+        if(get_cached_clock_time() - executor->last_reconnect_time >= 
+           SQL_COROUTINE_RECONNECT_INTERVAL_IN_SEC){
+
+            for(i = 0; i < executor->number_of_connections; i++){
+                if(NULL == executor->db_conns[i]){
+                    open_sql_coroutine_connection(executor, i);
+                }
+            }
+
+            executor->last_reconnect_time = get_cached_clock_time();
+        }
+
+        /* Start the waiting coroutines on the free connections */
+        for(i = 0; i < executor->number_of_connections; i++){
+
+            if(NULL == executor->db_conns[i] || 
+               NULL != executor->coroutines[i]){
+                continue;
+            }
+
+            co = take_waiting_sql_coroutine(executor->scheduler);
+            if(NULL == co){
+                break;
+            }
+
+            co->db_conn = executor->db_conns[i];
+            executor->coroutines[i] = co;
+            executor->number_of_running++;
+
+            run_sql_coroutine(executor, i);
+        }
+
+        FD_ZERO(&read_fds);
+        max_socket = -1;
+
+        for(i = 0; i < executor->number_of_connections; i++){
+
+            if(NULL == executor->coroutines[i]){
+                continue;
+            }
+
+            db_socket = PQsocket(executor->db_conns[i]);
+            if(db_socket < 0){
+                continue;
+            }
+
+            FD_SET(db_socket, &read_fds);
+            if(db_socket > max_socket){
+                max_socket = db_socket;
+            }
+        }
+
+        if(max_socket < 0){
+            sleep_t(SQL_COROUTINE_POLL_INTERVAL_IN_MS);
+            continue;
+        }
+
+        /* Wait with timeout, so coroutines submitted in the meantime are 
+           started soon */
+        timeout.tv_sec = 0;
+        timeout.tv_usec = SQL_COROUTINE_POLL_INTERVAL_IN_MS * 1000;
+
+        if(select(max_socket + 1, &read_fds, NULL, NULL, &timeout) <= 0){
+            continue;
+        }
+
+        for(i = 0; i < executor->number_of_connections; i++){
+
+            co = executor->coroutines[i];
+            if(NULL == co){
+                continue;
+            }
+
+            db_socket = PQsocket(co->db_conn);
+            if(db_socket < 0 || 0 == FD_ISSET(db_socket, &read_fds)){
+                continue;
+            }
+
+            if(true == poll_sql_coroutine_statement(co)){
+                run_sql_coroutine(executor, i);
+            }
+        }
+    }
+
+    /* The coroutines still running are dropped with their connections */
+    for(i = 0; i < executor->number_of_connections; i++){
+
+        if(NULL != executor->db_conns[i]){
+            close_sql_coroutine_connection(executor, i);
+        }
+    }
+
+    return (void *)NULL;
+}
+
+void get_sql_coroutine_report(SqlCoroutineScheduler *scheduler, 
+                              char *buf, 
+                              size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+    int number_of_waiting = 0;
+    int number_of_running = 0;
+    int number_of_finished = 0;
+    int number_of_failed = 0;
+    int number_of_live_connections = 0;
+    int i;
+
+    pthread_mutex_lock(&scheduler->list_lock);
+    number_of_waiting = scheduler->number_of_waiting;
+    number_of_live_connections = scheduler->number_of_live_connections;
+    pthread_mutex_unlock(&scheduler->list_lock);
+
+    for(i = 0; i < scheduler->number_of_executors; i++){
+        number_of_running += scheduler->executors[i].number_of_running;
+        number_of_finished += scheduler->executors[i].number_of_finished;
+        number_of_failed += scheduler->executors[i].number_of_failed;
+    }
+
+    memset(report, 0, sizeof(report));
+
+    sprintf(report, 
+            "sql_coroutine_executors=%d;sql_coroutine_waiting=%d;" \
+            "sql_coroutine_running=%d;sql_coroutine_finished=%d;" \
+            "sql_coroutine_failed=%d;sql_coroutine_connections=%d;",
+            scheduler->number_of_executors,
+            number_of_waiting,
+            number_of_running,
+            number_of_finished,
+            number_of_failed,
+            number_of_live_connections);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
@@ -0,0 +1,345 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     SqlCoroutine.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in SqlCoroutine.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef SQL_COROUTINE_H
+#define SQL_COROUTINE_H
+
+#include "BeDIS.h"
+#include "ProtocolSchema.h"
+#include "ClockCache.h"
+#include <libpq-fe.h>
+
+/* Maximum number of threads running SQL coroutines */
+#define MAX_SQL_COROUTINE_EXECUTORS 8
+
+/* Maximum number of connections of one executor thread. Each connection 
+runs one statement at a time, so it bounds the statements in flight. */
+#define MAX_SQL_COROUTINE_CONNECTIONS 64
+
+/* The longest time in milliseconds an executor waits for results before it
+starts coroutines submitted in the meantime */
+#define SQL_COROUTINE_POLL_INTERVAL_IN_MS 10
+
+/* Time in seconds an executor waits before opening its closed connections 
+again */
+#define SQL_COROUTINE_RECONNECT_INTERVAL_IN_SEC 30
+
+/* The results of running a coroutine until it suspends or ends */
+typedef enum _SqlCoroutineStatus{
+
+    /* A statement was sent and the coroutine waits for its result */
+    SQL_COROUTINE_WAITING = 0,
+
+    SQL_COROUTINE_FINISHED = 1
+
+} SqlCoroutineStatus;
+
+typedef struct _SqlCoroutine SqlCoroutine;
+
+typedef struct _SqlCoroutineScheduler SqlCoroutineScheduler;
+
+/* The body of a coroutine. It is called again from its resume point each 
+time the result of the awaited statement arrives, so its local variables 
+do not survive SQL_COROUTINE_AWAIT_STATEMENT. The state kept across 
+statements lives in the coroutine. */
+typedef SqlCoroutineStatus (*SqlCoroutineRoutine)(SqlCoroutine *co);
+
+/* The continuation called by the executor after the routine ends */
+typedef void (*SqlCoroutineCompletion)(SqlCoroutine *co);
+
+struct _SqlCoroutine{
+
+    /* The line the routine resumes at, 0 before the routine starts */
+    int resume_point;
+
+    SqlCoroutineRoutine routine;
+
+    SqlCoroutineCompletion completion;
+
+    /* The argument owned by the submitter until the completion is called */
+    void *argument;
+
+    /* The connection assigned by the executor for the life of the 
+       coroutine */
+    PGconn *db_conn;
+
+    /* The result of the last awaited statement, and whether any statement 
+       failed */
+    ErrorCode db_result;
+    bool is_failed;
+
+    /* The copy of the packet parsed by the routine across statements */
+    char buf[WIFI_MESSAGE_LENGTH];
+
+    /* The address of the gateway which sent the packet */
+    char address[NETWORK_ADDR_LENGTH];
+
+    /* The parse position in buf and the number of items left */
+    ProtocolCursor cursor;
+    int number_of_remaining;
+
+    List_Entry coroutine_list_entry;
+
+};
+
+/* Starts the body of a coroutine routine */
+#define SQL_COROUTINE_BEGIN(co) switch((co)->resume_point){ case 0:
+
+/* Sends a statement and suspends the routine until its result arrives. The 
+result is in co->db_result afterwards. As in other stackless coroutines, 
+the macro must not be used inside a switch statement of the routine. */
+#define SQL_COROUTINE_AWAIT_STATEMENT(co, sql) \
+    do{ \
+        (co)->db_result = send_sql_coroutine_statement((co), (sql)); \
+        if(WORK_SUCCESSFULLY == (co)->db_result){ \
+            (co)->resume_point = __LINE__; \
+            return SQL_COROUTINE_WAITING; \
+            case __LINE__: ; \
+        } \
+        if(WORK_SUCCESSFULLY != (co)->db_result){ \
+            (co)->is_failed = true; \
+        } \
+    }while(0)
+
+/* Ends the routine before the end of its body */
+#define SQL_COROUTINE_EXIT(co) \
+    do{ \
+        (co)->resume_point = -1; \
+        return SQL_COROUTINE_FINISHED; \
+    }while(0)
+
+/* Ends the body of a coroutine routine */
+#define SQL_COROUTINE_END(co) } (co)->resume_point = -1; \
+    return SQL_COROUTINE_FINISHED
+
+typedef struct {
+
+    pthread_t thread;
+
+    SqlCoroutineScheduler *scheduler;
+
+    /* The connections of the executor, NULL if they failed to open or 
+       are closed after a failed reset */
+    int number_of_connections;
+    PGconn *db_conns[MAX_SQL_COROUTINE_CONNECTIONS];
+
+    /* The clock time in seconds the closed connections were last tried */
+    int last_reconnect_time;
+
+    /* The coroutine running on each connection, NULL if it is free */
+    SqlCoroutine *coroutines[MAX_SQL_COROUTINE_CONNECTIONS];
+
+    /* The counters written by the executor thread only */
+    int number_of_running;
+    int number_of_finished;
+    int number_of_failed;
+
+} SqlCoroutineExecutor;
+
+struct _SqlCoroutineScheduler{
+
+    /* The information to open database connections */
+    char conninfo[CONFIG_BUFFER_SIZE];
+
+    /* The lock of the coroutines waiting for a connection */
+    pthread_mutex_t list_lock;
+
+    struct List_Entry list_head;
+
+    int number_of_waiting;
+
+    /* The number of open connections over all executors. Coroutines are 
+       only accepted while it is positive. Protected by list_lock. */
+    int number_of_live_connections;
+
+    int number_of_executors;
+
+    SqlCoroutineExecutor executors[MAX_SQL_COROUTINE_EXECUTORS];
+
+};
+
+/* global variables */
+
+/* The mempool for the SQL coroutine structures */
+Memory_Pool sql_coroutine_mempool;
+
+/* The SQL coroutine scheduler of the server */
+SqlCoroutineScheduler sql_coroutine_scheduler;
+
+/*
+  init_sql_coroutine_scheduler:
+
+     This function initializes the scheduler, opens the connections of 
+     each executor and starts the executor threads. Each executor owns its 
+     connections, so the connection pool is not used by coroutines.
+
+  Parameters:
+
+     scheduler - The pointer to the scheduler
+
+     conninfo - The information to open database connections
+
+     number_of_executors - The number of executor threads
+
+     connections_per_executor - The number of connections of each executor
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_SQL_OPEN_DATABASE: no connection can be opened.
+                 E_INITIALIZATION_FAIL: no executor thread is started.
+
+ */
+
+ErrorCode init_sql_coroutine_scheduler(SqlCoroutineScheduler *scheduler,
+                                       char *conninfo,
+                                       int number_of_executors,
+                                       int connections_per_executor);
+
+/*
+  submit_sql_coroutine:
+
+     This function queues a coroutine to be started by the first executor 
+     with a free connection. The content is copied into the coroutine, and 
+     the completion is called with the argument when the routine ends. 
+     Coroutines are refused while no executor has an open connection, so 
+     the caller runs its blocking routine instead.
+
+  Parameters:
+
+     scheduler - The pointer to the scheduler
+
+     routine - The body of the coroutine
+
+     completion - The continuation called after the routine ends
+
+     argument - The argument passed to the completion
+
+     content - The packet parsed by the routine
+
+     content_size - Length in number of bytes of content
+
+     address - The address of the gateway which sent the packet
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the content does not fit a coroutine.
+                 E_MALLOC: no free node in sql_coroutine_mempool.
+                 E_SQL_OPEN_DATABASE: no executor has an open connection.
+
+ */
+
+ErrorCode submit_sql_coroutine(SqlCoroutineScheduler *scheduler,
+                               SqlCoroutineRoutine routine,
+                               SqlCoroutineCompletion completion,
+                               void *argument,
+                               char *content,
+                               int content_size,
+                               char *address);
+
+/*
+  send_sql_coroutine_statement:
+
+     This function sends a statement on the connection of the coroutine 
+     without waiting for its result. It is called by 
+     SQL_COROUTINE_AWAIT_STATEMENT.
+
+  Parameters:
+
+     co - The pointer to the coroutine
+
+     sql - The statement
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_SQL_EXECUTE: the statement cannot be sent.
+
+ */
+
+ErrorCode send_sql_coroutine_statement(SqlCoroutine *co, char *sql);
+
+/*
+  sql_coroutine_executor:
+
+     This function is executed by each executor thread until the server 
+     stops. It starts waiting coroutines on its free connections, waits on 
+     the sockets of the busy connections, and resumes each coroutine whose 
+     result has arrived.
+
+  Parameters:
+
+     _executor - The pointer to the executor
+
+  Return value:
+
+     None
+
+ */
+
+void *sql_coroutine_executor(void *_executor);
+
+/*
+  get_sql_coroutine_report:
+
+     This function writes the numbers of waiting, running, finished and 
+     failed coroutines into buf.
+
+  Parameters:
+
+     scheduler - The pointer to the scheduler
+
+     buf - The output buffer
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_sql_coroutine_report(SqlCoroutineScheduler *scheduler, 
+                              char *buf, 
+                              size_t buf_len);
+
+#endif
@@ -43,15 +43,81 @@
  */
 
 #include "SqlWrapper.h"
+#include "CpuAffinity.h"
+#include "StageProfiler.h"
+
+/* The database connection owned by the calling worker thread */
+static THREAD_LOCAL DBConnectionNode *dedicated_db_connection = NULL;
+
+/* The connection pool which the dedicated connection belongs to */
+static THREAD_LOCAL DBConnectionListHead *dedicated_db_connection_list_head = 
+    NULL;
+
+/* The clock time in seconds before which the calling worker thread does not 
+   try to open its dedicated connection again */
+static THREAD_LOCAL int dedicated_db_connection_retry_time = 0;
+
+/* The flag indicating whether all dedicated connections were taken when the 
+   calling worker thread tried to bind one. The thread then stays on the 
+   shared pool instead of taking the lock of the pool again per packet. */
+static THREAD_LOCAL bool is_dedicated_db_connection_unavailable = false;
+
+/* Close the dedicated connection of the calling worker thread and give its 
+   slot back. The thread uses the shared pool until the retry interval has 
+   passed. */
+static void SQL_close_dedicated_database_connection(){
+
+    DBConnectionListHead *db_connection_list_head = 
+        dedicated_db_connection_list_head;
+
+    pthread_mutex_lock(&db_connection_list_head->list_lock);
+
+    remove_list_node(&dedicated_db_connection->list_entry);
+    db_connection_list_head->number_of_dedicated_connections--;
+
+    pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+    zlog_error(category_debug, 
+               "Close broken dedicated database connection serial_id=[%d]",
+               dedicated_db_connection->serial_id);
+
+    PQfinish(dedicated_db_connection->db);
+    free(dedicated_db_connection);
+
+    dedicated_db_connection = NULL;
+    dedicated_db_connection_list_head = NULL;
+
+    dedicated_db_connection_retry_time = 
+        get_cached_clock_time() + 
+        SQL_DEDICATED_CONNECTION_RETRY_INTERVAL_IN_SEC;
+}
+
+static void SQL_get_current_timestamp(char *buf){
+
+    /* The violation pipeline reads the server clock through the clock 
+       cache, so a simulated clock moves the database timestamps too */
+    if(true == clock_cache.is_simulated){
+        sprintf(buf, "TO_TIMESTAMP(%d)", get_cached_system_time());
+    }else{
+        sprintf(buf, "NOW()");
+    }
+}
 
 static ErrorCode SQL_execute(PGconn *db_conn, char *sql_statement){
 
     PGresult *res;
+    long long profile_start_time = 0;
 
     zlog_info(category_debug, "SQL command = [%s]", sql_statement);
 
+    profile_start_time = begin_profile_stage(&stage_profiler);
+
     res = PQexec(db_conn, sql_statement);
 
+    end_profile_stage(&stage_profiler, 
+                      PROFILE_STAGE_SQL_EXECUTE, 
+                      profile_start_time);
+
     if(PQresultStatus(res) != PGRES_COMMAND_OK){
 
         zlog_error(category_debug, 
@@ -112,7 +178,8 @@ static ErrorCode SQL_rollback_transaction(PGconn *db_conn){
 ErrorCode SQL_create_database_connection_pool(
     char *conninfo, 
     DBConnectionListHead * db_connection_list_head,
-    int max_connection){
+    int max_connection,
+    int max_dedicated_connection){
 
     int i;
     int retry_times = MEMORY_ALLOCATE_RETRIES;
@@ -120,6 +187,23 @@ ErrorCode SQL_create_database_connection_pool(
 
     pthread_mutex_lock(&db_connection_list_head->list_lock);
 
+    init_entry(&db_connection_list_head->dedicated_list_head);
+
+    memset(db_connection_list_head->conninfo, 0, 
+           sizeof(db_connection_list_head->conninfo));
+    strncpy(db_connection_list_head->conninfo, conninfo, 
+            sizeof(db_connection_list_head->conninfo) - 1);
+
+    db_connection_list_head->number_of_shared_connections = max_connection;
+    db_connection_list_head->max_dedicated_connections = 
+        max_dedicated_connection;
+    db_connection_list_head->number_of_dedicated_connections = 0;
+    db_connection_list_head->next_dedicated_serial_id = max_connection;
+    db_connection_list_head->number_of_lock_acquisitions = 0;
+    db_connection_list_head->number_of_shared_hits = 0;
+    db_connection_list_head->number_of_failures = 0;
+    db_connection_list_head->listen_db = NULL;
+
     for(i = 0; i< max_connection; i++){
     
         while(retry_times --){
@@ -188,6 +272,29 @@ ErrorCode SQL_destroy_database_connection_pool(
         free(current_list_ptr);
     }
 
+    list_for_each_safe(current_list_entry,
+                       next_list_entry, 
+                       &db_connection_list_head->dedicated_list_head){
+
+        current_list_ptr = ListEntry(current_list_entry,
+                                     DBConnectionNode,
+                                     list_entry);
+
+        conn = (PGconn*) current_list_ptr->db;
+        PQfinish(conn);
+
+        remove_list_node(current_list_entry);
+
+        free(current_list_ptr);
+    }
+
+    db_connection_list_head->number_of_dedicated_connections = 0;
+
+    if(NULL != db_connection_list_head->listen_db){
+        PQfinish(db_connection_list_head->listen_db);
+        db_connection_list_head->listen_db = NULL;
+    }
+
     pthread_mutex_unlock(&db_connection_list_head->list_lock);
 
     return WORK_SUCCESSFULLY;
@@ -202,10 +309,39 @@ static ErrorCode SQL_get_database_connection(
     DBConnectionNode * current_list_ptr = NULL;
     int retry_times = SQL_GET_AVAILABLE_CONNECTION_RETRIES;
 
+    /* The dedicated connection is only accessed by its owner thread, so it 
+       is taken without the lock. It is in use when the owner already holds 
+       it, for example while iterating a result set. */
+    if(dedicated_db_connection != NULL && 
+       dedicated_db_connection_list_head == db_connection_list_head &&
+       dedicated_db_connection->is_used == 0 &&
+       CONNECTION_BAD == PQstatus(dedicated_db_connection->db)){
+
+        PQreset(dedicated_db_connection->db);
+
+        if(CONNECTION_BAD == PQstatus(dedicated_db_connection->db)){
+            SQL_close_dedicated_database_connection();
+        }
+    }
+
+    if(dedicated_db_connection != NULL && 
+       dedicated_db_connection_list_head == db_connection_list_head &&
+       dedicated_db_connection->is_used == 0){
+
+        *db = (PGconn*) dedicated_db_connection->db;
+        *serial_id = dedicated_db_connection->serial_id;
+        dedicated_db_connection->is_used = 1;
+        SQL_ATOMIC_INCREMENT(dedicated_db_connection->number_of_uses);
+
+        return WORK_SUCCESSFULLY;
+    }
+
     while(retry_times --){
 
         pthread_mutex_lock(&db_connection_list_head->list_lock);
 
+        db_connection_list_head->number_of_lock_acquisitions++;
+
         list_for_each(current_list_entry,
                       &db_connection_list_head->list_head){
             
@@ -219,6 +355,8 @@ static ErrorCode SQL_get_database_connection(
                *serial_id = current_list_ptr->serial_id;
                current_list_ptr->is_used = 1;
 
+               db_connection_list_head->number_of_shared_hits++;
+
                pthread_mutex_unlock(&db_connection_list_head->list_lock);
                return WORK_SUCCESSFULLY;
            } 
@@ -227,6 +365,10 @@ static ErrorCode SQL_get_database_connection(
 
     }
 
+    pthread_mutex_lock(&db_connection_list_head->list_lock);
+    db_connection_list_head->number_of_failures++;
+    pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
     return E_SQL_OPEN_DATABASE;
 }
 
@@ -237,8 +379,19 @@ static ErrorCode SQL_release_database_connection(
     List_Entry *current_list_entry = NULL;
     DBConnectionNode *current_list_ptr = NULL;
 
+    if(dedicated_db_connection != NULL && 
+       dedicated_db_connection_list_head == db_connection_list_head &&
+       dedicated_db_connection->serial_id == serial_id){
+
+        dedicated_db_connection->is_used = 0;
+
+        return WORK_SUCCESSFULLY;
+    }
+
     pthread_mutex_lock(&db_connection_list_head->list_lock);
 
+    db_connection_list_head->number_of_lock_acquisitions++;
+
     list_for_each(current_list_entry,
                   &db_connection_list_head->list_head){
         current_list_ptr = ListEntry(current_list_entry,
@@ -257,6 +410,160 @@ static ErrorCode SQL_release_database_connection(
     return E_SQL_OPEN_DATABASE;
 }
 
+ErrorCode SQL_bind_dedicated_database_connection(
+    DBConnectionListHead *db_connection_list_head){
+
+    DBConnectionNode *db_connection = NULL;
+    int retry_times = MEMORY_ALLOCATE_RETRIES;
+    int serial_id = 0;
+
+    if(dedicated_db_connection != NULL ||
+       true == is_dedicated_db_connection_unavailable ||
+       0 >= db_connection_list_head->max_dedicated_connections){
+        return WORK_SUCCESSFULLY;
+    }
+
+    /* Every packet would otherwise wait for another failed connection 
+       attempt while the database is unreachable */
+    if(get_cached_clock_time() < dedicated_db_connection_retry_time){
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    /* Reserve a slot first, so the connection is opened outside the lock */
+    pthread_mutex_lock(&db_connection_list_head->list_lock);
+
+    db_connection_list_head->number_of_lock_acquisitions++;
+
+    if(db_connection_list_head->number_of_dedicated_connections >= 
+       db_connection_list_head->max_dedicated_connections){
+
+        pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+        is_dedicated_db_connection_unavailable = true;
+
+        return WORK_SUCCESSFULLY;
+    }
+
+    serial_id = db_connection_list_head->next_dedicated_serial_id;
+    db_connection_list_head->next_dedicated_serial_id++;
+    db_connection_list_head->number_of_dedicated_connections++;
+
+    pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+    while(retry_times --){
+        db_connection = malloc(sizeof(DBConnectionNode));
+        if(NULL != db_connection)
+            break;
+    }
+    if(NULL == db_connection){
+        zlog_error(category_debug, 
+                   "SQL_bind_dedicated_database_connection malloc failed");
+
+        pthread_mutex_lock(&db_connection_list_head->list_lock);
+        db_connection_list_head->number_of_dedicated_connections--;
+        pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+        return E_MALLOC;
+    }
+    memset(db_connection, 0, sizeof(DBConnectionNode));
+
+    init_entry(&db_connection->list_entry);
+
+    db_connection->serial_id = serial_id;
+    db_connection->is_used = 0;
+    db_connection->is_dedicated = 1;
+    db_connection->db = (PGconn*) PQconnectdb(
+        db_connection_list_head->conninfo);
+
+    if(PQstatus(db_connection->db) != CONNECTION_OK){
+
+        zlog_error(category_debug,
+                   "Connect to database failed: %s",
+                   PQerrorMessage(db_connection->db));
+
+        PQfinish(db_connection->db);
+        free(db_connection);
+
+        pthread_mutex_lock(&db_connection_list_head->list_lock);
+        db_connection_list_head->number_of_dedicated_connections--;
+        pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+        dedicated_db_connection_retry_time = 
+            get_cached_clock_time() + 
+            SQL_DEDICATED_CONNECTION_RETRY_INTERVAL_IN_SEC;
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    pthread_mutex_lock(&db_connection_list_head->list_lock);
+
+    insert_list_tail(&db_connection->list_entry, 
+                     &db_connection_list_head->dedicated_list_head);
+
+    pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+    dedicated_db_connection = db_connection;
+    dedicated_db_connection_list_head = db_connection_list_head;
+
+    zlog_info(category_debug, 
+              "Bind dedicated database connection serial_id=[%d]", 
+              serial_id);
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode SQL_report_database_connection_metrics(
+    DBConnectionListHead *db_connection_list_head){
+
+    List_Entry *current_list_entry = NULL;
+    DBConnectionNode *current_list_ptr = NULL;
+    int number_of_shared_in_use = 0;
+    long number_of_dedicated_uses = 0;
+
+    pthread_mutex_lock(&db_connection_list_head->list_lock);
+
+    list_for_each(current_list_entry,
+                  &db_connection_list_head->list_head){
+        current_list_ptr = ListEntry(current_list_entry,
+                                     DBConnectionNode,
+                                     list_entry);
+        if(current_list_ptr->is_used){
+            number_of_shared_in_use++;
+        }
+    }
+
+    list_for_each(current_list_entry,
+                  &db_connection_list_head->dedicated_list_head){
+        current_list_ptr = ListEntry(current_list_entry,
+                                     DBConnectionNode,
+                                     list_entry);
+
+        number_of_dedicated_uses += current_list_ptr->number_of_uses;
+
+        zlog_info(category_health_report, 
+                  "Dedicated database connection serial_id=[%d] uses=[%ld]",
+                  current_list_ptr->serial_id,
+                  current_list_ptr->number_of_uses);
+    }
+
+    zlog_info(category_health_report, 
+              "Database connections: shared=[%d] shared_in_use=[%d] " \
+              "dedicated=[%d/%d] dedicated_uses=[%ld] shared_hits=[%d] " \
+              "lock_acquisitions=[%d] failures=[%d]",
+              db_connection_list_head->number_of_shared_connections,
+              number_of_shared_in_use,
+              db_connection_list_head->number_of_dedicated_connections,
+              db_connection_list_head->max_dedicated_connections,
+              number_of_dedicated_uses,
+              db_connection_list_head->number_of_shared_hits,
+              db_connection_list_head->number_of_lock_acquisitions,
+              db_connection_list_head->number_of_failures);
+
+    pthread_mutex_unlock(&db_connection_list_head->list_lock);
+
+    return WORK_SUCCESSFULLY;
+}
+
 ErrorCode SQL_vacuum_database(
     DBConnectionListHead *db_connection_list_head){
 
@@ -411,112 +718,287 @@ ErrorCode SQL_delete_old_data(
 }
 
 
-ErrorCode SQL_update_gateway_registration_status(
-    DBConnectionListHead *db_connection_list_head,
-    char *buf,
-    size_t buf_len){
+/* Splits a CSV row of COPY TO STDOUT in place. Empty fields, which are NULL 
+   values, are kept as empty strings. */
+static int SQL_split_copy_row(char *row, char **fields, int max_fields){
 
-    PGconn *db_conn = NULL;
-    int db_serial_id = -1;
-    ErrorCode ret_val = WORK_SUCCESSFULLY;
-    char temp_buf[WIFI_MESSAGE_LENGTH];
-    char *saveptr = NULL;
-    char *numbers_str = NULL;
-    int numbers = 0;
-    char sql[SQL_TEMP_BUFFER_LENGTH];
-    char *sql_template = "INSERT INTO gateway_table " \
-                         "(ip_address, " \
-                         "health_status, " \
-                         "registered_timestamp, " \
-                         "last_report_timestamp) " \
-                         "VALUES " \
-                         "(%s, \'%d\', NOW(), NOW())" \
-                         "ON CONFLICT (ip_address) " \
-                         "DO UPDATE SET health_status = \'%d\', " \
-                         "last_report_timestamp = NOW();";
-    HealthStatus health_status = S_NORMAL_STATUS;
-    char *ip_address = NULL;
-    char *pqescape_ip_address = NULL;
+    int number_of_fields = 0;
+    char *current = row;
+    char *delimiter = NULL;
 
+    while(number_of_fields < max_fields){
+        fields[number_of_fields] = current;
+        number_of_fields++;
 
-    memset(temp_buf, 0, sizeof(temp_buf));
-    memcpy(temp_buf, buf, buf_len);
+        delimiter = strchr(current, ',');
+        if(NULL == delimiter){
+            break;
+        }
+        *delimiter = '\0';
+        current = delimiter + 1;
+    }
 
-    numbers_str = strtok_save(temp_buf, DELIMITER_SEMICOLON, &saveptr);
-    if(numbers_str == NULL){
-        return E_API_PROTOCOL_FORMAT;
+    /* Strip the line feed at the end of the row */
+    delimiter = strchr(fields[number_of_fields - 1], '\n');
+    if(NULL != delimiter){
+        *delimiter = '\0';
     }
-    numbers = atoi(numbers_str);
 
-    if(numbers <= 0){
-        return E_SQL_PARSE;
+    return number_of_fields;
+}
+
+static ErrorCode SQL_archive_tracking_chunk(PGconn *db_conn,
+                                            char *chunk_name,
+                                            char *archive_directory){
+
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    char filename[MAX_PATH];
+    char temp_filename[MAX_PATH];
+    char *table_name = NULL;
+    FILE *file = NULL;
+    TrackingArchiveWriter writer;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    PGresult *res = NULL;
+    char *row = NULL;
+    int row_len = 0;
+    char *fields[NUMBER_FIELDS_OF_ARCHIVED_TRACKING_DATA];
+
+    char *sql_copy_template = 
+        "COPY (" \
+        "SELECT object_mac_address, " \
+        "lbeacon_uuid, " \
+        "rssi, " \
+        "panic_button, " \
+        "battery_voltage, " \
+        "EXTRACT(EPOCH FROM initial_timestamp)::bigint, " \
+        "EXTRACT(EPOCH FROM final_timestamp)::bigint " \
+        "FROM %s " \
+        "ORDER BY final_timestamp ASC" \
+        ") TO STDOUT WITH CSV;";
+
+    const int FIELD_INDEX_OF_MAC_ADDRESS = 0;
+    const int FIELD_INDEX_OF_UUID = 1;
+    const int FIELD_INDEX_OF_RSSI = 2;
+    const int FIELD_INDEX_OF_PANIC_BUTTON = 3;
+    const int FIELD_INDEX_OF_BATTERY_VOLTAGE = 4;
+    const int FIELD_INDEX_OF_INITIAL_TIMESTAMP = 5;
+    const int FIELD_INDEX_OF_FINAL_TIMESTAMP = 6;
+
+    table_name = strrchr(chunk_name, '.');
+    table_name = (NULL == table_name) ? chunk_name : table_name + 1;
+
+    memset(filename, 0, sizeof(filename));
+    sprintf(filename, "%s/%s%s", archive_directory, table_name, 
+            TRACKING_ARCHIVE_FILE_EXTENSION);
+
+    /* The chunk was archived in an earlier round but not dropped yet */
+    file = fopen(filename, "rb");
+    if(NULL != file){
+        fclose(file);
+        return WORK_SUCCESSFULLY;
     }
 
-    if(WORK_SUCCESSFULLY != 
-       SQL_get_database_connection(db_connection_list_head, 
-                                   &db_conn, 
-                                   &db_serial_id)){
-        zlog_error(category_debug,
-                   "cannot operate database");
+    /* Write to a temporary file first, so an interrupted archival never 
+       leaves a partial archive file behind */
+    memset(temp_filename, 0, sizeof(temp_filename));
+    sprintf(temp_filename, "%s.tmp", filename);
 
-        return E_SQL_OPEN_DATABASE;
+    ret_val = open_tracking_archive_writer(&writer, temp_filename);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
     }
 
-    while( numbers-- ){
-        
-        ip_address = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-       
-        /* Create SQL statement */
-        pqescape_ip_address =
-            PQescapeLiteral(db_conn, ip_address, strlen(ip_address));
+    memset(sql, 0, sizeof(sql));
+    sprintf(sql, sql_copy_template, chunk_name);
 
-        memset(sql, 0, sizeof(sql));
-        sprintf(sql, sql_template,
-                pqescape_ip_address,
-                health_status, health_status);
+    zlog_info(category_debug, "SQL command = [%s]", sql);
 
-        PQfreemem(pqescape_ip_address);
+    res = PQexec(db_conn, sql);
 
-        /* Execute SQL statement */
-        ret_val = SQL_execute(db_conn, sql);
+    if(PQresultStatus(res) != PGRES_COPY_OUT){
+        PQclear(res);
 
-        if(WORK_SUCCESSFULLY != ret_val){
-            
-            SQL_release_database_connection(
-                db_connection_list_head,
-                db_serial_id);
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
 
-            return E_SQL_EXECUTE;
+        close_tracking_archive_writer(&writer);
+        remove(temp_filename);
+
+        return E_SQL_EXECUTE;
+    }
+    PQclear(res);
+
+    /* The rows are streamed one at a time, so the memory usage does not 
+       depend on the size of the chunk */
+    while((row_len = PQgetCopyData(db_conn, &row, 0)) > 0){
+
+        if(WORK_SUCCESSFULLY == ret_val &&
+           NUMBER_FIELDS_OF_ARCHIVED_TRACKING_DATA == 
+           SQL_split_copy_row(row, 
+                              fields, 
+                              NUMBER_FIELDS_OF_ARCHIVED_TRACKING_DATA)){
+
+            ret_val = append_tracking_archive_row(
+                &writer,
+                fields[FIELD_INDEX_OF_MAC_ADDRESS],
+                fields[FIELD_INDEX_OF_UUID],
+                atoi(fields[FIELD_INDEX_OF_RSSI]),
+                atoi(fields[FIELD_INDEX_OF_PANIC_BUTTON]),
+                atoi(fields[FIELD_INDEX_OF_BATTERY_VOLTAGE]),
+                strtoll(fields[FIELD_INDEX_OF_INITIAL_TIMESTAMP], NULL, 10),
+                strtoll(fields[FIELD_INDEX_OF_FINAL_TIMESTAMP], NULL, 10));
         }
+
+        PQfreemem(row);
     }
 
-    SQL_release_database_connection(
-        db_connection_list_head,
-        db_serial_id);
+    if(-2 == row_len){
+        zlog_error(category_debug, "PQgetCopyData failed: %s", 
+                   PQerrorMessage(db_conn));
+        ret_val = E_SQL_EXECUTE;
+    }
+
+    while(NULL != (res = PQgetResult(db_conn))){
+        if(PQresultStatus(res) != PGRES_COMMAND_OK){
+            zlog_error(category_debug, "SQL_execute failed: %s", 
+                       PQerrorMessage(db_conn));
+            ret_val = E_SQL_EXECUTE;
+        }
+        PQclear(res);
+    }
+
+    if(WORK_SUCCESSFULLY != close_tracking_archive_writer(&writer)){
+        ret_val = E_OPEN_FILE;
+    }
+
+    if(WORK_SUCCESSFULLY != ret_val){
+        remove(temp_filename);
+        return ret_val;
+    }
+
+    if(0 != rename(temp_filename, filename)){
+        zlog_error(category_debug, "cannot rename %s", temp_filename);
+        remove(temp_filename);
+        return E_OPEN_FILE;
+    }
+
+    zlog_info(category_debug, "archived chunk [%s] into [%s]", 
+              chunk_name, filename);
 
     return WORK_SUCCESSFULLY;
 }
 
-ErrorCode SQL_update_lbeacon_registration_status(
+ErrorCode SQL_archive_expiring_tracking_data(
     DBConnectionListHead *db_connection_list_head,
-    char *buf,
-    size_t buf_len,
-    char *gateway_ip_address){
+    int retention_hours,
+    char *archive_directory){
 
     PGconn *db_conn = NULL;
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
-    char temp_buf[WIFI_MESSAGE_LENGTH];
-    char *saveptr = NULL;
-    char *numbers_str = NULL;
-    int numbers = 0;
     char sql[SQL_TEMP_BUFFER_LENGTH];
-    char *sql_template = "INSERT INTO lbeacon_table " \
-                         "(uuid, " \
-                         "ip_address, " \
-                         "health_status, " \
-                         "gateway_ip_address, " \
-                         "registered_timestamp, " \
+    char *sql_select_template = "SELECT show_chunks(\'tracking_table\', " \
+                                "older_than => INTERVAL \'%d HOURS\');";
+    PGresult *res = NULL;
+    int total_rows = 0;
+    int i;
+
+    memset(sql, 0, sizeof(sql));
+    sprintf(sql, sql_select_template, retention_hours);
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+        zlog_error(category_debug,
+                   "cannot operate database");
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    res = PQexec(db_conn, sql);
+
+    if(PQresultStatus(res) != PGRES_TUPLES_OK){
+        PQclear(res);
+
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        SQL_release_database_connection(
+            db_connection_list_head,
+            db_serial_id);
+
+        return E_SQL_EXECUTE;
+    }
+
+    total_rows = PQntuples(res);
+
+    for(i = 0 ; i < total_rows ; i++){
+
+        ret_val = SQL_archive_tracking_chunk(db_conn, 
+                                             PQgetvalue(res, i, 0),
+                                             archive_directory);
+
+        if(WORK_SUCCESSFULLY != ret_val){
+            zlog_error(category_debug, 
+                       "cannot archive chunk [%s]", PQgetvalue(res, i, 0));
+            break;
+        }
+    }
+
+    PQclear(res);
+
+    SQL_release_database_connection(
+        db_connection_list_head,
+        db_serial_id);
+
+    return ret_val;
+}
+
+/* The statements shared by the blocking updates and their coroutines. Each 
+   writes one statement into sql of SQL_TEMP_BUFFER_LENGTH bytes. */
+
+static void SQL_format_gateway_registration(PGconn *db_conn,
+                                            char *ip_address,
+                                            char *sql){
+
+    char *sql_template = "INSERT INTO gateway_table " \
+                         "(ip_address, " \
+                         "health_status, " \
+                         "registered_timestamp, " \
+                         "last_report_timestamp) " \
+                         "VALUES " \
+                         "(%s, \'%d\', NOW(), NOW())" \
+                         "ON CONFLICT (ip_address) " \
+                         "DO UPDATE SET health_status = \'%d\', " \
+                         "last_report_timestamp = NOW();";
+    HealthStatus health_status = S_NORMAL_STATUS;
+    char *pqescape_ip_address = NULL;
+
+    pqescape_ip_address =
+        PQescapeLiteral(db_conn, ip_address, strlen(ip_address));
+
+    memset(sql, 0, SQL_TEMP_BUFFER_LENGTH);
+    sprintf(sql, sql_template,
+            pqescape_ip_address,
+            health_status, health_status);
+
+    PQfreemem(pqescape_ip_address);
+}
+
+static void SQL_format_lbeacon_registration(PGconn *db_conn,
+                                            char *uuid,
+                                            char *registered_timestamp_GMT,
+                                            char *lbeacon_ip,
+                                            char *gateway_ip_address,
+                                            char *sql){
+
+    char *sql_template = "INSERT INTO lbeacon_table " \
+                         "(uuid, " \
+                         "ip_address, " \
+                         "health_status, " \
+                         "gateway_ip_address, " \
+                         "registered_timestamp, " \
                          "last_report_timestamp, " \
                          "coordinate_x, " \
                          "coordinate_y) " \
@@ -533,10 +1015,6 @@ ErrorCode SQL_update_lbeacon_registration_status(
                          "coordinate_x = %d, " \
                          "coordinate_y = %d;";
     HealthStatus health_status = S_NORMAL_STATUS;
-    char *uuid = NULL;
-    char *lbeacon_ip = NULL;
-    char *not_used_gateway_ip = NULL;
-    char *registered_timestamp_GMT = NULL;
     char *pqescape_uuid = NULL;
     char *pqescape_lbeacon_ip = NULL;
     char *pqescape_gateway_ip = NULL;
@@ -546,26 +1024,156 @@ ErrorCode SQL_update_lbeacon_registration_status(
     char coordinate_y[LENGTH_OF_UUID];
     int int_coordinate_x = 0;
     int int_coordinate_y = 0;
-	const int INDEX_OF_COORDINATE_X_IN_UUID = 12;
+    const int INDEX_OF_COORDINATE_X_IN_UUID = 12;
     const int INDEX_OF_COORDINATE_Y_IN_UUID = 24;
     const int LENGTH_OF_COORDINATE_IN_UUID = 8;
+
+    memset(str_uuid, 0, sizeof(str_uuid));
+    strcpy(str_uuid, uuid);
+
+    memset(coordinate_x, 0, sizeof(coordinate_x));
+    memset(coordinate_y, 0, sizeof(coordinate_y));
     
-	
+    strncpy(coordinate_x, 
+            &str_uuid[INDEX_OF_COORDINATE_X_IN_UUID], 
+            LENGTH_OF_COORDINATE_IN_UUID);
+    strncpy(coordinate_y, 
+            &str_uuid[INDEX_OF_COORDINATE_Y_IN_UUID], 
+            LENGTH_OF_COORDINATE_IN_UUID);
+
+    int_coordinate_x = atoi(coordinate_x);
+    int_coordinate_y = atoi(coordinate_y);
+
+    pqescape_uuid = 
+        PQescapeLiteral(db_conn, uuid, strlen(uuid));
+    pqescape_lbeacon_ip =
+        PQescapeLiteral(db_conn, lbeacon_ip, strlen(lbeacon_ip));
+    pqescape_gateway_ip =
+        PQescapeLiteral(db_conn, gateway_ip_address, 
+                        strlen(gateway_ip_address));
+    pqescape_registered_timestamp_GMT =
+        PQescapeLiteral(db_conn, registered_timestamp_GMT,
+                        strlen(registered_timestamp_GMT));
+
+    memset(sql, 0, SQL_TEMP_BUFFER_LENGTH);
+    sprintf(sql, sql_template,
+            pqescape_uuid,
+            pqescape_lbeacon_ip,
+            health_status,
+            pqescape_gateway_ip,
+            pqescape_registered_timestamp_GMT,
+            int_coordinate_x,
+            int_coordinate_y,
+            pqescape_lbeacon_ip,
+            health_status,
+            pqescape_gateway_ip,
+            int_coordinate_x,
+            int_coordinate_y);
+
+    PQfreemem(pqescape_uuid);
+    PQfreemem(pqescape_lbeacon_ip);
+    PQfreemem(pqescape_gateway_ip);
+    PQfreemem(pqescape_registered_timestamp_GMT);
+}
+
+static void SQL_format_gateway_health(PGconn *db_conn,
+                                      char *health_status,
+                                      char *gateway_ip_address,
+                                      char *sql){
+
+    char *sql_template = "UPDATE gateway_table " \
+                         "SET health_status = %s, " \
+                         "last_report_timestamp = NOW() " \
+                         "WHERE ip_address = %s ;" ;
+    char *pqescape_ip_address = NULL;
+    char *pqescape_health_status = NULL;
+
+    pqescape_ip_address =
+        PQescapeLiteral(db_conn, gateway_ip_address, strlen(gateway_ip_address));
+    pqescape_health_status =
+        PQescapeLiteral(db_conn, health_status, strlen(health_status));
+
+    memset(sql, 0, SQL_TEMP_BUFFER_LENGTH);
+    sprintf(sql, sql_template,
+            pqescape_health_status,
+            pqescape_ip_address);
+
+    PQfreemem(pqescape_ip_address);
+    PQfreemem(pqescape_health_status);
+}
+
+static void SQL_format_lbeacon_health(PGconn *db_conn,
+                                      char *lbeacon_uuid,
+                                      char *health_status,
+                                      char *gateway_ip_address,
+                                      char *sql){
+
+    char *sql_template = "UPDATE lbeacon_table " \
+                         "SET health_status = %s, " \
+                         "last_report_timestamp = NOW(), " \
+                         "gateway_ip_address = %s " \
+                         "WHERE uuid = %s ;";
+    char *pqescape_lbeacon_uuid = NULL;
+    char *pqescape_health_status = NULL;
+    char *pqescape_gateway_ip = NULL;
+
+    pqescape_lbeacon_uuid = 
+        PQescapeLiteral(db_conn, lbeacon_uuid, strlen(lbeacon_uuid));
+    pqescape_health_status =
+        PQescapeLiteral(db_conn, health_status, strlen(health_status));
+    pqescape_gateway_ip = 
+        PQescapeLiteral(db_conn, gateway_ip_address, strlen(gateway_ip_address));
+
+    memset(sql, 0, SQL_TEMP_BUFFER_LENGTH);
+    sprintf(sql, sql_template,
+            pqescape_health_status,
+            pqescape_gateway_ip,
+            pqescape_lbeacon_uuid);
+
+    PQfreemem(pqescape_lbeacon_uuid);
+    PQfreemem(pqescape_health_status);
+    PQfreemem(pqescape_gateway_ip);
+}
+
+ErrorCode SQL_update_gateway_registration_status(
+    DBConnectionListHead *db_connection_list_head,
+    char *buf,
+    size_t buf_len){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    char temp_buf[WIFI_MESSAGE_LENGTH];
+    ProtocolCursor cursor;
+    GatewayRegistrationHeaderFields header;
+    GatewayRegistrationItemFields item;
+    int numbers = 0;
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+
+
+    if(buf_len >= sizeof(temp_buf)){
+        return E_INPUT_PARAMETER;
+    }
+
     memset(temp_buf, 0, sizeof(temp_buf));
     memcpy(temp_buf, buf, buf_len);
 
-    numbers_str = strtok_save(temp_buf, DELIMITER_SEMICOLON, &saveptr);
-    if(numbers_str == NULL){
+    open_protocol_cursor(&cursor, temp_buf);
+
+    if(WORK_SUCCESSFULLY != 
+       decode_gateway_registration_header(&cursor, &header) ||
+       WORK_SUCCESSFULLY != 
+       decode_protocol_count(&cursor, 
+                             header.number_of_gateways,
+                             NUMBER_OF_GATEWAY_REGISTRATION_ITEM_FIELDS,
+                             &numbers)){
         return E_API_PROTOCOL_FORMAT;
     }
-    numbers = atoi(numbers_str);
 
     if(numbers <= 0){
         return E_SQL_PARSE;
     }
 
-    not_used_gateway_ip = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-
     if(WORK_SUCCESSFULLY != 
        SQL_get_database_connection(db_connection_list_head, 
                                    &db_conn, 
@@ -577,60 +1185,109 @@ ErrorCode SQL_update_lbeacon_registration_status(
     }
 
     while( numbers-- ){
-        uuid = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+        
+        if(WORK_SUCCESSFULLY != 
+           decode_gateway_registration_item(&cursor, &item)){
 
-        memset(str_uuid, 0, sizeof(str_uuid));
-        strcpy(str_uuid, uuid);
+            SQL_release_database_connection(
+                db_connection_list_head,
+                db_serial_id);
 
-        memset(coordinate_x, 0, sizeof(coordinate_x));
-        memset(coordinate_y, 0, sizeof(coordinate_y));
-        
-        strncpy(coordinate_x, 
-                &str_uuid[INDEX_OF_COORDINATE_X_IN_UUID], 
-                LENGTH_OF_COORDINATE_IN_UUID);
-        strncpy(coordinate_y, 
-                &str_uuid[INDEX_OF_COORDINATE_Y_IN_UUID], 
-                LENGTH_OF_COORDINATE_IN_UUID);
+            return E_API_PROTOCOL_FORMAT;
+        }
+       
+        /* Create SQL statement */
+        SQL_format_gateway_registration(db_conn, item.ip_address, sql);
 
-        int_coordinate_x = atoi(coordinate_x);
-        int_coordinate_y = atoi(coordinate_y);
+        /* Execute SQL statement */
+        ret_val = SQL_execute(db_conn, sql);
 
-        registered_timestamp_GMT = 
-            strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-        lbeacon_ip = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+        if(WORK_SUCCESSFULLY != ret_val){
+            
+            SQL_release_database_connection(
+                db_connection_list_head,
+                db_serial_id);
 
-        /* Create SQL statement */
-        memset(sql, 0, sizeof(sql));
+            return E_SQL_EXECUTE;
+        }
+    }
+
+    SQL_release_database_connection(
+        db_connection_list_head,
+        db_serial_id);
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode SQL_update_lbeacon_registration_status(
+    DBConnectionListHead *db_connection_list_head,
+    char *buf,
+    size_t buf_len,
+    char *gateway_ip_address){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    char temp_buf[WIFI_MESSAGE_LENGTH];
+    ProtocolCursor cursor;
+    LBeaconRegistrationHeaderFields header;
+    LBeaconRegistrationItemFields item;
+    int numbers = 0;
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    
+	
+    if(buf_len >= sizeof(temp_buf)){
+        return E_INPUT_PARAMETER;
+    }
+
+    memset(temp_buf, 0, sizeof(temp_buf));
+    memcpy(temp_buf, buf, buf_len);
+
+    open_protocol_cursor(&cursor, temp_buf);
 
-        pqescape_uuid = 
-            PQescapeLiteral(db_conn, uuid, strlen(uuid));
-        pqescape_lbeacon_ip =
-            PQescapeLiteral(db_conn, lbeacon_ip, strlen(lbeacon_ip));
-        pqescape_gateway_ip =
-            PQescapeLiteral(db_conn, gateway_ip_address, 
-                            strlen(gateway_ip_address));
-        pqescape_registered_timestamp_GMT =
-            PQescapeLiteral(db_conn, registered_timestamp_GMT,
-                            strlen(registered_timestamp_GMT));
-
-        sprintf(sql, sql_template,
-                pqescape_uuid,
-                pqescape_lbeacon_ip,
-                health_status,
-                pqescape_gateway_ip,
-                pqescape_registered_timestamp_GMT,
-                int_coordinate_x,
-                int_coordinate_y,
-                pqescape_lbeacon_ip,
-                health_status,
-                pqescape_gateway_ip,
-                int_coordinate_x,
-                int_coordinate_y);
-
-        PQfreemem(pqescape_uuid);
-        PQfreemem(pqescape_lbeacon_ip);
-        PQfreemem(pqescape_gateway_ip);
-        PQfreemem(pqescape_registered_timestamp_GMT);
+    /* The gateway address in the packet is not used */
+    if(WORK_SUCCESSFULLY != 
+       decode_lbeacon_registration_header(&cursor, &header) ||
+       WORK_SUCCESSFULLY != 
+       decode_protocol_count(&cursor, 
+                             header.number_of_lbeacons,
+                             NUMBER_OF_LBEACON_REGISTRATION_ITEM_FIELDS,
+                             &numbers)){
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    if(numbers <= 0){
+        return E_SQL_PARSE;
+    }
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+        zlog_error(category_debug,
+                   "cannot operate database");
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    while( numbers-- ){
+
+        if(WORK_SUCCESSFULLY != 
+           decode_lbeacon_registration_item(&cursor, &item)){
+
+            SQL_release_database_connection(
+                db_connection_list_head,
+                db_serial_id);
+            return E_API_PROTOCOL_FORMAT;
+        }
+
+        /* Create SQL statement */
+        SQL_format_lbeacon_registration(db_conn,
+                                        item.uuid,
+                                        item.registered_timestamp,
+                                        item.lbeacon_ip,
+                                        gateway_ip_address,
+                                        sql);
 
         /* Execute SQL statement */
         ret_val = SQL_execute(db_conn, sql);
@@ -661,23 +1318,24 @@ ErrorCode SQL_update_gateway_health_status(
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char temp_buf[WIFI_MESSAGE_LENGTH];
-    char *saveptr = NULL;
+    ProtocolCursor cursor;
+    GatewayHealthReportFields report;
     char sql[SQL_TEMP_BUFFER_LENGTH];
-    char *sql_template = "UPDATE gateway_table " \
-                         "SET health_status = %s, " \
-                         "last_report_timestamp = NOW() " \
-                         "WHERE ip_address = %s ;" ;
-    char *not_used_ip_address = NULL;
-    char *health_status = NULL;
-    char *pqescape_ip_address = NULL;
-    char *pqescape_health_status = NULL;
 
 
+    if(buf_len >= sizeof(temp_buf)){
+        return E_INPUT_PARAMETER;
+    }
+
     memset(temp_buf, 0, sizeof(temp_buf));
     memcpy(temp_buf, buf, buf_len);
 
-    not_used_ip_address = strtok_save(temp_buf, DELIMITER_SEMICOLON, &saveptr);
-    health_status = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+    open_protocol_cursor(&cursor, temp_buf);
+
+    /* The gateway address in the packet is not used */
+    if(WORK_SUCCESSFULLY != decode_gateway_health_report(&cursor, &report)){
+        return E_API_PROTOCOL_FORMAT;
+    }
 
     /* Create SQL statement */
     if(WORK_SUCCESSFULLY != 
@@ -690,18 +1348,10 @@ ErrorCode SQL_update_gateway_health_status(
         return E_SQL_OPEN_DATABASE;
     }
 
-    pqescape_ip_address =
-        PQescapeLiteral(db_conn, gateway_ip_address, strlen(gateway_ip_address));
-    pqescape_health_status =
-        PQescapeLiteral(db_conn, health_status, strlen(health_status));
-
-    memset(sql, 0, sizeof(sql));
-    sprintf(sql, sql_template,
-            pqescape_health_status,
-            pqescape_ip_address);
-
-    PQfreemem(pqescape_ip_address);
-    PQfreemem(pqescape_health_status);
+    SQL_format_gateway_health(db_conn, 
+                              report.health_status, 
+                              gateway_ip_address, 
+                              sql);
 
     /* Execute SQL statement */
     ret_val = SQL_execute(db_conn, sql);
@@ -729,29 +1379,23 @@ ErrorCode SQL_update_lbeacon_health_status(
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char temp_buf[WIFI_MESSAGE_LENGTH];
-    char *saveptr = NULL;
+    ProtocolCursor cursor;
+    LBeaconHealthReportFields report;
     char sql[SQL_TEMP_BUFFER_LENGTH];
-    char *sql_template = "UPDATE lbeacon_table " \
-                         "SET health_status = %s, " \
-                         "last_report_timestamp = NOW(), " \
-						 "gateway_ip_address = %s " \
-                         "WHERE uuid = %s ;";
-    char *lbeacon_uuid = NULL;
-    char *lbeacon_timestamp = NULL;
-    char *lbeacon_ip = NULL;
-    char *health_status = NULL;
-    char *pqescape_lbeacon_uuid = NULL;
-    char *pqescape_health_status = NULL;
-    char *pqescape_gateway_ip = NULL;
  
  
+    if(buf_len >= sizeof(temp_buf)){
+        return E_INPUT_PARAMETER;
+    }
+
     memset(temp_buf, 0, sizeof(temp_buf));
     memcpy(temp_buf, buf, buf_len);
 
-    lbeacon_uuid = strtok_save(temp_buf, DELIMITER_SEMICOLON, &saveptr);	
-    lbeacon_timestamp = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-    lbeacon_ip = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-    health_status = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+    open_protocol_cursor(&cursor, temp_buf);
+
+    if(WORK_SUCCESSFULLY != decode_lbeacon_health_report(&cursor, &report)){
+        return E_API_PROTOCOL_FORMAT;
+    }
 
 
     /* Create SQL statement */
@@ -764,22 +1408,12 @@ ErrorCode SQL_update_lbeacon_health_status(
 
         return E_SQL_OPEN_DATABASE;
     }
-    pqescape_lbeacon_uuid = 
-        PQescapeLiteral(db_conn, lbeacon_uuid, strlen(lbeacon_uuid));
-    pqescape_health_status =
-        PQescapeLiteral(db_conn, health_status, strlen(health_status));
-    pqescape_gateway_ip = 
-        PQescapeLiteral(db_conn, gateway_ip_address, strlen(gateway_ip_address));
 
-    memset(sql, 0, sizeof(sql));
-    sprintf(sql, sql_template,
-            pqescape_health_status,
-		    pqescape_gateway_ip,
-            pqescape_lbeacon_uuid);
-
-    PQfreemem(pqescape_lbeacon_uuid);
-    PQfreemem(pqescape_health_status);
-    PQfreemem(pqescape_gateway_ip);
+    SQL_format_lbeacon_health(db_conn, 
+                              report.lbeacon_uuid, 
+                              report.health_status, 
+                              gateway_ip_address, 
+                              sql);
 
     /* Execute SQL statement */
     ret_val = SQL_execute(db_conn, sql);
@@ -795,19 +1429,138 @@ ErrorCode SQL_update_lbeacon_health_status(
     return WORK_SUCCESSFULLY;
 }
 
+SqlCoroutineStatus SQL_update_registration_status_coroutine(
+    SqlCoroutine *co){
+
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    LBeaconRegistrationHeaderFields header;
+    LBeaconRegistrationItemFields item;
+
+    SQL_COROUTINE_BEGIN(co);
+
+    SQL_format_gateway_registration(co->db_conn, co->address, sql);
+
+    SQL_COROUTINE_AWAIT_STATEMENT(co, sql);
+
+    open_protocol_cursor(&co->cursor, co->buf);
+
+    /* The gateway address in the packet is not used */
+    if(WORK_SUCCESSFULLY != 
+       decode_lbeacon_registration_header(&co->cursor, &header) ||
+       WORK_SUCCESSFULLY != 
+       decode_protocol_count(&co->cursor, 
+                             header.number_of_lbeacons,
+                             NUMBER_OF_LBEACON_REGISTRATION_ITEM_FIELDS,
+                             &co->number_of_remaining)){
+        co->is_failed = true;
+        SQL_COROUTINE_EXIT(co);
+    }
+
+    while(co->number_of_remaining > 0){
+
+        co->number_of_remaining--;
+
+        if(WORK_SUCCESSFULLY != 
+           decode_lbeacon_registration_item(&co->cursor, &item)){
+            co->is_failed = true;
+            SQL_COROUTINE_EXIT(co);
+        }
+
+        SQL_format_lbeacon_registration(co->db_conn,
+                                        item.uuid,
+                                        item.registered_timestamp,
+                                        item.lbeacon_ip,
+                                        co->address,
+                                        sql);
+
+        SQL_COROUTINE_AWAIT_STATEMENT(co, sql);
+
+        if(WORK_SUCCESSFULLY != co->db_result){
+            SQL_COROUTINE_EXIT(co);
+        }
+    }
+
+    SQL_COROUTINE_END(co);
+}
+
+SqlCoroutineStatus SQL_update_gateway_health_status_coroutine(
+    SqlCoroutine *co){
+
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    GatewayHealthReportFields report;
+
+    SQL_COROUTINE_BEGIN(co);
+
+    open_protocol_cursor(&co->cursor, co->buf);
+
+    /* The gateway address in the packet is not used */
+    if(WORK_SUCCESSFULLY != 
+       decode_gateway_health_report(&co->cursor, &report)){
+        co->is_failed = true;
+        SQL_COROUTINE_EXIT(co);
+    }
+
+    SQL_format_gateway_health(co->db_conn, 
+                              report.health_status, 
+                              co->address, 
+                              sql);
+
+    SQL_COROUTINE_AWAIT_STATEMENT(co, sql);
+
+    SQL_COROUTINE_END(co);
+}
+
+SqlCoroutineStatus SQL_update_lbeacon_health_status_coroutine(
+    SqlCoroutine *co){
+
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+    LBeaconHealthReportFields report;
+
+    SQL_COROUTINE_BEGIN(co);
+
+    open_protocol_cursor(&co->cursor, co->buf);
+
+    /* The timestamp and the address of the LBeacon are not used */
+    if(WORK_SUCCESSFULLY != 
+       decode_lbeacon_health_report(&co->cursor, &report)){
+        co->is_failed = true;
+        SQL_COROUTINE_EXIT(co);
+    }
+
+    SQL_format_lbeacon_health(co->db_conn, 
+                              report.lbeacon_uuid, 
+                              report.health_status, 
+                              co->address, 
+                              sql);
+
+    SQL_COROUTINE_AWAIT_STATEMENT(co, sql);
+
+    SQL_COROUTINE_END(co);
+}
+
 ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
     DBConnectionListHead *db_connection_list_head,
     char *buf,
     size_t buf_len,
+    float API_version,
     char *server_installation_path,
-    int is_enabled_panic_monitoring){
+    int is_enabled_panic_monitoring,
+    DirtyObjectSetHead *dirty_object_set_head,
+    ClockOffsetListHead *clock_offset_list_head,
+    ObjectMirror *object_mirror,
+    EventWatermarkState *event_watermark,
+    char *gateway_address){
 
     PGconn *db_conn = NULL;
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char sql[SQL_TEMP_BUFFER_LENGTH];
-    char temp_buf[WIFI_MESSAGE_LENGTH];
-    char *saveptr = NULL;
+    char temp_buf[LENGTH_OF_REASSEMBLED_REPORT];
+    ProtocolCursor cursor;
+    const ProtocolVersionSchema *schema = NULL;
+    TrackingDataHeaderFields header;
+    ObjectGroupFields object_group;
+    TrackedObjectFields tracked_object;
     int num_types = 2; // BR_EDR and BLE types
     char *sql_bulk_insert_template = 
                          "COPY " \
@@ -824,30 +1577,27 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
                          "\'%s\' " \
                          "DELIMITER \',\' CSV;";
     
-    char *lbeacon_uuid = NULL;
-    char *lbeacon_ip = NULL;
-    char *lbeacon_timestamp = NULL;
-    char *object_type = NULL;
-    char *object_number = NULL;
     int numbers = 0;
-    char *object_mac_address = NULL;
-    char *initial_timestamp_GMT = NULL;
-    char *final_timestamp_GMT = NULL;
-    char *rssi = NULL;
-    char *panic_button = NULL;
-    char *battery_voltage = NULL;
-    int current_time = get_system_time();
+    int current_time = get_cached_system_time();
     int lbeacon_timestamp_value;
+    int clock_offset = 0;
     char filename[MAX_PATH];
     FILE *file = NULL;
     time_t rawtime;
     struct tm ts;
     char buf_initial_time[80];
     char buf_final_time[80];
+    char *object_mac_address_list[MAXIMUM_OBJECTS_IN_TRACKING_DATA];
+    int object_event_time_list[MAXIMUM_OBJECTS_IN_TRACKING_DATA];
+    int number_of_objects = 0;
+    int event_time = 0;
+    int i = 0;
+    long long profile_start_time = 0;
+    char current_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
 
     char *sql_identify_panic = 
         "UPDATE object_summary_table " \
-        "SET panic_violation_timestamp = NOW() " \
+        "SET panic_violation_timestamp = %s " \
         "FROM object_summary_table as R " \
         "INNER JOIN object_table " \
         "ON R.mac_address = object_table.mac_address " \
@@ -856,6 +1606,17 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
 
     char *pqescape_mac_address = NULL;
 
+    if(buf_len >= sizeof(temp_buf)){
+        return E_INPUT_PARAMETER;
+    }
+
+    schema = get_protocol_version_schema(API_version);
+    if(NULL == schema){
+        zlog_error(category_debug, 
+                   "No layout of tracked objects in API version [%f]", 
+                   API_version);
+        return E_API_PROTOCOL_FORMAT;
+    }
    
     /* Open temporary file with thread id as filename to prepare the tracking 
        data for postgresql bulk-insertion */
@@ -870,53 +1631,64 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
         return E_OPEN_FILE;
     }
 
+    profile_start_time = begin_profile_stage(&stage_profiler);
+
     /* Parse the message buffer */
     memset(temp_buf, 0, sizeof(temp_buf));
     memcpy(temp_buf, buf, buf_len);
 
-    lbeacon_uuid = strtok_save(temp_buf, DELIMITER_SEMICOLON, &saveptr);
-    lbeacon_timestamp = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-    if(lbeacon_timestamp == NULL){
+    open_protocol_cursor(&cursor, temp_buf);
+
+    if(WORK_SUCCESSFULLY != decode_tracking_data_header(&cursor, &header)){
         fclose(file);
         return E_API_PROTOCOL_FORMAT;
     }
-    lbeacon_timestamp_value = atoi(lbeacon_timestamp);
-    lbeacon_ip = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+    lbeacon_timestamp_value = atoi(header.lbeacon_timestamp);
+
+    /* Timestamps are stored in server time, so the queries on tracking_table 
+       can compare them against NOW() directly */
+    get_smoothed_clock_offset(clock_offset_list_head,
+                              header.lbeacon_uuid,
+                              current_time - lbeacon_timestamp_value,
+                              &clock_offset);
 
     zlog_debug(category_debug, "lbeacon_uuid=[%s], lbeacon_timestamp=[%s], " \
-               "lbeacon_ip=[%s]", lbeacon_uuid, lbeacon_timestamp, lbeacon_ip);
+               "lbeacon_ip=[%s]", header.lbeacon_uuid, 
+               header.lbeacon_timestamp, header.lbeacon_ip);
 
     while(num_types --){
 
-        object_type = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-
-        object_number = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-
-        zlog_debug(category_debug, "object_type=[%s], object_number=[%s]", 
-                   object_type, object_number);
-
-        if(object_number == NULL){
+        /* The number of objects is checked against the rest of the message 
+           before any object is taken */
+        if(WORK_SUCCESSFULLY != 
+           decode_object_group(&cursor, &object_group) ||
+           WORK_SUCCESSFULLY != 
+           decode_protocol_count(&cursor, 
+                                 object_group.number_of_objects,
+                                 schema->number_of_tracked_object_fields,
+                                 &numbers)){
             fclose(file);
             return E_API_PROTOCOL_FORMAT;
         }
-        numbers = atoi(object_number);
-
-        while(numbers--){
-
-            object_mac_address = 
-                strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-
-            initial_timestamp_GMT = 
-                strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
 
-            final_timestamp_GMT = 
-                strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+        zlog_debug(category_debug, "object_type=[%s], object_number=[%s]", 
+                   object_group.object_type, object_group.number_of_objects);
 
-            rssi = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+        while(numbers--){
 
-            panic_button = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
+            if(WORK_SUCCESSFULLY != 
+               schema->decode_tracked_object(&cursor, &tracked_object)){
+                fclose(file);
+                return E_API_PROTOCOL_FORMAT;
+            }
 
-            if(panic_button != NULL && 1 == atoi(panic_button)){
+            /* Skip the database work for objects which are known not to 
+               be under panic monitoring */
+            if(1 == atoi(tracked_object.panic_button) &&
+               (NULL == object_mirror || 
+                is_object_monitored(object_mirror, 
+                                    tracked_object.mac_address, 
+                                    MONITOR_PANIC))){
                 
                 memset(sql, 0, sizeof(sql));
                 if(WORK_SUCCESSFULLY != 
@@ -931,10 +1703,13 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
                 }
 
                 pqescape_mac_address = 
-                    PQescapeLiteral(db_conn, object_mac_address, 
-                                    strlen(object_mac_address)); 
+                    PQescapeLiteral(db_conn, tracked_object.mac_address, 
+                                    strlen(tracked_object.mac_address)); 
    
+                SQL_get_current_timestamp(current_timestamp);
+
                 sprintf(sql, sql_identify_panic, 
+                        current_timestamp,
                         pqescape_mac_address, 
                         MONITOR_PANIC,
                         MONITOR_PANIC);
@@ -948,29 +1723,43 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
                     db_serial_id);
             }
 
-            battery_voltage = strtok_save(NULL, DELIMITER_SEMICOLON, &saveptr);
-           
             // Convert Unix epoch timestamp (since 1970-1-1) to 
             // postgre timestamp (since 2000-1-1)
-            rawtime = atoi(initial_timestamp_GMT);
+            rawtime = atoi(tracked_object.initial_timestamp) + clock_offset;
             ts = *gmtime(&rawtime);
             strftime(buf_initial_time, sizeof(buf_initial_time), 
                      "%Y-%m-%d %H:%M:%S", &ts);
             
-            rawtime = atoi(final_timestamp_GMT);
+            event_time = atoi(tracked_object.final_timestamp) + clock_offset;
+
+            rawtime = event_time;
             ts = *gmtime(&rawtime);
             strftime(buf_final_time, sizeof(buf_final_time), 
                      "%Y-%m-%d %H:%M:%S", &ts);
+
+            /* A late row is still stored, but its object is not marked 
+               for summarization, because the window the row belongs to 
+               may already be closed */
+            if(number_of_objects < MAXIMUM_OBJECTS_IN_TRACKING_DATA &&
+               false == observe_event_time(event_watermark, 
+                                           gateway_address, 
+                                           event_time)){
+
+                object_mac_address_list[number_of_objects] = 
+                    tracked_object.mac_address;
+                object_event_time_list[number_of_objects] = event_time;
+                number_of_objects++;
+            }
                       
             fprintf(file, "%s,%s,%s,%s,%s,%s,%s,%d\n",
-                    object_mac_address,
-                    lbeacon_uuid,
-                    rssi,
-                    panic_button,
-                    battery_voltage,
+                    tracked_object.mac_address,
+                    header.lbeacon_uuid,
+                    tracked_object.rssi,
+                    tracked_object.panic_button,
+                    tracked_object.battery_voltage,
                     buf_initial_time,
                     buf_final_time,
-                    current_time - lbeacon_timestamp_value);
+                    clock_offset);
         }
     }
     fclose(file);
@@ -978,6 +1767,10 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
     memset(sql, 0, sizeof(sql));
     sprintf(sql, sql_bulk_insert_template, filename); 
 
+    end_profile_stage(&stage_profiler, 
+                      PROFILE_STAGE_SQL_BUILD, 
+                      profile_start_time);
+
     if(WORK_SUCCESSFULLY != 
        SQL_get_database_connection(db_connection_list_head, 
                                    &db_conn, 
@@ -1001,32 +1794,106 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
         return E_SQL_EXECUTE;
     }
 
+    /* Mark the objects only after their tracking data is stored, so the 
+       location summarization always sees the new tracking data */
+    for(i = 0; i < number_of_objects; i++){
+        mark_object_dirty(dirty_object_set_head, 
+                          object_mac_address_list[i],
+                          object_event_time_list[i]);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode SQL_get_location_summary_generation(
+    DBConnectionListHead *db_connection_list_head,
+    int *generation){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    PGresult *res = NULL;
+    char *sql = 
+        "SELECT COALESCE(MAX(is_location_updated), 0) " \
+        "FROM object_summary_table;";
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+        zlog_error(category_debug,
+                   "cannot open database\n");
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    res = PQexec(db_conn, sql);
+
+    if(PQresultStatus(res) != PGRES_TUPLES_OK || PQntuples(res) != 1){
+        PQclear(res);
+
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        SQL_release_database_connection(
+            db_connection_list_head,
+            db_serial_id);
+
+        return E_SQL_EXECUTE;
+    }
+
+    *generation = atoi(PQgetvalue(res, 0, 0));
+
+    PQclear(res);
+
+    SQL_release_database_connection(
+        db_connection_list_head,
+        db_serial_id);
+
     return WORK_SUCCESSFULLY;
 }
 
 ErrorCode SQL_summarize_object_location(
     DBConnectionListHead *db_connection_list_head,
+    char *mac_address_list,
+    int generation,
+    int watermark,
     int database_pre_filter_time_window_in_sec,
     int time_interval_in_sec,
     int rssi_difference_of_location_accuracy_tolerance,
-    int base_location_tolerance_in_millimeter){
+    int base_location_tolerance_in_millimeter,
+    OccupancyCounters *occupancy_counters,
+    TrajectoryHistory *trajectory_history){
 
     PGconn *db_conn = NULL;
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
-    char sql[SQL_TEMP_BUFFER_LENGTH];
+    char sql[SQL_SUMMARY_BUFFER_LENGTH];
+    char mac_address_array[SQL_SUMMARY_BUFFER_LENGTH];
+    char *pqescape_mac_address_array = NULL;
+    char window_end[SQL_TEMP_BUFFER_LENGTH];
+    PGresult *res = NULL;
+    int total_rows = 0;
+    long long profile_start_time = 0;
+    int i;
+
+    const int NUMBER_FIELDS_OF_MOVING_TAG_RETURNING = 4;
+    const int FIELD_INDEX_OF_MAC_ADDRESS = 0;
+    const int FIELD_INDEX_OF_UUID = 1;
+    const int FIELD_INDEX_OF_ROOM = 2;
+    const int FIELD_INDEX_OF_OBJECT_TYPE = 3;
 
-    char *sql_reset_state_template = 
-        "UPDATE object_summary_table "\
-        "SET is_location_updated = 0 " \
-        "WHERE id > 0";
+    const int NUMBER_FIELDS_OF_TRAJECTORY = 6;
+    const int FIELD_INDEX_OF_BASE_X = 2;
+    const int FIELD_INDEX_OF_BASE_Y = 3;
+    const int FIELD_INDEX_OF_ENTER_TIMESTAMP = 4;
+    const int FIELD_INDEX_OF_LEAVE_TIMESTAMP = 5;
 
     char *sql_update_stable_tag_template = 
         "UPDATE object_summary_table " \
         "SET " \
         "rssi = avg_rssi, last_seen_timestamp = final_timestamp, " \
         "battery_voltage = stable_table.battery_voltage, " \
-        "is_location_updated = 1 " \
+        "is_location_updated = %d " \
         "FROM ( " \
         "SELECT mac_address, uuid, avg_rssi, final_timestamp, " \
         "recent_table.battery_voltage " \
@@ -1041,9 +1908,10 @@ ErrorCode SQL_summarize_object_location(
         "FROM " \
         "tracking_table " \
         "WHERE " \
-        "final_timestamp > NOW() - interval '%d seconds' AND " \
-        "final_timestamp >= NOW() - (server_time_offset|| 'seconds')::INTERVAL - " \
-        "INTERVAL '%d seconds' " \
+        "final_timestamp > %s - interval '%d seconds' AND " \
+        "final_timestamp >= %s - INTERVAL '%d seconds' AND " \
+        "final_timestamp <= %s AND " \
+        "object_mac_address = ANY(%s) " \
         "GROUP BY object_mac_address, lbeacon_uuid " \
         ") recent_table " \
         "ON object_summary_table.mac_address = recent_table.object_mac_address AND " \
@@ -1063,9 +1931,10 @@ ErrorCode SQL_summarize_object_location(
         "FROM " \
         "tracking_table t "\
         "WHERE " \
-        "final_timestamp >= NOW() - INTERVAL '%d seconds' AND " \
-        "final_timestamp >= NOW() - (server_time_offset || 'seconds')::INTERVAL - " \
-        "INTERVAL '%d seconds' " \
+        "final_timestamp >= %s - INTERVAL '%d seconds' AND " \
+        "final_timestamp >= %s - INTERVAL '%d seconds' AND " \
+        "final_timestamp <= %s AND " \
+        "object_mac_address = ANY(%s) " \
         "GROUP BY " \
         "object_mac_address, " \
         "lbeacon_uuid " \
@@ -1097,7 +1966,7 @@ ErrorCode SQL_summarize_object_location(
         "battery_voltage = location_information.battery_voltage, " \
         "last_seen_timestamp = location_information.final_timestamp, " \
         "uuid = location_information.lbeacon_uuid, " \
-        "is_location_updated = 1 " \
+        "is_location_updated = %d " \
         "FROM " \
         "(SELECT " \
         "object_mac_address, " \
@@ -1124,9 +1993,10 @@ ErrorCode SQL_summarize_object_location(
         "FROM " \
         "tracking_table t " \
         "WHERE " \
-        "final_timestamp >= NOW() - INTERVAL '%d seconds' AND " \
-        "final_timestamp >= NOW() - (server_time_offset || 'seconds')::INTERVAL - " \
-        "INTERVAL '%d seconds' " \
+        "final_timestamp >= %s - INTERVAL '%d seconds' AND " \
+        "final_timestamp >= %s - INTERVAL '%d seconds' AND " \
+        "final_timestamp <= %s AND " \
+        "object_mac_address = ANY(%s) " \
         "GROUP BY " \
         "object_mac_address, " \
         "lbeacon_uuid " \
@@ -1143,7 +2013,14 @@ ErrorCode SQL_summarize_object_location(
         "WHERE " \
         "object_summary_table.mac_address = " \
         "location_information.object_mac_address AND " \
-		"object_summary_table.is_location_updated = 0;";
+		"object_summary_table.is_location_updated <> %d " \
+        "RETURNING object_summary_table.mac_address, " \
+        "object_summary_table.uuid, " \
+        "(SELECT room FROM lbeacon_table " \
+        "WHERE lbeacon_table.uuid = object_summary_table.uuid), " \
+        "(SELECT object_type FROM object_table " \
+        "WHERE object_table.mac_address = " \
+        "object_summary_table.mac_address);";
 		
 	char *sql_update_tag_base_location_template = 
 	    "UPDATE object_summary_table "\
@@ -1165,9 +2042,10 @@ ErrorCode SQL_summarize_object_location(
         "AS weight " \
         "FROM tracking_table " \
         "WHERE " \
-        "final_timestamp > NOW() - interval '%d seconds' AND " \
-        "final_timestamp >= NOW() - (server_time_offset || 'seconds')::INTERVAL - " \
-        "INTERVAL '%d seconds' " \
+        "final_timestamp > %s - interval '%d seconds' AND " \
+        "final_timestamp >= %s - INTERVAL '%d seconds' AND " \
+        "final_timestamp <= %s AND " \
+        "object_mac_address = ANY(%s) " \
         "GROUP BY object_mac_address, lbeacon_uuid " \
         "HAVING avg(rssi) >  -100" \
         "ORDER BY object_mac_address, lbeacon_uuid, average_rssi DESC " \
@@ -1188,8 +2066,39 @@ ErrorCode SQL_summarize_object_location(
         "(ABS(object_summary_table.base_y - tag_new_base.base_y) >= %d) " \
         ")";
 
-    memset(sql, 0, sizeof(sql));
-    sprintf(sql, sql_reset_state_template);
+    char *sql_select_trajectory_template = 
+        "SELECT mac_address, uuid, base_x, base_y, " \
+        "CAST(EXTRACT(EPOCH FROM first_seen_timestamp) * 1000000 AS BIGINT), " \
+        "CAST(EXTRACT(EPOCH FROM last_seen_timestamp) * 1000000 AS BIGINT) " \
+        "FROM object_summary_table " \
+        "WHERE mac_address = ANY(%s) AND " \
+        "uuid IS NOT NULL AND " \
+        "first_seen_timestamp IS NOT NULL AND " \
+        "last_seen_timestamp IS NOT NULL;";
+
+    if(mac_address_list == NULL || strlen(mac_address_list) == 0){
+        return WORK_SUCCESSFULLY;
+    }
+
+    /* The escaped array literal is embedded twice in the statement for 
+       stable tags, so it must fit in the statement buffer together with 
+       the template */
+    if(strlen(mac_address_list) + 3 > 
+       (SQL_SUMMARY_BUFFER_LENGTH - SQL_TEMP_BUFFER_LENGTH) / 2){
+        return E_INPUT_PARAMETER;
+    }
+
+    memset(mac_address_array, 0, sizeof(mac_address_array));
+    sprintf(mac_address_array, "{%s}", mac_address_list);
+
+    /* The time windows end at the watermark, so rows arriving after a 
+       window is summarized cannot change its result */
+    memset(window_end, 0, sizeof(window_end));
+    if(watermark > 0){
+        sprintf(window_end, "TO_TIMESTAMP(%d)", watermark);
+    }else{
+        SQL_get_current_timestamp(window_end);
+    }
 
     if(WORK_SUCCESSFULLY != 
        SQL_get_database_connection(db_connection_list_head, 
@@ -1201,17 +2110,34 @@ ErrorCode SQL_summarize_object_location(
         return E_SQL_OPEN_DATABASE;
     }
 
-    ret_val = SQL_execute(db_conn, sql);
+    profile_start_time = begin_profile_stage(&stage_profiler);
+
+    pqescape_mac_address_array = 
+        PQescapeLiteral(db_conn, mac_address_array, 
+                        strlen(mac_address_array));
 
     /* Update stable tags */
     memset(sql, 0, sizeof(sql));
 
     sprintf(sql, sql_update_stable_tag_template,
+            generation,
+            window_end,
             database_pre_filter_time_window_in_sec,
+            window_end,
             time_interval_in_sec,
+            window_end,
+            pqescape_mac_address_array,
+            window_end,
             database_pre_filter_time_window_in_sec,
+            window_end,
             time_interval_in_sec,
+            window_end,
+            pqescape_mac_address_array,
             rssi_difference_of_location_accuracy_tolerance);
+
+    end_profile_stage(&stage_profiler, 
+                      PROFILE_STAGE_SQL_BUILD, 
+                      profile_start_time);
   
     ret_val = SQL_execute(db_conn, sql);
 
@@ -1219,6 +2145,8 @@ ErrorCode SQL_summarize_object_location(
         zlog_error(category_debug, "SQL_execute failed [%d]: %s",
                    ret_val, PQerrorMessage(db_conn));
 
+        PQfreemem(pqescape_mac_address_array);
+
         SQL_release_database_connection(
             db_connection_list_head,
             db_serial_id);
@@ -1230,13 +2158,32 @@ ErrorCode SQL_summarize_object_location(
     memset(sql, 0, sizeof(sql));
 
     sprintf(sql, sql_update_moving_tag_template, 
+            generation,
+            window_end,
             database_pre_filter_time_window_in_sec, 
-            time_interval_in_sec);
+            window_end,
+            time_interval_in_sec,
+            window_end,
+            pqescape_mac_address_array,
+            generation);
   
-    ret_val = SQL_execute(db_conn, sql);
-    if(WORK_SUCCESSFULLY != ret_val){
-        zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                   ret_val, PQerrorMessage(db_conn));
+    zlog_info(category_debug, "SQL command = [%s]", sql);
+
+    profile_start_time = begin_profile_stage(&stage_profiler);
+
+    res = PQexec(db_conn, sql);
+
+    end_profile_stage(&stage_profiler, 
+                      PROFILE_STAGE_SQL_EXECUTE, 
+                      profile_start_time);
+
+    if(PQresultStatus(res) != PGRES_TUPLES_OK){
+        PQclear(res);
+
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        PQfreemem(pqescape_mac_address_array);
 
         SQL_release_database_connection(
             db_connection_list_head,
@@ -1244,13 +2191,36 @@ ErrorCode SQL_summarize_object_location(
 
         return E_SQL_EXECUTE;
     }
+
+    /* Only moving tags can change their LBeacon, so the occupancy counters 
+       are updated from the rows returned by this statement */
+    total_rows = PQntuples(res);
+
+    if(NULL != occupancy_counters &&
+       PQnfields(res) == NUMBER_FIELDS_OF_MOVING_TAG_RETURNING){
+
+        for(i = 0 ; i < total_rows ; i++){
+            update_object_occupancy(
+                occupancy_counters,
+                PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS),
+                PQgetvalue(res, i, FIELD_INDEX_OF_UUID),
+                PQgetvalue(res, i, FIELD_INDEX_OF_ROOM),
+                atoi(PQgetvalue(res, i, FIELD_INDEX_OF_OBJECT_TYPE)));
+        }
+    }
+
+    PQclear(res);
 	
 	/* Update base location of tags */
     memset(sql, 0, sizeof(sql));
 
     sprintf(sql, sql_update_tag_base_location_template, 
+            window_end,
             database_pre_filter_time_window_in_sec, 
+            window_end,
             time_interval_in_sec,
+            window_end,
+            pqescape_mac_address_array,
             base_location_tolerance_in_millimeter,
             base_location_tolerance_in_millimeter);
   
@@ -1259,6 +2229,8 @@ ErrorCode SQL_summarize_object_location(
         zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
                    ret_val, PQerrorMessage(db_conn));
 
+        PQfreemem(pqescape_mac_address_array);
+
         SQL_release_database_connection(
             db_connection_list_head,
             db_serial_id);
@@ -1266,6 +2238,61 @@ ErrorCode SQL_summarize_object_location(
         return E_SQL_EXECUTE;
     }
 
+    /* Record the current LBeacon and base location of the summarized tags 
+       in their trajectory */
+    if(NULL != trajectory_history){
+
+        memset(sql, 0, sizeof(sql));
+
+        sprintf(sql, sql_select_trajectory_template, 
+                pqescape_mac_address_array);
+
+        profile_start_time = begin_profile_stage(&stage_profiler);
+
+        res = PQexec(db_conn, sql);
+
+        end_profile_stage(&stage_profiler, 
+                          PROFILE_STAGE_SQL_EXECUTE, 
+                          profile_start_time);
+
+        if(PQresultStatus(res) != PGRES_TUPLES_OK){
+            PQclear(res);
+
+            zlog_error(category_debug, "SQL_execute failed: %s", 
+                       PQerrorMessage(db_conn));
+
+            PQfreemem(pqescape_mac_address_array);
+
+            SQL_release_database_connection(
+                db_connection_list_head,
+                db_serial_id);
+
+            return E_SQL_EXECUTE;
+        }
+
+        total_rows = PQntuples(res);
+
+        if(PQnfields(res) == NUMBER_FIELDS_OF_TRAJECTORY){
+
+            for(i = 0 ; i < total_rows ; i++){
+                record_object_trajectory(
+                    trajectory_history,
+                    PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS),
+                    PQgetvalue(res, i, FIELD_INDEX_OF_UUID),
+                    atoi(PQgetvalue(res, i, FIELD_INDEX_OF_BASE_X)),
+                    atoi(PQgetvalue(res, i, FIELD_INDEX_OF_BASE_Y)),
+                    strtoll(PQgetvalue(res, i, FIELD_INDEX_OF_ENTER_TIMESTAMP), 
+                            NULL, 10),
+                    strtoll(PQgetvalue(res, i, FIELD_INDEX_OF_LEAVE_TIMESTAMP), 
+                            NULL, 10));
+            }
+        }
+
+        PQclear(res);
+    }
+
+    PQfreemem(pqescape_mac_address_array);
+
     SQL_release_database_connection(
         db_connection_list_head,
         db_serial_id);
@@ -1285,10 +2312,11 @@ ErrorCode SQL_identify_geofence_violation(
     char *sql_insert_summary_table = 
         "UPDATE object_summary_table " \
         "SET " \
-        "geofence_violation_timestamp = NOW() " \
+        "geofence_violation_timestamp = %s " \
         "WHERE mac_address = %s";
 
     char *pqescape_mac_address = NULL;
+    char current_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
 
     memset(sql, 0, sizeof(sql));
 
@@ -1306,8 +2334,11 @@ ErrorCode SQL_identify_geofence_violation(
         PQescapeLiteral(db_conn, mac_address, 
                         strlen(mac_address)); 
    
+    SQL_get_current_timestamp(current_timestamp);
+
     sprintf(sql, 
             sql_insert_summary_table, 
+            current_timestamp,
             pqescape_mac_address);
     
     ret_val = SQL_execute(db_conn, sql);
@@ -1333,6 +2364,266 @@ ErrorCode SQL_identify_geofence_violation(
     return WORK_SUCCESSFULLY;
 }
 
+ErrorCode SQL_load_object_occupancy(
+    DBConnectionListHead *db_connection_list_head,
+    OccupancyCounters *occupancy_counters){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    char *sql = "SELECT " \
+                "object_summary_table.mac_address, " \
+                "object_summary_table.uuid, " \
+                "lbeacon_table.room, " \
+                "object_table.object_type " \
+                "FROM object_summary_table " \
+                "LEFT JOIN lbeacon_table ON " \
+                "object_summary_table.uuid = lbeacon_table.uuid " \
+                "LEFT JOIN object_table ON " \
+                "object_summary_table.mac_address = " \
+                "object_table.mac_address " \
+                "WHERE object_summary_table.uuid IS NOT NULL;";
+
+    const int NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE = 4;
+    const int FIELD_INDEX_OF_MAC_ADDRESS = 0;
+    const int FIELD_INDEX_OF_UUID = 1;
+    const int FIELD_INDEX_OF_ROOM = 2;
+    const int FIELD_INDEX_OF_OBJECT_TYPE = 3;
+
+    PGresult *res = NULL;
+    ExecStatusType status;
+    int total_rows = 0;
+    int i;
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+        zlog_error(category_debug,
+                   "cannot operate database");
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    zlog_info(category_debug, "SQL command = [%s]", sql);
+
+    if(0 == PQsendQuery(db_conn, sql)){
+
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        SQL_release_database_connection(
+            db_connection_list_head, 
+            db_serial_id);
+
+        return E_SQL_EXECUTE;
+    }
+
+    if(0 == PQsetSingleRowMode(db_conn)){
+        zlog_error(category_debug, 
+                   "PQsetSingleRowMode failed, fetch the result at once");
+    }
+
+    while(NULL != (res = PQgetResult(db_conn))){
+
+        status = PQresultStatus(res);
+
+        if(status != PGRES_SINGLE_TUPLE && status != PGRES_TUPLES_OK){
+
+            zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
+                       res, PQerrorMessage(db_conn));
+
+            ret_val = E_SQL_EXECUTE;
+
+            PQclear(res);
+            continue;
+        }
+
+        total_rows = PQntuples(res);
+
+        if(PQnfields(res) == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+
+            for(i = 0 ; i < total_rows ; i++){
+                update_object_occupancy(
+                    occupancy_counters,
+                    PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS),
+                    PQgetvalue(res, i, FIELD_INDEX_OF_UUID),
+                    PQgetvalue(res, i, FIELD_INDEX_OF_ROOM),
+                    atoi(PQgetvalue(res, i, FIELD_INDEX_OF_OBJECT_TYPE)));
+            }
+        }
+
+        PQclear(res);
+    }
+
+    SQL_release_database_connection(
+        db_connection_list_head, 
+        db_serial_id);
+
+    return ret_val;
+}
+
+ErrorCode SQL_create_occupancy_rollup_table(
+    DBConnectionListHead *db_connection_list_head){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    char *sql = "CREATE TABLE IF NOT EXISTS " \
+                "occupancy_rollup_table " \
+                "(rollup_timestamp TIMESTAMP WITH TIME ZONE NOT NULL, " \
+                "scope INTEGER NOT NULL, " \
+                "area_id INTEGER NOT NULL, " \
+                "room TEXT NOT NULL DEFAULT '', " \
+                "object_type INTEGER NOT NULL, " \
+                "number_of_objects INTEGER NOT NULL); " \
+                "ALTER TABLE occupancy_rollup_table " \
+                "ADD COLUMN IF NOT EXISTS " \
+                "rollup_timestamp TIMESTAMP WITH TIME ZONE; " \
+                "CREATE INDEX IF NOT EXISTS " \
+                "occupancy_rollup_table_rollup_timestamp_index " \
+                "ON occupancy_rollup_table (rollup_timestamp, area_id);";
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+        zlog_error(category_debug,
+                   "cannot operate database");
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    ret_val = SQL_execute(db_conn, sql);
+
+    SQL_release_database_connection(
+        db_connection_list_head,
+        db_serial_id);
+
+    if(WORK_SUCCESSFULLY != ret_val){
+        return E_SQL_EXECUTE;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode SQL_flush_occupancy_rollup(
+    DBConnectionListHead *db_connection_list_head,
+    OccupancyCounters *occupancy_counters){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    char rows[SQL_SUMMARY_BUFFER_LENGTH];
+    char *sql = "COPY " \
+                "occupancy_rollup_table " \
+                "(rollup_timestamp, " \
+                "scope, " \
+                "area_id, " \
+                "room, " \
+                "object_type, " \
+                "number_of_objects) " \
+                "FROM STDIN WITH CSV;";
+    PGresult *res = NULL;
+    int number_of_rows = 0;
+    int first_row = 0;
+    time_t rawtime;
+    struct tm ts;
+    char rollup_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
+
+    /* All rows of the snapshot carry the same time, in UTC like the 
+       timestamps of tracking_table */
+    rawtime = get_cached_system_time();
+    ts = *gmtime(&rawtime);
+    memset(rollup_timestamp, 0, sizeof(rollup_timestamp));
+    strftime(rollup_timestamp, sizeof(rollup_timestamp), 
+             "%Y-%m-%d %H:%M:%S+00", &ts);
+
+    number_of_rows = get_occupancy_rollup_rows(occupancy_counters, 
+                                               rollup_timestamp,
+                                               first_row,
+                                               rows, 
+                                               sizeof(rows));
+    if(0 == number_of_rows){
+        return WORK_SUCCESSFULLY;
+    }
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+        zlog_error(category_debug,
+                   "cannot operate database");
+
+        return E_SQL_OPEN_DATABASE;
+    }
+
+    zlog_info(category_debug, "SQL command = [%s]", sql);
+
+    res = PQexec(db_conn, sql);
+
+    if(PQresultStatus(res) != PGRES_COPY_IN){
+        PQclear(res);
+
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        SQL_release_database_connection(
+            db_connection_list_head,
+            db_serial_id);
+
+        return E_SQL_EXECUTE;
+    }
+    PQclear(res);
+
+    /* The counters are sent in chunks of the row buffer, so a snapshot 
+       larger than the buffer is still copied completely */
+    while(number_of_rows > 0){
+
+        if(1 != PQputCopyData(db_conn, rows, strlen(rows))){
+
+            zlog_error(category_debug, "PQputCopyData failed: %s", 
+                       PQerrorMessage(db_conn));
+            ret_val = E_SQL_EXECUTE;
+            break;
+        }
+
+        first_row += number_of_rows;
+
+        number_of_rows = get_occupancy_rollup_rows(occupancy_counters, 
+                                                   rollup_timestamp,
+                                                   first_row,
+                                                   rows, 
+                                                   sizeof(rows));
+    }
+
+    if(WORK_SUCCESSFULLY != ret_val){
+
+        PQputCopyEnd(db_conn, "cannot send occupancy rollup rows");
+
+    }else if(1 != PQputCopyEnd(db_conn, NULL)){
+
+        zlog_error(category_debug, "PQputCopyEnd failed: %s", 
+                   PQerrorMessage(db_conn));
+        ret_val = E_SQL_EXECUTE;
+    }
+
+    while(NULL != (res = PQgetResult(db_conn))){
+        if(PQresultStatus(res) != PGRES_COMMAND_OK){
+            zlog_error(category_debug, "SQL_execute failed: %s", 
+                       PQerrorMessage(db_conn));
+            ret_val = E_SQL_EXECUTE;
+        }
+        PQclear(res);
+    }
+
+    SQL_release_database_connection(
+        db_connection_list_head,
+        db_serial_id);
+
+    return ret_val;
+}
+
 ErrorCode SQL_identify_location_not_stay_room(
     DBConnectionListHead *db_connection_list_head){
 
@@ -1340,9 +2631,10 @@ ErrorCode SQL_identify_location_not_stay_room(
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char sql[SQL_TEMP_BUFFER_LENGTH];
+    char current_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
     char *sql_select_template = "UPDATE object_summary_table " \
                                 "SET " \
-                                "location_violation_timestamp = NOW() " \
+                                "location_violation_timestamp = %s " \
                                 "FROM " \
                                 "(SELECT " \
                                 "object_summary_table.mac_address, " \
@@ -1371,7 +2663,10 @@ ErrorCode SQL_identify_location_not_stay_room(
 
     memset(sql, 0, sizeof(sql));
 
+    SQL_get_current_timestamp(current_timestamp);
+
     sprintf(sql, sql_select_template, 
+            current_timestamp,
             MONITOR_LOCATION,
             MONITOR_LOCATION);
 
@@ -1412,9 +2707,10 @@ ErrorCode SQL_identify_location_long_stay_in_danger(
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char sql[SQL_TEMP_BUFFER_LENGTH];
+    char current_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
     char *sql_select_template = "UPDATE object_summary_table " \
                                 "SET " \
-                                "location_violation_timestamp = NOW() " \
+                                "location_violation_timestamp = %s " \
                                 "FROM " \
                                 "(SELECT " \
                                 "object_summary_table.mac_address, " \
@@ -1446,7 +2742,10 @@ ErrorCode SQL_identify_location_long_stay_in_danger(
 
     memset(sql, 0, sizeof(sql));
 
+    SQL_get_current_timestamp(current_timestamp);
+
     sprintf(sql, sql_select_template, 
+            current_timestamp,
             MONITOR_LOCATION,
             MONITOR_LOCATION);
 
@@ -1490,6 +2789,7 @@ ErrorCode SQL_identify_last_movement_status(
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char sql[SQL_TEMP_BUFFER_LENGTH];
+    char sql_cursor[SQL_TEMP_BUFFER_LENGTH];
 
     char *sql_select_template = "SELECT " \
                                 "object_summary_table.mac_address, " \
@@ -1528,7 +2828,7 @@ ErrorCode SQL_identify_last_movement_status(
         "SELECT TIME_BUCKET('%d minutes', final_timestamp) as time_slot, " \
         "AVG(rssi) as avg_rssi " \
         "FROM tracking_table where " \
-        "final_timestamp > NOW() - INTERVAL '%d minutes' " \
+        "final_timestamp > %s - INTERVAL '%d minutes' " \
         "AND lbeacon_uuid = %s " \
         "AND object_mac_address = %s " \
         "GROUP BY time_slot" \
@@ -1545,14 +2845,17 @@ ErrorCode SQL_identify_last_movement_status(
     int rows_activity = 0;
    
     char *time_slot_activity = NULL;
+    char current_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
 
     char *sql_update_activity_template = 
         "UPDATE object_summary_table " \
-        "SET movement_violation_timestamp = NOW()" \
+        "SET movement_violation_timestamp = %s " \
         "WHERE mac_address = %s";
   
     memset(sql, 0, sizeof(sql));
 
+    SQL_get_current_timestamp(current_timestamp);
+
     sprintf(sql, sql_select_template,
             MONITOR_MOVEMENT,
             MONITOR_MOVEMENT);
@@ -1567,13 +2870,21 @@ ErrorCode SQL_identify_last_movement_status(
         return E_SQL_OPEN_DATABASE;
     }
 
-    res = PQexec(db_conn, sql);
+    /* Walk the candidates through a server-side cursor in chunks, so the
+       memory usage does not grow with the number of monitored objects. The
+       activity queries below reuse the same connection while the cursor is
+       open. */
+    SQL_begin_transaction(db_conn);
 
-    if(PQresultStatus(res) != PGRES_TUPLES_OK){
-        PQclear(res);
+    memset(sql_cursor, 0, sizeof(sql_cursor));
+    sprintf(sql_cursor, "DECLARE movement_candidate_cursor " \
+                        "NO SCROLL CURSOR FOR %s;", sql);
 
-        zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                   res, PQerrorMessage(db_conn));
+    ret_val = SQL_execute(db_conn, sql_cursor);
+
+    if(WORK_SUCCESSFULLY != ret_val){
+
+        SQL_rollback_transaction(db_conn);
 
         SQL_release_database_connection(
             db_connection_list_head,
@@ -1582,95 +2893,133 @@ ErrorCode SQL_identify_last_movement_status(
         return E_SQL_EXECUTE;
     }
 
-    total_fields = PQnfields(res);
-    total_rows = PQntuples(res);
+    memset(sql_cursor, 0, sizeof(sql_cursor));
+    sprintf(sql_cursor, "FETCH FORWARD %d FROM movement_candidate_cursor;",
+            SQL_CURSOR_FETCH_ROWS);
+
+    do{
+        res = PQexec(db_conn, sql_cursor);
 
-    if(total_rows > 0 && 
-       total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+        if(PQresultStatus(res) != PGRES_TUPLES_OK){
+            PQclear(res);
 
-        for(current_row = 0 ; current_row < total_rows ; current_row++){
-            mac_address = PQgetvalue(res, 
-                                     current_row, 
-                                     FIELD_INDEX_OF_MAC_ADDRESS);
+            zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
+                       res, PQerrorMessage(db_conn));
 
-            lbeacon_uuid = PQgetvalue(res, 
-                                      current_row, 
-                                      FIELD_INDEX_OF_UUID);
+            SQL_rollback_transaction(db_conn);
 
-            if(strlen(lbeacon_uuid) == 0){
-                continue;
-            }
+            SQL_release_database_connection(
+                db_connection_list_head,
+                db_serial_id);
+
+            return E_SQL_EXECUTE;
+        }
+
+        total_fields = PQnfields(res);
+        total_rows = PQntuples(res);
+
+        if(total_rows > 0 && 
+           total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+
+            for(current_row = 0 ; current_row < total_rows ; current_row++){
+                mac_address = PQgetvalue(res, 
+                                         current_row, 
+                                         FIELD_INDEX_OF_MAC_ADDRESS);
+
+                lbeacon_uuid = PQgetvalue(res, 
+                                          current_row, 
+                                          FIELD_INDEX_OF_UUID);
+
+                if(strlen(lbeacon_uuid) == 0){
+                    continue;
+                }
 
-            pqescape_mac_address = 
-                PQescapeLiteral(db_conn, mac_address, strlen(mac_address));
-            pqescape_lbeacon_uuid = 
-                PQescapeLiteral(db_conn, lbeacon_uuid, strlen(lbeacon_uuid));
+                pqescape_mac_address = 
+                    PQescapeLiteral(db_conn, mac_address, 
+                                    strlen(mac_address));
+                pqescape_lbeacon_uuid = 
+                    PQescapeLiteral(db_conn, lbeacon_uuid, 
+                                    strlen(lbeacon_uuid));
 
-            sprintf(sql, sql_select_activity_template, 
-                    each_time_slot_in_min,
-                    time_interval_in_min,
-                    pqescape_lbeacon_uuid,
-                    pqescape_mac_address,
-                    rssi_delta,
-                    0 - rssi_delta);
+                sprintf(sql, sql_select_activity_template, 
+                        each_time_slot_in_min,
+                        current_timestamp,
+                        time_interval_in_min,
+                        pqescape_lbeacon_uuid,
+                        pqescape_mac_address,
+                        rssi_delta,
+                        0 - rssi_delta);
 
-            res_activity = PQexec(db_conn, sql);
+                res_activity = PQexec(db_conn, sql);
 
-            PQfreemem(pqescape_mac_address);
-            PQfreemem(pqescape_lbeacon_uuid);
+                PQfreemem(pqescape_mac_address);
+                PQfreemem(pqescape_lbeacon_uuid);
 
-            if(PQresultStatus(res_activity) != PGRES_TUPLES_OK){
-                PQclear(res_activity);
-                PQclear(res);
+                if(PQresultStatus(res_activity) != PGRES_TUPLES_OK){
+                    PQclear(res_activity);
+                    PQclear(res);
                     
-                zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                           res_activity, PQerrorMessage(db_conn));
+                    zlog_error(category_debug, 
+                               "SQL_execute failed [%d]: %s", 
+                               res_activity, PQerrorMessage(db_conn));
 
-                SQL_release_database_connection(
-                    db_connection_list_head,
-                    db_serial_id);
+                    SQL_rollback_transaction(db_conn);
 
-                return E_SQL_EXECUTE;
-            }
+                    SQL_release_database_connection(
+                        db_connection_list_head,
+                        db_serial_id);
 
-            rows_activity = PQntuples(res_activity);
+                    return E_SQL_EXECUTE;
+                }
+
+                rows_activity = PQntuples(res_activity);
          
-            if(rows_activity == 0){
-                pqescape_mac_address = 
-                    PQescapeLiteral(db_conn, mac_address, 
-                                    strlen(mac_address));
+                if(rows_activity == 0){
+                    pqescape_mac_address = 
+                        PQescapeLiteral(db_conn, mac_address, 
+                                        strlen(mac_address));
                 
-                memset(sql, 0, sizeof(sql));
+                    memset(sql, 0, sizeof(sql));
                     
-                sprintf(sql, sql_update_activity_template,
-                        pqescape_mac_address);
+                    sprintf(sql, sql_update_activity_template,
+                            current_timestamp,
+                            pqescape_mac_address);
                             
-                ret_val = SQL_execute(db_conn, sql);
+                    ret_val = SQL_execute(db_conn, sql);
 
-                PQfreemem(pqescape_mac_address);
+                    PQfreemem(pqescape_mac_address);
                
-                if(WORK_SUCCESSFULLY != ret_val){
-                    PQclear(res_activity);   
-                    PQclear(res);
+                    if(WORK_SUCCESSFULLY != ret_val){
+                        PQclear(res_activity);   
+                        PQclear(res);
 
-                    zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                               ret_val, PQerrorMessage(db_conn));
+                        zlog_error(category_debug, 
+                                   "SQL_execute failed [%d]: %s", 
+                                   ret_val, PQerrorMessage(db_conn));
 
-                    SQL_release_database_connection(
-                        db_connection_list_head,
-                        db_serial_id);
+                        SQL_rollback_transaction(db_conn);
 
-                    return E_SQL_EXECUTE;
-                }     
-                PQclear(res_activity);
+                        SQL_release_database_connection(
+                            db_connection_list_head,
+                            db_serial_id);
 
-                continue;
+                        return E_SQL_EXECUTE;
+                    }     
+                    PQclear(res_activity);
+
+                    continue;
+                }
+                PQclear(res_activity);
             }
-            PQclear(res_activity);
         }
-    }
 
-    PQclear(res);
+        PQclear(res);
+
+    }while(total_rows == SQL_CURSOR_FETCH_ROWS);
+
+    /* Ending the transaction also closes the cursor */
+    SQL_commit_transaction(db_conn);
+
     SQL_release_database_connection(
         db_connection_list_head,
         db_serial_id);
@@ -1705,7 +3054,7 @@ ErrorCode SQL_collect_violation_events(
         "FROM object_summary_table " \
         "WHERE "\
         "%s >= " \
-        "NOW() - interval '%d seconds' " \
+        "%s - interval '%d seconds' " \
         "AND NOT EXISTS(" \
         "SELECT * FROM notification_table " \
         "WHERE monitor_type = %d " \
@@ -1719,6 +3068,7 @@ ErrorCode SQL_collect_violation_events(
     char *movement_violation_timestamp = "movement_violation_timestamp";
     char *location_violation_timestamp = "location_violation_timestamp";
     char *violation_timestamp_name = NULL;
+    char current_timestamp[LENGTH_OF_CURRENT_TIMESTAMP];
 
     switch (monitor_type){
         case MONITOR_GEO_FENCE:
@@ -1740,11 +3090,13 @@ ErrorCode SQL_collect_violation_events(
     }
 
     memset(sql, 0, sizeof(sql));
+    SQL_get_current_timestamp(current_timestamp);
     sprintf(sql, 
             sql_insert_template, 
             monitor_type, 
             violation_timestamp_name,
             violation_timestamp_name,
+            current_timestamp,
             time_interval_in_sec,
             monitor_type,
             violation_timestamp_name,
@@ -1790,6 +3142,7 @@ ErrorCode SQL_get_and_update_violation_events(
     int db_serial_id = -1;
     ErrorCode ret_val = WORK_SUCCESSFULLY;
     char sql[SQL_TEMP_BUFFER_LENGTH];
+    char sql_cursor[SQL_TEMP_BUFFER_LENGTH];
 
     char *sql_select_template = 
         "SELECT id, monitor_type, mac_address, uuid, violation_timestamp " \
@@ -1816,8 +3169,13 @@ ErrorCode SQL_get_and_update_violation_events(
         "SET "\
         "processed = 1 " \
         "WHERE id = %d;";
+    char *sql_savepoint = "SAVEPOINT violation_event_mark;";
+    char *sql_rollback_to_savepoint = 
+        "ROLLBACK TO SAVEPOINT violation_event_mark;";
+    char *sql_release_savepoint = "RELEASE SAVEPOINT violation_event_mark;";
 
     int id_int;
+    bool is_buffer_full = false;
 
 
     memset(sql, 0, sizeof(sql));
@@ -1833,13 +3191,20 @@ ErrorCode SQL_get_and_update_violation_events(
         return E_SQL_OPEN_DATABASE;
     }
 
-    res = PQexec(db_conn, sql);
+    /* Read the pending events through a server-side cursor in chunks and
+       stop as soon as buf is full. The remaining events are kept unprocessed
+       and are picked up by the next call in the same order. */
+    SQL_begin_transaction(db_conn);
 
-    if(PQresultStatus(res) != PGRES_TUPLES_OK){
-        PQclear(res);
+    memset(sql_cursor, 0, sizeof(sql_cursor));
+    sprintf(sql_cursor, "DECLARE violation_event_cursor " \
+                        "NO SCROLL CURSOR FOR %s", sql);
 
-        zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                   res, PQerrorMessage(db_conn));
+    ret_val = SQL_execute(db_conn, sql_cursor);
+
+    if(WORK_SUCCESSFULLY != ret_val){
+
+        SQL_rollback_transaction(db_conn);
 
         SQL_release_database_connection(
             db_connection_list_head,
@@ -1848,27 +3213,54 @@ ErrorCode SQL_get_and_update_violation_events(
         return E_SQL_EXECUTE;
     }
 
-    total_rows = PQntuples(res);
-    total_fields = PQnfields(res);
+    memset(sql_cursor, 0, sizeof(sql_cursor));
+    sprintf(sql_cursor, "FETCH FORWARD %d FROM violation_event_cursor;",
+            SQL_CURSOR_FETCH_ROWS);
+
+    do{
+        res = PQexec(db_conn, sql_cursor);
+
+        if(PQresultStatus(res) != PGRES_TUPLES_OK){
+            PQclear(res);
+
+            zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
+                       res, PQerrorMessage(db_conn));
+
+            SQL_rollback_transaction(db_conn);
+
+            SQL_release_database_connection(
+                db_connection_list_head,
+                db_serial_id);
+
+            return E_SQL_EXECUTE;
+        }
+
+        total_rows = PQntuples(res);
+        total_fields = PQnfields(res);
     
-    if(total_rows > 0 && 
-       total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
-        for(i = 0 ; i < total_rows ; i++){
-            memset(one_record, 0, sizeof(one_record));
-            sprintf(one_record, "%s,%s,%s,%s,%s;", 
-                    PQgetvalue(res, i, FIELD_INDEX_OF_ID),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_MONITOR_TYPE),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_UUID),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_VIOLATION_TIMESTAMP));
-            
-            if(buf_len > strlen(buf) + strlen(one_record)){
-                strcat(buf, one_record);
+        if(total_rows > 0 && 
+           total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+            for(i = 0 ; i < total_rows ; i++){
+                memset(one_record, 0, sizeof(one_record));
+                sprintf(one_record, "%s,%s,%s,%s,%s;", 
+                        PQgetvalue(res, i, FIELD_INDEX_OF_ID),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_MONITOR_TYPE),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_UUID),
+                        PQgetvalue(res, i, 
+                                   FIELD_INDEX_OF_VIOLATION_TIMESTAMP));
             
+                if(buf_len <= strlen(buf) + strlen(one_record)){
+                    is_buffer_full = true;
+                    break;
+                }
+
                 memset(sql, 0, sizeof(sql));
                 if(PQgetvalue(res, i, FIELD_INDEX_OF_ID) == NULL){
                     PQclear(res);
 
+                    SQL_rollback_transaction(db_conn);
+
                     SQL_release_database_connection(
                         db_connection_list_head,
                         db_serial_id);
@@ -1879,12 +3271,37 @@ ErrorCode SQL_get_and_update_violation_events(
                         sql_update_template, 
                         atoi(PQgetvalue(res, i, FIELD_INDEX_OF_ID)));
 
+                /* A failed mark would abort the whole transaction and undo 
+                   the marks of the events already in buf, which are sent 
+                   anyway. Only this mark is undone, and the event is kept 
+                   unprocessed and sent by the next call. */
+                SQL_execute(db_conn, sql_savepoint);
+
                 ret_val = SQL_execute(db_conn, sql);        
+                if(WORK_SUCCESSFULLY != ret_val){
+
+                    zlog_error(category_debug, 
+                               "mark violation event [%s] failed: %s",
+                               PQgetvalue(res, i, FIELD_INDEX_OF_ID),
+                               PQerrorMessage(db_conn));
+
+                    SQL_execute(db_conn, sql_rollback_to_savepoint);
+                    continue;
+                }
+
+                SQL_execute(db_conn, sql_release_savepoint);
+
+                strcat(buf, one_record);
             }
         }
-    }
 
-    PQclear(res);
+        PQclear(res);
+
+    }while(false == is_buffer_full && total_rows == SQL_CURSOR_FETCH_ROWS);
+
+    /* Ending the transaction also closes the cursor */
+    SQL_commit_transaction(db_conn);
+
     SQL_release_database_connection(
         db_connection_list_head,
         db_serial_id);
@@ -2011,6 +3428,7 @@ ErrorCode SQL_dump_active_geo_fence_settings(
     FILE *file = NULL;
 
     PGresult *res = NULL;
+    ExecStatusType status;
     int total_fields = 0;
     int total_rows = 0;
     int i = 0;
@@ -2036,14 +3454,10 @@ ErrorCode SQL_dump_active_geo_fence_settings(
        return E_SQL_OPEN_DATABASE;
     }
 
-    res = PQexec(db_conn, sql);
-
-    if(PQresultStatus(res) != PGRES_TUPLES_OK){
-
-        PQclear(res);
+    if(0 == PQsendQuery(db_conn, sql)){
 
-        zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                   res, PQerrorMessage(db_conn));
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
 
         SQL_release_database_connection(
             db_connection_list_head, 
@@ -2054,23 +3468,46 @@ ErrorCode SQL_dump_active_geo_fence_settings(
         return E_SQL_EXECUTE;
     }
 
-    total_rows = PQntuples(res);
-    total_fields = PQnfields(res);
+    /* Stream the settings row by row, so the whole result set is never held
+       in client memory */
+    if(0 == PQsetSingleRowMode(db_conn)){
+        zlog_error(category_debug, 
+                   "PQsetSingleRowMode failed, fetch the result at once");
+    }
+
+    while(NULL != (res = PQgetResult(db_conn))){
+
+        status = PQresultStatus(res);
+
+        if(status != PGRES_SINGLE_TUPLE && status != PGRES_TUPLES_OK){
+
+            zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
+                       res, PQerrorMessage(db_conn));
+
+            ret_val = E_SQL_EXECUTE;
+
+            PQclear(res);
+            continue;
+        }
+
+        total_rows = PQntuples(res);
+        total_fields = PQnfields(res);
     
-    if(total_rows > 0 && 
-       total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+        if(total_rows > 0 && 
+           total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
          
-        for(i = 0 ; i < total_rows ; i++){
-            fprintf(file, "%s;%s;%s;%s;%s;\n", 
-                    PQgetvalue(res, i, FIELD_INDEX_OF_AREA_ID),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_ID),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_NAME),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_PERIMETRS),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_FENCES));
+            for(i = 0 ; i < total_rows ; i++){
+                fprintf(file, "%s;%s;%s;%s;%s;\n", 
+                        PQgetvalue(res, i, FIELD_INDEX_OF_AREA_ID),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_ID),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_NAME),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_PERIMETRS),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_FENCES));
+            }
         }
-    }
 
-    PQclear(res);
+        PQclear(res);
+    }
 
     SQL_release_database_connection(
         db_connection_list_head, 
@@ -2078,12 +3515,13 @@ ErrorCode SQL_dump_active_geo_fence_settings(
 
     fclose(file);
 
-    return WORK_SUCCESSFULLY;
+    return ret_val;
 }
 
 ErrorCode SQL_dump_mac_address_under_geo_fence_monitor(
     DBConnectionListHead *db_connection_list_head, 
-    char *filename){
+    char *filename,
+    ObjectMirror *object_mirror){
 
     PGconn *db_conn = NULL;
     int db_serial_id = -1;
@@ -2105,10 +3543,17 @@ ErrorCode SQL_dump_mac_address_under_geo_fence_monitor(
     FILE *file = NULL;
 
     PGresult *res = NULL;
+    ExecStatusType status;
     int total_fields = 0;
     int total_rows = 0;
     int i = 0;
 
+    if(NULL != object_mirror && true == object_mirror->is_loaded){
+        return dump_mac_address_under_monitor(object_mirror,
+                                              MONITOR_GEO_FENCE,
+                                              filename);
+    }
+
     file = fopen(filename, "wt");
     if(file == NULL){
         zlog_error(category_debug, "cannot open filepath %s", filename);
@@ -2132,14 +3577,10 @@ ErrorCode SQL_dump_mac_address_under_geo_fence_monitor(
        return E_SQL_OPEN_DATABASE;
     }
 
-    res = PQexec(db_conn, sql);
-
-    if(PQresultStatus(res) != PGRES_TUPLES_OK){
-
-        PQclear(res);
+    if(0 == PQsendQuery(db_conn, sql)){
 
-        zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
-                   res, PQerrorMessage(db_conn));
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
 
         SQL_release_database_connection(
             db_connection_list_head,
@@ -2150,21 +3591,44 @@ ErrorCode SQL_dump_mac_address_under_geo_fence_monitor(
         return E_SQL_EXECUTE;
     }
 
-    total_rows = PQntuples(res);
-    total_fields = PQnfields(res);
+    /* Stream the objects row by row, so the whole result set is never held
+       in client memory */
+    if(0 == PQsetSingleRowMode(db_conn)){
+        zlog_error(category_debug, 
+                   "PQsetSingleRowMode failed, fetch the result at once");
+    }
+
+    while(NULL != (res = PQgetResult(db_conn))){
+
+        status = PQresultStatus(res);
+
+        if(status != PGRES_SINGLE_TUPLE && status != PGRES_TUPLES_OK){
+
+            zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
+                       res, PQerrorMessage(db_conn));
+
+            ret_val = E_SQL_EXECUTE;
+
+            PQclear(res);
+            continue;
+        }
+
+        total_rows = PQntuples(res);
+        total_fields = PQnfields(res);
     
-    if(total_rows > 0 && 
-       total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+        if(total_rows > 0 && 
+           total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
          
-        for(i = 0 ; i < total_rows ; i++){
+            for(i = 0 ; i < total_rows ; i++){
 
-            fprintf(file, "%s;%s;\n", 
-                    PQgetvalue(res, i, FIELD_INDEX_OF_AREA_ID),
-                    PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS));
+                fprintf(file, "%s;%s;\n", 
+                        PQgetvalue(res, i, FIELD_INDEX_OF_AREA_ID),
+                        PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS));
+            }
         }
-    }
 
-    PQclear(res);
+        PQclear(res);
+    }
 
     SQL_release_database_connection(
         db_connection_list_head,
@@ -2172,6 +3636,184 @@ ErrorCode SQL_dump_mac_address_under_geo_fence_monitor(
 
     fclose(file);
 
-    return WORK_SUCCESSFULLY;
+    return ret_val;
+
+}
+
+ErrorCode SQL_load_object_mirror(
+    DBConnectionListHead *db_connection_list_head,
+    ObjectMirror *object_mirror){
+
+    PGconn *db_conn = NULL;
+    int db_serial_id = -1;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+    
+    char *sql_select_template = "SELECT " \
+                                "mac_address, " \
+                                "monitor_type, " \
+                                "area_id, " \
+                                "room " \
+                                "FROM object_table;";
+
+    const int NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE = 4;
+    const int FIELD_INDEX_OF_MAC_ADDRESS = 0;
+    const int FIELD_INDEX_OF_MONITOR_TYPE = 1;
+    const int FIELD_INDEX_OF_AREA_ID = 2;
+    const int FIELD_INDEX_OF_ROOM = 3;
+
+    PGresult *res = NULL;
+    ExecStatusType status;
+    int total_fields = 0;
+    int total_rows = 0;
+    int generation = 0;
+    int i = 0;
+
+    if(WORK_SUCCESSFULLY != 
+       SQL_get_database_connection(db_connection_list_head, 
+                                   &db_conn, 
+                                   &db_serial_id)){
+       zlog_error(category_debug,
+                  "cannot open database\n");
+
+       return E_SQL_OPEN_DATABASE;
+    }
+
+    if(0 == PQsendQuery(db_conn, sql_select_template)){
+
+        zlog_error(category_debug, "SQL_execute failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        SQL_release_database_connection(
+            db_connection_list_head,
+            db_serial_id);
+
+        return E_SQL_EXECUTE;
+    }
+
+    if(0 == PQsetSingleRowMode(db_conn)){
+        zlog_error(category_debug, 
+                   "PQsetSingleRowMode failed, fetch the result at once");
+    }
+
+    generation = begin_object_mirror_load(object_mirror);
+
+    while(NULL != (res = PQgetResult(db_conn))){
+
+        status = PQresultStatus(res);
+
+        if(status != PGRES_SINGLE_TUPLE && status != PGRES_TUPLES_OK){
+
+            zlog_error(category_debug, "SQL_execute failed [%d]: %s", 
+                       res, PQerrorMessage(db_conn));
+
+            ret_val = E_SQL_EXECUTE;
+
+            PQclear(res);
+            continue;
+        }
+
+        total_rows = PQntuples(res);
+        total_fields = PQnfields(res);
+    
+        if(total_rows > 0 && 
+           total_fields == NUMBER_FIELDS_OF_SQL_SELECT_TEMPLATE){
+         
+            for(i = 0 ; i < total_rows ; i++){
+
+                if(E_MALLOC == 
+                   update_object_mirror(
+                       object_mirror,
+                       generation,
+                       PQgetvalue(res, i, FIELD_INDEX_OF_MAC_ADDRESS),
+                       atoi(PQgetvalue(res, i, FIELD_INDEX_OF_MONITOR_TYPE)),
+                       atoi(PQgetvalue(res, i, FIELD_INDEX_OF_AREA_ID)),
+                       PQgetvalue(res, i, FIELD_INDEX_OF_ROOM))){
+
+                    ret_val = E_MALLOC;
+                }
+            }
+        }
+
+        PQclear(res);
+    }
+
+    SQL_release_database_connection(
+        db_connection_list_head,
+        db_serial_id);
+
+    /* Objects missing from an incomplete load must not be removed, or they 
+       would be treated as not monitored */
+    if(WORK_SUCCESSFULLY == ret_val){
+        finish_object_mirror_load(object_mirror, generation);
+    }
+
+    return ret_val;
+}
+
+ErrorCode SQL_check_object_table_changes(
+    DBConnectionListHead *db_connection_list_head,
+    bool *is_changed){
+
+    PGconn *db_conn = NULL;
+    PGnotify *notify = NULL;
+    char sql[SQL_TEMP_BUFFER_LENGTH];
+
+    *is_changed = false;
+
+    if(NULL == db_connection_list_head->listen_db){
+
+        db_conn = PQconnectdb(db_connection_list_head->conninfo);
+
+        if(PQstatus(db_conn) != CONNECTION_OK){
+
+            zlog_error(category_debug,
+                       "Connect to database failed: %s",
+                       PQerrorMessage(db_conn));
+
+            PQfinish(db_conn);
+
+            return E_SQL_OPEN_DATABASE;
+        }
+
+        memset(sql, 0, sizeof(sql));
+        sprintf(sql, "LISTEN %s;", OBJECT_TABLE_CHANGE_CHANNEL);
+
+        if(WORK_SUCCESSFULLY != SQL_execute(db_conn, sql)){
+
+            zlog_error(category_debug, "SQL_execute failed: %s", 
+                       PQerrorMessage(db_conn));
+
+            PQfinish(db_conn);
+
+            return E_SQL_EXECUTE;
+        }
+
+        db_connection_list_head->listen_db = db_conn;
+
+        *is_changed = true;
 
-}
\ No newline at end of file
+        return WORK_SUCCESSFULLY;
+    }
+
+    db_conn = db_connection_list_head->listen_db;
+
+    if(0 == PQconsumeInput(db_conn)){
+
+        zlog_error(category_debug, "PQconsumeInput failed: %s", 
+                   PQerrorMessage(db_conn));
+
+        PQfinish(db_conn);
+        db_connection_list_head->listen_db = NULL;
+
+        return E_SQL_EXECUTE;
+    }
+
+    while(NULL != (notify = PQnotifies(db_conn))){
+
+        *is_changed = true;
+
+        PQfreemem(notify);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
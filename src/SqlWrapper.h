@@ -43,15 +43,65 @@
 #define SQL_WRAPPER_H
 
 #include "BeDIS.h"
+#include "DirtyObjectSet.h"
+#include "ClockOffset.h"
+#include "ClockCache.h"
+#include "TrackingArchive.h"
+#include "Occupancy.h"
+#include "ObjectTrajectory.h"
+#include "ObjectMirror.h"
+#include "FragmentReassembly.h"
+#include "EventWatermark.h"
+#include "SqlCoroutine.h"
+#include "ProtocolSchema.h"
 #include <libpq-fe.h>
 
 /* Maximum length of message to communicate with SQL wrapper API in bytes */
 #define SQL_TEMP_BUFFER_LENGTH 4096
 
+/* Maximum length of the SQL expression of the current timestamp in bytes */
+#define LENGTH_OF_CURRENT_TIMESTAMP 32
+
+/* Maximum length of the location summarization SQL statements in bytes. The 
+statements embed the list of MAC addresses of objects being summarized. */
+#define SQL_SUMMARY_BUFFER_LENGTH 16384
+
+/* Maximum number of objects summarized by one set of location summarization 
+SQL statements */
+#define MAXIMUM_OBJECTS_IN_LOCATION_SUMMARY_BATCH 128
+
+/* Maximum number of objects in a tracking data message. A message 
+reassembled from fragments carries more objects than a single datagram. */
+#define MAXIMUM_OBJECTS_IN_TRACKING_DATA 1024
+
+/* The largest generation number of location summarization. The generation 
+number wraps around to 1 after reaching this value. */
+#define MAXIMUM_LOCATION_SUMMARY_GENERATION 1000000000
+
+/* Number of rows fetched from a server-side cursor at a time when a large 
+result set is processed in chunks */
+#define SQL_CURSOR_FETCH_ROWS 500
+
+/* Number of columns of tracking_table stored in archive files */
+#define NUMBER_FIELDS_OF_ARCHIVED_TRACKING_DATA 7
+
 /* The times of retrying to get available database connection from connection 
 pool */
 #define SQL_GET_AVAILABLE_CONNECTION_RETRIES 5
 
+/* Time in seconds a worker thread waits before opening its dedicated 
+connection again after the previous attempt failed. Meanwhile the thread 
+uses the shared connection pool. */
+#define SQL_DEDICATED_CONNECTION_RETRY_INTERVAL_IN_SEC 30
+
+/* The counters of dedicated connections are written by their owner threads 
+without the lock of the connection pool */
+#ifdef _WIN32
+#define SQL_ATOMIC_INCREMENT(counter) InterlockedIncrement(&(counter))
+#else
+#define SQL_ATOMIC_INCREMENT(counter) __sync_fetch_and_add(&(counter), 1)
+#endif
+
 /* When debugging is needed */
 //#define debugging
 
@@ -63,6 +113,15 @@ typedef struct{
 
     PGconn *db;
 
+    /* The flag indicating whether the connection is owned by a worker thread
+       instead of being shared in the connection pool */
+    int is_dedicated;
+
+    /* The number of times the dedicated connection is taken by its owner. 
+       It is incremented atomically, because the metrics read it while the 
+       owner is running. */
+    volatile long number_of_uses;
+
     struct List_Entry list_entry;
 
 } DBConnectionNode;
@@ -73,6 +132,39 @@ typedef struct{
     
     struct List_Entry list_head;
 
+    /* The list of connections owned by worker threads. Each owner accesses 
+       its own connection without taking list_lock. */
+    struct List_Entry dedicated_list_head;
+
+    /* The information to open database connections */
+    char conninfo[SQL_TEMP_BUFFER_LENGTH];
+
+    /* The number of connections in the shared connection pool */
+    int number_of_shared_connections;
+
+    /* The maximum number of connections owned by worker threads */
+    int max_dedicated_connections;
+
+    /* The number of connections owned by worker threads */
+    int number_of_dedicated_connections;
+
+    /* The serial id of the next connection owned by a worker thread */
+    int next_dedicated_serial_id;
+
+    /* The number of times list_lock is taken to get or release connections */
+    int number_of_lock_acquisitions;
+
+    /* The number of times a connection is taken from the shared pool */
+    int number_of_shared_hits;
+
+    /* The number of times no connection is available in the shared pool */
+    int number_of_failures;
+
+    /* The connection listening to change notifications of object_table. It 
+       is opened by SQL_check_object_table_changes and only used by the 
+       thread refreshing the object mirror. */
+    PGconn *listen_db;
+
 } DBConnectionListHead;
 
 
@@ -166,6 +258,11 @@ static ErrorCode SQL_rollback_transaction(PGconn *db_conn);
      max_connection - the maximum number of database connection in the 
                       connection pool
 
+     max_dedicated_connection - the maximum number of database connections 
+                                owned by worker threads. Dedicated 
+                                connections are opened when worker threads 
+                                bind them. 0 disables dedicated connections.
+
   Return Value:
 
      ErrorCode - indicate the result of execution, the expected return code 
@@ -175,7 +272,8 @@ static ErrorCode SQL_rollback_transaction(PGconn *db_conn);
 ErrorCode SQL_create_database_connection_pool(
     char *conninfo, 
     DBConnectionListHead * db_connection_list_head, 
-    int max_connection);
+    int max_connection,
+    int max_dedicated_connection);
 
 /*
   SQL_destroy_database_connection_pool
@@ -239,6 +337,52 @@ ErrorCode SQL_release_database_connection(
     DBConnectionListHead *db_connection_list_head,
     int serial_id);
 
+/*
+  SQL_bind_dedicated_database_connection
+
+    Open a database connection owned by the calling worker thread for its 
+    lifetime. Afterwards SQL_get_database_connection and 
+    SQL_release_database_connection called by this thread use the dedicated
+    connection without taking the lock of the connection pool. Nothing is 
+    done if the thread already owns a connection or dedicated connections 
+    are disabled. A thread which finds the maximum number of dedicated 
+    connections reached remembers it and stays on the shared connection 
+    pool. After a failed attempt, or after its connection is found broken 
+    and cannot be reset, the thread uses the shared connection pool and 
+    only tries again after SQL_DEDICATED_CONNECTION_RETRY_INTERVAL_IN_SEC.
+  
+  Parameter:
+
+    db_connection_list_head - the list head of database connection pool
+
+  Return Value:
+
+    ErrorCode - indicate the result of execution, the expected return code 
+                is WORK_SUCCESSFULLY
+*/
+
+ErrorCode SQL_bind_dedicated_database_connection(
+    DBConnectionListHead *db_connection_list_head);
+
+/*
+  SQL_report_database_connection_metrics
+
+    Write the ownership and usage of database connections to the health 
+    report log.
+  
+  Parameter:
+
+    db_connection_list_head - the list head of database connection pool
+
+  Return Value:
+
+    ErrorCode - indicate the result of execution, the expected return code 
+                is WORK_SUCCESSFULLY
+*/
+
+ErrorCode SQL_report_database_connection_metrics(
+    DBConnectionListHead *db_connection_list_head);
+
 /*
   SQL_vacuum_database();
 
@@ -278,6 +422,33 @@ ErrorCode SQL_vacuum_database(DBConnectionListHead *db_connection_list_head);
 ErrorCode SQL_delete_old_data(DBConnectionListHead *db_connection_list_head, 
                               int retention_hours);
 
+/*
+  SQL_archive_expiring_tracking_data
+
+     Streams each chunk of tracking_table which is older than the specified 
+     number of hours into an archive file under archive_directory, before 
+     SQL_delete_old_data drops the chunk. A chunk whose archive file already 
+     exists is skipped.
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+     retention_hours - specify the hours for data retention
+
+     archive_directory - the directory to store the archive files
+
+  Return Value:
+
+     ErrorCode - indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY
+*/
+
+ErrorCode SQL_archive_expiring_tracking_data(
+    DBConnectionListHead *db_connection_list_head,
+    int retention_hours,
+    char *archive_directory);
+
 
 /*
   SQL_update_gateway_registration_status
@@ -401,6 +572,64 @@ ErrorCode SQL_update_lbeacon_health_status(
     size_t buf_len,
     char *gateway_ip_address);
 
+/*
+  SQL_update_registration_status_coroutine
+
+     The coroutine form of a join request. It registers the gateway at 
+     co->address, then each LBeacon in co->buf, without holding a thread 
+     while the statements run.
+
+  Parameter:
+
+     co - the coroutine. co->buf has the format of the buf input string of
+          SQL_update_lbeacon_registration_status.
+
+  Return Value:
+
+     SqlCoroutineStatus - SQL_COROUTINE_WAITING until the last statement 
+                          ends. co->is_failed tells whether any update 
+                          failed.
+*/
+
+SqlCoroutineStatus SQL_update_registration_status_coroutine(
+    SqlCoroutine *co);
+
+/*
+  SQL_update_gateway_health_status_coroutine
+
+     The coroutine form of SQL_update_gateway_health_status.
+
+  Parameter:
+
+     co - the coroutine. co->buf has the format of the buf input string of
+          SQL_update_gateway_health_status.
+
+  Return Value:
+
+     SqlCoroutineStatus - SQL_COROUTINE_WAITING until the statement ends
+*/
+
+SqlCoroutineStatus SQL_update_gateway_health_status_coroutine(
+    SqlCoroutine *co);
+
+/*
+  SQL_update_lbeacon_health_status_coroutine
+
+     The coroutine form of SQL_update_lbeacon_health_status.
+
+  Parameter:
+
+     co - the coroutine. co->buf has the format of the buf input string of
+          SQL_update_lbeacon_health_status.
+
+  Return Value:
+
+     SqlCoroutineStatus - SQL_COROUTINE_WAITING until the statement ends
+*/
+
+SqlCoroutineStatus SQL_update_lbeacon_health_status_coroutine(
+    SqlCoroutine *co);
+
 /*
   SQL_update_object_tracking_data
 
@@ -421,11 +650,34 @@ ErrorCode SQL_update_lbeacon_health_status(
 
      buf_len - Length in number of bytes of buf input string
 
+     API_version - the API version of the packet. The tracked objects in buf 
+                   are decoded in the layout of this API version.
+
      server_installation_path - the absolute file path of server installation path
 
      is_enabled_panic_monitoring - the flag indicating whether panic monitoring is
                                    enabled
 
+     dirty_object_set_head - the set of objects waiting for location 
+                             summarization. Objects in buf are marked in this 
+                             set after their tracking data is stored.
+
+     clock_offset_list_head - the list of smoothed clock offsets of LBeacons. 
+                              The initial and final timestamps in buf are 
+                              converted to server time with the smoothed 
+                              clock offset of the LBeacon before they are 
+                              stored.
+
+     object_mirror - the in-memory mirror of object_table. The panic 
+                     violation is only updated in the database for objects 
+                     which may be under panic monitoring.
+
+     event_watermark - the event-time watermark state. Rows later than the 
+                       watermark of their gateway are stored but their 
+                       objects are not marked in dirty_object_set_head.
+
+     gateway_address - the address of the gateway which sent buf
+
   Return Value:
 
      ErrorCode - indicate the result of execution, the expected return code
@@ -436,8 +688,37 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
     DBConnectionListHead *db_connection_list_head,
     char *buf,
     size_t buf_len,
+    float API_version,
     char *server_installation_path,
-    int is_enabled_panic_monitoring);
+    int is_enabled_panic_monitoring,
+    DirtyObjectSetHead *dirty_object_set_head,
+    ClockOffsetListHead *clock_offset_list_head,
+    ObjectMirror *object_mirror,
+    EventWatermarkState *event_watermark,
+    char *gateway_address);
+
+/*
+  SQL_get_location_summary_generation
+
+     This function queries the largest generation number of location 
+     summarization stored in the is_location_updated column of 
+     object_summary_table. 
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+     generation - the pointer to the output generation number
+
+  Return Value:
+
+     ErrorCode - Indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY.
+*/
+
+ErrorCode SQL_get_location_summary_generation(
+    DBConnectionListHead *db_connection_list_head,
+    int *generation);
 
 /*
   SQL_summarize_object_location
@@ -447,12 +728,23 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
      value for each object mac_address. It is also responsible for maintaining 
      the first seen timestamp and last seen timestamp of the object mac_address 
      and lbeacon_uuid pair. The summary information is updated to the summary 
-     table object_summary_table.
+     table object_summary_table. Only the objects specified in 
+     mac_address_list are summarized.
 
   Parameter:
 
      db_connection_list_head - the list head of database connection pool
 
+     mac_address_list - the MAC addresses of objects to be summarized 
+                        separated by DELIMITER_COMMA
+
+     generation - the generation number of this summarization. Objects whose 
+                  location is updated as stable tags are marked with this 
+                  number in the is_location_updated column.
+
+     watermark - the event-time watermark in seconds since epoch at which 
+                 the time windows end. 0 ends the time windows at NOW().
+
      database_pre_filter_time_window_in_sec - 
          The length of time window in which tracked data is filtered to limit 
          database processing time
@@ -470,6 +762,12 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
                                              this distance the tag is treated
                                              as not moved
 
+     occupancy_counters - the occupancy counters updated with the current 
+                          LBeacon of each moving tag
+
+     trajectory_history - the trajectory history updated with the current 
+                          LBeacon and base location of each summarized tag
+
   Return Value:
 
      ErrorCode - Indicate the result of execution, the expected return code
@@ -478,10 +776,81 @@ ErrorCode SQL_update_object_tracking_data_with_battery_voltage(
 
 ErrorCode SQL_summarize_object_location(
     DBConnectionListHead *db_connection_list_head, 
+    char *mac_address_list,
+    int generation,
+    int watermark,
     int database_pre_filter_time_window_in_sec,
     int time_interval_in_sec,
     int rssi_difference_of_location_accuracy_tolerance,
-    int base_location_tolerance_in_millimeter);
+    int base_location_tolerance_in_millimeter,
+    OccupancyCounters *occupancy_counters,
+    TrajectoryHistory *trajectory_history);
+
+/*
+  SQL_load_object_occupancy
+
+     This function loads the current LBeacon, room and object type of all 
+     objects in object_summary_table into the occupancy counters. It is 
+     called once at startup, and the counters are maintained incrementally 
+     by SQL_summarize_object_location afterwards.
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+     occupancy_counters - the occupancy counters to be loaded
+
+  Return Value:
+
+     ErrorCode - Indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY.
+*/
+
+ErrorCode SQL_load_object_occupancy(
+    DBConnectionListHead *db_connection_list_head,
+    OccupancyCounters *occupancy_counters);
+
+/*
+  SQL_create_occupancy_rollup_table
+
+     This function creates occupancy_rollup_table and its index if they do 
+     not exist, and adds rollup_timestamp to a table created without it. 
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+  Return Value:
+
+     ErrorCode - Indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY.
+*/
+
+ErrorCode SQL_create_occupancy_rollup_table(
+    DBConnectionListHead *db_connection_list_head);
+
+/*
+  SQL_flush_occupancy_rollup
+
+     This function appends a snapshot of the occupancy counters to 
+     occupancy_rollup_table. Every row of the snapshot is stamped with the 
+     time of the flush. 
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+     occupancy_counters - the occupancy counters to be flushed
+
+  Return Value:
+
+     ErrorCode - Indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY.
+*/
+
+ErrorCode SQL_flush_occupancy_rollup(
+    DBConnectionListHead *db_connection_list_head,
+    OccupancyCounters *occupancy_counters);
 
 
 /*
@@ -618,7 +987,10 @@ ErrorCode SQL_collect_violation_events(
 
      This function checks object_summary_table to see whether there are any 
      violation events. If YES, the violation events of all monitoring 
-     types are recorded in a notification_table. 
+     types are recorded in a notification_table. The unprocessed events are 
+     read in chunks, and the reading stops once buf is full. Only the 
+     events marked processed are written to buf; an event whose mark 
+     fails is left for the next call. 
 
   Parameter:
 
@@ -665,6 +1037,7 @@ ErrorCode SQL_reload_monitor_config(
   SQL_dump_active_geo_fence_settings
 
      This function dumps geo-fence settings from database to specified file
+     row by row
 
   Parameter:
 
@@ -684,12 +1057,17 @@ ErrorCode SQL_dump_active_geo_fence_settings(DBConnectionListHead *db_connection
   SQL_dump_mac_address_under_geo_fence_monitor
 
      This function dumps mac address objects which are under geo-fence monitoring
+     row by row
 
   Parameter:
 
      db_connection_list_head - the list head of database connection pool
 
      filename - the specified file name to store the dumped mac address
+
+     object_mirror - the in-memory mirror of object_table. The objects are 
+                     dumped from the mirror instead of object_table once the 
+                     mirror is loaded.
      
   Return Value:
 
@@ -698,6 +1076,56 @@ ErrorCode SQL_dump_active_geo_fence_settings(DBConnectionListHead *db_connection
 */
 ErrorCode SQL_dump_mac_address_under_geo_fence_monitor(
     DBConnectionListHead *db_connection_list_head,
-    char *filename);
+    char *filename,
+    ObjectMirror *object_mirror);
+
+/*
+  SQL_load_object_mirror
+
+     This function loads the monitor type, area id and room of all objects 
+     in object_table into the object mirror. The objects deleted from 
+     object_table are removed from the mirror. The mirror is left unchanged 
+     if the load fails.
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+     object_mirror - the in-memory mirror of object_table
+
+  Return Value:
+
+     ErrorCode - indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY
+*/
+ErrorCode SQL_load_object_mirror(
+    DBConnectionListHead *db_connection_list_head,
+    ObjectMirror *object_mirror);
+
+/*
+  SQL_check_object_table_changes
+
+     This function checks whether object_table is notified as changed on 
+     OBJECT_TABLE_CHANGE_CHANNEL since the previous call. The listening 
+     connection is opened on the first call and reopened after it is broken. 
+     Because notifications may be missed while the connection is not 
+     listening, object_table is reported as changed whenever the connection 
+     is (re)opened.
+
+  Parameter:
+
+     db_connection_list_head - the list head of database connection pool
+
+     is_changed - the pointer to the output flag indicating whether 
+                  object_table is changed
+
+  Return Value:
+
+     ErrorCode - indicate the result of execution, the expected return code
+                 is WORK_SUCCESSFULLY
+*/
+ErrorCode SQL_check_object_table_changes(
+    DBConnectionListHead *db_connection_list_head,
+    bool *is_changed);
 
 #endif
\ No newline at end of file
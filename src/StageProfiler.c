@@ -0,0 +1,272 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     StageProfiler.c
+
+  File Description:
+
+     This file provides APIs to measure the time spent in each processing
+     stage of the server. Each thread counts its own samples, and the
+     counters of all threads are aggregated into histograms on demand.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "StageProfiler.h"
+
+/* The counters of the calling thread */
+static THREAD_LOCAL ProfileThreadCounters *profile_thread_counters = NULL;
+
+/* The names of the stages in the report */
+static const char * const ProfileStage_String[] = {
+    "receive",
+    "tracked_object_data",
+    "geo_fence",
+    "sql_build",
+    "sql_execute"
+};
+
+static long long get_profile_time_in_ns(){
+
+#ifdef _WIN32
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    return (long long)((double)counter.QuadPart * 1000000000 / 
+                       frequency.QuadPart);
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (long long)now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+static int get_profile_histogram_bucket(unsigned long long time_in_ns){
+
+    int bucket = 0;
+
+    while(time_in_ns > 1 && bucket < NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS - 1){
+        time_in_ns >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void init_stage_profiler(StageProfiler *profiler, bool is_enabled){
+
+    memset(profiler, 0, sizeof(StageProfiler));
+
+    pthread_mutex_init(&profiler->list_lock, 0);
+
+    profiler->is_enabled = is_enabled;
+}
+
+long long begin_profile_stage(StageProfiler *profiler){
+
+    if(false == profiler->is_enabled){
+        return 0;
+    }
+
+    return get_profile_time_in_ns();
+}
+
+void end_profile_stage(StageProfiler *profiler, 
+                       ProfileStage stage, 
+                       long long start_time){
+
+    ProfileStageCounters *counters = NULL;
+    unsigned long long elapsed_time = 0;
+
+    if(0 == start_time){
+        return;
+    }
+
+    elapsed_time = get_profile_time_in_ns() - start_time;
+
+    /* A thread takes its counters on its first sample, so samples never 
+       contend for a lock or a cache line */
+    if(NULL == profile_thread_counters){
+
+        pthread_mutex_lock(&profiler->list_lock);
+
+        if(profiler->number_of_threads < MAX_NUMBER_OF_PROFILED_THREADS){
+            profile_thread_counters = 
+                &profiler->threads[profiler->number_of_threads];
+            profiler->number_of_threads++;
+        }
+
+        pthread_mutex_unlock(&profiler->list_lock);
+
+        if(NULL == profile_thread_counters){
+            profiler->number_of_dropped_samples++;
+            return;
+        }
+    }
+
+    counters = &profile_thread_counters->stages[stage];
+
+    counters->number_of_samples++;
+    counters->total_time_in_ns += elapsed_time;
+    if(elapsed_time > counters->max_time_in_ns){
+        counters->max_time_in_ns = elapsed_time;
+    }
+    counters->histogram[get_profile_histogram_bucket(elapsed_time)]++;
+}
+
+void reset_stage_profiler(StageProfiler *profiler){
+
+    int i;
+
+    pthread_mutex_lock(&profiler->list_lock);
+
+    for(i = 0; i < profiler->number_of_threads; i++){
+        memset(&profiler->threads[i], 0, sizeof(ProfileThreadCounters));
+    }
+
+    profiler->number_of_dropped_samples = 0;
+
+    pthread_mutex_unlock(&profiler->list_lock);
+}
+
+void get_profile_stage_counters(StageProfiler *profiler,
+                                ProfileStage stage,
+                                ProfileStageCounters *total){
+
+    ProfileStageCounters *counters = NULL;
+    int number_of_threads = 0;
+    int i;
+    int j;
+
+    pthread_mutex_lock(&profiler->list_lock);
+    number_of_threads = profiler->number_of_threads;
+    pthread_mutex_unlock(&profiler->list_lock);
+
+    memset(total, 0, sizeof(ProfileStageCounters));
+
+    /* The counters are read without a lock, so a report taken while 
+       threads are sampling may be off by the samples in progress */
+    for(i = 0; i < number_of_threads; i++){
+
+        counters = &profiler->threads[i].stages[stage];
+
+        total->number_of_samples += counters->number_of_samples;
+        total->total_time_in_ns += counters->total_time_in_ns;
+        if(counters->max_time_in_ns > total->max_time_in_ns){
+            total->max_time_in_ns = counters->max_time_in_ns;
+        }
+        for(j = 0; j < NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS; j++){
+            total->histogram[j] += counters->histogram[j];
+        }
+    }
+}
+
+const char *get_profile_stage_name(ProfileStage stage){
+
+    if(stage < 0 || stage >= NUMBER_OF_PROFILE_STAGES){
+        return "";
+    }
+
+    return ProfileStage_String[stage];
+}
+
+int get_stage_profiler_report(StageProfiler *profiler,
+                              char *buf,
+                              size_t buf_len){
+
+    ProfileStageCounters total;
+    char one_stage[CONFIG_BUFFER_SIZE];
+    char one_bucket[64];
+    size_t used_len = 0;
+    int number_of_threads = 0;
+    int stage;
+    int j;
+
+    memset(buf, 0, buf_len);
+
+    pthread_mutex_lock(&profiler->list_lock);
+    number_of_threads = profiler->number_of_threads;
+    pthread_mutex_unlock(&profiler->list_lock);
+
+    memset(one_stage, 0, sizeof(one_stage));
+    sprintf(one_stage, "profiler_enabled=%d;profiled_threads=%d;" \
+            "dropped_samples=%d;",
+            profiler->is_enabled,
+            number_of_threads,
+            profiler->number_of_dropped_samples);
+
+    if(strlen(one_stage) < buf_len){
+        strcat(buf, one_stage);
+        used_len = strlen(one_stage);
+    }
+
+    for(stage = 0; stage < NUMBER_OF_PROFILE_STAGES; stage++){
+
+        get_profile_stage_counters(profiler, (ProfileStage)stage, &total);
+
+        memset(one_stage, 0, sizeof(one_stage));
+        sprintf(one_stage, "%s=%llu,%llu,%llu",
+                ProfileStage_String[stage],
+                total.number_of_samples,
+                total.total_time_in_ns / 1000,
+                total.max_time_in_ns / 1000);
+
+        for(j = 0; j < NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS; j++){
+
+            if(0 == total.histogram[j]){
+                continue;
+            }
+
+            sprintf(one_bucket, ",%d:%llu", j, total.histogram[j]);
+
+            if(strlen(one_stage) + strlen(one_bucket) + 2 > 
+               sizeof(one_stage)){
+                break;
+            }
+            strcat(one_stage, one_bucket);
+        }
+        strcat(one_stage, ";");
+
+        if(used_len + strlen(one_stage) >= buf_len){
+            break;
+        }
+
+        strcat(buf, one_stage);
+        used_len += strlen(one_stage);
+    }
+
+    return used_len;
+}
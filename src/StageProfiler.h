@@ -0,0 +1,263 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     StageProfiler.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in StageProfiler.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+
+#include "BeDIS.h"
+#include "CpuAffinity.h"
+
+/* Maximum number of threads with their own stage counters. Samples of 
+further threads are dropped. */
+#define MAX_NUMBER_OF_PROFILED_THREADS 64
+
+/* Number of buckets of a stage histogram. Bucket i counts the samples 
+which took from 2^i to 2^(i+1) - 1 nanoseconds, and the last bucket also 
+counts longer samples. */
+#define NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS 40
+
+/* The argument of the profile request to clear the counters after they are 
+reported */
+#define PROFILE_REQUEST_RESET "reset"
+
+/* The processing stages being measured */
+typedef enum _ProfileStage{
+    /* Parsing the header of a received packet into a buffer node */
+    PROFILE_STAGE_RECEIVE = 0,
+    /* Processing tracked object data in Server_LBeacon_routine */
+    PROFILE_STAGE_TRACKED_OBJECT_DATA = 1,
+    /* Checking tracked object data against geo-fences */
+    PROFILE_STAGE_GEO_FENCE = 2,
+    /* Parsing, escaping and formatting data into SQL statements */
+    PROFILE_STAGE_SQL_BUILD = 3,
+    /* Waiting for PQexec to return */
+    PROFILE_STAGE_SQL_EXECUTE = 4,
+    NUMBER_OF_PROFILE_STAGES = 5
+} ProfileStage;
+
+typedef struct {
+
+    unsigned long long number_of_samples;
+
+    unsigned long long total_time_in_ns;
+
+    unsigned long long max_time_in_ns;
+
+    unsigned long long histogram[NUMBER_OF_PROFILE_HISTOGRAM_BUCKETS];
+
+} ProfileStageCounters;
+
+/* The counters written by one thread only */
+typedef struct {
+
+    ProfileStageCounters stages[NUMBER_OF_PROFILE_STAGES];
+
+} ProfileThreadCounters;
+
+typedef struct {
+
+    /* The flag of measuring stages. When it is false, a stage costs one 
+       comparison. */
+    volatile bool is_enabled;
+
+    /* The lock of assigning counters to threads */
+    pthread_mutex_t list_lock;
+
+    int number_of_threads;
+
+    /* The number of samples dropped because all counters were assigned */
+    volatile int number_of_dropped_samples;
+
+    ProfileThreadCounters threads[MAX_NUMBER_OF_PROFILED_THREADS];
+
+} StageProfiler;
+
+/* global variables */
+
+/* The stage profiler of the server */
+StageProfiler stage_profiler;
+
+/*
+  init_stage_profiler:
+
+     This function initializes the counters of the stage profiler.
+
+  Parameters:
+
+     profiler - The pointer to the stage profiler
+
+     is_enabled - The flag of measuring stages
+
+  Return value:
+
+     None
+
+ */
+
+void init_stage_profiler(StageProfiler *profiler, bool is_enabled);
+
+/*
+  begin_profile_stage:
+
+     This function returns the start time of a stage.
+
+  Parameters:
+
+     profiler - The pointer to the stage profiler
+
+  Return value:
+
+     long long - The monotonic time in nanoseconds, or 0 if the profiler is 
+                 disabled
+
+ */
+
+long long begin_profile_stage(StageProfiler *profiler);
+
+/*
+  end_profile_stage:
+
+     This function adds the time since start_time to the counters of the 
+     stage in the calling thread.
+
+  Parameters:
+
+     profiler - The pointer to the stage profiler
+
+     stage - The stage which ended
+
+     start_time - The value returned by begin_profile_stage
+
+  Return value:
+
+     None
+
+ */
+
+void end_profile_stage(StageProfiler *profiler, 
+                       ProfileStage stage, 
+                       long long start_time);
+
+/*
+  reset_stage_profiler:
+
+     This function clears the counters of all threads. Samples ending 
+     during the reset may be partly kept.
+
+  Parameters:
+
+     profiler - The pointer to the stage profiler
+
+  Return value:
+
+     None
+
+ */
+
+void reset_stage_profiler(StageProfiler *profiler);
+
+/*
+  get_profile_stage_counters:
+
+     This function aggregates the counters of a stage over all threads.
+
+  Parameters:
+
+     profiler - The pointer to the stage profiler
+
+     stage - The stage
+
+     total - The pointer to the aggregated counters
+
+  Return value:
+
+     None
+
+ */
+
+void get_profile_stage_counters(StageProfiler *profiler,
+                                ProfileStage stage,
+                                ProfileStageCounters *total);
+
+/*
+  get_profile_stage_name:
+
+     This function returns the name of a stage used in the reports.
+
+  Parameters:
+
+     stage - The stage
+
+  Return value:
+
+     const char * - The name of the stage
+
+ */
+
+const char *get_profile_stage_name(ProfileStage stage);
+
+/*
+  get_stage_profiler_report:
+
+     This function aggregates the counters of all threads and writes each 
+     stage into buf as name=samples,total_us,max_us followed by 
+     ,bucket:count for each non-empty histogram bucket. A bucket is the 
+     base-2 logarithm of its lower bound in nanoseconds.
+
+  Parameters:
+
+     profiler - The pointer to the stage profiler
+
+     buf - The output buffer
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     int - The length in number of bytes of the report
+
+ */
+
+int get_stage_profiler_report(StageProfiler *profiler,
+                              char *buf,
+                              size_t buf_len);
+
+#endif
@@ -0,0 +1,269 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     TimeCriticalReceiver.c
+
+  File Description:
+
+     This file provides APIs to receive time-critical tracked object data on
+     a dedicated UDP port, so geo-fence packets never wait behind bulk
+     tracked object data in the socket buffer of recv_port.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "TimeCriticalReceiver.h"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+static void close_time_critical_socket(TimeCriticalReceiver *receiver){
+
+#ifdef _WIN32
+    if(INVALID_SOCKET != receiver->socket_fd){
+        closesocket(receiver->socket_fd);
+        receiver->socket_fd = INVALID_SOCKET;
+    }
+#else
+    if(receiver->socket_fd >= 0){
+        close(receiver->socket_fd);
+        receiver->socket_fd = -1;
+    }
+#endif
+}
+
+ErrorCode init_time_critical_receiver(TimeCriticalReceiver *receiver,
+                                      int port,
+                                      int receive_buffer_size,
+                                      int inherited_socket_fd,
+                                      ReceivedPacketHandler handler){
+
+    struct sockaddr_in address;
+    int granted_buffer_size = 0;
+#ifdef _WIN32
+    DWORD timeout = TIME_CRITICAL_RECEIVE_TIMEOUT_IN_MS;
+    int option_len = sizeof(granted_buffer_size);
+#else
+    struct timeval timeout;
+    socklen_t option_len = sizeof(granted_buffer_size);
+#endif
+
+    memset(receiver, 0, sizeof(TimeCriticalReceiver));
+
+    receiver->handler = handler;
+    receiver->port = port;
+    receiver->requested_buffer_size = receive_buffer_size;
+
+#ifndef _WIN32
+    if(inherited_socket_fd >= 0){
+        receiver->socket_fd = dup(inherited_socket_fd);
+    }else{
+        receiver->socket_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    }
+#else
+    receiver->socket_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+#endif
+#ifdef _WIN32
+    if(INVALID_SOCKET == receiver->socket_fd){
+#else
+    if(receiver->socket_fd < 0){
+#endif
+        zlog_error(category_debug, "time-critical receiver socket failed");
+        return E_WIFI_INIT_FAIL;
+    }
+
+    /* A larger receive buffer lets a burst of geo-fence packets wait in the 
+       kernel instead of being dropped while the thread is dispatching */
+    if(receive_buffer_size > 0){
+        if(0 != setsockopt(receiver->socket_fd, SOL_SOCKET, SO_RCVBUF, 
+                           (char *)&receive_buffer_size, 
+                           sizeof(receive_buffer_size))){
+            zlog_error(category_debug, 
+                       "time-critical receiver SO_RCVBUF [%d] failed", 
+                       receive_buffer_size);
+        }
+    }
+
+    if(0 == getsockopt(receiver->socket_fd, SOL_SOCKET, SO_RCVBUF, 
+                       (char *)&granted_buffer_size, &option_len)){
+        receiver->granted_buffer_size = granted_buffer_size;
+    }
+
+    /* The receive times out periodically so the thread notices when 
+       ready_to_work becomes false */
+#ifndef _WIN32
+    timeout.tv_sec = 0;
+    timeout.tv_usec = TIME_CRITICAL_RECEIVE_TIMEOUT_IN_MS * 1000;
+#endif
+    if(0 != setsockopt(receiver->socket_fd, SOL_SOCKET, SO_RCVTIMEO, 
+                       (char *)&timeout, sizeof(timeout))){
+        zlog_error(category_debug, 
+                   "time-critical receiver SO_RCVTIMEO failed");
+        close_time_critical_socket(receiver);
+        return E_WIFI_INIT_FAIL;
+    }
+
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((unsigned short)port);
+
+    /* A handed off socket is already bound, and the port is still held by 
+       the process which handed it off */
+    if(inherited_socket_fd < 0 &&
+       0 != bind(receiver->socket_fd, (struct sockaddr *)&address, 
+                 sizeof(address))){
+        zlog_error(category_debug, 
+                   "time-critical receiver bind port [%d] failed", port);
+        close_time_critical_socket(receiver);
+        return E_WIFI_INIT_FAIL;
+    }
+
+    zlog_info(category_debug, 
+              "time-critical receiver listens on port [%d] with receive " \
+              "buffer [%d] bytes", port, receiver->granted_buffer_size);
+
+    return WORK_SUCCESSFULLY;
+}
+
+void release_time_critical_receiver(TimeCriticalReceiver *receiver){
+
+    close_time_critical_socket(receiver);
+}
+
+ErrorCode send_time_critical_receiver_packet(TimeCriticalReceiver *receiver,
+                                             char *address,
+                                             int port,
+                                             char *content,
+                                             int content_size){
+
+    struct sockaddr_in destination;
+
+    if(content_size <= 0 || content_size > WIFI_MESSAGE_LENGTH){
+        return E_INPUT_PARAMETER;
+    }
+
+    memset(&destination, 0, sizeof(destination));
+    destination.sin_family = AF_INET;
+    destination.sin_addr.s_addr = inet_addr(address);
+    destination.sin_port = htons(port);
+
+    if(content_size != sendto(receiver->socket_fd, 
+                              content, 
+                              content_size, 
+                              0, 
+                              (struct sockaddr *)&destination, 
+                              sizeof(destination))){
+
+        zlog_error(category_debug, 
+                   "time-critical receiver cannot send to [%s:%d]", 
+                   address, port);
+        return E_WIFI_INIT_FAIL;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+void *time_critical_receiver_routine(void *_receiver){
+
+    TimeCriticalReceiver *receiver = (TimeCriticalReceiver *)_receiver;
+    char content[WIFI_MESSAGE_LENGTH];
+    char address[NETWORK_ADDR_LENGTH];
+    struct sockaddr_in source;
+    int received_length = 0;
+    int pkt_direction = 0;
+    int pkt_type = 0;
+#ifdef _WIN32
+    int source_len = 0;
+#else
+    socklen_t source_len = 0;
+#endif
+
+    while(true == ready_to_work && false == receiver->is_stopped){
+
+        memset(content, 0, sizeof(content));
+        source_len = sizeof(source);
+
+        received_length = recvfrom(receiver->socket_fd, 
+                                   content, 
+                                   sizeof(content) - 1, 
+                                   0, 
+                                   (struct sockaddr *)&source, 
+                                   &source_len);
+
+        /* A timeout or an interrupted receive returns no packet */
+        if(received_length <= 0){
+            continue;
+        }
+
+        receiver->number_of_packets++;
+        receiver->number_of_bytes += received_length;
+
+        if(2 == sscanf(content, "%d;%d;", &pkt_direction, &pkt_type) && 
+           time_critical_tracked_object_data != pkt_type){
+
+            receiver->number_of_misrouted_packets++;
+        }
+
+        memset(address, 0, sizeof(address));
+        strncpy(address, inet_ntoa(source.sin_addr), sizeof(address) - 1);
+
+        receiver->handler(content, address, ntohs(source.sin_port));
+    }
+
+    return (void *)NULL;
+}
+
+void get_time_critical_receiver_report(TimeCriticalReceiver *receiver,
+                                       char *buf,
+                                       size_t buf_len){
+
+    char report[CONFIG_BUFFER_SIZE];
+
+    memset(report, 0, sizeof(report));
+    sprintf(report, 
+            "time_critical_port=%d;time_critical_recv_buffer=%d;" \
+            "time_critical_packets=%llu;time_critical_bytes=%llu;" \
+            "time_critical_misrouted_packets=%llu;",
+            receiver->port,
+            receiver->granted_buffer_size,
+            receiver->number_of_packets,
+            receiver->number_of_bytes,
+            receiver->number_of_misrouted_packets);
+
+    memset(buf, 0, buf_len);
+    strncpy(buf, report, buf_len - 1);
+}
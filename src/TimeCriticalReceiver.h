@@ -0,0 +1,221 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     TimeCriticalReceiver.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in TimeCriticalReceiver.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef TIME_CRITICAL_RECEIVER_H
+#define TIME_CRITICAL_RECEIVER_H
+
+#include "BeDIS.h"
+#include "IoUringReceiver.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#endif
+
+/* Time in milliseconds a receive waits for a packet before checking whether 
+the receiver should stop */
+#define TIME_CRITICAL_RECEIVE_TIMEOUT_IN_MS 100
+
+typedef struct {
+
+    /* The function to process each received packet */
+    ReceivedPacketHandler handler;
+
+    /* The UDP port the receiver is listening on */
+    int port;
+
+    /* The size in bytes of the socket receive buffer requested from the 
+       kernel, and the size actually granted */
+    int requested_buffer_size;
+    int granted_buffer_size;
+
+#ifdef _WIN32
+    SOCKET socket_fd;
+#else
+    int socket_fd;
+#endif
+
+    /* The number of packets received */
+    unsigned long long number_of_packets;
+
+    /* The number of payload bytes received */
+    unsigned long long number_of_bytes;
+
+    /* The number of packets of other types sent to the time-critical port. 
+       They are still dispatched, but indicate a misconfigured gateway. */
+    unsigned long long number_of_misrouted_packets;
+
+    /* The flag asking the receiver to stop before ready_to_work becomes 
+       false, when its socket was handed off to another process */
+    volatile bool is_stopped;
+
+} TimeCriticalReceiver;
+
+/* global variables */
+
+/* The optional receiver of time-critical tracked object data */
+TimeCriticalReceiver time_critical_receiver;
+
+/*
+  init_time_critical_receiver:
+
+     This function binds a UDP socket to the specified port and sizes its 
+     receive buffer. A socket already bound to the port by another process 
+     is duplicated instead.
+
+  Parameters:
+
+     receiver - The pointer to the time-critical receiver
+
+     port - The UDP port to listen on
+
+     receive_buffer_size - The size in bytes of the socket receive buffer. 
+                           Zero keeps the default of the system.
+
+     inherited_socket_fd - The socket bound to port and handed off by 
+                           another process, or -1 to bind a new socket
+
+     handler - The function to process each received packet
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_WIFI_INIT_FAIL: the socket cannot be created or bound.
+
+ */
+
+ErrorCode init_time_critical_receiver(TimeCriticalReceiver *receiver,
+                                      int port,
+                                      int receive_buffer_size,
+                                      int inherited_socket_fd,
+                                      ReceivedPacketHandler handler);
+
+/*
+  release_time_critical_receiver:
+
+     This function closes the socket of the receiver.
+
+  Parameters:
+
+     receiver - The pointer to the time-critical receiver
+
+  Return value:
+
+     None
+
+ */
+
+void release_time_critical_receiver(TimeCriticalReceiver *receiver);
+
+/*
+  send_time_critical_receiver_packet:
+
+     This function sends a packet from the socket of the receiver, so the 
+     destination sees it coming from the port of the receiver.
+
+  Parameters:
+
+     receiver - The pointer to the time-critical receiver
+
+     address - The IPv4 address of the destination
+
+     port - The UDP port of the destination
+
+     content - The payload to send
+
+     content_size - Length in number of bytes of content
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the size is invalid.
+                 E_WIFI_INIT_FAIL: the packet cannot be sent.
+
+ */
+
+ErrorCode send_time_critical_receiver_packet(TimeCriticalReceiver *receiver,
+                                             char *address,
+                                             int port,
+                                             char *content,
+                                             int content_size);
+
+/*
+  time_critical_receiver_routine:
+
+     This function receives packets on the socket and passes each of them to 
+     the handler until ready_to_work becomes false or the receiver is 
+     stopped.
+
+  Parameters:
+
+     _receiver - The pointer to the time-critical receiver
+
+  Return value:
+
+     None
+
+ */
+
+void *time_critical_receiver_routine(void *_receiver);
+
+/*
+  get_time_critical_receiver_report:
+
+     This function writes the counters of the receiver into buf.
+
+  Parameters:
+
+     receiver - The pointer to the time-critical receiver
+
+     buf - The output buffer of the report
+
+     buf_len - Length in number of bytes of buf
+
+  Return value:
+
+     None
+
+ */
+
+void get_time_critical_receiver_report(TimeCriticalReceiver *receiver,
+                                       char *buf,
+                                       size_t buf_len);
+
+#endif
@@ -0,0 +1,568 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     TrackingArchive.c
+
+  File Description:
+
+     This file provides APIs to write tracking data into column-oriented
+     archive files before the data is dropped from the database, and to scan
+     the archive files for offline analytics.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#include "TrackingArchive.h"
+
+static unsigned int get_dictionary_hash(char *value){
+
+    unsigned int hash = 5381;
+    char *current_char = value;
+
+    while(*current_char != '\0'){
+        hash = ((hash << 5) + hash) + (unsigned char) *current_char;
+        current_char++;
+    }
+
+    return hash;
+}
+
+/* Returns the index of value in the dictionary, adding it when absent */
+static int lookup_dictionary(unsigned short *slot,
+                             char *dictionary,
+                             size_t entry_len,
+                             int *number_of_entries,
+                             char *value){
+
+    unsigned int index = 0;
+    char *entry = NULL;
+
+    index = get_dictionary_hash(value) & 
+            (TRACKING_ARCHIVE_DICTIONARY_SLOTS - 1);
+
+    while(0 != slot[index]){
+        entry = dictionary + (slot[index] - 1) * entry_len;
+        if(strncmp(entry, value, entry_len) == 0){
+            return slot[index] - 1;
+        }
+        index = (index + 1) & (TRACKING_ARCHIVE_DICTIONARY_SLOTS - 1);
+    }
+
+    entry = dictionary + (*number_of_entries) * entry_len;
+    memset(entry, 0, entry_len);
+    strcpy(entry, value);
+
+    (*number_of_entries)++;
+    slot[index] = (unsigned short) *number_of_entries;
+
+    return *number_of_entries - 1;
+}
+
+static unsigned char *put_uint32(unsigned char *current, unsigned int value){
+
+    current[0] = (unsigned char)(value & 0xFF);
+    current[1] = (unsigned char)((value >> 8) & 0xFF);
+    current[2] = (unsigned char)((value >> 16) & 0xFF);
+    current[3] = (unsigned char)((value >> 24) & 0xFF);
+
+    return current + 4;
+}
+
+static unsigned char *get_uint32(unsigned char *current, 
+                                 unsigned char *end, 
+                                 unsigned int *value){
+
+    if(NULL == current || end - current < 4){
+        return NULL;
+    }
+
+    *value = (unsigned int)current[0] | 
+             ((unsigned int)current[1] << 8) |
+             ((unsigned int)current[2] << 16) | 
+             ((unsigned int)current[3] << 24);
+
+    return current + 4;
+}
+
+/* Writes a signed value as a zigzag-encoded variable-length integer */
+static unsigned char *put_varint(unsigned char *current, long long value){
+
+    unsigned long long zigzag = ((unsigned long long)value << 1) ^ 
+                                (unsigned long long)(value >> 63);
+
+    while(zigzag >= 0x80){
+        *current = (unsigned char)(zigzag | 0x80);
+        current++;
+        zigzag >>= 7;
+    }
+    *current = (unsigned char)zigzag;
+
+    return current + 1;
+}
+
+static unsigned char *get_varint(unsigned char *current, 
+                                 unsigned char *end,
+                                 long long *value){
+
+    unsigned long long zigzag = 0;
+    int shift = 0;
+
+    if(NULL == current){
+        return NULL;
+    }
+
+    while(current < end && shift < 7 * MAXIMUM_VARINT_LENGTH){
+        zigzag |= (unsigned long long)(*current & 0x7F) << shift;
+        if(0 == (*current & 0x80)){
+            *value = (long long)(zigzag >> 1) ^ -(long long)(zigzag & 1);
+            return current + 1;
+        }
+        current++;
+        shift += 7;
+    }
+
+    return NULL;
+}
+
+static unsigned char *put_dictionary(unsigned char *current,
+                                     char *dictionary,
+                                     size_t entry_len,
+                                     int number_of_entries){
+
+    int i;
+    size_t len = 0;
+
+    current = put_uint32(current, number_of_entries);
+
+    for(i = 0; i < number_of_entries; i++){
+        len = strlen(dictionary + i * entry_len);
+        *current = (unsigned char)len;
+        current++;
+        memcpy(current, dictionary + i * entry_len, len);
+        current += len;
+    }
+
+    return current;
+}
+
+static unsigned char *get_dictionary(unsigned char *current,
+                                     unsigned char *end,
+                                     char *dictionary,
+                                     size_t entry_len,
+                                     int *number_of_entries){
+
+    unsigned int count = 0;
+    unsigned int i;
+    size_t len = 0;
+
+    current = get_uint32(current, end, &count);
+    if(NULL == current || count > TRACKING_ARCHIVE_ROWS_PER_BLOCK){
+        return NULL;
+    }
+
+    for(i = 0; i < count; i++){
+        if(current >= end){
+            return NULL;
+        }
+        len = *current;
+        current++;
+        if(len >= entry_len || (size_t)(end - current) < len){
+            return NULL;
+        }
+        memset(dictionary + i * entry_len, 0, entry_len);
+        memcpy(dictionary + i * entry_len, current, len);
+        current += len;
+    }
+
+    *number_of_entries = count;
+
+    return current;
+}
+
+static ErrorCode flush_tracking_archive_block(TrackingArchiveWriter *writer){
+
+    TrackingArchiveBlock *block = writer->block;
+    unsigned char *current = NULL;
+    int i;
+    size_t block_len = 0;
+
+    if(0 == block->number_of_rows){
+        return WORK_SUCCESSFULLY;
+    }
+
+    /* The length of the block is filled in after encoding */
+    current = writer->encode_buffer + 4;
+
+    current = put_uint32(current, block->number_of_rows);
+
+    current = put_dictionary(current, 
+                             (char *)block->mac_address, 
+                             LENGTH_OF_MAC_ADDRESS,
+                             block->number_of_mac_addresses);
+    current = put_dictionary(current, 
+                             (char *)block->uuid, 
+                             LENGTH_OF_UUID,
+                             block->number_of_uuids);
+
+    for(i = 0; i < block->number_of_rows; i++){
+        current[0] = (unsigned char)(block->mac_address_id[i] & 0xFF);
+        current[1] = (unsigned char)(block->mac_address_id[i] >> 8);
+        current += 2;
+    }
+    for(i = 0; i < block->number_of_rows; i++){
+        current[0] = (unsigned char)(block->uuid_id[i] & 0xFF);
+        current[1] = (unsigned char)(block->uuid_id[i] >> 8);
+        current += 2;
+    }
+
+    memcpy(current, block->rssi, block->number_of_rows);
+    current += block->number_of_rows;
+    memcpy(current, block->panic_button, block->number_of_rows);
+    current += block->number_of_rows;
+    memcpy(current, block->battery_voltage, block->number_of_rows);
+    current += block->number_of_rows;
+
+    /* final_timestamp is delta-encoded against the previous row, and 
+       initial_timestamp against final_timestamp of the same row */
+    current = put_varint(current, block->final_timestamp[0]);
+    for(i = 1; i < block->number_of_rows; i++){
+        current = put_varint(current, 
+                             block->final_timestamp[i] - 
+                             block->final_timestamp[i - 1]);
+    }
+    for(i = 0; i < block->number_of_rows; i++){
+        current = put_varint(current, 
+                             block->final_timestamp[i] - 
+                             block->initial_timestamp[i]);
+    }
+
+    block_len = current - writer->encode_buffer;
+    put_uint32(writer->encode_buffer, (unsigned int)(block_len - 4));
+
+    if(fwrite(writer->encode_buffer, 1, block_len, writer->file) != 
+       block_len){
+        zlog_error(category_debug, "cannot write tracking archive block");
+        return E_OPEN_FILE;
+    }
+
+    writer->number_of_rows += block->number_of_rows;
+    writer->number_of_bytes += block_len;
+
+    block->number_of_rows = 0;
+    block->number_of_mac_addresses = 0;
+    block->number_of_uuids = 0;
+
+    memset(writer->mac_address_slot, 0, 
+           sizeof(unsigned short) * TRACKING_ARCHIVE_DICTIONARY_SLOTS);
+    memset(writer->uuid_slot, 0, 
+           sizeof(unsigned short) * TRACKING_ARCHIVE_DICTIONARY_SLOTS);
+
+    return WORK_SUCCESSFULLY;
+}
+
+static void free_tracking_archive_writer(TrackingArchiveWriter *writer){
+
+    if(NULL != writer->block){
+        free(writer->block);
+        writer->block = NULL;
+    }
+    if(NULL != writer->mac_address_slot){
+        free(writer->mac_address_slot);
+        writer->mac_address_slot = NULL;
+    }
+    if(NULL != writer->uuid_slot){
+        free(writer->uuid_slot);
+        writer->uuid_slot = NULL;
+    }
+    if(NULL != writer->encode_buffer){
+        free(writer->encode_buffer);
+        writer->encode_buffer = NULL;
+    }
+}
+
+ErrorCode open_tracking_archive_writer(TrackingArchiveWriter *writer,
+                                       char *filename){
+
+    memset(writer, 0, sizeof(TrackingArchiveWriter));
+
+    writer->block = malloc(sizeof(TrackingArchiveBlock));
+    writer->mac_address_slot = 
+        calloc(TRACKING_ARCHIVE_DICTIONARY_SLOTS, sizeof(unsigned short));
+    writer->uuid_slot = 
+        calloc(TRACKING_ARCHIVE_DICTIONARY_SLOTS, sizeof(unsigned short));
+    writer->encode_buffer = malloc(TRACKING_ARCHIVE_MAXIMUM_BLOCK_LENGTH);
+
+    if(NULL == writer->block || NULL == writer->mac_address_slot ||
+       NULL == writer->uuid_slot || NULL == writer->encode_buffer){
+
+        zlog_error(category_debug, "tracking archive writer malloc failed");
+        free_tracking_archive_writer(writer);
+        return E_MALLOC;
+    }
+
+    writer->block->number_of_rows = 0;
+    writer->block->number_of_mac_addresses = 0;
+    writer->block->number_of_uuids = 0;
+
+    writer->file = fopen(filename, "wb");
+    if(NULL == writer->file){
+        zlog_error(category_debug, "cannot open filepath %s", filename);
+        free_tracking_archive_writer(writer);
+        return E_OPEN_FILE;
+    }
+
+    if(fwrite(TRACKING_ARCHIVE_MAGIC, 1, TRACKING_ARCHIVE_MAGIC_LENGTH, 
+              writer->file) != TRACKING_ARCHIVE_MAGIC_LENGTH){
+
+        zlog_error(category_debug, "cannot write filepath %s", filename);
+        fclose(writer->file);
+        writer->file = NULL;
+        free_tracking_archive_writer(writer);
+        return E_OPEN_FILE;
+    }
+
+    writer->number_of_bytes = TRACKING_ARCHIVE_MAGIC_LENGTH;
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode append_tracking_archive_row(TrackingArchiveWriter *writer,
+                                      char *mac_address,
+                                      char *uuid,
+                                      int rssi,
+                                      int panic_button,
+                                      int battery_voltage,
+                                      long long initial_timestamp,
+                                      long long final_timestamp){
+
+    TrackingArchiveBlock *block = writer->block;
+    int row = 0;
+
+    if(strlen(mac_address) >= LENGTH_OF_MAC_ADDRESS || 
+       strlen(uuid) >= LENGTH_OF_UUID){
+        return E_INPUT_PARAMETER;
+    }
+
+    row = block->number_of_rows;
+
+    block->mac_address_id[row] = (unsigned short)
+        lookup_dictionary(writer->mac_address_slot,
+                          (char *)block->mac_address,
+                          LENGTH_OF_MAC_ADDRESS,
+                          &block->number_of_mac_addresses,
+                          mac_address);
+
+    block->uuid_id[row] = (unsigned short)
+        lookup_dictionary(writer->uuid_slot,
+                          (char *)block->uuid,
+                          LENGTH_OF_UUID,
+                          &block->number_of_uuids,
+                          uuid);
+
+    block->rssi[row] = (signed char)rssi;
+    block->panic_button[row] = (unsigned char)panic_button;
+    block->battery_voltage[row] = (unsigned char)battery_voltage;
+    block->initial_timestamp[row] = initial_timestamp;
+    block->final_timestamp[row] = final_timestamp;
+
+    block->number_of_rows++;
+
+    if(block->number_of_rows == TRACKING_ARCHIVE_ROWS_PER_BLOCK){
+        return flush_tracking_archive_block(writer);
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode close_tracking_archive_writer(TrackingArchiveWriter *writer){
+
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    if(NULL == writer->file){
+        return E_OPEN_FILE;
+    }
+
+    ret_val = flush_tracking_archive_block(writer);
+
+    if(0 != fclose(writer->file)){
+        ret_val = E_OPEN_FILE;
+    }
+    writer->file = NULL;
+
+    free_tracking_archive_writer(writer);
+
+    return ret_val;
+}
+
+ErrorCode open_tracking_archive_reader(TrackingArchiveReader *reader,
+                                       char *filename){
+
+    char magic[TRACKING_ARCHIVE_MAGIC_LENGTH];
+
+    memset(reader, 0, sizeof(TrackingArchiveReader));
+
+    reader->block = malloc(sizeof(TrackingArchiveBlock));
+    reader->read_buffer = malloc(TRACKING_ARCHIVE_MAXIMUM_BLOCK_LENGTH);
+
+    if(NULL == reader->block || NULL == reader->read_buffer){
+        zlog_error(category_debug, "tracking archive reader malloc failed");
+        close_tracking_archive_reader(reader);
+        return E_MALLOC;
+    }
+
+    reader->block->number_of_rows = 0;
+
+    reader->file = fopen(filename, "rb");
+    if(NULL == reader->file){
+        zlog_error(category_debug, "cannot open filepath %s", filename);
+        close_tracking_archive_reader(reader);
+        return E_OPEN_FILE;
+    }
+
+    if(fread(magic, 1, sizeof(magic), reader->file) != sizeof(magic) ||
+       memcmp(magic, TRACKING_ARCHIVE_MAGIC, sizeof(magic)) != 0){
+
+        zlog_error(category_debug, "%s is not a tracking archive", filename);
+        close_tracking_archive_reader(reader);
+        return E_OPEN_FILE;
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+ErrorCode read_tracking_archive_block(TrackingArchiveReader *reader){
+
+    TrackingArchiveBlock *block = reader->block;
+    unsigned char length_buffer[4];
+    unsigned char *current = NULL;
+    unsigned char *end = NULL;
+    unsigned int block_len = 0;
+    unsigned int number_of_rows = 0;
+    long long delta = 0;
+    int i;
+
+    block->number_of_rows = 0;
+
+    if(fread(length_buffer, 1, sizeof(length_buffer), reader->file) != 
+       sizeof(length_buffer)){
+        /* End of the archive file */
+        return WORK_SUCCESSFULLY;
+    }
+
+    get_uint32(length_buffer, length_buffer + 4, &block_len);
+
+    if(block_len > TRACKING_ARCHIVE_MAXIMUM_BLOCK_LENGTH ||
+       fread(reader->read_buffer, 1, block_len, reader->file) != block_len){
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    current = reader->read_buffer;
+    end = reader->read_buffer + block_len;
+
+    current = get_uint32(current, end, &number_of_rows);
+    if(NULL == current || 0 == number_of_rows ||
+       number_of_rows > TRACKING_ARCHIVE_ROWS_PER_BLOCK){
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    current = get_dictionary(current, end,
+                             (char *)block->mac_address,
+                             LENGTH_OF_MAC_ADDRESS,
+                             &block->number_of_mac_addresses);
+    current = get_dictionary(current, end,
+                             (char *)block->uuid,
+                             LENGTH_OF_UUID,
+                             &block->number_of_uuids);
+
+    if(NULL == current || 
+       (size_t)(end - current) < (size_t)number_of_rows * 7){
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    for(i = 0; i < (int)number_of_rows; i++){
+        block->mac_address_id[i] = 
+            (unsigned short)(current[0] | (current[1] << 8));
+        current += 2;
+        if(block->mac_address_id[i] >= block->number_of_mac_addresses){
+            return E_API_PROTOCOL_FORMAT;
+        }
+    }
+    for(i = 0; i < (int)number_of_rows; i++){
+        block->uuid_id[i] = (unsigned short)(current[0] | (current[1] << 8));
+        current += 2;
+        if(block->uuid_id[i] >= block->number_of_uuids){
+            return E_API_PROTOCOL_FORMAT;
+        }
+    }
+
+    memcpy(block->rssi, current, number_of_rows);
+    current += number_of_rows;
+    memcpy(block->panic_button, current, number_of_rows);
+    current += number_of_rows;
+    memcpy(block->battery_voltage, current, number_of_rows);
+    current += number_of_rows;
+
+    current = get_varint(current, end, &block->final_timestamp[0]);
+    for(i = 1; i < (int)number_of_rows; i++){
+        current = get_varint(current, end, &delta);
+        if(NULL == current){
+            return E_API_PROTOCOL_FORMAT;
+        }
+        block->final_timestamp[i] = block->final_timestamp[i - 1] + delta;
+    }
+    for(i = 0; i < (int)number_of_rows; i++){
+        current = get_varint(current, end, &delta);
+        if(NULL == current){
+            return E_API_PROTOCOL_FORMAT;
+        }
+        block->initial_timestamp[i] = block->final_timestamp[i] - delta;
+    }
+
+    block->number_of_rows = number_of_rows;
+
+    return WORK_SUCCESSFULLY;
+}
+
+void close_tracking_archive_reader(TrackingArchiveReader *reader){
+
+    if(NULL != reader->file){
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+    if(NULL != reader->block){
+        free(reader->block);
+        reader->block = NULL;
+    }
+    if(NULL != reader->read_buffer){
+        free(reader->read_buffer);
+        reader->read_buffer = NULL;
+    }
+}
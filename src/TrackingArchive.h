@@ -0,0 +1,289 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     TrackingArchive.h
+
+  File Description:
+
+     This file contains the header of function declarations and variable used
+     in TrackingArchive.c
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+#ifndef TRACKING_ARCHIVE_H
+#define TRACKING_ARCHIVE_H
+
+#include "BeDIS.h"
+
+/* strtoll is not available before Visual Studio 2013 */
+#if defined(_MSC_VER) && _MSC_VER < 1800
+#define strtoll _strtoi64
+#endif
+
+/* The directory under the server installation path to store archive files */
+#define TRACKING_ARCHIVE_DIRECTORY "archive"
+
+/* The file name extension of archive files */
+#define TRACKING_ARCHIVE_FILE_EXTENSION ".bta"
+
+/* The magic bytes at the beginning of each archive file */
+#define TRACKING_ARCHIVE_MAGIC "BOTTRKA1"
+
+/* Length in number of bytes of TRACKING_ARCHIVE_MAGIC */
+#define TRACKING_ARCHIVE_MAGIC_LENGTH 8
+
+/* Maximum number of rows in an archive block. Each block carries its own 
+dictionaries, so it can be decoded independently. */
+#define TRACKING_ARCHIVE_ROWS_PER_BLOCK 16384
+
+/* Number of hash slots of the dictionaries used by the writer. It must be a 
+power of two larger than TRACKING_ARCHIVE_ROWS_PER_BLOCK. */
+#define TRACKING_ARCHIVE_DICTIONARY_SLOTS 32768
+
+/* Maximum length in number of bytes of an encoded variable-length integer */
+#define MAXIMUM_VARINT_LENGTH 10
+
+/* Maximum length in number of bytes of an encoded archive block. Each row 
+takes at most one dictionary entry of each kind, two dictionary ids, three 
+bytes of RSSI, panic button and battery voltage, and two timestamps. */
+#define TRACKING_ARCHIVE_MAXIMUM_BLOCK_LENGTH \
+    (16 + TRACKING_ARCHIVE_ROWS_PER_BLOCK * \
+    (1 + LENGTH_OF_MAC_ADDRESS + 1 + LENGTH_OF_UUID + 2 + 2 + 3 + \
+    2 * MAXIMUM_VARINT_LENGTH))
+
+/* A block of archived tracking data in decoded column-oriented form. The 
+timestamps are in seconds since epoch. */
+typedef struct {
+
+    /* The number of rows in the block */
+    int number_of_rows;
+
+    /* The number of distinct MAC addresses and LBeacon UUIDs in the block */
+    int number_of_mac_addresses;
+    int number_of_uuids;
+
+    /* The dictionaries of MAC addresses and LBeacon UUIDs */
+    char mac_address[TRACKING_ARCHIVE_ROWS_PER_BLOCK][LENGTH_OF_MAC_ADDRESS];
+    char uuid[TRACKING_ARCHIVE_ROWS_PER_BLOCK][LENGTH_OF_UUID];
+
+    /* The columns of the block. mac_address_id and uuid_id index into the 
+       dictionaries. */
+    unsigned short mac_address_id[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+    unsigned short uuid_id[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+    signed char rssi[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+    unsigned char panic_button[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+    unsigned char battery_voltage[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+    long long initial_timestamp[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+    long long final_timestamp[TRACKING_ARCHIVE_ROWS_PER_BLOCK];
+
+} TrackingArchiveBlock;
+
+typedef struct {
+
+    FILE *file;
+
+    /* The block being filled */
+    TrackingArchiveBlock *block;
+
+    /* The hash slots of the dictionaries. Each slot stores the dictionary 
+       index plus one, and zero means the slot is empty. */
+    unsigned short *mac_address_slot;
+    unsigned short *uuid_slot;
+
+    /* The buffer to encode a block before writing it to the file */
+    unsigned char *encode_buffer;
+
+    /* The number of rows and bytes written to the file */
+    long long number_of_rows;
+    long long number_of_bytes;
+
+} TrackingArchiveWriter;
+
+typedef struct {
+
+    FILE *file;
+
+    /* The most recently decoded block */
+    TrackingArchiveBlock *block;
+
+    /* The buffer to read an encoded block from the file */
+    unsigned char *read_buffer;
+
+} TrackingArchiveReader;
+
+/*
+  open_tracking_archive_writer:
+
+     This function creates an archive file and prepares the writer.
+
+  Parameters:
+
+     writer - The pointer to the archive writer
+
+     filename - The file path of the archive file
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the archive file cannot be created.
+                 E_MALLOC: the buffers of the writer cannot be allocated.
+
+ */
+
+ErrorCode open_tracking_archive_writer(TrackingArchiveWriter *writer,
+                                       char *filename);
+
+/*
+  append_tracking_archive_row:
+
+     This function appends one row of tracking data to the writer. The 
+     block is encoded and written to the file when it is full. Rows are 
+     expected in the order of final_timestamp to keep the deltas small.
+
+  Parameters:
+
+     writer - The pointer to the archive writer
+
+     mac_address - The MAC address of the object
+
+     uuid - The UUID of the LBeacon which scanned the object
+
+     rssi - The RSSI of the object
+
+     panic_button - The panic button status of the object
+
+     battery_voltage - The battery voltage of the object
+
+     initial_timestamp - The first time in seconds since epoch the object 
+                         was scanned
+
+     final_timestamp - The last time in seconds since epoch the object was 
+                       scanned
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: the MAC address or UUID is too long.
+                 E_OPEN_FILE: the block cannot be written to the file.
+
+ */
+
+ErrorCode append_tracking_archive_row(TrackingArchiveWriter *writer,
+                                      char *mac_address,
+                                      char *uuid,
+                                      int rssi,
+                                      int panic_button,
+                                      int battery_voltage,
+                                      long long initial_timestamp,
+                                      long long final_timestamp);
+
+/*
+  close_tracking_archive_writer:
+
+     This function writes the remaining rows, closes the archive file and 
+     releases the buffers of the writer.
+
+  Parameters:
+
+     writer - The pointer to the archive writer
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the last block cannot be written to the file.
+
+ */
+
+ErrorCode close_tracking_archive_writer(TrackingArchiveWriter *writer);
+
+/*
+  open_tracking_archive_reader:
+
+     This function opens an archive file and checks its magic bytes.
+
+  Parameters:
+
+     reader - The pointer to the archive reader
+
+     filename - The file path of the archive file
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_OPEN_FILE: the file cannot be opened or is not an archive.
+                 E_MALLOC: the buffers of the reader cannot be allocated.
+
+ */
+
+ErrorCode open_tracking_archive_reader(TrackingArchiveReader *reader,
+                                       char *filename);
+
+/*
+  read_tracking_archive_block:
+
+     This function reads the next block of the archive file and decodes it 
+     into reader->block. The columns of the block can then be scanned 
+     directly as arrays.
+
+  Parameters:
+
+     reader - The pointer to the archive reader
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully. The number of rows of 
+                                    the block is zero at the end of the file.
+                 E_API_PROTOCOL_FORMAT: the block is malformed.
+
+ */
+
+ErrorCode read_tracking_archive_block(TrackingArchiveReader *reader);
+
+/*
+  close_tracking_archive_reader:
+
+     This function closes the archive file and releases the buffers of the 
+     reader.
+
+  Parameters:
+
+     reader - The pointer to the archive reader
+
+  Return value:
+
+     None
+
+ */
+
+void close_tracking_archive_reader(TrackingArchiveReader *reader);
+
+#endif
@@ -0,0 +1,665 @@
+/*
+  Copyright (c) 2016 Academia Sinica, Institute of Information Science
+
+  License:
+
+     GPL 3.0 : The content of this file is subject to the terms and conditions
+     defined in file 'COPYING.txt', which is part of this source code package.
+
+  Project Name:
+
+     BeDIS
+
+  File Name:
+
+     ProtocolCheck.c
+
+  File Description:
+
+     This file provides a test executable which encodes sample messages with
+     the codecs in ProtocolSchema.c and decodes them back, intact and after
+     random damage. It is built by "make protocheck" and is not part of the
+     server.
+
+  Version:
+
+     1.0, 20261018
+
+  Abstract:
+
+     BeDIS uses LBeacons to deliver 3D coordinates and textual descriptions of
+     their locations to users' devices. Basically, a LBeacon is an inexpensive,
+     Bluetooth Smart Ready device. The 3D coordinates and location description
+     of every LBeacon are retrieved from BeDIS (Building/environment Data and
+     Information System) and stored locally during deployment and maintenance
+     times. Once initialized, each LBeacon broadcasts its coordinates and
+     location description to Bluetooth enabled user devices within its coverage
+     area.
+
+  Authors:
+
+     Chun-Yu Lai   , chunyu1202@gmail.com
+ */
+
+
+#include "ProtocolSchema.h"
+
+/* Number of messages decoded by the protocol check */
+#define PROTOCOL_CHECK_CASES 100000
+
+/* Number of bytes of the buffer used to check the encoders refuse a message 
+larger than the buffer */
+#define PROTOCOL_CHECK_SMALL_BUFFER_LENGTH 16
+
+/* The digits inserted into a sample to make a field oversized */
+#define PROTOCOL_CHECK_OVERSIZED_DIGITS "99999999999"
+
+/* Number of items of each repeated part of the samples */
+#define NUMBER_OF_SAMPLE_LBEACONS 2
+#define NUMBER_OF_SAMPLE_OBJECT_GROUPS 2
+#define NUMBER_OF_SAMPLE_TRACKED_OBJECTS 3
+
+/* The functions to encode a sample and to decode it back */
+typedef struct {
+
+    ErrorCode (*encode)(ProtocolCursor *writer);
+
+    ErrorCode (*decode)(ProtocolCursor *cursor, 
+                        bool is_damaged, 
+                        int *number_of_failures);
+
+} ProtocolSample;
+
+/* The field taken beyond the end of a message, which is never stray */
+static char *protocol_empty_field = NULL;
+
+static PacketHeaderFields sample_packet_header = 
+    {"1", "4", PROTOCOL_API_VERSION_21};
+
+static GatewayHealthReportFields sample_gateway_health_report = 
+    {"192.168.0.1", "0"};
+
+static LBeaconHealthReportFields sample_lbeacon_health_report = 
+    {"00010018000000004760000000011234", "1571100000", "192.168.0.11", "0"};
+
+static GatewayRegistrationHeaderFields sample_gateway_registration_header = 
+    {"1"};
+
+static GatewayRegistrationItemFields sample_gateway_registration_item = 
+    {"192.168.0.1"};
+
+static LBeaconRegistrationHeaderFields sample_lbeacon_registration_header = 
+    {"2", "192.168.0.1"};
+
+static LBeaconRegistrationItemFields 
+    sample_lbeacon_registration_items[NUMBER_OF_SAMPLE_LBEACONS] = {
+    {"00010018000000004760000000011234", "1571100000", "192.168.0.11"},
+    {"00010018000000004761000000011235", "1571100001", "192.168.0.12"}
+};
+
+static TrackingDataHeaderFields sample_tracking_data_header = 
+    {"00010018000000004760000000011234", "1571100000", "192.168.0.11"};
+
+static ObjectGroupFields 
+    sample_object_groups[NUMBER_OF_SAMPLE_OBJECT_GROUPS] = {
+    {"0", "2"},
+    {"1", "1"}
+};
+
+static TrackedObjectFields 
+    sample_tracked_objects[NUMBER_OF_SAMPLE_TRACKED_OBJECTS] = {
+    {"c1:00:00:00:00:01", "1571099990", "1571099999", "-60", "0", "3.00"},
+    {"c1:00:00:00:00:02", "1571099991", "1571099999", "-72", "1", "2.95"},
+    {"c1:00:00:00:00:03", "1571099992", "1571099999", "-81", "0", "3.10"}
+};
+
+static unsigned int get_protocol_check_random(unsigned int *seed){
+
+    *seed = *seed * 1103515245 + 12345;
+
+    return (*seed >> 16) & 0x7fff;
+}
+
+static int is_protocol_field_stray(ProtocolCursor *cursor, char *field){
+
+    if(field == protocol_empty_field){
+        return 0;
+    }
+
+    if(field < cursor->begin || field > cursor->end){
+        return 1;
+    }
+
+    /* The field must end within the message */
+    if(field + strlen(field) > cursor->end){
+        return 1;
+    }
+
+    return 0;
+}
+
+/* A decoded field fails if it points out of the message, or differs from 
+   the sample when the sample is not damaged */
+#define PROTOCOL_CHECK_FIELD(name) \
+    if(is_protocol_field_stray(cursor, fields->name)){ \
+        number_of_failures++; \
+    }else if(false == is_damaged && \
+             0 != strcmp(expected->name, fields->name)){ \
+        number_of_failures++; \
+    }
+
+#define PROTOCOL_DEFINE_CHECKS(name, structure, FIELDS) \
+    static int check_##name(ProtocolCursor *cursor, \
+                            structure *expected, \
+                            structure *fields, \
+                            bool is_damaged){ \
+        int number_of_failures = 0; \
+        FIELDS(PROTOCOL_CHECK_FIELD) \
+        return number_of_failures; \
+    }
+
+PROTOCOL_MESSAGES(PROTOCOL_DEFINE_CHECKS)
+
+static ErrorCode encode_gateway_health_sample(ProtocolCursor *writer){
+
+    encode_packet_header(writer, &sample_packet_header);
+
+    return encode_gateway_health_report(writer, 
+                                        &sample_gateway_health_report);
+}
+
+static ErrorCode decode_gateway_health_sample(ProtocolCursor *cursor,
+                                              bool is_damaged,
+                                              int *number_of_failures){
+
+    PacketHeaderFields header;
+    GatewayHealthReportFields report;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    ret_val = decode_packet_header(cursor, &header);
+    *number_of_failures += check_packet_header(cursor, 
+                                               &sample_packet_header, 
+                                               &header, 
+                                               is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    ret_val = decode_gateway_health_report(cursor, &report);
+    *number_of_failures += 
+        check_gateway_health_report(cursor, 
+                                    &sample_gateway_health_report, 
+                                    &report, 
+                                    is_damaged);
+
+    return ret_val;
+}
+
+static ErrorCode encode_lbeacon_health_sample(ProtocolCursor *writer){
+
+    encode_packet_header(writer, &sample_packet_header);
+
+    return encode_lbeacon_health_report(writer, 
+                                        &sample_lbeacon_health_report);
+}
+
+static ErrorCode decode_lbeacon_health_sample(ProtocolCursor *cursor,
+                                              bool is_damaged,
+                                              int *number_of_failures){
+
+    PacketHeaderFields header;
+    LBeaconHealthReportFields report;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    ret_val = decode_packet_header(cursor, &header);
+    *number_of_failures += check_packet_header(cursor, 
+                                               &sample_packet_header, 
+                                               &header, 
+                                               is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    ret_val = decode_lbeacon_health_report(cursor, &report);
+    *number_of_failures += 
+        check_lbeacon_health_report(cursor, 
+                                    &sample_lbeacon_health_report, 
+                                    &report, 
+                                    is_damaged);
+
+    return ret_val;
+}
+
+static ErrorCode encode_gateway_registration_sample(ProtocolCursor *writer){
+
+    encode_gateway_registration_header(writer, 
+                                       &sample_gateway_registration_header);
+
+    return encode_gateway_registration_item(
+        writer, 
+        &sample_gateway_registration_item);
+}
+
+static ErrorCode decode_gateway_registration_sample(ProtocolCursor *cursor,
+                                                    bool is_damaged,
+                                                    int *number_of_failures){
+
+    GatewayRegistrationHeaderFields header;
+    GatewayRegistrationItemFields item;
+    int numbers = 0;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    ret_val = decode_gateway_registration_header(cursor, &header);
+    *number_of_failures += 
+        check_gateway_registration_header(cursor, 
+                                          &sample_gateway_registration_header,
+                                          &header, 
+                                          is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    ret_val = decode_protocol_count(cursor, 
+                                    header.number_of_gateways,
+                                    NUMBER_OF_GATEWAY_REGISTRATION_ITEM_FIELDS,
+                                    &numbers);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    while(numbers--){
+
+        ret_val = decode_gateway_registration_item(cursor, &item);
+        *number_of_failures += 
+            check_gateway_registration_item(cursor, 
+                                            &sample_gateway_registration_item,
+                                            &item, 
+                                            is_damaged);
+        if(WORK_SUCCESSFULLY != ret_val){
+            return ret_val;
+        }
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+static ErrorCode encode_lbeacon_registration_sample(ProtocolCursor *writer){
+
+    int i;
+
+    encode_packet_header(writer, &sample_packet_header);
+
+    encode_lbeacon_registration_header(writer, 
+                                       &sample_lbeacon_registration_header);
+
+    for(i = 0; i < NUMBER_OF_SAMPLE_LBEACONS; i++){
+        encode_lbeacon_registration_item(
+            writer, 
+            &sample_lbeacon_registration_items[i]);
+    }
+
+    return (true == writer->is_out_of_bounds) ? 
+           E_INPUT_PARAMETER : WORK_SUCCESSFULLY;
+}
+
+static ErrorCode decode_lbeacon_registration_sample(ProtocolCursor *cursor,
+                                                    bool is_damaged,
+                                                    int *number_of_failures){
+
+    PacketHeaderFields header;
+    LBeaconRegistrationHeaderFields registration_header;
+    LBeaconRegistrationItemFields item;
+    int numbers = 0;
+    int index = 0;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    ret_val = decode_packet_header(cursor, &header);
+    *number_of_failures += check_packet_header(cursor, 
+                                               &sample_packet_header, 
+                                               &header, 
+                                               is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    ret_val = decode_lbeacon_registration_header(cursor, &registration_header);
+    *number_of_failures += 
+        check_lbeacon_registration_header(cursor, 
+                                          &sample_lbeacon_registration_header,
+                                          &registration_header, 
+                                          is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    ret_val = decode_protocol_count(cursor, 
+                                    registration_header.number_of_lbeacons,
+                                    NUMBER_OF_LBEACON_REGISTRATION_ITEM_FIELDS,
+                                    &numbers);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    for(index = 0; index < numbers; index++){
+
+        ret_val = decode_lbeacon_registration_item(cursor, &item);
+        *number_of_failures += 
+            check_lbeacon_registration_item(
+                cursor, 
+                &sample_lbeacon_registration_items[
+                    index % NUMBER_OF_SAMPLE_LBEACONS],
+                &item, 
+                is_damaged);
+        if(WORK_SUCCESSFULLY != ret_val){
+            return ret_val;
+        }
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+static ErrorCode encode_tracking_data_sample(ProtocolCursor *writer){
+
+    const ProtocolVersionSchema *schema = NULL;
+    int group_index = 0;
+    int object_index = 0;
+    int numbers = 0;
+
+    schema = 
+        get_protocol_version_schema(
+            (float)atof(sample_packet_header.API_version));
+    if(NULL == schema){
+        return E_INPUT_PARAMETER;
+    }
+
+    encode_packet_header(writer, &sample_packet_header);
+
+    encode_tracking_data_header(writer, &sample_tracking_data_header);
+
+    for(group_index = 0; 
+        group_index < NUMBER_OF_SAMPLE_OBJECT_GROUPS; 
+        group_index++){
+
+        encode_object_group(writer, &sample_object_groups[group_index]);
+
+        numbers = atoi(sample_object_groups[group_index].number_of_objects);
+
+        while(numbers--){
+            schema->encode_tracked_object(
+                writer, 
+                &sample_tracked_objects[object_index]);
+            object_index++;
+        }
+    }
+
+    return (true == writer->is_out_of_bounds) ? 
+           E_INPUT_PARAMETER : WORK_SUCCESSFULLY;
+}
+
+static ErrorCode decode_tracking_data_sample(ProtocolCursor *cursor,
+                                             bool is_damaged,
+                                             int *number_of_failures){
+
+    PacketHeaderFields header;
+    TrackingDataHeaderFields tracking_data_header;
+    ObjectGroupFields object_group;
+    TrackedObjectFields tracked_object;
+    const ProtocolVersionSchema *schema = NULL;
+    int group_index = 0;
+    int object_index = 0;
+    int numbers = 0;
+    ErrorCode ret_val = WORK_SUCCESSFULLY;
+
+    ret_val = decode_packet_header(cursor, &header);
+    *number_of_failures += check_packet_header(cursor, 
+                                               &sample_packet_header, 
+                                               &header, 
+                                               is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    schema = get_protocol_version_schema((float)atof(header.API_version));
+    if(NULL == schema){
+        return E_API_PROTOCOL_FORMAT;
+    }
+
+    ret_val = decode_tracking_data_header(cursor, &tracking_data_header);
+    *number_of_failures += 
+        check_tracking_data_header(cursor, 
+                                   &sample_tracking_data_header, 
+                                   &tracking_data_header, 
+                                   is_damaged);
+    if(WORK_SUCCESSFULLY != ret_val){
+        return ret_val;
+    }
+
+    for(group_index = 0; 
+        group_index < NUMBER_OF_SAMPLE_OBJECT_GROUPS; 
+        group_index++){
+
+        ret_val = decode_object_group(cursor, &object_group);
+        *number_of_failures += 
+            check_object_group(cursor, 
+                               &sample_object_groups[group_index], 
+                               &object_group, 
+                               is_damaged);
+        if(WORK_SUCCESSFULLY != ret_val){
+            return ret_val;
+        }
+
+        ret_val = 
+            decode_protocol_count(cursor, 
+                                  object_group.number_of_objects,
+                                  schema->number_of_tracked_object_fields,
+                                  &numbers);
+        if(WORK_SUCCESSFULLY != ret_val){
+            return ret_val;
+        }
+
+        while(numbers--){
+
+            ret_val = schema->decode_tracked_object(cursor, &tracked_object);
+            *number_of_failures += 
+                check_tracked_object_v21(
+                    cursor, 
+                    &sample_tracked_objects[
+                        object_index % NUMBER_OF_SAMPLE_TRACKED_OBJECTS],
+                    &tracked_object, 
+                    is_damaged);
+            if(WORK_SUCCESSFULLY != ret_val){
+                return ret_val;
+            }
+
+            object_index++;
+        }
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+static const ProtocolSample protocol_samples[] = {
+    {encode_gateway_health_sample, decode_gateway_health_sample},
+    {encode_lbeacon_health_sample, decode_lbeacon_health_sample},
+    {encode_gateway_registration_sample, decode_gateway_registration_sample},
+    {encode_lbeacon_registration_sample, decode_lbeacon_registration_sample},
+    {encode_tracking_data_sample, decode_tracking_data_sample}
+};
+
+#define NUMBER_OF_PROTOCOL_SAMPLES \
+    ((int)(sizeof(protocol_samples) / sizeof(protocol_samples[0])))
+
+static void damage_protocol_sample(char *buf, 
+                                   size_t buf_len, 
+                                   unsigned int *seed){
+
+    size_t message_len = strlen(buf);
+    size_t position = 0;
+    size_t digits_len = strlen(PROTOCOL_CHECK_OVERSIZED_DIGITS);
+
+    if(0 == message_len){
+        return;
+    }
+
+    position = get_protocol_check_random(seed) % message_len;
+
+    switch(get_protocol_check_random(seed) % 5){
+
+        case 0:
+            /* Truncate the message */
+            buf[position] = '\0';
+            break;
+
+        case 1:
+            /* Remove a byte, which may be a delimiter */
+            memmove(&buf[position], 
+                    &buf[position + 1], 
+                    message_len - position);
+            break;
+
+        case 2:
+            /* Split a field with an extra delimiter */
+            buf[position] = DELIMITER_SEMICOLON[0];
+            break;
+
+        case 3:
+            /* Insert digits to make a field and possibly a number of items 
+               oversized */
+            if(message_len + digits_len < buf_len){
+                memmove(&buf[position + digits_len], 
+                        &buf[position], 
+                        message_len - position + 1);
+                memcpy(&buf[position], 
+                       PROTOCOL_CHECK_OVERSIZED_DIGITS, 
+                       digits_len);
+            }
+            break;
+
+        default:
+            /* Replace a byte with a random byte other than the terminating 
+               character */
+            buf[position] = (char)(1 + get_protocol_check_random(seed) % 255);
+            break;
+    }
+}
+
+/*
+  check_protocol_codecs:
+
+     This function encodes sample messages and decodes them back, then 
+     decodes the samples after random truncation, deletion and replacement 
+     of bytes. A failure is a field which differs after decoding a sample 
+     or points out of the buffer after decoding a damaged sample.
+
+  Parameters:
+
+     number_of_cases - Number of damaged samples to be decoded
+
+     number_of_rejected - The output number of damaged samples rejected by 
+                          the decoders
+
+     number_of_failures - The output number of failures
+
+  Return value:
+
+     ErrorCode - WORK_SUCCESSFULLY: work successfully.
+                 E_INPUT_PARAMETER: a sample does not fit in the buffer.
+
+ */
+
+static ErrorCode check_protocol_codecs(int number_of_cases,
+                                       int *number_of_rejected,
+                                       int *number_of_failures){
+
+    char buf[WIFI_MESSAGE_LENGTH];
+    ProtocolCursor cursor;
+    const ProtocolSample *sample = NULL;
+    unsigned int seed = 1;
+    int number_of_damages = 0;
+    int i;
+
+    *number_of_rejected = 0;
+    *number_of_failures = 0;
+
+    /* The codecs share one empty field for every field taken beyond the 
+       end of a message */
+    memset(buf, 0, sizeof(buf));
+    open_protocol_cursor(&cursor, buf);
+    protocol_empty_field = take_protocol_field(&cursor);
+
+    /* Every sample must be decoded back to its fields */
+    for(i = 0; i < NUMBER_OF_PROTOCOL_SAMPLES; i++){
+
+        open_protocol_writer(&cursor, buf, sizeof(buf));
+
+        if(WORK_SUCCESSFULLY != protocol_samples[i].encode(&cursor)){
+            return E_INPUT_PARAMETER;
+        }
+
+        open_protocol_cursor(&cursor, buf);
+
+        if(WORK_SUCCESSFULLY != 
+           protocol_samples[i].decode(&cursor, false, number_of_failures)){
+            (*number_of_failures)++;
+        }
+    }
+
+    /* The encoders must refuse a field with the delimiter and a message 
+       larger than the buffer */
+    open_protocol_writer(&cursor, buf, sizeof(buf));
+    put_protocol_field(&cursor, "1;2");
+    if(false == cursor.is_out_of_bounds || 0 != strlen(buf)){
+        (*number_of_failures)++;
+    }
+
+    open_protocol_writer(&cursor, buf, PROTOCOL_CHECK_SMALL_BUFFER_LENGTH);
+    if(WORK_SUCCESSFULLY == encode_tracking_data_sample(&cursor) ||
+       strlen(buf) >= PROTOCOL_CHECK_SMALL_BUFFER_LENGTH){
+        (*number_of_failures)++;
+    }
+
+    /* No field of a damaged sample may point out of the message */
+    for(i = 0; i < number_of_cases; i++){
+
+        sample = &protocol_samples[i % NUMBER_OF_PROTOCOL_SAMPLES];
+
+        open_protocol_writer(&cursor, buf, sizeof(buf));
+        sample->encode(&cursor);
+
+        number_of_damages = 1 + get_protocol_check_random(&seed) % 3;
+        while(number_of_damages--){
+            damage_protocol_sample(buf, sizeof(buf), &seed);
+        }
+
+        open_protocol_cursor(&cursor, buf);
+
+        if(WORK_SUCCESSFULLY != 
+           sample->decode(&cursor, true, number_of_failures)){
+            (*number_of_rejected)++;
+        }
+    }
+
+    return WORK_SUCCESSFULLY;
+}
+
+int main(){
+
+    int number_of_rejected = 0;
+    int number_of_failures = 0;
+
+    if(WORK_SUCCESSFULLY != check_protocol_codecs(PROTOCOL_CHECK_CASES, 
+                                                  &number_of_rejected,
+                                                  &number_of_failures)){
+
+        printf("protocol check failed: a sample does not fit in the " \
+               "buffer\n");
+        return 1;
+    }
+
+    printf("protocol_cases=%d;protocol_rejected=%d;protocol_failures=%d;\n",
+           PROTOCOL_CHECK_CASES,
+           number_of_rejected,
+           number_of_failures);
+
+    return (0 == number_of_failures) ? 0 : 1;
+}